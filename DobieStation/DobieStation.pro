@@ -20,6 +20,7 @@ SOURCES += ../src/qt/main.cpp \
     ../src/core/errors.cpp \
     ../src/core/ee/emotion.cpp \
     ../src/core/emulator.cpp \
+    ../src/core/emulatorpool.cpp \
     ../src/core/ee/emotioninterpreter.cpp \
     ../src/core/ee/cop0.cpp \
     ../src/core/ee/cop1.cpp \
@@ -39,7 +40,11 @@ SOURCES += ../src/qt/main.cpp \
     ../src/core/iop/iop.cpp \
     ../src/core/iop/iop_cop0.cpp \
     ../src/core/iop/iop_interpreter.cpp \
+    ../src/core/profiler.cpp \
     ../src/core/sif.cpp \
+    ../src/core/statehash.cpp \
+    ../src/core/threadtopology.cpp \
+    ../src/core/trace.cpp \
     ../src/core/iop/iop_dma.cpp \
     ../src/core/ee/timers.cpp \
     ../src/core/iop/iop_timers.cpp \
@@ -52,6 +57,7 @@ SOURCES += ../src/qt/main.cpp \
     ../src/core/iop/spu.cpp \
     ../src/qt/emuthread.cpp \
     ../src/core/tests/iop/alu.cpp \
+    ../src/core/tests/testresults.cpp \
     ../src/core/ee/vif.cpp \
     ../src/core/ee/ipu/ipu.cpp \
     ../src/core/ee/ipu/vlc_table.cpp \
@@ -70,6 +76,8 @@ SOURCES += ../src/qt/main.cpp \
     ../src/core/ee/vu_interpreter.cpp \
     ../src/core/ee/vu_disasm.cpp \
     ../src/core/gsmem.cpp \
+    ../src/core/guestmemory.cpp \
+    ../src/core/lockstep.cpp \
     ../src/core/serialize.cpp \
     ../src/core/iop/memcard.cpp \
     ../src/qt/settings.cpp
@@ -78,12 +86,14 @@ HEADERS += \
     ../src/core/errors.hpp \
     ../src/core/ee/emotion.hpp \
     ../src/core/emulator.hpp \
+    ../src/core/emulatorpool.hpp \
     ../src/core/ee/emotioninterpreter.hpp \
     ../src/core/ee/cop0.hpp \
     ../src/core/ee/cop1.hpp \
     ../src/core/ee/bios_hle.hpp \
     ../src/core/gs.hpp \
     ../src/core/circularFIFO.hpp \
+    ../src/core/segmentedFIFO.hpp \
     ../src/core/gsthread.hpp \
     ../src/core/gsregisters.hpp \
     ../src/core/ee/dmac.hpp \
@@ -95,7 +105,11 @@ HEADERS += \
     ../src/core/iop/iop.hpp \
     ../src/core/iop/iop_cop0.hpp \
     ../src/core/iop/iop_interpreter.hpp \
+    ../src/core/profiler.hpp \
     ../src/core/sif.hpp \
+    ../src/core/statehash.hpp \
+    ../src/core/threadtopology.hpp \
+    ../src/core/trace.hpp \
     ../src/core/iop/iop_dma.hpp \
     ../src/core/ee/timers.hpp \
     ../src/core/iop/iop_timers.hpp \
@@ -125,5 +139,11 @@ HEADERS += \
     ../src/core/ee/vu_interpreter.hpp \
     ../src/core/ee/vu_disasm.hpp \
     ../src/core/gsmem.hpp \
+    ../src/core/guestmemory.hpp \
+    ../src/core/lockstep.hpp \
+    ../src/core/tests/cputests.hpp \
+    ../src/core/tests/gstests.hpp \
+    ../src/core/tests/testresults.hpp \
+    ../src/core/writelog.hpp \
     ../src/core/iop/memcard.hpp \
     ../src/qt/settings.hpp
@@ -77,6 +77,26 @@ uint32_t Cop1::get_gpr(int index)
     return gpr[index].u;
 }
 
+uint32_t Cop1::get_acc()
+{
+    return accumulator.u;
+}
+
+uint32_t Cop1::get_control()
+{
+    uint32_t reg;
+    reg = control.su << 3;
+    reg |= control.so << 4;
+    reg |= control.sd << 5;
+    reg |= control.si << 6;
+    reg |= control.u << 14;
+    reg |= control.o << 15;
+    reg |= control.d << 16;
+    reg |= control.i << 17;
+    reg |= control.condition << 23;
+    return reg;
+}
+
 void Cop1::mtc(int index, uint32_t value)
 {
     printf("[FPU] MTC1: %d, $%08X\n", index, value);
@@ -90,18 +110,8 @@ uint32_t Cop1::cfc(int index)
         case 0:
             return 0x2E00;
         case 31:
-            uint32_t reg;
-            reg = control.su << 3;
-            reg |= control.so << 4;
-            reg |= control.sd << 5;
-            reg |= control.si << 6;
-            reg |= control.u << 14;
-            reg |= control.o << 15;
-            reg |= control.d << 16;
-            reg |= control.i << 17;
-            reg |= control.condition << 23;
             printf("[FPU] Read Control Flag %x\n", control.condition);
-            return reg;
+            return get_control();
         default:
             return 0;
     }
@@ -41,6 +41,8 @@ class Cop1
         bool get_condition();
 
         uint32_t get_gpr(int index);
+        uint32_t get_acc();
+        uint32_t get_control();
         void mtc(int index, uint32_t value);
         uint32_t cfc(int index);
         void ctc(int index, uint32_t value);
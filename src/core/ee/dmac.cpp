@@ -1,25 +1,12 @@
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include "dmac.hpp"
 
 #include "../emulator.hpp"
 #include "../errors.hpp"
 
-enum CHANNELS
-{
-    VIF0,
-    VIF1,
-    GIF,
-    IPU_FROM,
-    IPU_TO,
-    SIF0,
-    SIF1,
-    SIF2,
-    SPR_FROM,
-    SPR_TO,
-    MFIFO_EMPTY = 14
-};
-
 DMAC::DMAC(EmotionEngine* cpu, Emulator* e, GraphicsInterface* gif, ImageProcessingUnit* ipu, SubsystemInterface* sif,
            VectorInterface* vif0, VectorInterface* vif1) :
     RDRAM(nullptr), scratchpad(nullptr), cpu(cpu), e(e), gif(gif), ipu(ipu), sif(sif), vif0(vif0), vif1(vif1)
@@ -35,9 +22,12 @@ void DMAC::reset(uint8_t* RDRAM, uint8_t* scratchpad)
     control.master_enable = false;
     mfifo_empty_triggered = false;
     PCR = 0;
+    stalled_channels = 0;
+    memset(channel_stats, 0, sizeof(channel_stats));
 
     for (int i = 0; i < 15; i++)
     {
+        stall_reason[i] = DMA_STALL::NONE;
         channels[i].started = false;
         channels[i].control = 0;
         interrupt_stat.channel_mask[i] = false;
@@ -69,6 +59,7 @@ void DMAC::store128(uint32_t addr, uint128_t data)
     else
     {
         addr &= 0x01FFFFF0;
+        e->mark_dirty(REGION_RDRAM, addr);
         *(uint128_t*)&RDRAM[addr] = data;
     }
 }
@@ -81,6 +72,13 @@ void DMAC::run(int cycles)
     {
         if (channels[i].started)
         {
+            //Channels waiting on their destination stay out of the loop until the destination wakes them
+            if (stalled_channels & (1 << i))
+            {
+                channel_stats[i].stalled_cycles += cycles;
+                continue;
+            }
+            channel_stats[i].busy_cycles += cycles;
             switch (i)
             {
                 case VIF0:
@@ -156,6 +154,57 @@ bool DMAC::mfifo_handler(int index)
     return true;
 }
 
+/**
+Returns how many quadwords a channel can read before it has to check the MFIFO again.
+For the drain channel this is bounded by the end of the ring (RBOR + RBSR) and by the SPR_FROM write pointer,
+so that a whole contiguous span of the ring can be transferred without masking or comparing addresses per quad.
+**/
+uint32_t DMAC::mfifo_span(int index)
+{
+    uint32_t qwc = channels[index].quadword_count;
+    if (control.mem_drain_channel - 1 != index)
+        return qwc;
+
+    //REFE/REF/REFS read from outside of the ring
+    uint8_t id = (channels[index].control >> 28) & 0x7;
+    if (id == 0 || id == 3 || id == 4)
+        return qwc;
+
+    uint32_t addr = channels[index].address;
+    uint32_t to_wrap = ((RBOR + RBSR + 16) - addr) >> 4;
+    uint32_t to_empty = ((channels[SPR_FROM].address - addr) & RBSR) >> 4;
+    if (!to_empty)
+        to_empty = 1;
+    return std::min(qwc, std::min(to_wrap, to_empty));
+}
+
+//Any change to the ring or its write pointer may refill an empty MFIFO
+void DMAC::wake_mfifo_drain()
+{
+    for (int i = VIF1; i <= GIF; i++)
+    {
+        if ((stalled_channels & (1 << i)) && stall_reason[i] == DMA_STALL::MFIFO_EMPTY)
+            wake_channel(i);
+    }
+}
+
+void DMAC::stall_channel(int index, DMA_STALL reason)
+{
+    stalled_channels |= 1 << index;
+    stall_reason[index] = reason;
+    channel_stats[index].stalls[(int)reason]++;
+}
+
+void DMAC::wake_channel(int index)
+{
+    stalled_channels &= ~(1 << index);
+}
+
+DMA_ChannelStats DMAC::get_channel_stats(int index)
+{
+    return channel_stats[index];
+}
+
 void DMAC::transfer_end(int index)
 {
     printf("[DMAC] Transfer end: %d\n", index);
@@ -188,7 +237,10 @@ void DMAC::process_VIF0(int cycles)
         {
             //If FIFO is too full to hold an extra quad, stall
             if (!vif0->feed_DMA(fetch128(channels[VIF0].address)))
+            {
+                stall_channel(VIF0, DMA_STALL::VIF_FIFO_FULL);
                 return;
+            }
 
             advance_source_dma(VIF0);
         }
@@ -206,7 +258,10 @@ void DMAC::process_VIF0(int cycles)
                 {
                     //If FIFO is too full to hold tag, stall
                     if (!vif0->transfer_DMAtag(DMAtag))
+                    {
+                        stall_channel(VIF0, DMA_STALL::VIF_FIFO_FULL);
                         return;
+                    }
                 }
                 handle_source_chain(VIF0);
             }
@@ -219,25 +274,39 @@ void DMAC::process_VIF1(int cycles)
     while (cycles)
     {
         if (!mfifo_handler(VIF1))
+        {
+            stall_channel(VIF1, DMA_STALL::MFIFO_EMPTY);
             return;
-        cycles--;
+        }
         if (channels[VIF1].quadword_count)
         {
-            if (channels[VIF1].control & 0x1)
+            uint32_t span = std::min((uint32_t)cycles, mfifo_span(VIF1));
+            while (span--)
             {
-                if (!vif1->feed_DMA(fetch128(channels[VIF1].address)))
-                    return;
+                cycles--;
+                if (channels[VIF1].control & 0x1)
+                {
+                    if (!vif1->feed_DMA(fetch128(channels[VIF1].address)))
+                    {
+                        stall_channel(VIF1, DMA_STALL::VIF_FIFO_FULL);
+                        return;
+                    }
 
-                advance_source_dma(VIF1);
-            }
-            else
-            {
-                channels[VIF1].quadword_count--;
-                channels[VIF1].address += 16;
+                    advance_source_dma(VIF1);
+                }
+                else
+                {
+                    //Without a local to host transfer there is nothing to read, so memory is left alone
+                    uint128_t quad;
+                    if (vif1->read_DMA(quad))
+                        store128(channels[VIF1].address, quad);
+                    advance_dest_dma(VIF1);
+                }
             }
         }
         else
         {
+            cycles--;
             if (channels[VIF1].tag_end)
             {
                 transfer_end(VIF1);
@@ -249,7 +318,10 @@ void DMAC::process_VIF1(int cycles)
                 if (channels[VIF1].control & (1 << 6))
                 {
                     if (!vif1->transfer_DMAtag(DMAtag))
+                    {
+                        stall_channel(VIF1, DMA_STALL::VIF_FIFO_FULL);
                         return;
+                    }
                 }
                 handle_source_chain(VIF1);
             }
@@ -262,12 +334,24 @@ void DMAC::process_GIF(int cycles)
     while (cycles)
     {
         if (!mfifo_handler(GIF))
+        {
+            stall_channel(GIF, DMA_STALL::MFIFO_EMPTY);
             return;
-        cycles--;
+        }
         if (channels[GIF].quadword_count)
         {
-            if (gif->path_active(3))
+            uint32_t span = std::min((uint32_t)cycles, mfifo_span(GIF));
+            while (span--)
             {
+                cycles--;
+                if (!gif->path_active(3))
+                {
+                    //If another path owns the GIF, sleep until it hands PATH3 back.
+                    //GS SIGNAL stalls aren't arbitrated by the GIF, so those are still polled.
+                    if (!gif->path_available(3))
+                        stall_channel(GIF, DMA_STALL::GIF_PATH_BUSY);
+                    return;
+                }
                 gif->send_PATH3(fetch128(channels[GIF].address));
 
                 advance_source_dma(GIF);
@@ -275,6 +359,7 @@ void DMAC::process_GIF(int cycles)
         }
         else
         {
+            cycles--;
             if (channels[GIF].tag_end)
             {
                 transfer_end(GIF);
@@ -296,14 +381,15 @@ void DMAC::process_IPU_FROM(int cycles)
         cycles--;
         if (channels[IPU_FROM].quadword_count)
         {
-            if (ipu->can_read_FIFO())
+            if (!ipu->can_read_FIFO())
             {
-                uint128_t data = ipu->read_FIFO();
-                store128(channels[IPU_FROM].address, data);
-
-                channels[IPU_FROM].address += 16;
-                channels[IPU_FROM].quadword_count--;
+                stall_channel(IPU_FROM, DMA_STALL::IPU_FIFO);
+                return;
             }
+            uint128_t data = ipu->read_FIFO();
+            store128(channels[IPU_FROM].address, data);
+
+            advance_dest_dma(IPU_FROM);
         }
         else
         {
@@ -327,12 +413,14 @@ void DMAC::process_IPU_TO(int cycles)
         cycles--;
         if (channels[IPU_TO].quadword_count)
         {
-            if (ipu->can_write_FIFO())
+            if (!ipu->can_write_FIFO())
             {
-                ipu->write_FIFO(fetch128(channels[IPU_TO].address));
-
-                advance_source_dma(IPU_TO);
+                stall_channel(IPU_TO, DMA_STALL::IPU_FIFO);
+                return;
             }
+            ipu->write_FIFO(fetch128(channels[IPU_TO].address));
+
+            advance_source_dma(IPU_TO);
         }
         else
         {
@@ -365,7 +453,10 @@ void DMAC::process_SIF0(int cycles)
                 advance_dest_dma(SIF0);
             }
             else
+            {
+                stall_channel(SIF0, DMA_STALL::SIF_FIFO);
                 return;
+            }
         }
         else
         {
@@ -393,6 +484,11 @@ void DMAC::process_SIF0(int cycles)
                 channels[SIF0].control &= 0xFFFF;
                 channels[SIF0].control |= DMAtag & 0xFFFF0000;
             }
+            else
+            {
+                stall_channel(SIF0, DMA_STALL::SIF_FIFO);
+                return;
+            }
         }
     }
 }
@@ -411,7 +507,10 @@ void DMAC::process_SIF1(int cycles)
                 advance_source_dma(SIF1);
             }
             else
+            {
+                stall_channel(SIF1, DMA_STALL::SIF_FIFO);
                 return;
+            }
         }
         else
         {
@@ -455,7 +554,10 @@ void DMAC::process_SPR_FROM(int cycles)
             }
 
             if (control.mem_drain_channel != 0)
+            {
                 channels[SPR_FROM].address = RBOR | (channels[SPR_FROM].address & RBSR);
+                wake_mfifo_drain();
+            }
         }
         else
         {
@@ -535,6 +637,7 @@ void DMAC::process_SPR_TO(int cycles)
 void DMAC::advance_source_dma(int index)
 {
     int mode = (channels[index].control >> 2) & 0x3;
+    channel_stats[index].quadwords++;
 
     channels[index].address += 16;
     channels[index].quadword_count--;
@@ -555,6 +658,7 @@ void DMAC::advance_source_dma(int index)
 void DMAC::advance_dest_dma(int index)
 {
     int mode = (channels[index].control >> 2) & 0x3;
+    channel_stats[index].quadwords++;
 
     channels[index].address += 16;
     channels[index].quadword_count--;
@@ -705,6 +809,7 @@ void DMAC::start_DMA(int index)
             break;
     }
     channels[index].started = true;
+    wake_channel(index);
 }
 
 uint32_t DMAC::read_master_disable()
@@ -904,6 +1009,7 @@ void DMAC::write8(uint32_t address, uint8_t value)
             control.mem_drain_channel = (value >> 2) & 0x3;
             control.stall_source_channel = (value >> 4) & 0x3;
             control.stall_dest_channel = (value >> 6) & 0x3;
+            wake_mfifo_drain();
             break;
         default:
             printf("[DMAC] Unrecognized write8 to $%08X of $%02X\n", address, value);
@@ -955,7 +1061,7 @@ void DMAC::write16(uint32_t address, uint16_t value)
                 if (value & 0x100)
                 {
                     start_DMA(GIF);
-                    gif->request_PATH(3, false);
+                    gif->request_PATH(3);
                 }
                 else
                 {
@@ -1045,7 +1151,7 @@ void DMAC::write32(uint32_t address, uint32_t value)
                 if (value & 0x100)
                 {
                     start_DMA(GIF);
-                    gif->request_PATH(3, false);
+                    gif->request_PATH(3);
                 }
                 else
                 {
@@ -1196,6 +1302,7 @@ void DMAC::write32(uint32_t address, uint32_t value)
         case 0x1000D010:
             printf("[DMAC] SPR_FROM M_ADR: $%08X\n", value);
             channels[SPR_FROM].address = value & ~0xF;
+            wake_mfifo_drain();
             break;
         case 0x1000D020:
             printf("[DMAC] SPR_FROM QWC: $%08X\n", value);
@@ -1245,6 +1352,7 @@ void DMAC::write32(uint32_t address, uint32_t value)
             control.stall_source_channel = (value >> 4) & 0x3;
             control.stall_dest_channel = (value >> 6) & 0x3;
             control.release_cycle = (value >> 8) & 0x7;
+            wake_mfifo_drain();
             break;
         case 0x1000E010:
         case 0x1000E100:
@@ -1272,10 +1380,12 @@ void DMAC::write32(uint32_t address, uint32_t value)
         case 0x1000E040:
             printf("[DMAC] Write to RBSR: $%08X\n", value);
             RBSR = value;
+            wake_mfifo_drain();
             break;
         case 0x1000E050:
             printf("[DMAC] Write to RBOR: $%08X\n", value);
             RBOR = value;
+            wake_mfifo_drain();
             break;
         default:
             printf("[DMAC] Unrecognized write32 of $%08X to $%08X\n", value, address);
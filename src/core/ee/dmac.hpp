@@ -22,6 +22,27 @@ struct DMA_Channel
     bool started;
 };
 
+//Why a channel went to sleep
+enum class DMA_STALL
+{
+    NONE,
+    VIF_FIFO_FULL,
+    GIF_PATH_BUSY,
+    IPU_FIFO,
+    SIF_FIFO,
+    MFIFO_EMPTY,
+    COUNT
+};
+
+//Per-channel counters, in bus cycles
+struct DMA_ChannelStats
+{
+    uint64_t busy_cycles;
+    uint64_t stalled_cycles;
+    uint64_t quadwords;
+    uint64_t stalls[(int)DMA_STALL::COUNT];
+};
+
 //Regs
 struct D_CTRL
 {
@@ -54,6 +75,21 @@ class VectorInterface;
 
 class DMAC
 {
+    public:
+        enum CHANNELS
+        {
+            VIF0,
+            VIF1,
+            GIF,
+            IPU_FROM,
+            IPU_TO,
+            SIF0,
+            SIF1,
+            SIF2,
+            SPR_FROM,
+            SPR_TO,
+            MFIFO_EMPTY = 14
+        };
     private:
         uint8_t* RDRAM, *scratchpad;
         EmotionEngine* cpu;
@@ -73,6 +109,11 @@ class DMAC
 
         uint32_t master_disable;
 
+        //Channels waiting on their destination are skipped until the destination wakes them
+        uint16_t stalled_channels;
+        DMA_STALL stall_reason[15];
+        DMA_ChannelStats channel_stats[15];
+
         void process_VIF0(int cycles);
         void process_VIF1(int cycles);
         void process_GIF(int cycles);
@@ -87,6 +128,9 @@ class DMAC
         void advance_source_dma(int index);
         void advance_dest_dma(int index);
         bool mfifo_handler(int index);
+        uint32_t mfifo_span(int index);
+        void stall_channel(int index, DMA_STALL reason);
+        void wake_mfifo_drain();
         void transfer_end(int index);
         void int1_check();
 
@@ -98,6 +142,8 @@ class DMAC
         void reset(uint8_t* RDRAM, uint8_t* scratchpad);
         void run(int cycles);
         void start_DMA(int index);
+        void wake_channel(int index);
+        DMA_ChannelStats get_channel_stats(int index);
 
         uint32_t read_master_disable();
         void write_master_disable(uint32_t value);
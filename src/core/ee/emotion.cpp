@@ -1,5 +1,6 @@
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include "emotion.hpp"
 #include "emotiondisasm.hpp"
 #include "emotioninterpreter.hpp"
@@ -15,6 +16,10 @@
 EmotionEngine::EmotionEngine(Cop0* cp0, Cop1* fpu, Emulator* e, uint8_t* sp, VectorUnit* vu0, VectorUnit* vu1) :
     cp0(cp0), fpu(fpu), e(e), scratchpad(sp), vu0(vu0), vu1(vu1)
 {
+    write_log = nullptr;
+    trace = nullptr;
+    profiler = nullptr;
+    profile_countdown = 0;
     reset();
 }
 
@@ -125,7 +130,16 @@ int EmotionEngine::run(int cycles_to_run)
                 printf("[$%08X] $%08X - %s\n", PC, instruction, disasm.c_str());
                 //print_state();
             }
+            if (trace)
+                trace->instruction(PC, instruction);
+            if (profiler && --profile_countdown <= 0)
+            {
+                profile_countdown = profiler->get_interval(PROFILE_EE);
+                profiler->sample_mips(PROFILE_EE, PC, get_gpr<uint32_t>(31), get_gpr<uint32_t>(29));
+            }
             EmotionInterpreter::interpret(*this, instruction);
+            if (trace && trace->records_registers())
+                trace->ee_registers(gpr);
             PC += 4;
 
             if (branch_on)
@@ -188,6 +202,43 @@ void EmotionEngine::set_disassembly(bool dis)
     can_disassemble = dis;
 }
 
+//Stores are only logged while a log is set, which the lockstep harness does
+void EmotionEngine::set_write_log(WriteLog* log)
+{
+    write_log = log;
+}
+
+void EmotionEngine::set_trace(TraceStream* trace)
+{
+    this->trace = trace;
+}
+
+void EmotionEngine::set_profiler(Profiler* profiler)
+{
+    this->profiler = profiler;
+    profile_countdown = profiler ? profiler->get_interval(PROFILE_EE) : 0;
+}
+
+void EmotionEngine::get_state(EE_State& state)
+{
+    memcpy(state.gpr, gpr, sizeof(gpr));
+    state.LO = LO;
+    state.HI = HI;
+    state.LO1 = LO1;
+    state.HI1 = HI1;
+    state.SA = SA;
+    state.PC = PC;
+    state.new_PC = new_PC;
+    state.branch_on = branch_on;
+    for (int i = 0; i < 32; i++)
+    {
+        state.cop0[i] = cp0->mfc(i);
+        state.fpr[i] = fpu->get_gpr(i);
+    }
+    state.fpu_acc = fpu->get_acc();
+    state.fpu_control = fpu->get_control();
+}
+
 void EmotionEngine::clear_interlock()
 {
     e->clear_cop2_interlock();
@@ -302,6 +353,7 @@ void EmotionEngine::set_PC(uint32_t addr)
 
 void EmotionEngine::write8(uint32_t address, uint8_t value)
 {
+    log_write(address, 1, uint128_t::from_u32(value));
     if (address >= 0x70000000 && address < 0x70004000)
     {
         scratchpad[address & 0x3FFF] = value;
@@ -316,6 +368,7 @@ void EmotionEngine::write16(uint32_t address, uint16_t value)
 {
     if (address & 0x1)
         Errors::die("[EE] Write16 to invalid address $%08X: $%04X", address, value);
+    log_write(address, 2, uint128_t::from_u32(value));
     if (address >= 0x70000000 && address < 0x70004000)
     {
         *(uint16_t*)&scratchpad[address & 0x3FFE] = value;
@@ -330,6 +383,7 @@ void EmotionEngine::write32(uint32_t address, uint32_t value)
 {
     if (address & 0x3)
         Errors::die("[EE] Write32 to invalid address $%08X: $%08X", address, value);
+    log_write(address, 4, uint128_t::from_u32(value));
     if (address >= 0x70000000 && address < 0x70004000)
     {
         *(uint32_t*)&scratchpad[address & 0x3FFC] = value;
@@ -344,6 +398,7 @@ void EmotionEngine::write64(uint32_t address, uint64_t value)
 {
     if (address & 0x7)
         Errors::die("[EE] Write64 to invalid address $%08X: $%08X_%08X", address, value >> 32, value);
+    log_write(address, 8, uint128_t::from_u64(value));
     if (address >= 0x70000000 && address < 0x70004000)
     {
         *(uint64_t*)&scratchpad[address & 0x3FF8] = value;
@@ -356,6 +411,7 @@ void EmotionEngine::write64(uint32_t address, uint64_t value)
 
 void EmotionEngine::write128(uint32_t address, uint128_t value)
 {
+    log_write(address, 16, value);
     if (address >= 0x70000000 && address < 0x70004000)
     {
         *(uint128_t*)&scratchpad[address & 0x3FF0] = value;
@@ -6,8 +6,11 @@
 #include "cop1.hpp"
 
 #include "../int128.hpp"
+#include "../trace.hpp"
+#include "../writelog.hpp"
 
 class Emulator;
+class Profiler;
 class VectorUnit;
 
 //Handler used for Deci2Call (syscall 0x7C)
@@ -18,6 +21,18 @@ struct Deci2Handler
     uint32_t addr;
 };
 
+//Architectural state, as compared by the lockstep harness
+struct EE_State
+{
+    alignas(16) uint8_t gpr[32 * sizeof(uint64_t) * 2];
+    uint64_t LO, HI, LO1, HI1, SA;
+    uint32_t PC, new_PC;
+    bool branch_on;
+    uint32_t cop0[32];
+    uint32_t fpr[32];
+    uint32_t fpu_acc, fpu_control;
+};
+
 class EmotionEngine
 {
     private:
@@ -28,8 +43,8 @@ class EmotionEngine
         VectorUnit* vu0;
         VectorUnit* vu1;
 
-        //Each register is 128-bit
-        uint8_t gpr[32 * sizeof(uint64_t) * 2];
+        //Each register is 128-bit, aligned so that whole registers can be loaded and stored as vectors
+        alignas(16) uint8_t gpr[32 * sizeof(uint64_t) * 2];
         uint64_t LO, HI, LO1, HI1;
         uint32_t PC, new_PC;
         uint64_t SA;
@@ -44,9 +59,15 @@ class EmotionEngine
         Deci2Handler deci2handlers[128];
         int deci2size;
 
+        WriteLog* write_log;
+        TraceStream* trace;
+        Profiler* profiler;
+        int profile_countdown;
+
         uint32_t get_paddr(uint32_t vaddr);
         void handle_exception(uint32_t new_addr, uint8_t code);
         void deci2call(uint32_t func, uint32_t param);
+        void log_write(uint32_t address, int size, const uint128_t& value);
     public:
         EmotionEngine(Cop0* cp0, Cop1* fpu, Emulator* e, uint8_t* sp, VectorUnit* vu0, VectorUnit* vu1);
         static const char* REG(int id);
@@ -57,6 +78,10 @@ class EmotionEngine
         void unhalt();
         void print_state();
         void set_disassembly(bool dis);
+        void set_write_log(WriteLog* log);
+        void set_trace(TraceStream* trace);
+        void set_profiler(Profiler* profiler);
+        void get_state(EE_State& state);
 
         template <typename T> T get_gpr(int id, int offset = 0);
         template <typename T> T get_LO(int offset = 0);
@@ -159,6 +184,14 @@ inline void EmotionEngine::set_gpr(int id, T value, int offset)
         *(T*)&gpr[(id * sizeof(uint64_t) * 2) + (offset * sizeof(T))] = value;
 }
 
+inline void EmotionEngine::log_write(uint32_t address, int size, const uint128_t& value)
+{
+    if (write_log)
+        write_log->push_back({address, size, value});
+    if (trace && trace->records_writes())
+        trace->write(address, size, value);
+}
+
 inline void EmotionEngine::halt()
 {
     wait_for_IRQ = true;
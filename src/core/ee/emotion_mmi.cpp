@@ -171,12 +171,7 @@ void EmotionInterpreter::psllh(EmotionEngine &cpu, uint32_t instruction)
     uint32_t dest = (instruction >> 11) & 0x1F;
     uint8_t shift = (instruction >> 6) & 0xF;
 
-    for (int i = 0; i < 8; i++)
-    {
-        uint16_t halfword = cpu.get_gpr<uint16_t>(source, i);
-        halfword <<= shift;
-        cpu.set_gpr<uint16_t>(dest, halfword, i);
-    }
+    cpu.set_gpr<uint128_t>(dest, uint128_t::sll16(cpu.get_gpr<uint128_t>(source), shift));
 }
 
 /**
@@ -188,12 +183,7 @@ void EmotionInterpreter::psrlh(EmotionEngine &cpu, uint32_t instruction)
     uint32_t dest = (instruction >> 11) & 0x1F;
     uint8_t shift = (instruction >> 6) & 0xF;
 
-    for (int i = 0; i < 8; i++)
-    {
-        uint16_t halfword = cpu.get_gpr<uint16_t>(source, i);
-        halfword >>= shift;
-        cpu.set_gpr<uint16_t>(dest, halfword, i);
-    }
+    cpu.set_gpr<uint128_t>(dest, uint128_t::srl16(cpu.get_gpr<uint128_t>(source), shift));
 }
 
 /**
@@ -205,12 +195,7 @@ void EmotionInterpreter::psrah(EmotionEngine &cpu, uint32_t instruction)
     uint32_t dest = (instruction >> 11) & 0x1F;
     uint8_t shift = (instruction >> 6) & 0xF;
 
-    for (int i = 0; i < 8; i++)
-    {
-        int16_t halfword = cpu.get_gpr<int16_t>(source, i);
-        halfword >>= shift;
-        cpu.set_gpr<int16_t>(dest, halfword, i);
-    }
+    cpu.set_gpr<uint128_t>(dest, uint128_t::sra16(cpu.get_gpr<uint128_t>(source), shift));
 }
 
 /**
@@ -223,12 +208,7 @@ void EmotionInterpreter::psllw(EmotionEngine &cpu, uint32_t instruction)
     uint32_t dest = (instruction >> 11) & 0x1F;
     uint8_t shift = (instruction >> 6) & 0x1F;
 
-    for (int i = 0; i < 4; i++)
-    {
-        uint32_t word = cpu.get_gpr<uint32_t>(source, i);
-        word <<= shift;
-        cpu.set_gpr<uint32_t>(dest, word, i);
-    }
+    cpu.set_gpr<uint128_t>(dest, uint128_t::sll32(cpu.get_gpr<uint128_t>(source), shift));
 }
 
 /**
@@ -240,12 +220,7 @@ void EmotionInterpreter::psrlw(EmotionEngine &cpu, uint32_t instruction)
     uint32_t dest = (instruction >> 11) & 0x1F;
     uint8_t shift = (instruction >> 6) & 0x1F;
 
-    for (int i = 0; i < 4; i++)
-    {
-        uint32_t word = cpu.get_gpr<uint32_t>(source, i);
-        word >>= shift;
-        cpu.set_gpr<uint32_t>(dest, word, i);
-    }
+    cpu.set_gpr<uint128_t>(dest, uint128_t::srl32(cpu.get_gpr<uint128_t>(source), shift));
 }
 
 /**
@@ -257,12 +232,7 @@ void EmotionInterpreter::psraw(EmotionEngine &cpu, uint32_t instruction)
     uint32_t dest = (instruction >> 11) & 0x1F;
     uint8_t shift = (instruction >> 6) & 0x1F;
 
-    for (int i = 0; i < 4; i++)
-    {
-        int32_t word = cpu.get_gpr<int32_t>(source, i);
-        word >>= shift;
-        cpu.set_gpr<int32_t>(dest, word, i);
-    }
+    cpu.set_gpr<uint128_t>(dest, uint128_t::sra32(cpu.get_gpr<uint128_t>(source), shift));
 }
 
 void EmotionInterpreter::pmfhlfmt(EmotionEngine& cpu, uint32_t instruction)
@@ -599,17 +569,8 @@ void EmotionInterpreter::pcgtw(EmotionEngine &cpu, uint32_t instruction)
 
     uint128_t qw1 = cpu.get_gpr<uint128_t>(reg1);
     uint128_t qw2 = cpu.get_gpr<uint128_t>(reg2);
-    uint128_t dest_qw;
 
-    for (int i = 0; i < 4; i++)
-    {
-        if ((int32_t)qw1._u32[i] > (int32_t)qw2._u32[i])
-            dest_qw._u32[i] = 0xFFFFFFFF;
-        else
-            dest_qw._u32[i] = 0;
-    }
-
-    cpu.set_gpr<uint128_t>(dest, dest_qw);
+    cpu.set_gpr<uint128_t>(dest, uint128_t::cmpgt32(qw1, qw2));
 }
 
 /**
@@ -678,17 +639,8 @@ void EmotionInterpreter::pcgth(EmotionEngine &cpu, uint32_t instruction)
 
     uint128_t qw1 = cpu.get_gpr<uint128_t>(reg1);
     uint128_t qw2 = cpu.get_gpr<uint128_t>(reg2);
-    uint128_t dest_qw;
-
-    for (int i = 0; i < 8; i++)
-    {
-        if ((int16_t)qw1._u16[i] > (int16_t)qw2._u16[i])
-            dest_qw._u16[i] = 0xFFFF;
-        else
-            dest_qw._u16[i] = 0;
-    }
 
-    cpu.set_gpr<uint128_t>(dest, dest_qw);
+    cpu.set_gpr<uint128_t>(dest, uint128_t::cmpgt16(qw1, qw2));
 }
 
 /**
@@ -759,17 +711,8 @@ void EmotionInterpreter::pcgtb(EmotionEngine &cpu, uint32_t instruction)
 
     uint128_t qw1 = cpu.get_gpr<uint128_t>(reg1);
     uint128_t qw2 = cpu.get_gpr<uint128_t>(reg2);
-    uint128_t dest_qw;
 
-    for (int i = 0; i < 16; i++)
-    {
-        if ((int8_t)qw1._u8[i] > (int8_t)qw2._u8[i])
-            dest_qw._u8[i] = 0xFF;
-        else
-            dest_qw._u8[i] = 0;
-    }
-
-    cpu.set_gpr<uint128_t>(dest, dest_qw);
+    cpu.set_gpr<uint128_t>(dest, uint128_t::cmpgt8(qw1, qw2));
 }
 
 void EmotionInterpreter::pextlw(EmotionEngine &cpu, uint32_t instruction)
@@ -796,10 +739,7 @@ void EmotionInterpreter::ppacw(EmotionEngine &cpu, uint32_t instruction)
     uint128_t qw1 = cpu.get_gpr<uint128_t>(reg1);
     uint128_t qw2 = cpu.get_gpr<uint128_t>(reg2);
 
-    cpu.set_gpr<uint32_t>(dest, qw2._u64[0] & 0xFFFFFFFF, 0);
-    cpu.set_gpr<uint32_t>(dest, qw2._u64[1] & 0xFFFFFFFF, 1);
-    cpu.set_gpr<uint32_t>(dest, qw1._u64[0] & 0xFFFFFFFF, 2);
-    cpu.set_gpr<uint32_t>(dest, qw1._u64[1] & 0xFFFFFFFF, 3);
+    cpu.set_gpr<uint128_t>(dest, uint128_t::pack64to32(qw2, qw1));
 }
 
 void EmotionInterpreter::pextlh(EmotionEngine &cpu, uint32_t instruction)
@@ -827,11 +767,7 @@ void EmotionInterpreter::ppach(EmotionEngine &cpu, uint32_t instruction)
     uint128_t qw1 = cpu.get_gpr<uint128_t>(reg1);
     uint128_t qw2 = cpu.get_gpr<uint128_t>(reg2);
 
-    for (int i = 0; i < 4; i++)
-    {
-        cpu.set_gpr<uint16_t>(dest, qw1._u32[i] & 0xFFFF, i + 4);
-        cpu.set_gpr<uint16_t>(dest, qw2._u32[i] & 0xFFFF, i);
-    }
+    cpu.set_gpr<uint128_t>(dest, uint128_t::pack32to16(qw2, qw1));
 }
 
 /**
@@ -989,13 +925,7 @@ void EmotionInterpreter::ppacb(EmotionEngine &cpu, uint32_t instruction)
     uint128_t qw1 = cpu.get_gpr<uint128_t>(reg1);
     uint128_t qw2 = cpu.get_gpr<uint128_t>(reg2);
 
-    for (int i = 0; i < 8; i++)
-    {
-        uint8_t byte1 = qw1._u16[i] & 0xFF;
-        uint8_t byte2 = qw2._u16[i] & 0xFF;
-        cpu.set_gpr<uint8_t>(dest, byte1, i + 8);
-        cpu.set_gpr<uint8_t>(dest, byte2, i);
-    }
+    cpu.set_gpr<uint128_t>(dest, uint128_t::pack16to8(qw2, qw1));
 }
 
 /**
@@ -1136,17 +1066,8 @@ void EmotionInterpreter::pceqw(EmotionEngine &cpu, uint32_t instruction)
 
     uint128_t qw1 = cpu.get_gpr<uint128_t>(reg1);
     uint128_t qw2 = cpu.get_gpr<uint128_t>(reg2);
-    uint128_t dest_qw;
 
-    for (int i = 0; i < 4; i++)
-    {
-        if (qw1._u32[i] == qw2._u32[i])
-            dest_qw._u32[i] = 0xFFFFFFFF;
-        else
-            dest_qw._u32[i] = 0;
-    }
-
-    cpu.set_gpr<uint128_t>(dest, dest_qw);
+    cpu.set_gpr<uint128_t>(dest, uint128_t::cmpeq32(qw1, qw2));
 }
 
 /**
@@ -1202,17 +1123,8 @@ void EmotionInterpreter::pceqh(EmotionEngine &cpu, uint32_t instruction)
 
     uint128_t qw1 = cpu.get_gpr<uint128_t>(reg1);
     uint128_t qw2 = cpu.get_gpr<uint128_t>(reg2);
-    uint128_t dest_qw;
 
-    for (int i = 0; i < 8; i++)
-    {
-        if (qw1._u16[i] == qw2._u16[i])
-            dest_qw._u16[i] = 0xFFFF;
-        else
-            dest_qw._u16[i] = 0;
-    }
-
-    cpu.set_gpr<uint128_t>(dest, dest_qw);
+    cpu.set_gpr<uint128_t>(dest, uint128_t::cmpeq16(qw1, qw2));
 }
 
 /**
@@ -1310,17 +1222,8 @@ void EmotionInterpreter::pceqb(EmotionEngine &cpu, uint32_t instruction)
 
     uint128_t qw1 = cpu.get_gpr<uint128_t>(reg1);
     uint128_t qw2 = cpu.get_gpr<uint128_t>(reg2);
-    uint128_t dest_qw;
-
-    for (int i = 0; i < 16; i++)
-    {
-        if (qw1._u8[i] == qw2._u8[i])
-            dest_qw._u8[i] = 0xFF;
-        else
-            dest_qw._u8[i] = 0;
-    }
 
-    cpu.set_gpr<uint128_t>(dest, dest_qw);
+    cpu.set_gpr<uint128_t>(dest, uint128_t::cmpeq8(qw1, qw2));
 }
 
 void EmotionInterpreter::pextuw(EmotionEngine &cpu, uint32_t instruction)
@@ -1834,8 +1737,7 @@ void EmotionInterpreter::pand(EmotionEngine &cpu, uint32_t instruction)
     uint64_t op2 = (instruction >> 16) & 0x1F;
     uint64_t dest = (instruction >> 11) & 0x1F;
 
-    cpu.set_gpr<uint64_t>(dest, cpu.get_gpr<uint64_t>(op1) & cpu.get_gpr<uint64_t>(op2));
-    cpu.set_gpr<uint64_t>(dest, cpu.get_gpr<uint64_t>(op1, 1) & cpu.get_gpr<uint64_t>(op2, 1), 1);
+    cpu.set_gpr<uint128_t>(dest, cpu.get_gpr<uint128_t>(op1) & cpu.get_gpr<uint128_t>(op2));
 }
 
 void EmotionInterpreter::pxor(EmotionEngine &cpu, uint32_t instruction)
@@ -1844,8 +1746,7 @@ void EmotionInterpreter::pxor(EmotionEngine &cpu, uint32_t instruction)
     uint64_t op2 = (instruction >> 16) & 0x1F;
     uint64_t dest = (instruction >> 11) & 0x1F;
 
-    cpu.set_gpr<uint64_t>(dest, cpu.get_gpr<uint64_t>(op1) ^ cpu.get_gpr<uint64_t>(op2));
-    cpu.set_gpr<uint64_t>(dest, cpu.get_gpr<uint64_t>(op1, 1) ^ cpu.get_gpr<uint64_t>(op2, 1), 1);
+    cpu.set_gpr<uint128_t>(dest, cpu.get_gpr<uint128_t>(op1) ^ cpu.get_gpr<uint128_t>(op2));
 }
 
 /**
@@ -2456,8 +2357,7 @@ void EmotionInterpreter::por(EmotionEngine &cpu, uint32_t instruction)
     uint64_t op2 = (instruction >> 16) & 0x1F;
     uint64_t dest = (instruction >> 11) & 0x1F;
 
-    cpu.set_gpr<uint64_t>(dest, cpu.get_gpr<uint64_t>(op1) | cpu.get_gpr<uint64_t>(op2));
-    cpu.set_gpr<uint64_t>(dest, cpu.get_gpr<uint64_t>(op1, 1) | cpu.get_gpr<uint64_t>(op2, 1), 1);
+    cpu.set_gpr<uint128_t>(dest, cpu.get_gpr<uint128_t>(op1) | cpu.get_gpr<uint128_t>(op2));
 }
 
 void EmotionInterpreter::pnor(EmotionEngine &cpu, uint32_t instruction)
@@ -2466,8 +2366,7 @@ void EmotionInterpreter::pnor(EmotionEngine &cpu, uint32_t instruction)
     uint64_t op2 = (instruction >> 16) & 0x1F;
     uint64_t dest = (instruction >> 11) & 0x1F;
 
-    cpu.set_gpr<uint64_t>(dest, ~(cpu.get_gpr<uint64_t>(op1) | cpu.get_gpr<uint64_t>(op2)));
-    cpu.set_gpr<uint64_t>(dest, ~(cpu.get_gpr<uint64_t>(op1, 1) | cpu.get_gpr<uint64_t>(op2, 1)), 1);
+    cpu.set_gpr<uint128_t>(dest, ~(cpu.get_gpr<uint128_t>(op1) | cpu.get_gpr<uint128_t>(op2)));
 }
 
 /**
@@ -2,8 +2,11 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
 #include "ipu.hpp"
+#include "../dmac.hpp"
 #include "../intc.hpp"
+#include "../../emulator.hpp"
 #include "../../errors.hpp"
 
 #define printf(fmt, ...)(0)
@@ -18,6 +21,10 @@
   * https://github.com/jpd002/Play--Framework/blob/master/src/idct/IEEE1180.cpp (IDCT transformation)
   */
 
+//Shared by every IPU in the process, built once by the first one constructed
+unsigned int ImageProcessingUnit::crcb_map[0x100];
+double ImageProcessingUnit::IDCT_table[8][8];
+
 uint32_t ImageProcessingUnit::inverse_scan_zigzag[0x40] =
 {
     0,	1,	5,	6,	14,	15,	27,	28,
@@ -58,8 +65,16 @@ uint32_t ImageProcessingUnit::quantizer_nonlinear[0x20] =
     56,		64,		72,		80,		88,		96,		104,	112,
 };
 
-ImageProcessingUnit::ImageProcessingUnit(INTC* intc) : intc(intc)
+ImageProcessingUnit::ImageProcessingUnit(Emulator* e, INTC* intc, DMAC* dmac) : e(e), intc(intc), dmac(dmac)
+{
+    static std::once_flag tables_ready;
+    std::call_once(tables_ready, prepare_tables);
+}
+
+void ImageProcessingUnit::prepare_tables()
 {
+    prepare_IDCT();
+
     //Generate CrCb->RGB conversion map
     for (unsigned int i = 0; i < 0x40; i += 0x8)
     {
@@ -81,7 +96,6 @@ void ImageProcessingUnit::reset()
     VDEC_table = nullptr;
     in_FIFO.reset();
     out_FIFO.reset();
-    prepare_IDCT();
 
     ctrl.error_code = false;
     ctrl.start_code = false;
@@ -97,6 +111,21 @@ void ImageProcessingUnit::reset()
 }
 
 void ImageProcessingUnit::run()
+{
+    run_command();
+
+    //Wake the IPU DMA channels if they went to sleep on an empty output FIFO or a full input FIFO
+    if (can_read_FIFO())
+        dmac->wake_channel(DMAC::IPU_FROM);
+    if (can_write_FIFO())
+        dmac->wake_channel(DMAC::IPU_TO);
+
+    //Only a new command or a reset can give the IPU more work
+    if (!ctrl.busy)
+        e->sleep_unit(UNIT_IPU);
+}
+
+void ImageProcessingUnit::run_command()
 {
     if (ctrl.busy)
     {
@@ -1008,6 +1037,7 @@ uint64_t ImageProcessingUnit::read_top()
 void ImageProcessingUnit::write_command(uint32_t value)
 {
     printf("[IPU] Write command: $%08X\n", value);
+    e->wake_unit(UNIT_IPU);
     if (!ctrl.busy)
     {
         ctrl.busy = true;
@@ -1093,6 +1123,7 @@ void ImageProcessingUnit::write_control(uint32_t value)
     ctrl.picture_type = (value >> 24) & 0x7;
     if (value & (1 << 30))
     {
+        e->wake_unit(UNIT_IPU);
         ctrl.busy = false;
         command_decoding = false;
         command = 0;
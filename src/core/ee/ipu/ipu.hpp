@@ -138,12 +138,16 @@ struct CSC_Command
     int block_index;
 };
 
+class DMAC;
+class Emulator;
 class INTC;
 
 class ImageProcessingUnit
 {
     private:
+        Emulator* e;
         INTC* intc;
+        DMAC* dmac;
         DCT_Coeff_Table0 dct_coeff0;
         DCT_Coeff_Table1 dct_coeff1;
         DCT_Coeff* dct_coeff;
@@ -162,7 +166,7 @@ class ImageProcessingUnit
         uint16_t VQCLUT[16];
         uint32_t TH0, TH1;
 
-        unsigned int crcb_map[0x100];
+        static unsigned int crcb_map[0x100];
 
         static uint32_t inverse_scan_zigzag[0x40];
         static uint32_t inverse_scan_alternate[0x40];
@@ -182,7 +186,7 @@ class ImageProcessingUnit
         VDEC_STATE vdec_state, fdec_state;
         CSC_Command csc;
 
-        double IDCT_table[8][8];
+        static double IDCT_table[8][8];
 
         void finish_command();
 
@@ -191,7 +195,8 @@ class ImageProcessingUnit
         bool process_BDEC();
         void inverse_scan(int16_t* block);
         void dequantize(int16_t* block);
-        void prepare_IDCT();
+        static void prepare_tables();
+        static void prepare_IDCT();
         void perform_IDCT(int16_t* pUV, int16_t* pXY);
         bool BDEC_read_coeffs();
         bool BDEC_read_diff();
@@ -199,8 +204,10 @@ class ImageProcessingUnit
         void process_VDEC();
         void process_FDEC();
         bool process_CSC();
+
+        void run_command();
     public:
-        ImageProcessingUnit(INTC* intc);
+        ImageProcessingUnit(Emulator* e, INTC* intc, DMAC* dmac);
 
         void reset();
         void run();
@@ -16,7 +16,7 @@ bool IPU_FIFO::get_bits(uint32_t &data, int bits)
     if (bit_cache_dirty)
     {
         std::queue<uint128_t> temp_fifo = f;
-        uint8_t temp[32];
+        alignas(16) uint8_t temp[32];
         *(uint128_t*)&temp[0] = temp_fifo.front();
         if (temp_fifo.size() > 1)
         {
@@ -5,21 +5,25 @@
 #include <cstring>
 #include "vu_disasm.hpp"
 #include "vif.hpp"
+#include "dmac.hpp"
 
+#include "../emulator.hpp"
 #include "../gif.hpp"
 #include "../errors.hpp"
 
 #define printf(fmt, ...)(0)
 
-VectorInterface::VectorInterface(GraphicsInterface* gif, VectorUnit* vu, INTC* intc, int id) : gif(gif), vu(vu), intc(intc), id(id)
+VectorInterface::VectorInterface(Emulator* e, GraphicsInterface* gif, VectorUnit* vu, INTC* intc, DMAC* dmac, int id) :
+    e(e), gif(gif), vu(vu), intc(intc), dmac(dmac), id(id)
 {
 
 }
 
 void VectorInterface::reset()
 {
-    std::queue<uint32_t> empty;
-    FIFO.swap(empty);
+    memset(last_micro, 0, sizeof(last_micro));
+    FIFO_head = 0;
+    FIFO_size = 0;
     command = 0;
     command_len = 0;
     buffer_size = 0;
@@ -70,17 +74,24 @@ bool VectorInterface::check_vif_stall(uint32_t value)
 
 void VectorInterface::update(int cycles)
 {
-    //Since the loop processes per-word, we need to multiply cycles by 4
+    //The FIFO is consumed per-word, so we need to multiply cycles by 4
     //This allows us to process one quadword per bus cycle
     int run_cycles = cycles << 2;
-   
+
+    //Nothing can happen until DMA or a pending wait gives us something to do
+    if (!FIFO_size && !wait_for_VU && !(vif_stalled & STALL_MSKPATH3))
+    {
+        e->sleep_unit(id ? UNIT_VIF1 : UNIT_VIF0);
+        return;
+    }
+
     if (vif_stalled & STALL_MSKPATH3)
     {
         gif->resume_path3();
         vif_stalled &= ~STALL_MSKPATH3;
     }
 
-    while (!vif_stalled && run_cycles--)
+    while (!vif_stalled && run_cycles > 0)
     {        
         if (wait_for_VU)
         {
@@ -102,84 +113,148 @@ void VectorInterface::update(int cycles)
             flush_stall = false;
         }*/
 
-        if(check_vif_stall(CODE) || !FIFO.size())
+        if(check_vif_stall(CODE) || !FIFO_size)
             return;
 
-        uint32_t value = FIFO.front();
+        int words;
         if (command == 0)
         {
             buffer_size = 0;
-            decode_cmd(value);
+            decode_cmd(peek_FIFO(0));
+            words = 1;
         }
         else
         {
-            switch (command)
+            //Hand everything of the current command that has arrived over in one go
+            //An UNPACK that reads no data (fill writes only) still looks at the front word without consuming it
+            int available = 1;
+            if (command_len)
+                available = std::min(std::min(FIFO_size, command_len), run_cycles);
+            words = process_data(available);
+            if (!words)
+                return;
+        }
+        run_cycles -= words;
+
+        if (command_len)
+        {
+            command_len -= words;
+            pop_FIFO(words);
+
+            //Let a DMA channel waiting on a full FIFO resume once a quadword fits again
+            if (FIFO_size <= 60)
+                dmac->wake_channel(id ? DMAC::VIF1 : DMAC::VIF0);
+        }
+    }
+}
+
+/**
+Consumes up to the given number of data words of the current command from the front of the FIFO, which the caller
+has already limited to what has arrived and what the command has left. Returns how many words were used, which
+is less than asked only when the command finishes early (an UNPACK whose last vector ends before its last word)
+or cannot take data right now (DIRECT without PATH2, or a GS stalled by the data sent so far).
+**/
+int VectorInterface::process_data(int words)
+{
+    int count = 0;
+    switch (command)
+    {
+        case 0x20:
+            //STMASK
+            MASK = peek_FIFO(0);
+            printf("[VIF] New MASK: $%08X\n", MASK);
+            command = 0;
+            return 1;
+        case 0x30:
+        case 0x31:
+            //STROW/STCOL
             {
-            case 0x20:
-                //STMASK
-                printf("[VIF] New MASK: $%08X\n", value);
-                MASK = value;
-                command = 0;
-                break;
-            case 0x30:
-                //STROW
-                printf("[VIF] ROW%d: $%08X\n", 4 - command_len, value);
-                ROW[4 - command_len] = value;
-                if (command_len <= 1)
-                    command = 0;
-                break;
-            case 0x31:
-                //STCOL
-                printf("[VIF] COL%d: $%08X\n", 4 - command_len, value);
-                COL[4 - command_len] = value;
-                if (command_len <= 1)
+                uint32_t* reg = (command == 0x30) ? ROW : COL;
+                for (; count < words; count++)
+                    reg[4 - command_len + count] = peek_FIFO(count);
+                if (command_len <= words)
                     command = 0;
-                break;
-            case 0x4A:
-                //MPG
-                vu->write_instr(mpg.addr, value);
+            }
+            return count;
+        case 0x4A:
+            //MPG
+            for (; count < words; count++)
+            {
+                vu->write_instr(mpg.addr, peek_FIFO(count));
                 mpg.addr += 4;
-                if (command_len <= 1)
-                {
-                    //disasm_micromem();
-                    command = 0;
-                }
-                break;
-            case 0x50:
-            case 0x51:
-                //DIRECT/DIRECTHL
-                if (!gif->path_active(2))
-                    return;
-
-                buffer[buffer_size] = value;
+            }
+            if (command_len <= words)
+            {
+                //disasm_micromem();
+                command = 0;
+            }
+            return count;
+        case 0x50:
+        case 0x51:
+            //DIRECT/DIRECTHL
+            if (!gif->path_active(2))
+                return 0;
+
+            for (; count < words; count++)
+            {
+                buffer[buffer_size] = peek_FIFO(count);
                 buffer_size++;
                 if (buffer_size == 4)
                 {
                     gif->send_PATH2(buffer);
                     buffer_size = 0;
+
+                    //A SIGNAL can stall the GS, and nothing more may reach it until that's cleared
+                    if (!gif->path_active(2))
+                    {
+                        count++;
+                        break;
+                    }
                 }
+            }
 
-                //If we've run out of data, deactivate the PATH2 transfer
-                if (command_len <= 1)
+            //If we've run out of data, deactivate the PATH2 transfer
+            if (command_len <= count)
+            {
+                gif->deactivate_PATH(2);
+                command = 0;
+            }
+            return count;
+        default:
+            if ((command & 0x60) != 0x60)
+                Errors::die("[VIF] Unhandled data for command $%02X\n", command);
+
+            //Whole V4-32 vectors are by far the most common geometry format, and can skip the word buffer
+            if (unpack.cmd == 0xC)
+            {
+                while (words - count >= 4 && !buffer_size && unpack.num && unpack.blocks_written < CYCLE.CL)
                 {
-                    gif->deactivate_PATH(2);
-                    command = 0;
+                    uint128_t quad;
+                    for (int i = 0; i < 4; i++)
+                        quad._u32[i] = peek_FIFO(count + i);
+                    count += 4;
+                    process_UNPACK_quad(quad);
+
+                    while (is_filling_write() && unpack.num)
+                    {
+                        quad._u64[0] = 0;
+                        quad._u64[1] = 0;
+                        process_UNPACK_quad(quad);
+                    }
                 }
-                break;
-            default:
-                if ((command & 0x60) == 0x60)
-                    handle_UNPACK(value);
-                else
+                if (!unpack.num)
                 {
-                    Errors::die("[VIF] Unhandled data for command $%02X\n", command);
+                    command = 0;
+                    return count;
                 }
             }
-        }
-        if (command_len)
-        {
-            command_len--;
-            FIFO.pop();
-        }
+
+            while (count < words && command)
+            {
+                handle_UNPACK(peek_FIFO(count));
+                count++;
+            }
+            return count;
     }
 }
 
@@ -315,7 +390,7 @@ void VectorInterface::decode_cmd(uint32_t value)
             else
                 command_len += (imm * 4);
             printf("[VIF] DIRECT: %d\n", command_len);
-            gif->request_PATH(2, command == 0x50);
+            gif->request_PATH(2);
             break;
         default:
             if ((command & 0x60) == 0x60)
@@ -818,29 +893,38 @@ void VectorInterface::process_UNPACK_quad(uint128_t &quad)
 bool VectorInterface::transfer_DMAtag(uint128_t tag)
 {
     //This should return false if the transfer stalls due to the FIFO filling up
-    if (FIFO.size() > 62)
+    if (FIFO_size > 62)
         return false;
     printf("[VIF] Transfer tag: $%08X_%08X_%08X_%08X\n", tag._u32[3], tag._u32[2], tag._u32[1], tag._u32[0]);
     for (int i = 2; i < 4; i++)
-        FIFO.push(tag._u32[i]);
+        push_FIFO(tag._u32[i]);
+    e->wake_unit(id ? UNIT_VIF1 : UNIT_VIF0);
     return true;
 }
 
 bool VectorInterface::feed_DMA(uint128_t quad)
 {
     printf("[VIF] Feed DMA: $%08X_%08X_%08X_%08X\n", quad._u32[3], quad._u32[2], quad._u32[1], quad._u32[0]);
-    if (FIFO.size() > 60)
+    if (FIFO_size > 60)
         return false;
     for (int i = 0; i < 4; i++)
-        FIFO.push(quad._u32[i]);
+        push_FIFO(quad._u32[i]);
+    e->wake_unit(id ? UNIT_VIF1 : UNIT_VIF0);
     return true;
 }
 
+//VIF1's FIFO runs backwards for local to host transfers, handing out what the GS reads from VRAM
+bool VectorInterface::read_DMA(uint128_t& quad)
+{
+    if (!gif)
+        return false;
+    return gif->read_GS_FIFO(quad);
+}
+
 void VectorInterface::disasm_micromem()
 {
     //Check for branch targets and also see if the microprogram is the same as the one previously disassembled
     int size = (vu->get_id()) ? 0x4000 : 0x1000;
-    static uint64_t last_micro[0x4000 / 8];
     bool should_disasm = false;
     bool is_branch_target[0x4000 / 8];
     memset(is_branch_target, 0, size / 8);
@@ -915,14 +999,14 @@ void VectorInterface::disasm_micromem()
 uint32_t VectorInterface::get_stat()
 {
     uint32_t reg = 0;
-    reg |= (vif_stalled & STALL_IBIT) ? 0 : ((FIFO.size() != 0) * 3);
+    reg |= (vif_stalled & STALL_IBIT) ? 0 : ((FIFO_size != 0) * 3);
     reg |= vu->is_running() << 2;
     reg |= mark_detected << 6;
     reg |= DBF << 7;
     reg |= vif_stop << 8;
     reg |= (vif_stalled & STALL_IBIT) << 10;
     reg |= vif_interrupt << 11;
-    reg |= ((FIFO.size() + 3) / 4) << 24;
+    reg |= ((FIFO_size + 3) / 4) << 24;
     //printf("[VIF] Get STAT: $%08X\n", reg);
     return reg;
 }
@@ -1,7 +1,6 @@
 #ifndef VIF_HPP
 #define VIF_HPP
 #include <cstdint>
-#include <queue>
 #include <fstream>
 
 #include "intc.hpp"
@@ -9,6 +8,8 @@
 
 #include "../int128.hpp"
 
+class DMAC;
+class Emulator;
 class GraphicsInterface;
 
 enum VIF_STALL
@@ -47,10 +48,14 @@ struct VIF_ERR_REG
 class VectorInterface
 {
     private:
+        Emulator* e;
         GraphicsInterface* gif;
         VectorUnit* vu;
         INTC* intc;
-        std::queue<uint32_t> FIFO;
+        DMAC* dmac;
+        //Words delivered by DMA, kept as a ring so a whole VIFcode and its data can be read in place
+        uint32_t FIFO[64];
+        int FIFO_head, FIFO_size;
         int id;
         uint16_t imm;
         uint8_t command;
@@ -86,8 +91,13 @@ class VectorInterface
         uint32_t MARK;
 
         int command_len;
+        void push_FIFO(uint32_t value);
+        uint32_t peek_FIFO(int index);
+        void pop_FIFO(int count);
+
         bool check_vif_stall(uint32_t value);
         void decode_cmd(uint32_t value);
+        int process_data(int words);
         void handle_wait_cmd(uint32_t value);
         void MSCAL(uint32_t addr);
         void init_UNPACK(uint32_t value);
@@ -97,9 +107,11 @@ class VectorInterface
         void handle_UNPACK_mode(uint128_t& quad);
         void process_UNPACK_quad(uint128_t& quad);
 
+        //Microprogram that was last disassembled, so that unchanged ones aren't dumped again
+        uint64_t last_micro[0x4000 / 8];
         void disasm_micromem();
     public:
-        VectorInterface(GraphicsInterface* gif, VectorUnit* vu, INTC* intc, int id);
+        VectorInterface(Emulator* e, GraphicsInterface* gif, VectorUnit* vu, INTC* intc, DMAC* dmac, int id);
         int get_id();
 
         void reset();
@@ -107,6 +119,7 @@ class VectorInterface
 
         bool transfer_DMAtag(uint128_t tag);
         bool feed_DMA(uint128_t quad);
+        bool read_DMA(uint128_t& quad);
 
         uint32_t get_stat();
         uint32_t get_mark();
@@ -127,4 +140,21 @@ inline int VectorInterface::get_id()
 {
     return id;
 }
+
+inline void VectorInterface::push_FIFO(uint32_t value)
+{
+    FIFO[(FIFO_head + FIFO_size) & 0x3F] = value;
+    FIFO_size++;
+}
+
+inline uint32_t VectorInterface::peek_FIFO(int index)
+{
+    return FIFO[(FIFO_head + index) & 0x3F];
+}
+
+inline void VectorInterface::pop_FIFO(int count)
+{
+    FIFO_head = (FIFO_head + count) & 0x3F;
+    FIFO_size -= count;
+}
 #endif // VIF_HPP
@@ -7,6 +7,9 @@
 #include "../emulator.hpp"
 #include "../errors.hpp"
 #include "../gif.hpp"
+#include "../profiler.hpp"
+#include "../statehash.hpp"
+#include "../trace.hpp"
 
 #define _x(f) f&8
 #define _y(f) f&4
@@ -31,10 +34,13 @@
 #define _Imm11_		(int32_t)(instr & 0x400 ? 0xfffffc00 | (instr & 0x3ff) : instr & 0x3ff)
 #define _UImm11_	(int32_t)(instr & 0x7ff)
 
-uint32_t VectorUnit::FBRST = 0;
-
-VectorUnit::VectorUnit(int id, Emulator* e) : id(id), e(e), gif(nullptr)
+VectorUnit::VectorUnit(int id, Emulator* e, uint32_t* FBRST) : id(id), e(e), gif(nullptr), FBRST(FBRST)
 {
+    trace = nullptr;
+    profiler = nullptr;
+    profile_countdown = 0;
+    program_start = 0;
+    invalidate_predecoded();
     gpr[0].f[0] = 0.0;
     gpr[0].f[1] = 0.0;
     gpr[0].f[2] = 0.0;
@@ -113,6 +119,24 @@ void VectorUnit::set_GIF(GraphicsInterface *gif)
     this->gif = gif;
 }
 
+void VectorUnit::set_trace(TraceStream* trace)
+{
+    this->trace = trace;
+}
+
+//Micro memory was replaced wholesale (e.g. by a save state), decode everything again as it's reached
+void VectorUnit::invalidate_predecoded()
+{
+    for (int i = 0; i < 1024 * 16 / 8; i++)
+        predecoded[i].valid = false;
+}
+
+void VectorUnit::set_profiler(Profiler* profiler)
+{
+    this->profiler = profiler;
+    profile_countdown = profiler ? profiler->get_interval(id ? PROFILE_VU1 : PROFILE_VU0) : 0;
+}
+
 //Propogate all pipeline updates instantly
 void VectorUnit::flush_pipes()
 {
@@ -125,6 +149,12 @@ void VectorUnit::flush_pipes()
 
 void VectorUnit::run(int cycles)
 {
+    if (!running && !transferring_GIF)
+    {
+        e->sleep_unit(id ? UNIT_VU1 : UNIT_VU0);
+        return;
+    }
+
     int cycles_to_run = cycles;
     while (running && cycles_to_run)
     {
@@ -148,7 +178,18 @@ void VectorUnit::run(int cycles)
         uint32_t upper_instr = *(uint32_t*)&instr_mem[PC + 4];
         uint32_t lower_instr = *(uint32_t*)&instr_mem[PC];
         //printf("[$%08X] $%08X:$%08X\n", PC, upper_instr, lower_instr);
-        VU_Interpreter::interpret(*this, upper_instr, lower_instr);
+        if (trace)
+            trace->vu_instruction(PC, upper_instr, lower_instr);
+        if (profiler && --profile_countdown <= 0)
+        {
+            PROFILE_UNIT unit = id ? PROFILE_VU1 : PROFILE_VU0;
+            profile_countdown = profiler->get_interval(unit);
+            profiler->sample_vu(unit, PC, program_start);
+        }
+        VU_Predecoded& pair = predecoded[PC >> 3];
+        if (!pair.valid)
+            VU_Interpreter::predecode(*this, upper_instr, lower_instr, pair);
+        VU_Interpreter::execute(*this, pair, upper_instr, lower_instr);
 
         PC += 8;
 
@@ -315,7 +356,7 @@ void VectorUnit::restore_vf(bool newvf, int index)
 
 uint32_t VectorUnit::read_fbrst()
 {
-    return FBRST;
+    return *FBRST;
 }
 
 void VectorUnit::callmsr()
@@ -325,6 +366,8 @@ void VectorUnit::callmsr()
     {
         running = true;
         PC = CMSAR0 * 8;
+        program_start = PC;
+        e->wake_unit(id ? UNIT_VU1 : UNIT_VU0);
     }
 }
 
@@ -335,6 +378,8 @@ void VectorUnit::mscal(uint32_t addr)
     {
         running = true;
         PC = addr;
+        program_start = PC;
+        e->wake_unit(id ? UNIT_VU1 : UNIT_VU0);
     }
 }
 
@@ -512,13 +557,50 @@ uint32_t VectorUnit::cfc(int index)
         case 27:
             return CMSAR0;
         case 28:
-            return FBRST;
+            return *FBRST;
         default:
             printf("[COP2] Unrecognized cfc2 from reg %d\n", index);
     }
     return 0;
 }
 
+//Instruction and data memory, sized for this unit
+uint64_t VectorUnit::hash_memory()
+{
+    size_t size = (id == 0) ? 1024 * 4 : 1024 * 16;
+    uint64_t hashes[2];
+    hashes[0] = StateHash::hash_bytes(instr_mem, size);
+    hashes[1] = StateHash::hash_bytes(data_mem, size);
+    return StateHash::hash_bytes(hashes, sizeof(hashes));
+}
+
+//Architectural registers only, gathered into one buffer so that padding doesn't get hashed
+uint64_t VectorUnit::hash_registers()
+{
+    uint32_t regs[32 * 4 + 16 + 4 + 10];
+    int count = 0;
+    for (int i = 0; i < 32; i++)
+    {
+        for (int field = 0; field < 4; field++)
+            regs[count++] = gpr[i].u[field];
+    }
+    for (int i = 0; i < 16; i++)
+        regs[count++] = int_gpr[i].u;
+    for (int field = 0; field < 4; field++)
+        regs[count++] = ACC.u[field];
+    regs[count++] = R.u;
+    regs[count++] = I.u;
+    regs[count++] = Q.u;
+    regs[count++] = P.u;
+    regs[count++] = status;
+    regs[count++] = *MAC_flags & 0xFFFF;
+    regs[count++] = *CLIP_flags;
+    regs[count++] = CMSAR0;
+    regs[count++] = PC;
+    regs[count++] = running;
+    return StateHash::hash_bytes(regs, count * sizeof(uint32_t));
+}
+
 void VectorUnit::ctc(int index, uint32_t value)
 {
     if (index < 16)
@@ -552,7 +634,7 @@ void VectorUnit::ctc(int index, uint32_t value)
         case 28:
             if (value & 0x2 && id == 0)
                 reset();
-            FBRST = value & ~0x303;
+            *FBRST = value & ~0x303;
             break;
         default:
             printf("[COP2] Unrecognized ctc2 of $%08X to reg %d\n", value, index);
@@ -2373,7 +2455,7 @@ void VectorUnit::xgkick(uint32_t instr)
     else
     {
         XGKICK_cycles = 0;
-        gif->request_PATH(1, true);
+        gif->request_PATH(1);
         transferring_GIF = true;
         GIF_addr = (uint32_t)(int_gpr[_is_].u & 0x3ff) * 16;
     }
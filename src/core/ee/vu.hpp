@@ -12,7 +12,7 @@ union VU_R
     uint32_t u;
 };
 
-union VU_GPR
+union alignas(16) VU_GPR
 {
     float f[4];
     uint32_t u[4];
@@ -44,6 +44,27 @@ struct DecodedRegs
 
 class GraphicsInterface;
 class Emulator;
+class TraceStream;
+class Profiler;
+class VectorUnit;
+
+enum VU_PREDECODED_FLAGS
+{
+    VU_PREDECODED_DIV_WAIT = 1 << 0, //DIV/SQRT/RSQRT wait on the previous Q before anything else
+    VU_PREDECODED_WAITP = 1 << 1,
+    VU_PREDECODED_WAITQ = 1 << 2,
+    VU_PREDECODED_SWAP = 1 << 3 //Upper writes a register lower reads or writes; lower must see the old value
+};
+
+//An instruction pair as decoded by VU_Interpreter::predecode. Kept until the micro memory under it is written.
+struct VU_Predecoded
+{
+    bool valid;
+    uint8_t flags;
+    void (VectorUnit::*upper_op)(uint32_t);
+    void (VectorUnit::*lower_op)(uint32_t);
+    DecodedRegs regs;
+};
 
 class VectorUnit
 {
@@ -51,13 +72,18 @@ class VectorUnit
         GraphicsInterface* gif;
         int id;
         Emulator* e;
+        TraceStream* trace;
+        Profiler* profiler;
+        int profile_countdown;
+        uint16_t program_start;
 
         uint64_t cycle_count;
 
         uint16_t *VIF_TOP, *VIF_ITOP;
 
-        uint8_t instr_mem[1024 * 16];
-        uint8_t data_mem[1024 * 16];
+        alignas(16) uint8_t instr_mem[1024 * 16];
+        VU_Predecoded predecoded[1024 * 16 / 8];
+        alignas(16) uint8_t data_mem[1024 * 16];
 
         bool running;
         uint16_t PC, new_PC, second_branch_PC;
@@ -79,7 +105,7 @@ class VectorUnit
         VU_I int_gpr[16];
 
         //Control registers
-        static uint32_t FBRST;
+        uint32_t* FBRST;
         uint32_t CMSAR0;
         VU_GPR ACC;
         uint32_t status;
@@ -116,9 +142,11 @@ class VectorUnit
         void print_vectors(uint8_t a, uint8_t b);
         float convert();
     public:
-        VectorUnit(int id, Emulator* e);
+        VectorUnit(int id, Emulator* e, uint32_t* FBRST);
 
         DecodedRegs decoder;
+        //The pair VU_Interpreter::predecode is working on. Kept per unit so that emulators can decode in parallel.
+        VU_Predecoded decoding;
 
         void clear_interlock();
         bool check_interlock();
@@ -126,6 +154,9 @@ class VectorUnit
 
         void set_TOP_regs(uint16_t* TOP, uint16_t* ITOP);
         void set_GIF(GraphicsInterface* gif);
+        void set_trace(TraceStream* trace);
+        void set_profiler(Profiler* profiler);
+        void invalidate_predecoded();
 
         void update_mac_pipeline();
         void check_for_FMAC_stall();
@@ -291,6 +322,9 @@ class VectorUnit
 
         void load_state(std::ifstream& state);
         void save_state(std::ofstream& state);
+
+        uint64_t hash_memory();
+        uint64_t hash_registers();
 };
 
 template <typename T>
@@ -318,6 +352,8 @@ inline void VectorUnit::write_instr(uint32_t addr, T data)
     if (get_id() == 0)
         mask = 0xfff;
      *(T*)&instr_mem[addr & mask] = data;
+    for (uint32_t pair = (addr & mask) >> 3; pair <= ((addr & mask) + sizeof(T) - 1) >> 3; pair++)
+        predecoded[pair].valid = false;
 }
 
 template <typename T>
@@ -7,27 +7,27 @@
 
 namespace VU_Interpreter {
 
-typedef void(VectorUnit::*vu_op)(uint32_t);
-vu_op upper_op, lower_op;
-
+//Decodes and runs a pair without touching the predecoded cache
 void interpret(VectorUnit &vu, uint32_t upper_instr, uint32_t lower_instr)
 {
-    if (vu.get_id() == 0 && vu.is_interlocked())
-    {
-        //Errors::die("VU%d Using M-Bit\n", vu.get_id());
-        if (vu.check_interlock())
-        {
-            vu.set_PC(vu.get_PC() - 8);
-            return;
-        }
-        vu.clear_interlock();
-    }
+    VU_Predecoded pair;
+    predecode(vu, upper_instr, lower_instr, pair);
+    execute(vu, pair, upper_instr, lower_instr);
+}
+
+/**
+Everything about a pair that only depends on its bits: the handlers, the registers they touch for the FMAC
+hazard checks, and the waits and upper/lower ordering they need. Decoding has no side effects on the VU,
+so the result can be kept until the micro memory under it changes.
+**/
+void predecode(VectorUnit &vu, uint32_t upper_instr, uint32_t lower_instr, VU_Predecoded &pair)
+{
+    DecodedRegs previous = vu.decoder;
+    vu.decoding.flags = 0;
 
     //WaitQ, DIV, RSQRT, SQRT
     if (((lower_instr & 0x800007FC) == 0x800003BC))
-    {
-        vu.waitq(0);
-    }
+        vu.decoding.flags |= VU_PREDECODED_DIV_WAIT;
 
     //Reset decoder
     vu.decoder.vf_read0[0] = 0; vu.decoder.vf_read0[1] = 0;
@@ -48,40 +48,80 @@ void interpret(VectorUnit &vu, uint32_t upper_instr, uint32_t lower_instr)
     //Get lower op
     if (!(upper_instr & (1 << 31)))
         lower(vu, lower_instr);
+    else
+        vu.decoding.lower_op = nullptr;
+
+    //If the upper op is writing to a reg the lower op is reading from, the lower op executes first
+    //Also used to handle if upper and lower write to the same register, upper gets priority
+    int write = vu.decoder.vf_write[0];
+    int write1 = vu.decoder.vf_write[1];
+    int read0 = vu.decoder.vf_read0[1];
+    int read1 = vu.decoder.vf_read1[1];
+    if (write && ((write == read0 || write == read1) || (write == write1)))
+        vu.decoding.flags |= VU_PREDECODED_SWAP;
+
+    pair.valid = true;
+    pair.flags = vu.decoding.flags;
+    pair.upper_op = vu.decoding.upper_op;
+    pair.lower_op = vu.decoding.lower_op;
+    pair.regs = vu.decoder;
+
+    //The pipelines still refer to the previous pair until this one executes
+    vu.decoder = previous;
+}
+
+void execute(VectorUnit &vu, const VU_Predecoded &pair, uint32_t upper_instr, uint32_t lower_instr)
+{
+    if (vu.get_id() == 0 && vu.is_interlocked())
+    {
+        //Errors::die("VU%d Using M-Bit\n", vu.get_id());
+        if (vu.check_interlock())
+        {
+            vu.set_PC(vu.get_PC() - 8);
+            return;
+        }
+        vu.clear_interlock();
+    }
+
+    if (pair.flags & VU_PREDECODED_DIV_WAIT)
+        vu.waitq(0);
+
+    vu.decoder = pair.regs;
+
+    //waitp/waitq should always execute before upper
+    if (pair.flags & VU_PREDECODED_WAITP)
+        vu.waitp(lower_instr);
+    if (pair.flags & VU_PREDECODED_WAITQ)
+        vu.waitq(lower_instr);
 
     vu.check_for_FMAC_stall();
     
     //LOI - upper op always executes first
     if (upper_instr & (1 << 31))
     {
-        (vu.*upper_op)(upper_instr);
+        (vu.*pair.upper_op)(upper_instr);
         vu.set_I(lower_instr);
     }
     else
     {
-        //If the upper op is writing to a reg the lower op is reading from, the lower op executes first
-        //Also used to handle if upper and lower write to the same register, upper gets priority
-        int write = vu.decoder.vf_write[0];
-        int write1 = vu.decoder.vf_write[1];
-        int read0 = vu.decoder.vf_read0[1];
-        int read1 = vu.decoder.vf_read1[1];
-        if (write && ((write == read0 || write == read1) || (write == write1)))
+        if (pair.flags & VU_PREDECODED_SWAP)
         {
+            int write = pair.regs.vf_write[0];
             vu.backup_vf(false, write);
 
-            (vu.*upper_op)(upper_instr);
+            (vu.*pair.upper_op)(upper_instr);
 
             vu.backup_vf(true, write);
             vu.restore_vf(false, write);
 
-            (vu.*lower_op)(lower_instr);
+            (vu.*pair.lower_op)(lower_instr);
 
             vu.restore_vf(true, write);
         }
         else
         {
-            (vu.*upper_op)(upper_instr);
-            (vu.*lower_op)(lower_instr);
+            (vu.*pair.upper_op)(upper_instr);
+            (vu.*pair.lower_op)(lower_instr);
         }
     }
 
@@ -232,7 +272,7 @@ void addbc(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_read1[0] = bc_reg;
     vu.decoder.vf_read1_field[0] = 1 << (3 - bc);
 
-    upper_op = &VectorUnit::addbc;
+    vu.decoding.upper_op = &VectorUnit::addbc;
 }
 
 void subbc(VectorUnit &vu, uint32_t instr)
@@ -251,7 +291,7 @@ void subbc(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = bc_reg;
     vu.decoder.vf_read1_field[0] = 1 << (3 - bc);
-    upper_op = &VectorUnit::subbc;
+    vu.decoding.upper_op = &VectorUnit::subbc;
 }
 
 void maddbc(VectorUnit &vu, uint32_t instr)
@@ -270,7 +310,7 @@ void maddbc(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = bc_reg;
     vu.decoder.vf_read1_field[0] = 1 << (3 - bc);
-    upper_op = &VectorUnit::maddbc;
+    vu.decoding.upper_op = &VectorUnit::maddbc;
 }
 
 void msubbc(VectorUnit &vu, uint32_t instr)
@@ -289,7 +329,7 @@ void msubbc(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = bc_reg;
     vu.decoder.vf_read1_field[0] = 1 << (3 - bc);
-    upper_op = &VectorUnit::msubbc;
+    vu.decoding.upper_op = &VectorUnit::msubbc;
 }
 
 void maxbc(VectorUnit &vu, uint32_t instr)
@@ -308,7 +348,7 @@ void maxbc(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = bc_reg;
     vu.decoder.vf_read1_field[0] = 1 << (3 - bc);
-    upper_op = &VectorUnit::maxbc;
+    vu.decoding.upper_op = &VectorUnit::maxbc;
 }
 
 void minibc(VectorUnit &vu, uint32_t instr)
@@ -327,7 +367,7 @@ void minibc(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = bc_reg;
     vu.decoder.vf_read1_field[0] = 1 << (3 - bc);
-    upper_op = &VectorUnit::minibc;
+    vu.decoding.upper_op = &VectorUnit::minibc;
 }
 
 void mulbc(VectorUnit &vu, uint32_t instr)
@@ -346,7 +386,7 @@ void mulbc(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = bc_reg;
     vu.decoder.vf_read1_field[0] = 1 << (3 - bc);
-    upper_op = &VectorUnit::mulbc;
+    vu.decoding.upper_op = &VectorUnit::mulbc;
 }
 
 void mulq(VectorUnit &vu, uint32_t instr)
@@ -360,7 +400,7 @@ void mulq(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::mulq;
+    vu.decoding.upper_op = &VectorUnit::mulq;
 }
 
 void maxi(VectorUnit &vu, uint32_t instr)
@@ -374,7 +414,7 @@ void maxi(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::maxi;
+    vu.decoding.upper_op = &VectorUnit::maxi;
 }
 
 void muli(VectorUnit &vu, uint32_t instr)
@@ -388,7 +428,7 @@ void muli(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::muli;
+    vu.decoding.upper_op = &VectorUnit::muli;
 }
 
 void minii(VectorUnit &vu, uint32_t instr)
@@ -402,7 +442,7 @@ void minii(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::minii;
+    vu.decoding.upper_op = &VectorUnit::minii;
 }
 
 void addq(VectorUnit &vu, uint32_t instr)
@@ -415,7 +455,7 @@ void addq(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_write_field[0] = field;
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::addq;
+    vu.decoding.upper_op = &VectorUnit::addq;
 }
 
 void maddq(VectorUnit &vu, uint32_t instr)
@@ -429,7 +469,7 @@ void maddq(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::maddq;
+    vu.decoding.upper_op = &VectorUnit::maddq;
 }
 
 void addi(VectorUnit &vu, uint32_t instr)
@@ -442,7 +482,7 @@ void addi(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_write_field[0] = field;
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::addi;
+    vu.decoding.upper_op = &VectorUnit::addi;
 }
 
 void maddi(VectorUnit &vu, uint32_t instr)
@@ -456,7 +496,7 @@ void maddi(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::maddi;
+    vu.decoding.upper_op = &VectorUnit::maddi;
 }
 
 void subq(VectorUnit &vu, uint32_t instr)
@@ -470,7 +510,7 @@ void subq(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::subq;
+    vu.decoding.upper_op = &VectorUnit::subq;
 }
 
 void msubq(VectorUnit &vu, uint32_t instr)
@@ -484,7 +524,7 @@ void msubq(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::msubq;
+    vu.decoding.upper_op = &VectorUnit::msubq;
 }
 
 void subi(VectorUnit &vu, uint32_t instr)
@@ -498,7 +538,7 @@ void subi(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::subi;
+    vu.decoding.upper_op = &VectorUnit::subi;
 }
 
 void msubi(VectorUnit &vu, uint32_t instr)
@@ -512,7 +552,7 @@ void msubi(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::msubi;
+    vu.decoding.upper_op = &VectorUnit::msubi;
 }
 
 void add(VectorUnit &vu, uint32_t instr)
@@ -530,7 +570,7 @@ void add(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = reg2;
     vu.decoder.vf_read1_field[0] = field;
-    upper_op = &VectorUnit::add;
+    vu.decoding.upper_op = &VectorUnit::add;
 }
 
 void madd(VectorUnit &vu, uint32_t instr)
@@ -548,7 +588,7 @@ void madd(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = reg2;
     vu.decoder.vf_read1_field[0] = field;
-    upper_op = &VectorUnit::madd;
+    vu.decoding.upper_op = &VectorUnit::madd;
 }
 
 void mul(VectorUnit &vu, uint32_t instr)
@@ -566,7 +606,7 @@ void mul(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = reg2;
     vu.decoder.vf_read1_field[0] = field;
-    upper_op = &VectorUnit::mul;
+    vu.decoding.upper_op = &VectorUnit::mul;
 }
 
 void max(VectorUnit &vu, uint32_t instr)
@@ -584,7 +624,7 @@ void max(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = reg2;
     vu.decoder.vf_read1_field[0] = field;
-    upper_op = &VectorUnit::max;
+    vu.decoding.upper_op = &VectorUnit::max;
 }
 
 void sub(VectorUnit &vu, uint32_t instr)
@@ -602,7 +642,7 @@ void sub(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = reg2;
     vu.decoder.vf_read1_field[0] = field;
-    upper_op = &VectorUnit::sub;
+    vu.decoding.upper_op = &VectorUnit::sub;
 }
 
 void msub(VectorUnit &vu, uint32_t instr)
@@ -617,7 +657,7 @@ void msub(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_write_field[0] = field;
     vu.decoder.vf_read0_field[0] = field;
     vu.decoder.vf_read1_field[0] = field;
-    upper_op = &VectorUnit::msub;
+    vu.decoding.upper_op = &VectorUnit::msub;
 }
 
 void opmsub(VectorUnit &vu, uint32_t instr)
@@ -631,7 +671,7 @@ void opmsub(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_write_field[0] = 0xE; //xyz
     vu.decoder.vf_read0_field[0] = 0xE;
     vu.decoder.vf_read1_field[0] = 0xE;
-    upper_op = &VectorUnit::opmsub;
+    vu.decoding.upper_op = &VectorUnit::opmsub;
 }
 
 void mini(VectorUnit &vu, uint32_t instr)
@@ -649,7 +689,7 @@ void mini(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = reg2;
     vu.decoder.vf_read1_field[0] = field;
-    upper_op = &VectorUnit::mini;
+    vu.decoding.upper_op = &VectorUnit::mini;
 }
 
 void upper_special(VectorUnit &vu, uint32_t instr)
@@ -764,7 +804,7 @@ void upper_special(VectorUnit &vu, uint32_t instr)
             /**
               * NOP
               */
-            upper_op = &VectorUnit::nop;
+            vu.decoding.upper_op = &VectorUnit::nop;
             break;
         default:
             unknown_op("upper special", instr, op);
@@ -783,7 +823,7 @@ void addabc(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = bc_reg;
     vu.decoder.vf_read1_field[0] = 1 << (3 - bc);
-    upper_op = &VectorUnit::addabc;
+    vu.decoding.upper_op = &VectorUnit::addabc;
 }
 
 void subabc(VectorUnit &vu, uint32_t instr)
@@ -798,7 +838,7 @@ void subabc(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = bc_reg;
     vu.decoder.vf_read1_field[0] = 1 << (3 - bc);
-    upper_op = &VectorUnit::subabc;
+    vu.decoding.upper_op = &VectorUnit::subabc;
 }
 
 void maddabc(VectorUnit &vu, uint32_t instr)
@@ -813,7 +853,7 @@ void maddabc(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = bc_reg;
     vu.decoder.vf_read1_field[0] = 1 << (3 - bc);
-    upper_op = &VectorUnit::maddabc;
+    vu.decoding.upper_op = &VectorUnit::maddabc;
 }
 
 void msubabc(VectorUnit &vu, uint32_t instr)
@@ -828,7 +868,7 @@ void msubabc(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = bc_reg;
     vu.decoder.vf_read1_field[0] = 1 << (3 - bc);
-    upper_op = &VectorUnit::msubabc;
+    vu.decoding.upper_op = &VectorUnit::msubabc;
 }
 
 void itof0(VectorUnit &vu, uint32_t instr)
@@ -841,7 +881,7 @@ void itof0(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_write_field[0] = field;
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::itof0;
+    vu.decoding.upper_op = &VectorUnit::itof0;
 }
 
 void itof4(VectorUnit &vu, uint32_t instr)
@@ -854,7 +894,7 @@ void itof4(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_write_field[0] = field;
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::itof4;
+    vu.decoding.upper_op = &VectorUnit::itof4;
 }
 
 void itof12(VectorUnit &vu, uint32_t instr)
@@ -867,7 +907,7 @@ void itof12(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_write_field[0] = field;
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::itof12;
+    vu.decoding.upper_op = &VectorUnit::itof12;
 }
 
 void itof15(VectorUnit &vu, uint32_t instr)
@@ -880,7 +920,7 @@ void itof15(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_write_field[0] = field;
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::itof15;
+    vu.decoding.upper_op = &VectorUnit::itof15;
 }
 
 void ftoi0(VectorUnit &vu, uint32_t instr)
@@ -893,7 +933,7 @@ void ftoi0(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_write_field[0] = field;
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::ftoi0;
+    vu.decoding.upper_op = &VectorUnit::ftoi0;
 }
 
 void ftoi4(VectorUnit &vu, uint32_t instr)
@@ -906,7 +946,7 @@ void ftoi4(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_write_field[0] = field;
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::ftoi4;
+    vu.decoding.upper_op = &VectorUnit::ftoi4;
 }
 
 void ftoi12(VectorUnit &vu, uint32_t instr)
@@ -919,7 +959,7 @@ void ftoi12(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_write_field[0] = field;
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::ftoi12;
+    vu.decoding.upper_op = &VectorUnit::ftoi12;
 }
 
 void ftoi15(VectorUnit &vu, uint32_t instr)
@@ -932,7 +972,7 @@ void ftoi15(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_write_field[0] = field;
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::ftoi15;
+    vu.decoding.upper_op = &VectorUnit::ftoi15;
 }
 
 void mulabc(VectorUnit &vu, uint32_t instr)
@@ -947,7 +987,7 @@ void mulabc(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = bc_reg;
     vu.decoder.vf_read1_field[0] = 1 << (3 - bc);
-    upper_op = &VectorUnit::mulabc;
+    vu.decoding.upper_op = &VectorUnit::mulabc;
 }
 
 void mulaq(VectorUnit &vu, uint32_t instr)
@@ -957,7 +997,7 @@ void mulaq(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::mulaq;
+    vu.decoding.upper_op = &VectorUnit::mulaq;
 }
 
 void abs(VectorUnit &vu, uint32_t instr)
@@ -971,7 +1011,7 @@ void abs(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::abs;
+    vu.decoding.upper_op = &VectorUnit::abs;
 }
 
 void mulai(VectorUnit &vu, uint32_t instr)
@@ -981,7 +1021,7 @@ void mulai(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::mulai;
+    vu.decoding.upper_op = &VectorUnit::mulai;
 }
 
 void clip(VectorUnit &vu, uint32_t instr)
@@ -994,7 +1034,7 @@ void clip(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = reg2;
     vu.decoder.vf_read1_field[0] = 0x1; //w
-    upper_op = &VectorUnit::clip;
+    vu.decoding.upper_op = &VectorUnit::clip;
 }
 
 void addai(VectorUnit &vu, uint32_t instr)
@@ -1004,7 +1044,7 @@ void addai(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::addai;
+    vu.decoding.upper_op = &VectorUnit::addai;
 }
 
 void maddaq(VectorUnit &vu, uint32_t instr)
@@ -1014,7 +1054,7 @@ void maddaq(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::maddaq;
+    vu.decoding.upper_op = &VectorUnit::maddaq;
 }
 
 void maddai(VectorUnit &vu, uint32_t instr)
@@ -1024,7 +1064,7 @@ void maddai(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::maddai;
+    vu.decoding.upper_op = &VectorUnit::maddai;
 }
 
 void msubaq(VectorUnit &vu, uint32_t instr)
@@ -1034,7 +1074,7 @@ void msubaq(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::msubaq;
+    vu.decoding.upper_op = &VectorUnit::msubaq;
 }
 
 void subai(VectorUnit &vu, uint32_t instr)
@@ -1044,7 +1084,7 @@ void subai(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::subai;
+    vu.decoding.upper_op = &VectorUnit::subai;
 }
 
 void msubai(VectorUnit &vu, uint32_t instr)
@@ -1054,7 +1094,7 @@ void msubai(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[0] = source;
     vu.decoder.vf_read0_field[0] = field;
-    upper_op = &VectorUnit::msubai;
+    vu.decoding.upper_op = &VectorUnit::msubai;
 }
 
 void mula(VectorUnit &vu, uint32_t instr)
@@ -1068,7 +1108,7 @@ void mula(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = reg2;
     vu.decoder.vf_read1_field[0] = field;
-    upper_op = &VectorUnit::mula;
+    vu.decoding.upper_op = &VectorUnit::mula;
 }
 
 void adda(VectorUnit &vu, uint32_t instr)
@@ -1082,7 +1122,7 @@ void adda(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = reg2;
     vu.decoder.vf_read1_field[0] = field;
-    upper_op = &VectorUnit::adda;
+    vu.decoding.upper_op = &VectorUnit::adda;
 }
 
 void suba(VectorUnit &vu, uint32_t instr)
@@ -1096,7 +1136,7 @@ void suba(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = reg2;
     vu.decoder.vf_read1_field[0] = field;
-    upper_op = &VectorUnit::suba;
+    vu.decoding.upper_op = &VectorUnit::suba;
 }
 
 void madda(VectorUnit &vu, uint32_t instr)
@@ -1110,7 +1150,7 @@ void madda(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = reg2;
     vu.decoder.vf_read1_field[0] = field;
-    upper_op = &VectorUnit::madda;
+    vu.decoding.upper_op = &VectorUnit::madda;
 }
 
 void opmula(VectorUnit &vu, uint32_t instr)
@@ -1121,7 +1161,7 @@ void opmula(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_read1[0] = reg2;
     vu.decoder.vf_read0_field[0] = 0xE; //xyz
     vu.decoder.vf_read1_field[0] = 0xE; //xyz
-    upper_op = &VectorUnit::opmula;
+    vu.decoding.upper_op = &VectorUnit::opmula;
 }
 
 void msuba(VectorUnit &vu, uint32_t instr)
@@ -1135,7 +1175,7 @@ void msuba(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[0] = reg2;
     vu.decoder.vf_read1_field[0] = field;
-    upper_op = &VectorUnit::msuba;
+    vu.decoding.upper_op = &VectorUnit::msuba;
 }
 
 void lower(VectorUnit &vu, uint32_t instr)
@@ -1182,7 +1222,7 @@ void iadd(VectorUnit &vu, uint32_t instr)
     /*uint8_t dest = (instr >> 6) & 0x1F;
     uint8_t reg1 = (instr >> 11) & 0x1F;
     uint8_t reg2 = (instr >> 16) & 0x1F;*/
-    lower_op = &VectorUnit::iadd;
+    vu.decoding.lower_op = &VectorUnit::iadd;
 }
 
 void isub(VectorUnit &vu, uint32_t instr)
@@ -1190,7 +1230,7 @@ void isub(VectorUnit &vu, uint32_t instr)
     /*uint8_t dest = (instr >> 6) & 0x1F;
     uint8_t reg1 = (instr >> 11) & 0x1F;
     uint8_t reg2 = (instr >> 16) & 0x1F;*/
-    lower_op = &VectorUnit::isub;
+    vu.decoding.lower_op = &VectorUnit::isub;
 }
 
 void iaddi(VectorUnit &vu, uint32_t instr)
@@ -1200,7 +1240,7 @@ void iaddi(VectorUnit &vu, uint32_t instr)
     uint8_t source = (instr >> 11) & 0x1F;
     uint8_t dest = (instr >> 16) & 0x1F;*/
 
-    lower_op = &VectorUnit::iaddi;
+    vu.decoding.lower_op = &VectorUnit::iaddi;
 }
 
 void iand(VectorUnit &vu, uint32_t instr)
@@ -1208,7 +1248,7 @@ void iand(VectorUnit &vu, uint32_t instr)
     /*uint8_t dest = (instr >> 6) & 0x1F;
     uint8_t reg1 = (instr >> 11) & 0x1F;
     uint8_t reg2 = (instr >> 16) & 0x1F;*/
-    lower_op = &VectorUnit::iand;
+    vu.decoding.lower_op = &VectorUnit::iand;
 }
 
 void ior(VectorUnit &vu, uint32_t instr)
@@ -1216,7 +1256,7 @@ void ior(VectorUnit &vu, uint32_t instr)
     /*uint8_t dest = (instr >> 6) & 0x1F;
     uint8_t reg1 = (instr >> 11) & 0x1F;
     uint8_t reg2 = (instr >> 16) & 0x1F;*/
-    lower_op = &VectorUnit::ior;
+    vu.decoding.lower_op = &VectorUnit::ior;
 }
 
 void lower1_special(VectorUnit &vu, uint32_t instr)
@@ -1310,8 +1350,8 @@ void lower1_special(VectorUnit &vu, uint32_t instr)
             break;
         case 0x7B:
             //waitp should always execute before upper
-            vu.waitp(instr);
-            lower_op = &VectorUnit::nop;
+            vu.decoding.flags |= VU_PREDECODED_WAITP;
+            vu.decoding.lower_op = &VectorUnit::nop;
             break;
         case 0x7C:
             esin(vu, instr);
@@ -1335,7 +1375,7 @@ void move(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = source;
     vu.decoder.vf_read0_field[1] = field;
-    lower_op = &VectorUnit::move;
+    vu.decoding.lower_op = &VectorUnit::move;
 }
 
 void mr32(VectorUnit &vu, uint32_t instr)
@@ -1349,7 +1389,7 @@ void mr32(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = source;
     vu.decoder.vf_read0_field[1] = (field >> 1) | ((field & 0x1) << 3);
-    lower_op = &VectorUnit::mr32;
+    vu.decoding.lower_op = &VectorUnit::mr32;
 }
 
 void lqi(VectorUnit &vu, uint32_t instr)
@@ -1359,7 +1399,7 @@ void lqi(VectorUnit &vu, uint32_t instr)
     uint8_t field = (instr >> 21) & 0xF;
     vu.decoder.vf_write[1] = ft;
     vu.decoder.vf_write_field[1] = field;
-    lower_op = &VectorUnit::lqi;
+    vu.decoding.lower_op = &VectorUnit::lqi;
 }
 
 void sqi(VectorUnit& vu, uint32_t instr)
@@ -1369,7 +1409,7 @@ void sqi(VectorUnit& vu, uint32_t instr)
     uint8_t dest_field = (instr >> 21) & 0xF;
     vu.decoder.vf_read0[1] = fs;
     vu.decoder.vf_read0_field[1] = dest_field;
-    lower_op = &VectorUnit::sqi;
+    vu.decoding.lower_op = &VectorUnit::sqi;
 }
 
 void lqd(VectorUnit &vu, uint32_t instr)
@@ -1379,7 +1419,7 @@ void lqd(VectorUnit &vu, uint32_t instr)
     uint8_t dest_field = (instr >> 21) & 0xF;
     vu.decoder.vf_write[1] = ft;
     vu.decoder.vf_write_field[1] = dest_field;
-    lower_op = &VectorUnit::lqd;
+    vu.decoding.lower_op = &VectorUnit::lqd;
 }
 
 void sqd(VectorUnit &vu, uint32_t instr)
@@ -1389,7 +1429,7 @@ void sqd(VectorUnit &vu, uint32_t instr)
     uint8_t dest_field = (instr >> 21) & 0xF;
     vu.decoder.vf_read0[1] = fs;
     vu.decoder.vf_read0_field[1] = dest_field;
-    lower_op = &VectorUnit::sqd;
+    vu.decoding.lower_op = &VectorUnit::sqd;
 }
 
 void div(VectorUnit &vu, uint32_t instr)
@@ -1404,7 +1444,7 @@ void div(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[1] = reg2;
     vu.decoder.vf_read1_field[1] = 1 << (3 - ftf);
-    lower_op = &VectorUnit::div;
+    vu.decoding.lower_op = &VectorUnit::div;
 }
 
 void vu_sqrt(VectorUnit &vu, uint32_t instr)
@@ -1414,7 +1454,7 @@ void vu_sqrt(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = source;
     vu.decoder.vf_read0_field[1] = 1 << (3 - ftf);
-    lower_op = &VectorUnit::vu_sqrt;
+    vu.decoding.lower_op = &VectorUnit::vu_sqrt;
 }
 
 void rsqrt(VectorUnit &vu, uint32_t instr)
@@ -1429,14 +1469,14 @@ void rsqrt(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read1[1] = reg2;
     vu.decoder.vf_read1_field[1] = 1 << (3 - ftf);
-    lower_op = &VectorUnit::rsqrt;
+    vu.decoding.lower_op = &VectorUnit::rsqrt;
 }
 
-void waitq(VectorUnit &vu, uint32_t instr)
+void waitq(VectorUnit &vu, uint32_t)
 {
     //waitq should always execute before upper
-    vu.waitq(instr);
-    lower_op = &VectorUnit::nop;
+    vu.decoding.flags |= VU_PREDECODED_WAITQ;
+    vu.decoding.lower_op = &VectorUnit::nop;
 }
 
 void mtir(VectorUnit &vu, uint32_t instr)
@@ -1447,7 +1487,7 @@ void mtir(VectorUnit &vu, uint32_t instr)
     vu.decoder.vf_read0[1] = fs;
     vu.decoder.vf_read0_field[1] = 1 << (3 - fsf);
     vu.decoder.vi_write = it;
-    lower_op = &VectorUnit::mtir;
+    vu.decoding.lower_op = &VectorUnit::mtir;
 }
 
 void mfir(VectorUnit &vu, uint32_t instr)
@@ -1458,7 +1498,7 @@ void mfir(VectorUnit &vu, uint32_t instr)
     vu.decoder.vi_read0 = is;
     vu.decoder.vf_write[1] = ft;
     vu.decoder.vf_write_field[1] = dest_field;
-    lower_op = &VectorUnit::mfir;
+    vu.decoding.lower_op = &VectorUnit::mfir;
 }
 
 void ilwr(VectorUnit &vu, uint32_t instr)
@@ -1466,7 +1506,7 @@ void ilwr(VectorUnit &vu, uint32_t instr)
     /*uint8_t is = (instr >> 11) & 0x1F;
     uint8_t it = (instr >> 16) & 0x1F;
     uint8_t field = (instr >> 21) & 0xF;*/
-    lower_op = &VectorUnit::ilwr;
+    vu.decoding.lower_op = &VectorUnit::ilwr;
 }
 
 void iswr(VectorUnit &vu, uint32_t instr)
@@ -1474,7 +1514,7 @@ void iswr(VectorUnit &vu, uint32_t instr)
     /*uint8_t is = (instr >> 11) & 0x1F;
     uint8_t it = (instr >> 16) & 0x1F;
     uint8_t field = (instr >> 21) & 0xF;*/
-    lower_op = &VectorUnit::iswr;
+    vu.decoding.lower_op = &VectorUnit::iswr;
 }
 
 void rnext(VectorUnit &vu, uint32_t instr)
@@ -1484,7 +1524,7 @@ void rnext(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_write[1] = dest;
     vu.decoder.vf_write_field[1] = field;
-    lower_op = &VectorUnit::rnext;
+    vu.decoding.lower_op = &VectorUnit::rnext;
 }
 
 void rget(VectorUnit &vu, uint32_t instr)
@@ -1494,7 +1534,7 @@ void rget(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_write[1] = dest;
     vu.decoder.vf_write_field[1] = field;
-    lower_op = &VectorUnit::rget;
+    vu.decoding.lower_op = &VectorUnit::rget;
 }
 
 void rinit(VectorUnit &vu, uint32_t instr)
@@ -1504,7 +1544,7 @@ void rinit(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = source;
     vu.decoder.vf_read0_field[1] = 1 << (3 - fsf);
-    lower_op = &VectorUnit::rinit;
+    vu.decoding.lower_op = &VectorUnit::rinit;
 }
 
 void rxor(VectorUnit &vu, uint32_t instr)
@@ -1514,7 +1554,7 @@ void rxor(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = source;
     vu.decoder.vf_read0_field[1] = 1 << (3 - fsf);
-    lower_op = &VectorUnit::rxor;
+    vu.decoding.lower_op = &VectorUnit::rxor;
 }
 
 void mfp(VectorUnit &vu, uint32_t instr)
@@ -1524,25 +1564,25 @@ void mfp(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_write[1] = dest;
     vu.decoder.vf_write_field[1] = field;
-    lower_op = &VectorUnit::mfp;
+    vu.decoding.lower_op = &VectorUnit::mfp;
 }
 
 void xtop(VectorUnit &vu, uint32_t instr)
 {
     uint8_t it = (instr >> 16) & 0x1F;
-    lower_op = &VectorUnit::xtop;
+    vu.decoding.lower_op = &VectorUnit::xtop;
 }
 
 void xitop(VectorUnit &vu, uint32_t instr)
 {
     uint8_t it = (instr >> 16) & 0x1F;
-    lower_op = &VectorUnit::xitop;
+    vu.decoding.lower_op = &VectorUnit::xitop;
 }
 
 void xgkick(VectorUnit &vu, uint32_t instr)
 {
     uint8_t is = (instr >> 11) & 0x1F;
-    lower_op = &VectorUnit::xgkick;
+    vu.decoding.lower_op = &VectorUnit::xgkick;
 }
 
 void ercpr(VectorUnit &vu, uint32_t instr)
@@ -1552,7 +1592,7 @@ void ercpr(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = source;
     vu.decoder.vf_read0_field[1] = 1 << (3 - fsf);
-    lower_op = &VectorUnit::ercpr;
+    vu.decoding.lower_op = &VectorUnit::ercpr;
 }
 
 void ersadd(VectorUnit &vu, uint32_t instr)
@@ -1561,7 +1601,7 @@ void ersadd(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = source;
     vu.decoder.vf_read0_field[1] = 0xE; //xyz
-    lower_op = &VectorUnit::ersadd;
+    vu.decoding.lower_op = &VectorUnit::ersadd;
 }
 
 void eleng(VectorUnit &vu, uint32_t instr)
@@ -1570,7 +1610,7 @@ void eleng(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = source;
     vu.decoder.vf_read0_field[1] = 0xE; //xyz
-    lower_op = &VectorUnit::eleng;
+    vu.decoding.lower_op = &VectorUnit::eleng;
 }
 
 void erleng(VectorUnit &vu, uint32_t instr)
@@ -1579,7 +1619,7 @@ void erleng(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = source;
     vu.decoder.vf_read0_field[1] = 0xE; //xyz
-    lower_op = &VectorUnit::erleng;
+    vu.decoding.lower_op = &VectorUnit::erleng;
 }
 
 void esqrt(VectorUnit &vu, uint32_t instr)
@@ -1589,7 +1629,7 @@ void esqrt(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = source;
     vu.decoder.vf_read0_field[1] = 1 << (3 - fsf);
-    lower_op = &VectorUnit::esqrt;
+    vu.decoding.lower_op = &VectorUnit::esqrt;
 }
 
 void ersqrt(VectorUnit &vu, uint32_t instr)
@@ -1599,7 +1639,7 @@ void ersqrt(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = source;
     vu.decoder.vf_read0_field[1] = 1 << (3 - fsf);
-    lower_op = &VectorUnit::ersqrt;
+    vu.decoding.lower_op = &VectorUnit::ersqrt;
 }
 
 void esin(VectorUnit &vu, uint32_t instr)
@@ -1609,7 +1649,7 @@ void esin(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = source;
     vu.decoder.vf_read0_field[1] = 1 << (3 - fsf);
-    lower_op = &VectorUnit::esin;
+    vu.decoding.lower_op = &VectorUnit::esin;
 }
 
 void eexp(VectorUnit &vu, uint32_t instr)
@@ -1619,7 +1659,7 @@ void eexp(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = source;
     vu.decoder.vf_read0_field[1] = 1 << (3 - fsf);
-    lower_op = &VectorUnit::eexp;
+    vu.decoding.lower_op = &VectorUnit::eexp;
 }
 
 void lower2(VectorUnit &vu, uint32_t instr)
@@ -1715,7 +1755,7 @@ void lq(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_write[1] = ft;
     vu.decoder.vf_write_field[1] = field;
-    lower_op = &VectorUnit::lq;
+    vu.decoding.lower_op = &VectorUnit::lq;
 }
 
 void sq(VectorUnit &vu, uint32_t instr)
@@ -1726,7 +1766,7 @@ void sq(VectorUnit &vu, uint32_t instr)
 
     vu.decoder.vf_read0[1] = fs;
     vu.decoder.vf_read0_field[1] = field;
-    lower_op = &VectorUnit::sq;
+    vu.decoding.lower_op = &VectorUnit::sq;
 }
 
 void ilw(VectorUnit &vu, uint32_t instr)
@@ -1737,7 +1777,7 @@ void ilw(VectorUnit &vu, uint32_t instr)
     uint8_t is = (instr >> 11) & 0x1F;
     uint8_t it = (instr >> 16) & 0x1F;
     uint8_t field = (instr >> 21) & 0xF;*/
-    lower_op = &VectorUnit::ilw;
+    vu.decoding.lower_op = &VectorUnit::ilw;
 }
 
 void isw(VectorUnit &vu, uint32_t instr)
@@ -1748,7 +1788,7 @@ void isw(VectorUnit &vu, uint32_t instr)
     uint8_t is = (instr >> 11) & 0x1F;
     uint8_t it = (instr >> 16) & 0x1F;
     uint8_t field = (instr >> 21) & 0xF;*/
-    lower_op = &VectorUnit::isw;
+    vu.decoding.lower_op = &VectorUnit::isw;
 }
 
 void iaddiu(VectorUnit &vu, uint32_t instr)
@@ -1757,7 +1797,7 @@ void iaddiu(VectorUnit &vu, uint32_t instr)
     imm |= ((instr >> 21) & 0xF) << 11;
     uint8_t source = (instr >> 11) & 0x1F;
     uint8_t dest = (instr >> 16) & 0x1F;*/
-    lower_op = &VectorUnit::iaddiu;
+    vu.decoding.lower_op = &VectorUnit::iaddiu;
 }
 
 void isubiu(VectorUnit &vu, uint32_t instr)
@@ -1766,102 +1806,102 @@ void isubiu(VectorUnit &vu, uint32_t instr)
     imm |= ((instr >> 21) & 0xF) << 11;
     uint8_t source = (instr >> 11) & 0x1F;
     uint8_t dest = (instr >> 16) & 0x1F;*/
-    lower_op = &VectorUnit::isubiu;
+    vu.decoding.lower_op = &VectorUnit::isubiu;
 }
 
 void fcset(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::fcset;
+    vu.decoding.lower_op = &VectorUnit::fcset;
 }
 
 void fcand(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::fcand;
+    vu.decoding.lower_op = &VectorUnit::fcand;
 }
 
 void fcor(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::fcor;
+    vu.decoding.lower_op = &VectorUnit::fcor;
 }
 
 void fsset(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::fsset;
+    vu.decoding.lower_op = &VectorUnit::fsset;
 }
 
 void fsand(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::fsand;
+    vu.decoding.lower_op = &VectorUnit::fsand;
 }
 
 void fmeq(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::fmeq;
+    vu.decoding.lower_op = &VectorUnit::fmeq;
 }
 
 void fmand(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::fmand;
+    vu.decoding.lower_op = &VectorUnit::fmand;
 }
 
 void fmor(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::fmor;
+    vu.decoding.lower_op = &VectorUnit::fmor;
 }
 
 void fcget(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::fcget;
+    vu.decoding.lower_op = &VectorUnit::fcget;
 }
 
 void b(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::b;
+    vu.decoding.lower_op = &VectorUnit::b;
 }
 
 void bal(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::bal;
+    vu.decoding.lower_op = &VectorUnit::bal;
 }
 
 void jr(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::jr;
+    vu.decoding.lower_op = &VectorUnit::jr;
 }
 
 void jalr(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::jalr;
+    vu.decoding.lower_op = &VectorUnit::jalr;
 }
 
 void ibeq(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::ibeq;
+    vu.decoding.lower_op = &VectorUnit::ibeq;
 }
 
 void ibne(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::ibne;
+    vu.decoding.lower_op = &VectorUnit::ibne;
 }
 
 void ibltz(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::ibltz;
+    vu.decoding.lower_op = &VectorUnit::ibltz;
 }
 
 void ibgtz(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::ibgtz;
+    vu.decoding.lower_op = &VectorUnit::ibgtz;
 }
 
 void iblez(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::iblez;
+    vu.decoding.lower_op = &VectorUnit::iblez;
 }
 
 void ibgez(VectorUnit &vu, uint32_t instr)
 {
-    lower_op = &VectorUnit::ibgez;
+    vu.decoding.lower_op = &VectorUnit::ibgez;
 }
 
 void unknown_op(const char *type, uint32_t instruction, uint16_t op)
@@ -5,6 +5,8 @@
 namespace VU_Interpreter
 {
     void interpret(VectorUnit& vu, uint32_t upper_instr, uint32_t lower_instr);
+    void predecode(VectorUnit& vu, uint32_t upper_instr, uint32_t lower_instr, VU_Predecoded& pair);
+    void execute(VectorUnit& vu, const VU_Predecoded& pair, uint32_t upper_instr, uint32_t lower_instr);
 
     void upper(VectorUnit& vu, uint32_t instr);
     void addbc(VectorUnit& vu, uint32_t instr);
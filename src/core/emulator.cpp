@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cfenv>
 #include <cstring>
 #include <cstdio>
@@ -15,10 +16,11 @@
 
 Emulator::Emulator() :
     cdvd(this), cp0(&dmac), cpu(&cp0, &fpu, this, (uint8_t*)&scratchpad, &vu0, &vu1),
-    dmac(&cpu, this, &gif, &ipu, &sif, &vif0, &vif1), gif(&gs), gs(&intc),
-    iop(this), iop_dma(this, &cdvd, &sif, &sio2, &spu, &spu2), iop_timers(this), intc(&cpu), ipu(&intc),
-    timers(&intc), sio2(this, &pad, &memcard), spu(1, this), spu2(2, this), vif0(nullptr, &vu0, &intc, 0),
-    vif1(&gif, &vu1, &intc, 1), vu0(0, this), vu1(1, this)
+    dmac(&cpu, this, &gif, &ipu, &sif, &vif0, &vif1), gif(&gs, &dmac), gs(&intc),
+    iop(this), iop_dma(this, &cdvd, &sif, &sio2, &spu, &spu2), iop_timers(this), intc(&cpu), ipu(this, &intc, &dmac),
+    sif(&dmac), timers(&intc), sio2(this, &pad, &memcard), spu(1, this, &spu_common), spu2(2, this, &spu_common), vif0(this, nullptr, &vu0, &intc, &dmac, 0),
+    vif1(this, &gif, &vu1, &intc, &dmac, 1), vu0(0, this, &VU_FBRST), vu1(1, this, &VU_FBRST),
+    RDRAM_hash(1024 * 1024 * 32, 1024 * 4), IOP_RAM_hash(1024 * 1024 * 2, 1024 * 4), SPU_RAM_hash(1024 * 1024 * 2, 1024 * 4)
 {
     BIOS = nullptr;
     RDRAM = nullptr;
@@ -26,31 +28,35 @@ Emulator::Emulator() :
     SPU_RAM = nullptr;
     ELF_file = nullptr;
     ELF_size = 0;
-    ee_log.open("ee_log.txt", std::ios::out);
+    huge_pages = HUGE_PAGES::TRANSPARENT;
 }
 
 Emulator::~Emulator()
 {
+    stop_trace();
+    stop_profile();
+    stop_draw_stats();
+    stop_hash_log();
     if (ee_log.is_open())
         ee_log.close();
-    if (RDRAM)
-        delete[] RDRAM;
-    if (IOP_RAM)
-        delete[] IOP_RAM;
-    if (BIOS)
-        delete[] BIOS;
-    if (SPU_RAM)
-        delete[] SPU_RAM;
     if (ELF_file)
         delete[] ELF_file;
 }
 
 void Emulator::run()
+{
+    start_frame();
+    while (run_slice());
+    end_frame();
+}
+
+void Emulator::start_frame()
 {
     gs.start_frame();
+    apply_scripted_input();
     instructions_ran = 0;
     VBLANK_sent = false;
-    const int originalRounding = fegetround();
+    host_rounding = fegetround();
     fesetround(FE_TOWARDZERO);
     if (save_requested)
         save_state(save_state_path.c_str());
@@ -75,50 +81,69 @@ void Emulator::run()
             gsdump_running = true;
         }
     }
-    
-    while (instructions_ran < CYCLES_PER_FRAME)
-    {
-        int cycles = cpu.run(16);
-        instructions_ran += cycles;
-        cycles >>= 1;
-        dmac.run(cycles);
-        timers.run(cycles);
-        ipu.run();
-        vif0.update(cycles);
-        vif1.update(cycles);
-        vu0.run(cycles);
-        vu1.run(cycles);
-        cycles >>= 2;
-        iop_timers.run(cycles);
-        iop_dma.run(cycles);
-        iop.run(cycles);
-        for (int i = 0; i < cycles; i++)
-        {
-            if (iop_i_ctrl_delay)
-            {
-                iop_i_ctrl_delay--;
-                if (!iop_i_ctrl_delay)
-                    iop.interrupt_check(IOP_I_CTRL && (IOP_I_MASK & IOP_I_STAT));
-            }
-        }
-        spu.update(cycles);
-        spu2.update(cycles);
-        cdvd.update(cycles);
-        if (!VBLANK_sent && instructions_ran >= VBLANK_START)
+}
+
+//Runs one scheduler slice: up to 16 EE cycles, and everything else for the time that took.
+//Returns false once the frame is finished.
+bool Emulator::run_slice()
+{
+    int cycles = cpu.run(16);
+    instructions_ran += cycles;
+    cycles >>= 1;
+    dmac.run(cycles);
+    timers.run(cycles);
+    if (active_units)
+    {
+        if (active_units & UNIT_IPU)
+            ipu.run();
+        if (active_units & UNIT_VIF0)
+            vif0.update(cycles);
+        if (active_units & UNIT_VIF1)
+            vif1.update(cycles);
+        if (active_units & UNIT_VU0)
+            vu0.run(cycles);
+        if (active_units & UNIT_VU1)
+            vu1.run(cycles);
+    }
+    cycles >>= 2;
+    iop_timers.run(cycles);
+    iop_dma.run(cycles);
+    iop.run(cycles);
+    for (int i = 0; i < cycles; i++)
+    {
+        if (iop_i_ctrl_delay)
         {
-            VBLANK_sent = true;
-            gs.set_VBLANK(true);
-            timers.gate(true, true);
-            cdvd.vsync();
-            //cpu.set_disassembly(frames == 263);
-            printf("VSYNC FRAMES: %d\n", frames);
-            gs.assert_VSYNC();
-            frames++;
-            iop_request_IRQ(0);
-            gs.render_CRT();
+            iop_i_ctrl_delay--;
+            if (!iop_i_ctrl_delay)
+                iop.interrupt_check(IOP_I_CTRL && (IOP_I_MASK & IOP_I_STAT));
         }
     }
-    fesetround(originalRounding);
+    spu.update(cycles);
+    spu2.update(cycles);
+    cdvd.update(cycles);
+    if (!VBLANK_sent && instructions_ran >= VBLANK_START)
+    {
+        VBLANK_sent = true;
+        gs.set_VBLANK(true);
+        timers.gate(true, true);
+        cdvd.vsync();
+        //cpu.set_disassembly(frames == 263);
+        printf("VSYNC FRAMES: %d\n", frames);
+        gs.assert_VSYNC();
+        if (draw_stats_log.is_open())
+            log_draw_stats();
+        if (hash_log.is_open())
+            log_state_hash();
+        frames++;
+        iop_request_IRQ(0);
+        gs.render_CRT();
+    }
+    return instructions_ran < CYCLES_PER_FRAME;
+}
+
+void Emulator::end_frame()
+{
+    fesetround(host_rounding);
     //VBLANK end
     iop_request_IRQ(11);
     gs.set_VBLANK(false);
@@ -131,17 +156,18 @@ void Emulator::reset()
     load_requested = false;
     gsdump_requested = false;
     iop_i_ctrl_delay = 0;
+    active_units = UNIT_ALL;
+    VU_FBRST = 0;
     ee_stdout = "";
     frames = 0;
     skip_BIOS_hack = NONE;
-    if (!RDRAM)
-        RDRAM = new uint8_t[1024 * 1024 * 32];
-    if (!IOP_RAM)
-        IOP_RAM = new uint8_t[1024 * 1024 * 2];
-    if (!BIOS)
-        BIOS = new uint8_t[1024 * 1024 * 4];
-    if (!SPU_RAM)
-        SPU_RAM = new uint8_t[1024 * 1024 * 2];
+    if (!memory.is_allocated())
+        allocate_memory();
+
+    //Loading a state resets first, so this also covers RAM replaced by load_state
+    RDRAM_hash.mark_all_dirty();
+    IOP_RAM_hash.mark_all_dirty();
+    SPU_RAM_hash.mark_all_dirty();
 
     cdvd.reset();
     cp0.reset();
@@ -155,6 +181,7 @@ void Emulator::reset()
     iop_timers.reset();
     intc.reset();
     ipu.reset();
+    memcard.reset();
     pad.reset();
     sif.reset();
     sio2.reset();
@@ -185,6 +212,53 @@ void Emulator::release_button(PAD_BUTTON button)
     pad.release_button(button);
 }
 
+void Emulator::set_analog_axis(PAD_AXIS axis, uint8_t value)
+{
+    pad.set_axis(axis, value);
+}
+
+/*
+The input script is meant for headless automation and is only touched by the thread calling run().
+Scripted events go through the same mailbox as live input, so the pad sees them on its next poll.
+*/
+void Emulator::queue_scripted_button(int frame, PAD_BUTTON button, bool pressed)
+{
+    queue_scripted_input({frame, false, (int)button, pressed});
+}
+
+void Emulator::queue_scripted_axis(int frame, PAD_AXIS axis, uint8_t value)
+{
+    queue_scripted_input({frame, true, (int)axis, value});
+}
+
+void Emulator::clear_input_script()
+{
+    input_script.clear();
+}
+
+void Emulator::queue_scripted_input(const ScriptedInput &event)
+{
+    //Keep the script sorted by frame, preserving queue order for events on the same frame
+    auto pos = std::upper_bound(input_script.begin(), input_script.end(), event,
+                                [](const ScriptedInput& a, const ScriptedInput& b) { return a.frame < b.frame; });
+    input_script.insert(pos, event);
+}
+
+void Emulator::apply_scripted_input()
+{
+    while (!input_script.empty() && input_script.front().frame <= frames)
+    {
+        ScriptedInput& event = input_script.front();
+        if (event.is_axis)
+            pad.set_axis((PAD_AXIS)event.index, event.value);
+        else if (event.value)
+            pad.press_button((PAD_BUTTON)event.index);
+        else
+            pad.release_button((PAD_BUTTON)event.index);
+        input_script.pop_front();
+    }
+}
+
 uint32_t* Emulator::get_framebuffer()
 {
     //This function should only be called upon ending a frame; return nullptr otherwise
@@ -259,6 +333,7 @@ void Emulator::fast_boot()
                     {
                         uint32_t argv = cpu.get_gpr<uint32_t>(5) + 0x40;
                         strcpy((char*)&RDRAM[argv], path.c_str());
+                        mark_dirty(REGION_RDRAM, argv, path.size() + 1);
                         write32(ptr, argv);
                     }
                 }
@@ -274,14 +349,329 @@ void Emulator::set_skip_BIOS_hack(SKIP_HACK type)
     skip_BIOS_hack = type;
 }
 
+//Only takes effect before guest memory is first allocated, i.e. before the first reset
+void Emulator::set_huge_pages(HUGE_PAGES mode)
+{
+    huge_pages = mode;
+}
+
+void Emulator::allocate_memory()
+{
+    memory.allocate(huge_pages);
+    RDRAM = memory.get(REGION_RDRAM);
+    IOP_RAM = memory.get(REGION_IOP_RAM);
+    SPU_RAM = memory.get(REGION_SPU_RAM);
+    if (!shared_BIOS)
+        BIOS = memory.get(REGION_BIOS);
+    gs.set_local_mem(memory.get(REGION_GS_VRAM));
+}
+
 void Emulator::load_BIOS(uint8_t *BIOS_file)
 {
-    if (!BIOS)
-        BIOS = new uint8_t[1024 * 1024 * 4];
+    if (!memory.is_allocated())
+        allocate_memory();
+    shared_BIOS.reset();
+    BIOS = memory.get(REGION_BIOS);
 
     memcpy(BIOS, BIOS_file, 1024 * 1024 * 4);
 }
 
+/**
+Uses a 4 MB BIOS image owned elsewhere instead of a private copy, so that many emulators in one process
+can run from the same image. The BIOS is read-only apart from the scratch area at 0x1FFF8000,
+so the first write to it gives this emulator its own copy.
+**/
+void Emulator::load_shared_BIOS(std::shared_ptr<const uint8_t> BIOS_image)
+{
+    shared_BIOS = BIOS_image;
+    BIOS = const_cast<uint8_t*>(shared_BIOS.get());
+}
+
+void Emulator::unshare_BIOS()
+{
+    if (!memory.is_allocated())
+        allocate_memory();
+    uint8_t* copy = memory.get(REGION_BIOS);
+    memcpy(copy, BIOS, 1024 * 1024 * 4);
+    BIOS = copy;
+    shared_BIOS.reset();
+}
+
+//The EE/IOP console output is only written to disk when a log file has been opened
+bool Emulator::open_ee_log(const char* file_name)
+{
+    if (ee_log.is_open())
+        ee_log.close();
+    ee_log.open(file_name, std::ios::out);
+    return ee_log.is_open();
+}
+
+//Records every instruction the EE, IOP and VUs execute from now on, see trace.hpp for the format
+bool Emulator::start_trace(const char* file_name, int flags)
+{
+    stop_trace();
+    if (!trace.open(file_name, flags))
+        return false;
+    cpu.set_trace(trace.get_stream(TRACE_EE));
+    iop.set_trace(trace.get_stream(TRACE_IOP));
+    vu0.set_trace(trace.get_stream(TRACE_VU0));
+    vu1.set_trace(trace.get_stream(TRACE_VU1));
+    return true;
+}
+
+void Emulator::stop_trace()
+{
+    cpu.set_trace(nullptr);
+    iop.set_trace(nullptr);
+    vu0.set_trace(nullptr);
+    vu1.set_trace(nullptr);
+    trace.close();
+}
+
+/**
+Samples the EE, IOP and VUs every interval EE cycles from now on. When profiling stops, call stacks are written
+to file_name in the folded format flamegraph tools read, and a flat per-function report to file_name + ".txt".
+**/
+void Emulator::start_profile(const char* file_name, int interval)
+{
+    if (!memory.is_allocated())
+        allocate_memory();
+    profile_path = file_name;
+    profiler.set_RAM(PROFILE_EE, RDRAM, 1024 * 1024 * 32);
+    profiler.set_RAM(PROFILE_IOP, IOP_RAM, 1024 * 1024 * 2);
+    profiler.start(interval);
+    cpu.set_profiler(&profiler);
+    iop.set_profiler(&profiler);
+    vu0.set_profiler(&profiler);
+    vu1.set_profiler(&profiler);
+}
+
+bool Emulator::stop_profile()
+{
+    if (!profiler.is_active())
+        return true;
+    cpu.set_profiler(nullptr);
+    iop.set_profiler(nullptr);
+    vu0.set_profiler(nullptr);
+    vu1.set_profiler(nullptr);
+    profiler.stop();
+
+    bool success = profiler.write_folded(profile_path.c_str());
+    success &= profiler.write_report((profile_path + ".txt").c_str(), 50);
+    if (!success)
+        Errors::print_warning("[Emulator] Failed to write the profile to %s\n", profile_path.c_str());
+    return success;
+}
+
+/**
+Logs what the GS did every frame to file_name as CSV, one line per frame, from the next VSYNC on.
+With heatmap, the pixels tested at each frame buffer coordinate are also summed over all frames and written
+to file_name + ".pgm" when logging stops, scaled so that the most drawn pixel is white.
+**/
+bool Emulator::start_draw_stats(const char* file_name, bool heatmap)
+{
+    stop_draw_stats();
+    draw_stats_log.open(file_name, std::ios::out);
+    if (!draw_stats_log.is_open())
+        return false;
+    draw_stats_log << "frame,points,lines,line_strips,triangles,triangle_strips,triangle_fans,sprites,"
+                   << "pixels_tested,pixels_passed,pixels_written,texels_fetched,clut_reloads,"
+                   << "hwreg_bytes,host_to_host_bytes,state_changes\n";
+    heatmap_path = std::string(file_name) + ".pgm";
+    if (heatmap)
+        heatmap_total.assign(GS_HEATMAP_WIDTH * GS_HEATMAP_HEIGHT, 0);
+    gs.set_draw_stats(true, heatmap);
+    return true;
+}
+
+void Emulator::log_draw_stats()
+{
+    GSDrawStats stats;
+    while (gs.pop_draw_stats(stats))
+    {
+        draw_stats_log << frames;
+        for (int i = 0; i < 7; i++)
+            draw_stats_log << "," << stats.prims[i];
+        draw_stats_log << "," << stats.pixels_tested << "," << stats.pixels_passed << "," << stats.pixels_written
+                       << "," << stats.texels_fetched << "," << stats.clut_reloads << "," << stats.hwreg_bytes
+                       << "," << stats.host_to_host_bytes << "," << stats.state_changes << "\n";
+
+        if (stats.heatmap)
+        {
+            if (!heatmap_total.empty())
+            {
+                for (size_t i = 0; i < heatmap_total.size(); i++)
+                    heatmap_total[i] += stats.heatmap[i];
+            }
+            delete[] stats.heatmap;
+        }
+    }
+}
+
+bool Emulator::stop_draw_stats()
+{
+    if (!draw_stats_log.is_open())
+        return true;
+    gs.set_draw_stats(false, false);
+    draw_stats_log.close();
+
+    bool success = true;
+    if (!heatmap_total.empty())
+    {
+        //Only the part of the frame buffer that was drawn to
+        int width = 0, height = 0;
+        uint32_t peak = 0;
+        for (int y = 0; y < GS_HEATMAP_HEIGHT; y++)
+        {
+            for (int x = 0; x < GS_HEATMAP_WIDTH; x++)
+            {
+                uint32_t count = heatmap_total[x + y * GS_HEATMAP_WIDTH];
+                if (count)
+                {
+                    width = std::max(width, x + 1);
+                    height = std::max(height, y + 1);
+                    peak = std::max(peak, count);
+                }
+            }
+        }
+
+        std::ofstream heatmap(heatmap_path, std::ios::out | std::ios::binary);
+        if (heatmap.is_open())
+        {
+            heatmap << "P5\n" << width << " " << height << "\n255\n";
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    uint64_t count = heatmap_total[x + y * GS_HEATMAP_WIDTH];
+                    heatmap.put((char)(count * 255 / peak));
+                }
+            }
+        }
+        success = heatmap.good();
+        if (!success)
+            Errors::print_warning("[Emulator] Failed to write the heatmap to %s\n", heatmap_path.c_str());
+        heatmap_total.clear();
+    }
+    return success;
+}
+
+/**
+Hashes the whole machine state that guest code can observe. Two runs that are in step give the same hash, so
+comparing per-frame hashes finds the first frame where runs diverge, and components narrows down where.
+Guest RAM is hashed in pages and only pages written since the last call are rehashed, so calling this every
+frame costs roughly what the guest writes. GS local memory is hashed on the GS thread the same way.
+If components isn't null, it receives the HASH_COMPONENT_COUNT hashes the result is made of.
+**/
+uint64_t Emulator::hash_state(uint64_t* components)
+{
+    uint64_t hashes[HASH_COMPONENT_COUNT];
+    hashes[HASH_RDRAM] = RDRAM_hash.update(RDRAM);
+    hashes[HASH_IOP_RAM] = IOP_RAM_hash.update(IOP_RAM);
+    hashes[HASH_SPU_RAM] = SPU_RAM_hash.update(SPU_RAM);
+    hashes[HASH_SCRATCHPAD] = StateHash::hash_bytes(scratchpad, sizeof(scratchpad));
+    uint64_t vu_hashes[2] = { vu0.hash_memory(), vu1.hash_memory() };
+    hashes[HASH_VU_MEM] = StateHash::hash_bytes(vu_hashes, sizeof(vu_hashes));
+    hashes[HASH_REGISTERS] = hash_registers();
+    hashes[HASH_GS_VRAM] = gs.hash_local_mem();
+
+    if (components)
+    {
+        for (int i = 0; i < HASH_COMPONENT_COUNT; i++)
+            components[i] = hashes[i];
+    }
+    return StateHash::hash_bytes(hashes, sizeof(hashes));
+}
+
+//EE, IOP and VU registers. Fields are copied one by one so that struct padding stays out of the hash.
+uint64_t Emulator::hash_registers()
+{
+    EE_State ee;
+    cpu.get_state(ee);
+    uint64_t ee_regs[64 + 5 + 3 + 32 + 32 + 2];
+    int count = 0;
+    memcpy(ee_regs, ee.gpr, sizeof(ee.gpr));
+    count += sizeof(ee.gpr) / sizeof(uint64_t);
+    ee_regs[count++] = ee.LO;
+    ee_regs[count++] = ee.HI;
+    ee_regs[count++] = ee.LO1;
+    ee_regs[count++] = ee.HI1;
+    ee_regs[count++] = ee.SA;
+    ee_regs[count++] = ee.PC;
+    ee_regs[count++] = ee.new_PC;
+    ee_regs[count++] = ee.branch_on;
+    for (int i = 0; i < 32; i++)
+        ee_regs[count++] = ee.cop0[i];
+    for (int i = 0; i < 32; i++)
+        ee_regs[count++] = ee.fpr[i];
+    ee_regs[count++] = ee.fpu_acc;
+    ee_regs[count++] = ee.fpu_control;
+
+    IOP_State iop_state;
+    iop.get_state(iop_state);
+    uint32_t iop_regs[32 + 8];
+    memcpy(iop_regs, iop_state.gpr, sizeof(iop_state.gpr));
+    iop_regs[32] = iop_state.PC;
+    iop_regs[33] = iop_state.LO;
+    iop_regs[34] = iop_state.HI;
+    iop_regs[35] = iop_state.new_PC;
+    iop_regs[36] = iop_state.will_branch;
+    iop_regs[37] = iop_state.cop0_status;
+    iop_regs[38] = iop_state.cop0_cause;
+    iop_regs[39] = iop_state.cop0_EPC;
+
+    uint64_t hashes[4];
+    hashes[0] = StateHash::hash_bytes(ee_regs, count * sizeof(uint64_t));
+    hashes[1] = StateHash::hash_bytes(iop_regs, sizeof(iop_regs));
+    hashes[2] = vu0.hash_registers();
+    hashes[3] = vu1.hash_registers();
+    return StateHash::hash_bytes(hashes, sizeof(hashes));
+}
+
+//Logs hash_state and every component to file_name as CSV at each VSYNC, for diffing two runs frame by frame
+bool Emulator::start_hash_log(const char* file_name)
+{
+    stop_hash_log();
+    hash_log.open(file_name, std::ios::out);
+    if (!hash_log.is_open())
+        return false;
+    hash_log << "frame,state";
+    for (int i = 0; i < HASH_COMPONENT_COUNT; i++)
+        hash_log << "," << StateHash::component_name((HASH_COMPONENT)i);
+    hash_log << "\n";
+    return true;
+}
+
+void Emulator::log_state_hash()
+{
+    uint64_t components[HASH_COMPONENT_COUNT];
+    uint64_t state = hash_state(components);
+
+    char hex[20];
+    snprintf(hex, sizeof(hex), "%016llX", (unsigned long long)state);
+    hash_log << frames << "," << hex;
+    for (int i = 0; i < HASH_COMPONENT_COUNT; i++)
+    {
+        snprintf(hex, sizeof(hex), "%016llX", (unsigned long long)components[i]);
+        hash_log << "," << hex;
+    }
+    hash_log << "\n";
+}
+
+bool Emulator::stop_hash_log()
+{
+    if (!hash_log.is_open())
+        return true;
+    hash_log.close();
+    return !hash_log.fail();
+}
+
+//Symbols for code the emulator doesn't load itself, e.g. a disc's executable or an IRX module at its load address
+bool Emulator::load_symbols(PROFILE_UNIT unit, const char* file_name, uint32_t base, std::string& error)
+{
+    return profiler.get_symbols(unit).load_file(file_name, base, error);
+}
+
 void Emulator::load_ELF(uint8_t *ELF, uint32_t size)
 {
     if (ELF[0] != 0x7F || ELF[1] != 'E' || ELF[2] != 'L' || ELF[3] != 'F')
@@ -302,6 +692,16 @@ bool Emulator::load_CDVD(const char *name)
     return cdvd.load_disc(name);
 }
 
+bool Emulator::load_memcard(const char *name)
+{
+    return memcard.open(name);
+}
+
+void Emulator::load_temporary_memcard()
+{
+    memcard.open_in_memory();
+}
+
 void Emulator::execute_ELF()
 {
     if (!ELF_file)
@@ -323,6 +723,13 @@ void Emulator::execute_ELF()
     printf("Section header entries: %d\n", e_shnum);
     printf("Section header names index: %d\n", e_shstrndx);
 
+    if (profiler.is_active())
+    {
+        std::string error;
+        if (!profiler.get_symbols(PROFILE_EE).load_elf(ELF_file, ELF_size, 0, error))
+            printf("[Emulator] No symbols for the profiler: %s\n", error.c_str());
+    }
+
     for (unsigned int i = e_phoff; i < e_phoff + (e_phnum * 0x20); i += 0x20)
     {
         uint32_t p_offset = *(uint32_t*)&ELF_file[i + 0x4];
@@ -567,6 +974,12 @@ uint128_t Emulator::read128(uint32_t address)
         return *(uint128_t*)&RDRAM[address & 0x01FFFFFF];
     if (address >= 0x1FC00000 && address < 0x20000000)
         return *(uint128_t*)&BIOS[address & 0x3FFFFF];
+    if (address == 0x10005000)
+    {
+        uint128_t quad = uint128_t::from_u32(0);
+        vif1.read_DMA(quad);
+        return quad;
+    }
     printf("Unrecognized read128 at physical addr $%08X\n", address);
     return uint128_t::from_u32(0);
 }
@@ -575,6 +988,7 @@ void Emulator::write8(uint32_t address, uint8_t value)
 {
     if (address < 0x10000000)
     {
+        mark_dirty(REGION_RDRAM, address);
         RDRAM[address & 0x01FFFFFF] = value;
         return;
     }
@@ -585,11 +999,14 @@ void Emulator::write8(uint32_t address, uint8_t value)
     }
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
+        mark_dirty(REGION_IOP_RAM, address);
         IOP_RAM[address & 0x1FFFFF] = value;
         return;
     }
     if (address >= 0x1FFF8000 && address < 0x20000000)
     {
+        if (shared_BIOS)
+            unshare_BIOS();
         BIOS[address & 0x3FFFFF] = value;
         return;
     }
@@ -607,6 +1024,7 @@ void Emulator::write16(uint32_t address, uint16_t value)
 {
     if (address < 0x10000000)
     {
+        mark_dirty(REGION_RDRAM, address);
         *(uint16_t*)&RDRAM[address & 0x01FFFFFF] = value;
         return;
     }
@@ -617,6 +1035,7 @@ void Emulator::write16(uint32_t address, uint16_t value)
     }
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
+        mark_dirty(REGION_IOP_RAM, address);
         *(uint16_t*)&IOP_RAM[address & 0x1FFFFF] = value;
         return;
     }
@@ -627,6 +1046,8 @@ void Emulator::write16(uint32_t address, uint16_t value)
     }
     if (address >= 0x1FFF8000 && address < 0x20000000)
     {
+        if (shared_BIOS)
+            unshare_BIOS();
         *(uint16_t*)&BIOS[address & 0x3FFFFF] = value;
         return;
     }
@@ -637,16 +1058,20 @@ void Emulator::write32(uint32_t address, uint32_t value)
 {
     if (address < 0x10000000)
     {
+        mark_dirty(REGION_RDRAM, address);
         *(uint32_t*)&RDRAM[address & 0x01FFFFFF] = value;
         return;
     }
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
+        mark_dirty(REGION_IOP_RAM, address);
         *(uint32_t*)&IOP_RAM[address & 0x1FFFFF] = value;
         return;
     }
     if (address >= 0x1FFF8000 && address < 0x20000000)
     {
+        if (shared_BIOS)
+            unshare_BIOS();
         *(uint32_t*)&BIOS[address & 0x3FFFFF] = value;
         return;
     }
@@ -737,16 +1162,20 @@ void Emulator::write64(uint32_t address, uint64_t value)
 {
     if (address < 0x10000000)
     {
+        mark_dirty(REGION_RDRAM, address);
         *(uint64_t*)&RDRAM[address & 0x01FFFFFF] = value;
         return;
     }
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
+        mark_dirty(REGION_IOP_RAM, address);
         *(uint64_t*)&IOP_RAM[address & 0x1FFFFF] = value;
         return;
     }
     if (address >= 0x1FFF8000 && address < 0x20000000)
     {
+        if (shared_BIOS)
+            unshare_BIOS();
         *(uint64_t*)&BIOS[address & 0x3FFFFF] = value;
         return;
     }
@@ -792,6 +1221,7 @@ void Emulator::write128(uint32_t address, uint128_t value)
 {
     if (address < 0x10000000)
     {
+        mark_dirty(REGION_RDRAM, address);
         *(uint128_t*)&RDRAM[address & 0x01FFFFFF] = value;
         return;
     }
@@ -832,6 +1262,8 @@ void Emulator::write128(uint32_t address, uint128_t value)
     }
     if (address >= 0x1FFF8000 && address < 0x20000000)
     {
+        if (shared_BIOS)
+            unshare_BIOS();
         *(uint128_t*)&BIOS[address & 0x3FFFFF] = value;
         return;
     }
@@ -1104,6 +1536,7 @@ void Emulator::iop_write8(uint32_t address, uint8_t value)
     if (address < 0x00200000)
     {
         //printf("[IOP] Write to $%08X of $%02X\n", address, value);
+        mark_dirty(REGION_IOP_RAM, address);
         IOP_RAM[address] = value;
         return;
     }
@@ -1151,6 +1584,7 @@ void Emulator::iop_write16(uint32_t address, uint16_t value)
     if (address < 0x00200000)
     {
         //printf("[IOP] Write16 to $%08X of $%08X\n", address, value);
+        mark_dirty(REGION_IOP_RAM, address);
         *(uint16_t*)&IOP_RAM[address] = value;
         return;
     }
@@ -1274,6 +1708,7 @@ void Emulator::iop_write32(uint32_t address, uint32_t value)
     if (address < 0x00200000)
     {
         //printf("[IOP] Write to $%08X of $%08X\n", address, value);
+        mark_dirty(REGION_IOP_RAM, address);
         *(uint32_t*)&IOP_RAM[address] = value;
         return;
     }
@@ -1601,6 +2036,26 @@ GraphicsSynthesizer& Emulator::get_gs()
     return gs;
 }
 
+EmotionEngine& Emulator::get_ee()
+{
+    return cpu;
+}
+
+IOP& Emulator::get_iop()
+{
+    return iop;
+}
+
+VectorInterface& Emulator::get_vif1()
+{
+    return vif1;
+}
+
+VectorUnit& Emulator::get_vu1()
+{
+    return vu1;
+}
+
 void Emulator::request_gsdump_toggle()
 {
     gsdump_requested = true;
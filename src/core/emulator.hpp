@@ -1,6 +1,9 @@
 #ifndef EMULATOR_HPP
 #define EMULATOR_HPP
+#include <deque>
 #include <fstream>
+#include <memory>
+#include <vector>
 
 #include "ee/dmac.hpp"
 #include "ee/emotion.hpp"
@@ -22,7 +25,11 @@
 #include "int128.hpp"
 #include "gs.hpp"
 #include "gif.hpp"
+#include "guestmemory.hpp"
+#include "profiler.hpp"
 #include "sif.hpp"
+#include "statehash.hpp"
+#include "trace.hpp"
 
 enum SKIP_HACK
 {
@@ -31,12 +38,38 @@ enum SKIP_HACK
     LOAD_DISC
 };
 
+//Units that are only stepped while they have work to do. Each unit wakes itself when it is given work
+//and puts itself to sleep the first time it is stepped with nothing to do.
+enum ACTIVE_UNIT
+{
+    UNIT_VU0 = 1 << 0,
+    UNIT_VU1 = 1 << 1,
+    UNIT_VIF0 = 1 << 2,
+    UNIT_VIF1 = 1 << 3,
+    UNIT_IPU = 1 << 4,
+    UNIT_ALL = 0x1F
+};
+
+//An input event queued by automation, applied at the start of the given frame
+struct ScriptedInput
+{
+    int frame;
+    bool is_axis;
+    int index;
+    uint8_t value;
+};
+
 class Emulator
 {
     private:
         std::atomic_bool save_requested, load_requested, gsdump_requested, gsdump_single_frame, gsdump_running;
         std::string save_state_path;
         int frames;
+
+        //Declared first so that it outlives every unit (and the GS thread) using it
+        GuestMemory memory;
+        HUGE_PAGES huge_pages;
+
         Cop0 cp0;
         Cop1 fpu;
         CDVD_Drive cdvd;
@@ -54,27 +87,47 @@ class Emulator
         Memcard memcard;
         SIO2 sio2;
         SPU spu, spu2;
+        SPU_COMMON spu_common;
         SubsystemInterface sif;
         VectorInterface vif0, vif1;
         VectorUnit vu0, vu1;
+        uint32_t VU_FBRST;
 
         bool VBLANK_sent;
         bool cop2_interlock, vu_interlock;
 
+        uint32_t active_units;
+
         std::ofstream ee_log;
         std::string ee_stdout;
 
+        TraceRecorder trace;
+        Profiler profiler;
+        std::string profile_path;
+
+        std::ofstream draw_stats_log;
+        std::string heatmap_path;
+        std::vector<uint32_t> heatmap_total;
+
+        //Pages of guest RAM written since the last state hash
+        PageHasher RDRAM_hash, IOP_RAM_hash, SPU_RAM_hash;
+        std::ofstream hash_log;
+
         uint8_t* RDRAM;
         uint8_t* IOP_RAM;
         uint8_t* BIOS;
         uint8_t* SPU_RAM;
 
-        uint8_t scratchpad[1024 * 16];
+        //Set when BIOS points into an image shared with other emulators
+        std::shared_ptr<const uint8_t> shared_BIOS;
+
+        alignas(16) uint8_t scratchpad[1024 * 16];
 
         uint32_t MCH_RICM, MCH_DRD;
         uint8_t rdram_sdevid;
 
         uint32_t instructions_ran;
+        int host_rounding;
 
         uint8_t IOP_POST;
         uint32_t IOP_I_STAT;
@@ -87,20 +140,53 @@ class Emulator
         uint8_t* ELF_file;
         uint32_t ELF_size;
 
+        std::deque<ScriptedInput> input_script;
+
+        void apply_scripted_input();
+        void queue_scripted_input(const ScriptedInput& event);
+        void log_draw_stats();
+        void log_state_hash();
+        uint64_t hash_registers();
         void iop_IRQ_check(uint32_t new_stat, uint32_t new_mask);
+        void unshare_BIOS();
+        void allocate_memory();
     public:
         Emulator();
         ~Emulator();
         void run();
+        void start_frame();
+        bool run_slice();
+        void end_frame();
         void reset();
         void press_button(PAD_BUTTON button);
         void release_button(PAD_BUTTON button);
+        void set_analog_axis(PAD_AXIS axis, uint8_t value);
+        void queue_scripted_button(int frame, PAD_BUTTON button, bool pressed);
+        void queue_scripted_axis(int frame, PAD_AXIS axis, uint8_t value);
+        void clear_input_script();
         bool skip_BIOS();
         void fast_boot();
         void set_skip_BIOS_hack(SKIP_HACK type);
+        void set_huge_pages(HUGE_PAGES mode);
         void load_BIOS(uint8_t* BIOS);
+        void load_shared_BIOS(std::shared_ptr<const uint8_t> BIOS);
+        bool open_ee_log(const char* file_name);
+        bool start_trace(const char* file_name, int flags);
+        void stop_trace();
+        void start_profile(const char* file_name, int interval = Profiler::DEFAULT_INTERVAL);
+        bool stop_profile();
+        bool start_draw_stats(const char* file_name, bool heatmap);
+        bool stop_draw_stats();
+        bool start_hash_log(const char* file_name);
+        bool stop_hash_log();
+        uint64_t hash_state(uint64_t* components = nullptr);
+        void mark_dirty(GUEST_REGION region, uint32_t offset);
+        void mark_dirty(GUEST_REGION region, uint32_t offset, uint32_t size);
+        bool load_symbols(PROFILE_UNIT unit, const char* file_name, uint32_t base, std::string& error);
         void load_ELF(uint8_t* ELF, uint32_t size);
         bool load_CDVD(const char* name);
+        bool load_memcard(const char* name);
+        void load_temporary_memcard();
         void execute_ELF();
         uint32_t* get_framebuffer();
         void get_resolution(int& w, int& h);
@@ -113,6 +199,9 @@ class Emulator
         void load_state(const char* file_name);
         void save_state(const char* file_name);
 
+        void wake_unit(ACTIVE_UNIT unit);
+        void sleep_unit(ACTIVE_UNIT unit);
+
         bool interlock_cop2_check(bool isCOP2);
         void clear_cop2_interlock();
         bool check_cop2_interlock();
@@ -144,6 +233,57 @@ class Emulator
 
         void test_iop();
         GraphicsSynthesizer& get_gs();//used for gs dumps
+        EmotionEngine& get_ee();//used for lockstep testing
+        IOP& get_iop();
+        VectorInterface& get_vif1();//used for VIF tests
+        VectorUnit& get_vu1();
 };
 
+inline void Emulator::wake_unit(ACTIVE_UNIT unit)
+{
+    active_units |= unit;
+}
+
+inline void Emulator::sleep_unit(ACTIVE_UNIT unit)
+{
+    active_units &= ~unit;
+}
+
+//Every write to guest RAM goes through here so that the state hash only has to revisit pages that changed
+inline void Emulator::mark_dirty(GUEST_REGION region, uint32_t offset)
+{
+    switch (region)
+    {
+        case REGION_RDRAM:
+            RDRAM_hash.mark_dirty(offset);
+            break;
+        case REGION_IOP_RAM:
+            IOP_RAM_hash.mark_dirty(offset);
+            break;
+        case REGION_SPU_RAM:
+            SPU_RAM_hash.mark_dirty(offset);
+            break;
+        default:
+            break;
+    }
+}
+
+inline void Emulator::mark_dirty(GUEST_REGION region, uint32_t offset, uint32_t size)
+{
+    switch (region)
+    {
+        case REGION_RDRAM:
+            RDRAM_hash.mark_dirty(offset, size);
+            break;
+        case REGION_IOP_RAM:
+            IOP_RAM_hash.mark_dirty(offset, size);
+            break;
+        case REGION_SPU_RAM:
+            SPU_RAM_hash.mark_dirty(offset, size);
+            break;
+        default:
+            break;
+    }
+}
+
 #endif // EMULATOR_HPP
@@ -0,0 +1,157 @@
+#include <cstring>
+#include "emulatorpool.hpp"
+#include "threadtopology.hpp"
+
+using namespace std;
+
+EmulatorPool::EmulatorPool(int count, int thread_count) :
+    generation(0), job(POOL_RUN_FRAME), workers_busy(0), shutting_down(false)
+{
+    for (int i = 0; i < count; i++)
+        emulators.emplace_back(new Emulator());
+    errors.resize(count);
+
+    worker_count = thread_count;
+    if (worker_count > count)
+        worker_count = count;
+    if (worker_count < 1)
+        worker_count = 1;
+    for (int i = 0; i < worker_count; i++)
+        workers.emplace_back(&EmulatorPool::worker_loop, this, i);
+}
+
+EmulatorPool::~EmulatorPool()
+{
+    //Each emulator is torn down by the worker that ran it
+    dispatch(POOL_DESTROY);
+    {
+        lock_guard<mutex> lock(work_mutex);
+        shutting_down = true;
+    }
+    work_cv.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+int EmulatorPool::size()
+{
+    return emulators.size();
+}
+
+Emulator& EmulatorPool::get(int index)
+{
+    return *emulators[index];
+}
+
+void EmulatorPool::load_BIOS(const uint8_t* BIOS_file)
+{
+    uint8_t* image = new uint8_t[1024 * 1024 * 4];
+    memcpy(image, BIOS_file, 1024 * 1024 * 4);
+    BIOS = shared_ptr<const uint8_t>(image, default_delete<uint8_t[]>());
+
+    for (auto& emulator : emulators)
+        emulator->load_shared_BIOS(BIOS);
+}
+
+void EmulatorPool::reset()
+{
+    dispatch(POOL_RESET);
+}
+
+//Runs one frame on every emulator that hasn't failed and waits for all of them
+void EmulatorPool::run_frame()
+{
+    dispatch(POOL_RUN_FRAME);
+}
+
+//Hands the job to every worker and waits until all of them are done with it
+void EmulatorPool::dispatch(POOL_JOB new_job)
+{
+    unique_lock<mutex> lock(work_mutex);
+    job = new_job;
+    generation++;
+    workers_busy = worker_count;
+    work_cv.notify_all();
+    done_cv.wait(lock, [this] { return !workers_busy; });
+}
+
+bool EmulatorPool::has_failed(int index)
+{
+    return !errors[index].empty();
+}
+
+const string& EmulatorPool::get_error(int index)
+{
+    return errors[index];
+}
+
+void EmulatorPool::worker_loop(int worker_id)
+{
+    ThreadRoleScope role(ROLE_CORE);
+    uint64_t last_generation = 0;
+    unique_lock<mutex> lock(work_mutex);
+    while (true)
+    {
+        work_cv.wait(lock, [&] { return shutting_down || generation != last_generation; });
+        if (shutting_down)
+            return;
+        last_generation = generation;
+        POOL_JOB current_job = job;
+        lock.unlock();
+
+        for (int i = worker_id; i < size(); i += worker_count)
+        {
+            switch (current_job)
+            {
+                case POOL_RUN_FRAME:
+                    run_emulator(i);
+                    break;
+                case POOL_RESET:
+                    reset_emulator(i);
+                    break;
+                case POOL_DESTROY:
+                    emulators[i].reset();
+                    break;
+            }
+        }
+
+        lock.lock();
+        workers_busy--;
+        if (!workers_busy)
+            done_cv.notify_one();
+    }
+}
+
+void EmulatorPool::run_emulator(int index)
+{
+    if (has_failed(index))
+        return;
+    try
+    {
+        emulators[index]->run();
+
+        //Take the finished frame so that the GS thread's return queue doesn't back up
+        emulators[index]->get_framebuffer();
+    }
+    catch (runtime_error& e)
+    {
+        errors[index] = e.what();
+        if (errors[index].empty())
+            errors[index] = "Unknown error";
+    }
+}
+
+void EmulatorPool::reset_emulator(int index)
+{
+    errors[index].clear();
+    try
+    {
+        emulators[index]->reset();
+    }
+    catch (runtime_error& e)
+    {
+        errors[index] = e.what();
+        if (errors[index].empty())
+            errors[index] = "Unknown error";
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef EMULATORPOOL_HPP
+#define EMULATORPOOL_HPP
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "emulator.hpp"
+
+//What the workers do with their emulators when woken
+enum POOL_JOB
+{
+    POOL_RUN_FRAME,
+    POOL_RESET,
+    POOL_DESTROY
+};
+
+/**
+Runs many independent emulators in one process.
+All of them run from one shared BIOS image; the IPU and GS lookup tables are process-wide already.
+A fixed set of worker threads steps the emulators a frame at a time. Each emulator is only ever reset, run and
+destroyed on the same worker, since the GS output buffer locks taken while fetching a frame must be released
+by the thread that took them.
+**/
+class EmulatorPool
+{
+    private:
+        std::vector<std::unique_ptr<Emulator>> emulators;
+        std::vector<std::string> errors;
+        std::shared_ptr<const uint8_t> BIOS;
+
+        std::vector<std::thread> workers;
+        int worker_count;
+        std::mutex work_mutex;
+        std::condition_variable work_cv, done_cv;
+        uint64_t generation;
+        POOL_JOB job;
+        int workers_busy;
+        bool shutting_down;
+
+        void dispatch(POOL_JOB new_job);
+        void worker_loop(int worker_id);
+        void run_emulator(int index);
+        void reset_emulator(int index);
+    public:
+        EmulatorPool(int count, int thread_count);
+        ~EmulatorPool();
+
+        int size();
+        Emulator& get(int index);
+
+        void load_BIOS(const uint8_t* BIOS_file);
+        void reset();
+        void run_frame();
+
+        bool has_failed(int index);
+        const std::string& get_error(int index);
+};
+
+#endif // EMULATORPOOL_HPP
@@ -1,8 +1,11 @@
 #include <cstdio>
+#include <cstring>
 #include "gif.hpp"
 #include "gs.hpp"
 
-GraphicsInterface::GraphicsInterface(GraphicsSynthesizer *gs) : gs(gs)
+#include "ee/dmac.hpp"
+
+GraphicsInterface::GraphicsInterface(GraphicsSynthesizer *gs, DMAC* dmac) : gs(gs), dmac(dmac)
 {
 
 }
@@ -23,6 +26,12 @@ void GraphicsInterface::reset()
     intermittent_mode = false;
     path3_vif_masked = false;
     path3_mode_masked = false;
+    memset(path_stats, 0, sizeof(path_stats));
+}
+
+GIFPathStats GraphicsInterface::get_path_stats(int index)
+{
+    return path_stats[index];
 }
 
 uint32_t GraphicsInterface::read_STAT()
@@ -53,6 +62,7 @@ void GraphicsInterface::write_MODE(uint32_t value)
     intermittent_mode = value & 0x4;
     path3_mode_masked = value & 0x1;
     resume_path3();
+    arbitrate();
 }
 
 void GraphicsInterface::process_PACKED(uint128_t data)
@@ -234,11 +244,28 @@ void GraphicsInterface::feed_GIF(uint128_t data)
         path_status[active_path] = 4;
         gs->assert_FINISH();
     }
+
+    //PATH3 entering IMAGE mode or going idle may let a queued path preempt it
+    if (active_path == 3 && path_queue)
+        arbitrate();
 }
 
 void GraphicsInterface::set_path3_vifmask(int value)
 {
     path3_vif_masked = value;
+    arbitrate();
+}
+
+void GraphicsInterface::resume_path3()
+{
+    if (path3_vif_masked || path3_mode_masked)
+        return;
+    if ((active_path == 3 || (path_queue & (1 << 3))) && path_status[3] == 4)
+    {
+        //printf("[GIF] Resuming PATH3\n");
+        path_status[3] = 0; //Force it to be busy so if VIF puts the mask back on quickly, it doesn't instantly mask it
+        arbitrate();
+    }
 }
 
 bool GraphicsInterface::path3_masked(int index)
@@ -255,49 +282,30 @@ bool GraphicsInterface::path3_masked(int index)
     return masked;
 }
 
-bool GraphicsInterface::interrupt_path3(int index)
+bool GraphicsInterface::path3_interruptible()
 {
-    //Can't interrupt other paths
-    if (active_path != 3)
-        return false;
-
-    if (index == 3)
-        return true;
-
-    if ((intermittent_mode && path_status[3] >= 2) || path3_masked(3)) //IMAGE MODE or IDLE
-    {
-        //printf("[GIF] Interrupting PATH3 with PATH%d\n", index);
-        deactivate_PATH(3);
-        //printf("Active Path Now %d\n", active_path);
-        path_queue |= 1 << 3;
-        return true;
-    }
-    return false;
+    return (intermittent_mode && path_status[3] >= 2) || path3_masked(3); //IMAGE MODE or IDLE
 }
 
-void GraphicsInterface::request_PATH(int index, bool canInterruptPath3)
+/**
+Resolves which path owns the GIF. Requests wait in path_queue and are granted in priority order
+(PATH1, then PATH2, then PATH3) whenever the GIF is free. PATH3 can additionally be preempted by a
+queued PATH1/PATH2 while it is masked and idle, or while it is sending IMAGE data in intermittent mode.
+In that case it's requeued and resumes once the higher priority paths are done.
+Once PATH3 becomes usable, the DMAC is notified so that the GIF channel doesn't need to spin on it.
+**/
+void GraphicsInterface::arbitrate()
 {
-    //printf("[GIF] PATH%d requested active path %d\n", index, active_path);
-    if (!active_path || (canInterruptPath3 && interrupt_path3(index)))
-    {
-        active_path = index;
-        //printf("[GIF] PATH%d Active!\n", active_path);
-    }
-    else
+    if (active_path == 3 && (path_queue & ((1 << 1) | (1 << 2))) && path3_interruptible())
     {
-        path_queue |= 1 << index;
-        //printf("[GIF] PATH%d Queued!\n", index);
+        //printf("[GIF] Interrupting PATH3\n");
+        path_stats[3].interrupted++;
+        active_path = 0;
+        path_queue |= 1 << 3;
     }
-}
 
-void GraphicsInterface::deactivate_PATH(int index)
-{
-    //printf("[GIF] PATH%d deactivated\n", index);
-    path_queue &= ~(1 << index);
-    if (active_path == index)
+    if (!active_path)
     {
-        active_path = 0;
-
         for (int path = 1; path <= 3; path++)
         {
             int bit = 1 << path;
@@ -310,6 +318,33 @@ void GraphicsInterface::deactivate_PATH(int index)
             }
         }
     }
+
+    if (path_available(3))
+        dmac->wake_channel(DMAC::GIF);
+}
+
+//Queues the path; arbitrate() grants it once nothing with higher priority holds the GIF
+void GraphicsInterface::request_PATH(int index)
+{
+    //printf("[GIF] PATH%d requested active path %d\n", index, active_path);
+    path_stats[index].requests++;
+    if (active_path == index)
+        return;
+    if (active_path)
+        path_stats[index].queued++;
+    path_queue |= 1 << index;
+    arbitrate();
+}
+
+void GraphicsInterface::deactivate_PATH(int index)
+{
+    //printf("[GIF] PATH%d deactivated\n", index);
+    path_queue &= ~(1 << index);
+    if (active_path == index)
+    {
+        active_path = 0;
+        arbitrate();
+    }
 }
 
 bool GraphicsInterface::send_PATH(int index, uint128_t quad)
@@ -340,3 +375,9 @@ void GraphicsInterface::send_PATH3(uint128_t data)
     //printf("[GIF] Send PATH3 $%08X_%08X_%08X_%08X\n", data._u32[3], data._u32[2], data._u32[1], data._u32[0]);
     feed_GIF(data);
 }
+
+//Local to host transfers come back through the GIF in the other direction
+bool GraphicsInterface::read_GS_FIFO(uint128_t& quad)
+{
+    return gs->read_FIFO(quad);
+}
@@ -25,10 +25,22 @@ struct GIFPath
     GIFtag current_tag;
 };
 
+//Contention counters, kept per path
+struct GIFPathStats
+{
+    uint64_t requests;
+    uint64_t queued; //Requests that had to wait behind another path
+    uint64_t interrupted; //PATH3 only: times it was preempted by PATH1/PATH2
+    uint64_t stalled_polls; //Times the producer found the path unavailable
+};
+
+class DMAC;
+
 class GraphicsInterface
 {
     private:
         GraphicsSynthesizer* gs;
+        DMAC* dmac;
         
         GIFPath path[4];
 
@@ -40,15 +52,21 @@ class GraphicsInterface
         bool path3_mode_masked;
         bool intermittent_mode;
 
+        GIFPathStats path_stats[4];
+
         float internal_Q;
 
+        bool path3_interruptible();
+        void arbitrate();
+
         void process_PACKED(uint128_t quad);
         void process_REGLIST(uint128_t quad);
         void feed_GIF(uint128_t quad);
     public:
-        GraphicsInterface(GraphicsSynthesizer* gs);
+        GraphicsInterface(GraphicsSynthesizer* gs, DMAC* dmac);
         void reset();
 
+        bool path_available(int index);
         bool path_active(int index);
         bool path_activepath3(int index);
         void resume_path3();
@@ -56,49 +74,43 @@ class GraphicsInterface
         uint32_t read_STAT();
         void write_MODE(uint32_t value);
 
-        void request_PATH(int index, bool canInterruptPath3);
+        void request_PATH(int index);
         void deactivate_PATH(int index);
         void set_path3_vifmask(int value);
         bool path3_masked(int index);
-        bool interrupt_path3(int index);
+
+        GIFPathStats get_path_stats(int index);
 
         bool send_PATH(int index, uint128_t quad);
 
         bool send_PATH1(uint128_t quad);
         void send_PATH2(uint32_t data[4]);
         void send_PATH3(uint128_t quad);
+        bool read_GS_FIFO(uint128_t& quad);
 
         void load_state(std::ifstream& state);
         void save_state(std::ofstream& state);
 };
 
-inline bool GraphicsInterface::path_active(int index)
+//Arbitration is resolved whenever a request, release or mask changes, so polling a path is just a few compares
+inline bool GraphicsInterface::path_available(int index)
 {
-    if (index != 3)
-    {
-        interrupt_path3(index);
-    }
-    return (active_path == index) && !path3_masked(index) && !gs->stalled();
+    return (active_path == index) && !path3_masked(index);
 }
 
-inline bool GraphicsInterface::path_activepath3(int index)
+inline bool GraphicsInterface::path_active(int index)
 {
-    if (index != 3)
+    if (!path_available(index) || gs->stalled())
     {
-        interrupt_path3(index);
+        path_stats[index].stalled_polls++;
+        return false;
     }
-    return ((active_path == index) || (path_queue & (1 << 3))) && !path3_masked(index) && !gs->stalled();
+    return true;
 }
 
-inline void GraphicsInterface::resume_path3()
+inline bool GraphicsInterface::path_activepath3(int index)
 {
-    if (path3_vif_masked || path3_mode_masked)
-        return;
-    if ((active_path == 3 || (path_queue & (1 << 3))) && path_status[3] == 4)
-    {
-        //printf("[GIF] Resuming PATH3\n");
-        path_status[3] = 0; //Force it to be busy so if VIF puts the mask back on quickly, it doesn't instantly mask it
-    }
+    return ((active_path == index) || (path_queue & (1 << 3))) && !path3_masked(index) && !gs->stalled();
 }
 
 #endif // GIF_HPP
@@ -22,6 +22,12 @@ GraphicsSynthesizer::GraphicsSynthesizer(INTC* intc) : intc(intc)
     output_buffer2 = nullptr;
     message_queue = nullptr;
     return_queue = nullptr;
+    local_mem = nullptr;
+    draw_stats_enabled = false;
+    draw_stats_heatmap = false;
+    readbacks_requested = 0;
+    readback = { nullptr, 0 };
+    readback_pos = 0;
     gsthread_id = std::thread();//no thread/default constructor
 }
 
@@ -34,6 +40,8 @@ GraphicsSynthesizer::~GraphicsSynthesizer()
         send_message({ GSCommand::die_t,payload });
         gsthread_id.join();
     }
+    if (return_queue)
+        clear_returns();
     if (output_buffer1)
         delete[] output_buffer1;
     if (output_buffer2)
@@ -44,6 +52,12 @@ GraphicsSynthesizer::~GraphicsSynthesizer()
         delete return_queue;
 }
 
+//Hands the GS thread 4 MB of VRAM owned by the caller. Without it, the GS thread allocates its own.
+void GraphicsSynthesizer::set_local_mem(uint8_t* mem)
+{
+    local_mem = mem;
+}
+
 void GraphicsSynthesizer::reset()
 {
     if (!output_buffer1)
@@ -66,14 +80,44 @@ void GraphicsSynthesizer::reset()
         send_message({ GSCommand::die_t,payload });
         gsthread_id.join();
     }
-    {
-        GSReturnMessage data;
-        while (return_queue->pop(data));
+    clear_returns();
 
-        GSMessage data2;
-        while (message_queue->pop(data2));
+    //Start over with an empty queue, which also gives back any segments a burst left behind
+    if (message_queue)
+        delete message_queue;
+    message_queue = new gs_fifo();
+    gsthread_id = std::thread(&GraphicsSynthesizerThread::event_loop, message_queue, return_queue, local_mem);//pass references to the fifos
+
+    if (draw_stats_enabled)
+        set_draw_stats(true, draw_stats_heatmap);
+}
+
+//Throws away every return the old GS thread left behind, along with the draw stats it sent
+void GraphicsSynthesizer::clear_returns()
+{
+    GSReturnMessage data;
+    while (return_queue->pop(data))
+    {
+        if (data.type == draw_stats_t)
+        {
+            delete[] data.payload.draw_stats_payload.stats->heatmap;
+            delete data.payload.draw_stats_payload.stats;
+        }
+        else if (data.type == local_to_host_done_t)
+            delete[] data.payload.readback_payload.data;
     }
-    gsthread_id = std::thread(&GraphicsSynthesizerThread::event_loop, message_queue, return_queue);//pass references to the fifos
+    deferred_returns.clear();
+    for (auto& stats : draw_stats)
+        delete[] stats.heatmap;
+    draw_stats.clear();
+
+    for (auto& transfer : readbacks)
+        delete[] transfer.data;
+    readbacks.clear();
+    delete[] readback.data;
+    readback = { nullptr, 0 };
+    readback_pos = 0;
+    readbacks_requested = 0;
 }
 
 void GraphicsSynthesizer::start_frame()
@@ -95,26 +139,41 @@ void GraphicsSynthesizer::set_CRT(bool interlaced, int mode, bool frame_mode)
     send_message({ GSCommand::set_crt_t,payload });
 }
 
-void wait_for_return(gs_return_fifo *return_queue, GSReturn type, GSReturnMessage &data)
+static void die_on_error(GSReturnMessage& data)
+{
+    if (data.type == death_error_t)
+    {
+        auto p = data.payload.death_error_payload;
+        auto error = std::string(p.error_str);
+        delete[] p.error_str;
+        Errors::die(error.c_str());
+        //There's probably a better way of doing this
+        //but I don't know how to make RAII work across threads properly
+    }
+}
+
+//Draw stats and readbacks can turn up at any point, so they are set aside here rather than taken for the reply
+void GraphicsSynthesizer::wait_for_return(GSReturn type, GSReturnMessage &data)
 {
     printf("wait for return\n");
     while (true)
     {
-        if (return_queue->pop(data))
+        bool available = !deferred_returns.empty();
+        if (available)
+        {
+            data = deferred_returns.front();
+            deferred_returns.pop_front();
+        }
+        else
+            available = return_queue->pop(data);
+
+        if (available)
         {
-            if (data.type == death_error_t)
-            {
-                auto p = data.payload.death_error_payload;
-                auto data = std::string(p.error_str);
-                delete[] p.error_str;
-                Errors::die(data.c_str());
-                //There's probably a better way of doing this
-                //but I don't know how to make RAII work across threads properly
-            }
+            die_on_error(data);
 
             if (data.type == type)
                 return;
-            else
+            if (!set_aside(data))
                 Errors::die("[GS] return message expected %d but was %d!\n", type, data.type);
         }
         else
@@ -122,11 +181,114 @@ void wait_for_return(gs_return_fifo *return_queue, GSReturn type, GSReturnMessag
     }
 }
 
+//Picks up whatever the GS thread has sent so far without blocking. Replies to anything else
+//are kept for wait_for_return.
+void GraphicsSynthesizer::receive_returns()
+{
+    GSReturnMessage data;
+    while (return_queue->pop(data))
+    {
+        die_on_error(data);
+
+        if (!set_aside(data))
+            deferred_returns.push_back(data);
+    }
+}
+
+//Keeps the returns that aren't replies to a request: draw stats, and finished local to host transfers
+bool GraphicsSynthesizer::set_aside(GSReturnMessage& data)
+{
+    switch (data.type)
+    {
+        case draw_stats_t:
+            store_draw_stats(data.payload.draw_stats_payload.stats);
+            return true;
+        case local_to_host_done_t:
+            //Transfers started behind our back, e.g. by a gsdump, are never read
+            if (readbacks.size() < (size_t)readbacks_requested)
+                readbacks.push_back(data.payload.readback_payload);
+            else
+                delete[] data.payload.readback_payload.data;
+            return true;
+        default:
+            return false;
+    }
+}
+
+void GraphicsSynthesizer::store_draw_stats(GSDrawStats* stats)
+{
+    //Nobody is reading them. Drop the oldest so that heatmaps don't pile up.
+    const size_t MAX_QUEUED_STATS = 8;
+    if (draw_stats.size() == MAX_QUEUED_STATS)
+    {
+        delete[] draw_stats.front().heatmap;
+        draw_stats.pop_front();
+    }
+    draw_stats.push_back(*stats);
+    delete stats;
+}
+
+/**
+Turns the GS thread's per-frame counters on or off. From the next VSYNC on, every frame's stats are sent back
+and can be read with pop_draw_stats. The heatmap costs 8 MB a frame, so it is separately optional.
+**/
+void GraphicsSynthesizer::set_draw_stats(bool enabled, bool heatmap)
+{
+    draw_stats_enabled = enabled;
+    draw_stats_heatmap = heatmap;
+
+    //Otherwise the thread is told when reset starts it
+    if (!gsthread_id.joinable())
+        return;
+    GSMessagePayload payload;
+    payload.set_draw_stats_payload = { enabled, heatmap };
+    send_message({ GSCommand::set_draw_stats_t,payload });
+}
+
+//Oldest frame's stats first. The caller takes over stats.heatmap and frees it with delete[].
+bool GraphicsSynthesizer::pop_draw_stats(GSDrawStats& stats)
+{
+    if (draw_stats.empty())
+        return false;
+    stats = draw_stats.front();
+    draw_stats.pop_front();
+    return true;
+}
+
+//Hash of local memory as of every command sent so far. Only pages written since the last call are rehashed.
+uint64_t GraphicsSynthesizer::hash_local_mem()
+{
+    if (!gsthread_id.joinable())
+        Errors::die("[GS] Local memory hashed before the GS thread was started");
+
+    GSMessagePayload payload;
+    payload.no_payload = { 0 };
+    send_message({ GSCommand::hash_vram_t,payload });
+
+    //Hashing happens behind whatever else was asked for, e.g. a frame that nobody has collected yet.
+    //Those replies stay queued in order for whoever waits on them.
+    GSReturnMessage data;
+    while (true)
+    {
+        if (return_queue->pop(data))
+        {
+            die_on_error(data);
+
+            if (data.type == vram_hash_t)
+                return data.payload.vram_hash_payload.hash;
+            if (!set_aside(data))
+                deferred_returns.push_back(data);
+        }
+        else
+            std::this_thread::yield();
+    }
+}
+
 uint32_t* GraphicsSynthesizer::get_framebuffer()
 {
     uint32_t* out;
     GSReturnMessage data;
-    wait_for_return(return_queue, GSReturn::render_complete_t, data);
+    wait_for_return(GSReturn::render_complete_t, data);
     if (using_first_buffer)
     {
         while (!output_buffer1_mutex.try_lock())
@@ -179,6 +341,7 @@ void GraphicsSynthesizer::assert_VSYNC()
     GSMessagePayload payload;
     payload.no_payload = {};
     message_queue->push({ GSCommand::assert_vsync_t,payload });
+    receive_returns();
 
     if (reg.assert_VSYNC())
         intc->assert_IRQ((int)Interrupt::GS);
@@ -214,7 +377,7 @@ uint32_t* GraphicsSynthesizer::render_partial_frame(uint16_t& width, uint16_t& h
     send_message({ GSCommand::memdump_t,payload });
 
     GSReturnMessage data;
-    wait_for_return(return_queue, GSReturn::gsdump_render_partial_done_t, data);
+    wait_for_return(GSReturn::gsdump_render_partial_done_t, data);
     width = data.payload.xy_payload.x;
     height = data.payload.xy_payload.y;
 
@@ -248,6 +411,10 @@ void GraphicsSynthesizer::write64(uint32_t addr, uint64_t value)
     payload.write64_payload = { addr, value };
     send_message({ GSCommand::write64_t,payload });
 
+    //TRXDIR = 1 starts a local to host transfer, which the GS thread sends back in one block
+    if (addr == 0x53 && (value & 0x3) == 1)
+        readbacks_requested++;
+
     //We need a check for SIGNAL here so that we can fire the interrupt
     if (addr == 0x60)
     {
@@ -259,6 +426,39 @@ void GraphicsSynthesizer::write64(uint32_t addr, uint64_t value)
     reg.write64(addr, value);
 }
 
+/**
+Reads the next quadword of a local to host transfer. The GS thread reads the whole rectangle at once,
+so only the first read of a transfer waits on it; the rest come straight out of the finished block.
+Returns false when no transfer has been started.
+**/
+bool GraphicsSynthesizer::read_FIFO(uint128_t& quad)
+{
+    while (readback_pos == readback.quadwords)
+    {
+        delete[] readback.data;
+        readback = { nullptr, 0 };
+        readback_pos = 0;
+        if (!readbacks_requested)
+            return false;
+
+        if (readbacks.empty())
+        {
+            GSReturnMessage data;
+            wait_for_return(GSReturn::local_to_host_done_t, data);
+            readback = data.payload.readback_payload;
+        }
+        else
+        {
+            readback = readbacks.front();
+            readbacks.pop_front();
+        }
+        readbacks_requested--;
+    }
+    quad = readback.data[readback_pos];
+    readback_pos++;
+    return true;
+}
+
 void GraphicsSynthesizer::write64_privileged(uint32_t addr, uint64_t value)
 {
     GSMessagePayload payload;
@@ -336,7 +536,7 @@ void GraphicsSynthesizer::load_state(ifstream &state)
     payload.load_state_payload = {&state};
     send_message({ GSCommand::load_state_t, payload});
     GSReturnMessage data;
-    wait_for_return(return_queue, GSReturn::load_state_done_t, data);
+    wait_for_return(GSReturn::load_state_done_t, data);
     state.read((char*)&reg, sizeof(reg));
 }
 
@@ -346,7 +546,28 @@ void GraphicsSynthesizer::save_state(ofstream &state)
     payload.save_state_payload = {&state};
     send_message({ GSCommand::save_state_t,payload });
     GSReturnMessage data;
-    wait_for_return(return_queue, GSReturn::save_state_done_t, data);
+    wait_for_return(GSReturn::save_state_done_t, data);
+    state.write((char*)&reg, sizeof(reg));
+}
+
+//Only the GS pages written since the last snapshot are stored, see GraphicsSynthesizerThread::load_state_delta
+void GraphicsSynthesizer::load_state_delta(ifstream &state)
+{
+    GSMessagePayload payload;
+    payload.load_state_payload = {&state};
+    send_message({ GSCommand::load_state_delta_t, payload});
+    GSReturnMessage data;
+    wait_for_return(GSReturn::load_state_done_t, data);
+    state.read((char*)&reg, sizeof(reg));
+}
+
+void GraphicsSynthesizer::save_state_delta(ofstream &state)
+{
+    GSMessagePayload payload;
+    payload.save_state_payload = {&state};
+    send_message({ GSCommand::save_state_delta_t, payload });
+    GSReturnMessage data;
+    wait_for_return(GSReturn::save_state_done_t, data);
     state.write((char*)&reg, sizeof(reg));
 }
 
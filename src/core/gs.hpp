@@ -1,11 +1,14 @@
 #ifndef GS_HPP
 #define GS_HPP
 #include <cstdint>
+#include <deque>
 #include <thread>
 #include <mutex>
 #include "gscontext.hpp"
+#include "int128.hpp"
 #include "gsregisters.hpp"
 #include "circularFIFO.hpp"
+#include "segmentedFIFO.hpp"
 
 class INTC;
 
@@ -15,7 +18,7 @@ enum GSCommand:uint8_t
 	write64_t, write64_privileged_t, write32_privileged_t,
     set_rgba_t, set_st_t, set_uv_t, set_xyz_t, set_xyzf_t, set_crt_t,
     render_crt_t, assert_finish_t, assert_vsync_t, set_vblank_t, memdump_t, die_t,
-    save_state_t, load_state_t, gsdump_t
+    save_state_t, load_state_t, gsdump_t, save_state_delta_t, load_state_delta_t, set_draw_stats_t, hash_vram_t
 };
 
 union GSMessagePayload 
@@ -77,12 +80,47 @@ union GSMessagePayload
     {
         std::ifstream* state;
     } load_state_payload;
+    struct
+    {
+        bool enabled;
+        bool heatmap;
+    } set_draw_stats_payload;
     struct 
 	{
         uint8_t BLANK; 
     } no_payload;//C++ doesn't like the empty struct
 };
 
+#define GS_HEATMAP_WIDTH 2048
+#define GS_HEATMAP_HEIGHT 2048
+
+/**
+What the GS thread did between two VSYNCs. Collection is off unless enabled with
+GraphicsSynthesizer::set_draw_stats, and then costs a handful of increments per pixel.
+Pixels are tested when a primitive covers them, pass when they survive the alpha, depth and
+destination alpha tests, and are written when the frame buffer is updated with a new color.
+**/
+struct GSDrawStats
+{
+    uint64_t prims[8]; //By PRIM type
+    uint64_t pixels_tested, pixels_passed, pixels_written;
+    uint64_t texels_fetched;
+    uint64_t clut_reloads;
+    uint64_t hwreg_bytes, host_to_host_bytes;
+    uint64_t state_changes; //Writes to registers other than vertex data and HWREG
+
+    //Pixels tested at each frame buffer coordinate, GS_HEATMAP_WIDTH x GS_HEATMAP_HEIGHT,
+    //or nullptr without the heatmap. Whoever receives the stats owns it.
+    uint16_t* heatmap;
+};
+
+//A local to host transfer, packed the way the GS hands it to the EE through the FIFO
+struct GSReadback
+{
+    uint128_t* data;
+    uint32_t quadwords;
+};
+
 struct GSMessage
 {
     GSCommand type;
@@ -97,6 +135,9 @@ enum GSReturn :uint8_t
     save_state_done_t,
     load_state_done_t,
     gsdump_render_partial_done_t,
+    draw_stats_t,
+    local_to_host_done_t,
+    vram_hash_t,
 };
 
 union GSReturnMessagePayload
@@ -110,6 +151,15 @@ union GSReturnMessagePayload
         uint16_t x, y;
     } xy_payload;
     struct
+    {
+        GSDrawStats* stats;
+    } draw_stats_payload;
+    GSReadback readback_payload;
+    struct
+    {
+        uint64_t hash;
+    } vram_hash_payload;
+    struct
     {
         uint8_t BLANK;
     } no_payload;//C++ doesn't like the empty struct
@@ -121,7 +171,8 @@ struct GSReturnMessage
     GSReturnMessagePayload payload;
 };
 
-typedef CircularFifo<GSMessage, 1024 * 1024 * 16> gs_fifo;
+//Up to 1M queued messages (24 MB) in 16K-message segments. Only what is actually queued stays resident.
+typedef SegmentedFifo<GSMessage, 1024 * 16, 64> gs_fifo;
 typedef CircularFifo<GSReturnMessage, 1024> gs_return_fifo;
 
 class GraphicsSynthesizer
@@ -140,12 +191,32 @@ class GraphicsSynthesizer
 
         gs_fifo* message_queue;
         gs_return_fifo* return_queue;
+        uint8_t* local_mem;
+
+        bool draw_stats_enabled, draw_stats_heatmap;
+
+        //Returns that arrived while looking for draw stats, in the order the GS thread sent them
+        std::deque<GSReturnMessage> deferred_returns;
+        std::deque<GSDrawStats> draw_stats;
+
+        //Local to host transfers started with TRXDIR and not yet read, and the one being read
+        int readbacks_requested;
+        std::deque<GSReadback> readbacks;
+        GSReadback readback;
+        uint32_t readback_pos;
+
+        void wait_for_return(GSReturn type, GSReturnMessage& data);
+        void receive_returns();
+        bool set_aside(GSReturnMessage& data);
+        void store_draw_stats(GSDrawStats* stats);
+        void clear_returns();
 
         std::thread gsthread_id;
     public:
         GraphicsSynthesizer(INTC* intc);
         ~GraphicsSynthesizer();
         void send_message(GSMessage message);
+        void set_local_mem(uint8_t* mem);
         void reset();
         void start_frame();
         bool is_frame_complete();
@@ -168,6 +239,7 @@ class GraphicsSynthesizer
         void write32_privileged(uint32_t addr, uint32_t value);
         void write64_privileged(uint32_t addr, uint64_t value);
         void write64(uint32_t addr, uint64_t value);
+        bool read_FIFO(uint128_t& quad);
 
         void set_RGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a, float q);
         void set_ST(uint32_t s, uint32_t t);
@@ -177,8 +249,14 @@ class GraphicsSynthesizer
 
         void load_state(std::ifstream& state);
         void save_state(std::ofstream& state);
+        void load_state_delta(std::ifstream& state);
+        void save_state_delta(std::ofstream& state);
         void send_dump_request();
-        
+
+        void set_draw_stats(bool enabled, bool heatmap);
+        bool pop_draw_stats(GSDrawStats& stats);
+
+        uint64_t hash_local_mem();
 };
 
 inline bool GraphicsSynthesizer::stalled()
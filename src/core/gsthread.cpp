@@ -4,10 +4,12 @@
 #include <cstring>
 #include <cmath>
 #include <fstream>
+#include <mutex>
 
 #include "gsthread.hpp"
 #include "gsmem.hpp"
 #include "errors.hpp"
+#include "threadtopology.hpp"
 
 using namespace std;
 
@@ -69,14 +71,147 @@ float interpolate_f(int32_t x, float u1, int32_t x1, float u2, int32_t x2)
     return bark / (x2 - x1);
 }
 
+/**
+Triangle setup. Every attribute is a plane across the triangle: its value at a pixel is the vertex values weighted
+by the pixel's barycentric coordinates, divided by the triangle's area. The planes are evaluated once per primitive,
+and the rasterizer then only adds a constant step per pixel and per row.
+**/
+
+static inline void floor_div(int64_t n, int64_t d, int64_t& q, int64_t& r)
+{
+    q = n / d;
+    r = n % d;
+    if (r < 0)
+    {
+        q--;
+        r += d;
+    }
+}
+
+//floor((p1 * k1 + p2 * k2 + p3 * k3) / d) and its remainder. Splitting p in halves keeps 32-bit Z inside 64 bits.
+static void weighted_quotient(const int64_t p[3], const int64_t k[3], int64_t d, int64_t& q, int64_t& r)
+{
+    int64_t high = 0, low = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        high += (p[i] >> 16) * k[i];
+        low += (p[i] & 0xFFFF) * k[i];
+    }
+    int64_t q_high, r_high;
+    floor_div(high, d, q_high, r_high);
+    floor_div((r_high << 16) + low, d, q, r);
+    q += q_high << 16;
+}
+
+//Z, color, fog and UV are stepped as an exact quotient and remainder of the area, so that every pixel gets the
+//same value a divide would have given it. S, T and Q only ever meet in the perspective divide and stay in floating point.
+enum TRIANGLE_ATTRIBUTE
+{
+    ATTR_Z,
+    ATTR_R,
+    ATTR_G,
+    ATTR_B,
+    ATTR_A,
+    ATTR_FOG,
+    ATTR_U,
+    ATTR_V,
+    ATTR_INTEGER_COUNT
+};
+
+enum TRIANGLE_STQ
+{
+    ATTR_S,
+    ATTR_T,
+    ATTR_Q,
+    ATTR_STQ_COUNT
+};
+
+//Every attribute of a triangle at one pixel, or the change in them from one pixel to another
+struct TriangleAttributes
+{
+    int64_t value[ATTR_INTEGER_COUNT];
+    int64_t remainder[ATTR_INTEGER_COUNT];
+    double stq[ATTR_STQ_COUNT];
+
+    void step(const TriangleAttributes& d, int64_t area)
+    {
+        for (int i = 0; i < ATTR_INTEGER_COUNT; i++)
+        {
+            value[i] += d.value[i];
+            remainder[i] += d.remainder[i];
+            int64_t carry = remainder[i] >= area;
+            value[i] += carry;
+            remainder[i] -= carry * area;
+        }
+        for (int i = 0; i < ATTR_STQ_COUNT; i++)
+            stq[i] += d.stq[i];
+    }
+};
+
+struct TriangleGradients
+{
+    int64_t area;
+    TriangleAttributes dx, dy, block_dx, block_dy;
+};
+
+static void setup_attribute(TRIANGLE_ATTRIBUTE attr, int64_t p1, int64_t p2, int64_t p3, const int32_t w[3],
+                            const int32_t A[3], const int32_t B[3], int32_t block_size,
+                            TriangleAttributes& start, TriangleGradients& gradients)
+{
+    const int64_t p[3] = {p1, p2, p3};
+    const int64_t k_corner[3] = {w[0], w[1], w[2]};
+    const int64_t k_x[3] = {(int64_t)A[0] << 4, (int64_t)A[1] << 4, (int64_t)A[2] << 4};
+    const int64_t k_y[3] = {(int64_t)B[0] << 4, (int64_t)B[1] << 4, (int64_t)B[2] << 4};
+    const int64_t k_block_x[3] = {(int64_t)A[0] * block_size, (int64_t)A[1] * block_size, (int64_t)A[2] * block_size};
+    const int64_t k_block_y[3] = {(int64_t)B[0] * block_size, (int64_t)B[1] * block_size, (int64_t)B[2] * block_size};
+    int64_t area = gradients.area;
+    weighted_quotient(p, k_corner, area, start.value[attr], start.remainder[attr]);
+    weighted_quotient(p, k_x, area, gradients.dx.value[attr], gradients.dx.remainder[attr]);
+    weighted_quotient(p, k_y, area, gradients.dy.value[attr], gradients.dy.remainder[attr]);
+    weighted_quotient(p, k_block_x, area, gradients.block_dx.value[attr], gradients.block_dx.remainder[attr]);
+    weighted_quotient(p, k_block_y, area, gradients.block_dy.value[attr], gradients.block_dy.remainder[attr]);
+}
+
+static void setup_stq(TRIANGLE_STQ attr, double p1, double p2, double p3, const int32_t w[3],
+                      const int32_t A[3], const int32_t B[3], int32_t block_size,
+                      TriangleAttributes& start, TriangleGradients& gradients)
+{
+    double inv_area = 1.0 / gradients.area;
+    double x_step = p1 * A[0] + p2 * A[1] + p3 * A[2];
+    double y_step = p1 * B[0] + p2 * B[1] + p3 * B[2];
+    start.stq[attr] = (p1 * w[0] + p2 * w[1] + p3 * w[2]) * inv_area;
+    gradients.dx.stq[attr] = x_step * 16.0 * inv_area;
+    gradients.dy.stq[attr] = y_step * 16.0 * inv_area;
+    gradients.block_dx.stq[attr] = x_step * block_size * inv_area;
+    gradients.block_dy.stq[attr] = y_step * block_size * inv_area;
+}
+
+//A pixel whose sample lies exactly on an edge is only drawn if some of the pixel's area is inside that edge.
+//Only called with w >= 0.
+static inline bool edge_covers_pixel(int32_t w, int32_t A, int32_t B)
+{
+    const int32_t last = (1 << 4) - 1;
+    return w > 0 || w + last * A > 0 || w + last * B > 0 || w + last * (A + B) > 0;
+}
+
 const unsigned int GraphicsSynthesizerThread::max_vertices[8] = {1, 2, 2, 3, 3, 3, 2, 0};
 
-GraphicsSynthesizerThread::GraphicsSynthesizerThread()
+GraphicsSynthesizerThread::GraphicsSynthesizerThread() : vram_hash(1024 * 1024 * 4, GS_PAGE_SIZE)
 {
     frame_complete = false;
     local_mem = nullptr;
+    owns_local_mem = false;
+    return_fifo = nullptr;
+    draw_stats = nullptr;
+    draw_stats_heatmap = false;
+
+    //Every GS thread in the process shares the same swizzling tables
+    static std::once_flag tables_ready;
+    std::call_once(tables_ready, &GraphicsSynthesizerThread::init_swizzle_tables, this);
+}
 
-    //Initialize swizzling tables
+void GraphicsSynthesizerThread::init_swizzle_tables()
+{
     for (int block = 0; block < 32; block++)
     {
         for (int y = 0; y < 32; y++)
@@ -117,13 +252,17 @@ GraphicsSynthesizerThread::GraphicsSynthesizerThread()
 
 GraphicsSynthesizerThread::~GraphicsSynthesizerThread()
 {
-    if (local_mem)
+    if (owns_local_mem)
         delete[] local_mem;
+    set_draw_stats(false, false);
 }
 
-void GraphicsSynthesizerThread::event_loop(gs_fifo* fifo, gs_return_fifo* return_fifo)
+void GraphicsSynthesizerThread::event_loop(gs_fifo* fifo, gs_return_fifo* return_fifo, uint8_t* local_mem)
 {
+    ThreadRoleScope role(ROLE_GS);
     GraphicsSynthesizerThread gs = GraphicsSynthesizerThread();
+    gs.local_mem = local_mem;
+    gs.return_fifo = return_fifo;
     gs.reset();
     bool gsdump_recording = false;
     ofstream gsdump_file;
@@ -215,6 +354,12 @@ void GraphicsSynthesizerThread::event_loop(gs_fifo* fifo, gs_return_fifo* return
                         break;
                     case assert_vsync_t:
                         gs.reg.assert_VSYNC();
+                        if (gs.draw_stats)
+                        {
+                            GSReturnMessagePayload return_payload;
+                            return_payload.draw_stats_payload = { gs.swap_draw_stats() };
+                            return_fifo->push({ GSReturn::draw_stats_t,return_payload });
+                        }
                         break;
                     case set_vblank_t:
                     {
@@ -257,6 +402,35 @@ void GraphicsSynthesizerThread::event_loop(gs_fifo* fifo, gs_return_fifo* return
                         return_fifo->push({ GSReturn::save_state_done_t,return_payload });
                         break;
                     }
+                    case save_state_delta_t:
+                    {
+                        gs.save_state_delta(data.payload.save_state_payload.state);
+                        GSReturnMessagePayload return_payload;
+                        return_payload.no_payload = { 0 };
+                        return_fifo->push({ GSReturn::save_state_done_t,return_payload });
+                        break;
+                    }
+                    case load_state_delta_t:
+                    {
+                        gs.load_state_delta(data.payload.load_state_payload.state);
+                        GSReturnMessagePayload return_payload;
+                        return_payload.no_payload = { 0 };
+                        return_fifo->push({ GSReturn::load_state_done_t,return_payload });
+                        break;
+                    }
+                    case set_draw_stats_t:
+                    {
+                        auto p = data.payload.set_draw_stats_payload;
+                        gs.set_draw_stats(p.enabled, p.heatmap);
+                        break;
+                    }
+                    case hash_vram_t:
+                    {
+                        GSReturnMessagePayload return_payload;
+                        return_payload.vram_hash_payload.hash = gs.hash_local_mem();
+                        return_fifo->push({ GSReturn::vram_hash_t,return_payload });
+                        break;
+                    }
                     case gsdump_t:
                     {
                         printf("gs dump! ");
@@ -290,6 +464,7 @@ void GraphicsSynthesizerThread::event_loop(gs_fifo* fifo, gs_return_fifo* return
     }
     catch (Emulation_error &e)
     {
+        fifo->close();
         GSReturnMessagePayload return_payload;
         char* copied_string = new char[ERROR_STRING_MAX_LENGTH];
         strncpy(copied_string, e.what(), ERROR_STRING_MAX_LENGTH);
@@ -301,11 +476,17 @@ void GraphicsSynthesizerThread::event_loop(gs_fifo* fifo, gs_return_fifo* return
 void GraphicsSynthesizerThread::reset()
 {
     if (!local_mem)
+    {
         local_mem = new uint8_t[1024 * 1024 * 4];
+        owns_local_mem = true;
+    }
     pixels_transferred = 0;
     num_vertices = 0;
     frame_count = 0;
 
+    //Nothing is known about local memory relative to any snapshot or hash
+    memset(dirty_pages, GS_DIRTY_SNAPSHOT | GS_DIRTY_HASH, sizeof(dirty_pages));
+
     COLCLAMP = true;
 
     reg.reset();
@@ -317,6 +498,29 @@ void GraphicsSynthesizerThread::reset()
     current_PRMODE = &PRIM;
 }
 
+void GraphicsSynthesizerThread::set_draw_stats(bool enabled, bool heatmap)
+{
+    if (draw_stats)
+    {
+        delete[] draw_stats->heatmap;
+        delete draw_stats;
+        draw_stats = nullptr;
+    }
+    draw_stats_heatmap = heatmap;
+    if (enabled)
+        swap_draw_stats();
+}
+
+//Hands over the counters collected so far and starts counting from zero
+GSDrawStats* GraphicsSynthesizerThread::swap_draw_stats()
+{
+    GSDrawStats* old_stats = draw_stats;
+    draw_stats = new GSDrawStats();
+    if (draw_stats_heatmap)
+        draw_stats->heatmap = new uint16_t[GS_HEATMAP_WIDTH * GS_HEATMAP_HEIGHT]();
+    return old_stats;
+}
+
 void GraphicsSynthesizerThread::memdump(uint32_t* target, uint16_t& width, uint16_t& height)
 {
     SCISSOR s = current_ctx->scissor;
@@ -525,6 +729,24 @@ void GraphicsSynthesizerThread::write64(uint32_t addr, uint64_t value)
     if (reg.write64(addr, value))
         return;
     addr &= 0xFFFF;
+    if (draw_stats)
+    {
+        switch (addr)
+        {
+            case 0x0001: //RGBAQ
+            case 0x0002: //ST
+            case 0x0003: //UV
+            case 0x0004: //XYZF2
+            case 0x0005: //XYZ2
+            case 0x000A: //FOG
+            case 0x000C: //XYZF3
+            case 0x000D: //XYZ3
+            case 0x0054: //HWREG
+                break;
+            default:
+                draw_stats->state_changes++;
+        }
+    }
     switch (addr)
     {
         case 0x0000:
@@ -816,6 +1038,8 @@ void GraphicsSynthesizerThread::write64(uint32_t addr, uint64_t value)
                     host_to_host();
                     TRXDIR = 3;
                 }
+                else if (TRXDIR == 1)
+                    local_to_host();
             }
             break;
         case 0x0054:
@@ -1014,18 +1238,21 @@ uint8_t GraphicsSynthesizerThread::read_PSMCT4_block(uint32_t base, uint32_t wid
 void GraphicsSynthesizerThread::write_PSMCT32_block(uint32_t base, uint32_t width, uint32_t x, uint32_t y, uint32_t value)
 {
     uint32_t addr = addr_PSMCT32(base / 256, width / 64, x, y);
+    mark_dirty(addr);
     *(uint32_t*)&local_mem[addr] = value;
 }
 
 void GraphicsSynthesizerThread::write_PSMCT32Z_block(uint32_t base, uint32_t width, uint32_t x, uint32_t y, uint32_t value)
 {
     uint32_t addr = addr_PSMCT32Z(base / 256, width / 64, x, y);
+    mark_dirty(addr);
     *(uint32_t*)&local_mem[addr] = value;
 }
 
 void GraphicsSynthesizerThread::write_PSMCT24_block(uint32_t base, uint32_t width, uint32_t x, uint32_t y, uint32_t value)
 {
     uint32_t addr = addr_PSMCT32(base / 256, width / 64, x, y);
+    mark_dirty(addr);
     uint32_t old_mem = *(uint32_t*)&local_mem[addr];
     value &= 0xFFFFFF;
     *(uint32_t*)&local_mem[addr] = (old_mem & 0xFF000000) | value;
@@ -1034,6 +1261,7 @@ void GraphicsSynthesizerThread::write_PSMCT24_block(uint32_t base, uint32_t widt
 void GraphicsSynthesizerThread::write_PSMCT24Z_block(uint32_t base, uint32_t width, uint32_t x, uint32_t y, uint32_t value)
 {
     uint32_t addr = addr_PSMCT32Z(base / 256, width / 64, x, y);
+    mark_dirty(addr);
     uint32_t old_mem = *(uint32_t*)&local_mem[addr];
     value &= 0xFFFFFF;
     *(uint32_t*)&local_mem[addr] = (old_mem & 0xFF000000) | value;
@@ -1042,30 +1270,35 @@ void GraphicsSynthesizerThread::write_PSMCT24Z_block(uint32_t base, uint32_t wid
 void GraphicsSynthesizerThread::write_PSMCT16_block(uint32_t base, uint32_t width, uint32_t x, uint32_t y, uint16_t value)
 {
     uint32_t addr = addr_PSMCT16(base / 256, width / 64, x, y);
+    mark_dirty(addr);
     *(uint16_t*)&local_mem[addr] = value;
 }
 
 void GraphicsSynthesizerThread::write_PSMCT16S_block(uint32_t base, uint32_t width, uint32_t x, uint32_t y, uint16_t value)
 {
     uint32_t addr = addr_PSMCT16S(base / 256, width / 64, x, y);
+    mark_dirty(addr);
     *(uint16_t*)&local_mem[addr] = value;
 }
 
 void GraphicsSynthesizerThread::write_PSMCT16Z_block(uint32_t base, uint32_t width, uint32_t x, uint32_t y, uint16_t value)
 {
     uint32_t addr = addr_PSMCT16Z(base / 256, width / 64, x, y);
+    mark_dirty(addr);
     *(uint16_t*)&local_mem[addr] = value;
 }
 
 void GraphicsSynthesizerThread::write_PSMCT16SZ_block(uint32_t base, uint32_t width, uint32_t x, uint32_t y, uint16_t value)
 {
     uint32_t addr = addr_PSMCT16SZ(base / 256, width / 64, x, y);
+    mark_dirty(addr);
     *(uint16_t*)&local_mem[addr] = value;
 }
 
 void GraphicsSynthesizerThread::write_PSMCT8_block(uint32_t base, uint32_t width, uint32_t x, uint32_t y, uint8_t value)
 {
     uint32_t addr = addr_PSMCT8(base / 256, width / 64, x, y);
+    mark_dirty(addr);
     local_mem[addr] = value;
 }
 
@@ -1074,6 +1307,7 @@ void GraphicsSynthesizerThread::write_PSMCT4_block(uint32_t base, uint32_t width
     uint32_t addr = addr_PSMCT4(base / 256, width / 64, x, y);
     int shift = (addr & 1) << 2;
     addr >>= 1;
+    mark_dirty(addr);
 
     local_mem[addr] = (uint8_t)((local_mem[addr] & (0xf0 >> shift)) | ((value & 0x0f) << shift));
 }
@@ -1155,6 +1389,8 @@ void GraphicsSynthesizerThread::vertex_kick(bool drawing_kick)
 
 void GraphicsSynthesizerThread::render_primitive()
 {
+    if (draw_stats)
+        draw_stats->prims[prim_type]++;
     switch (prim_type)
     {
         case 0:
@@ -1234,6 +1470,17 @@ void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGB
     bool update_alpha = true;
     bool update_z = !current_ctx->zbuf.no_update;
 
+    if (draw_stats)
+    {
+        draw_stats->pixels_tested++;
+        if (draw_stats->heatmap && (uint32_t)x < GS_HEATMAP_WIDTH && (uint32_t)y < GS_HEATMAP_HEIGHT)
+        {
+            uint16_t& count = draw_stats->heatmap[x + y * GS_HEATMAP_WIDTH];
+            if (count != 0xFFFF)
+                count++;
+        }
+    }
+
     if (test->alpha_test)
     {
         bool fail = false;
@@ -1346,6 +1593,13 @@ void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGB
             return;
     }
 
+    if (draw_stats)
+    {
+        draw_stats->pixels_passed++;
+        if (update_frame)
+            draw_stats->pixels_written++;
+    }
+
     //PABE - MSB of source alpha must be set to enable alpha blending
     if (alpha_blending && (!PABE || (color.a & 0x80)))
     {
@@ -1733,6 +1987,10 @@ void GraphicsSynthesizerThread::render_triangle()
         swap(v2, v3);
 
     int32_t divider = orient2D(v1, v2, v3);
+    //Zero area, nothing to cover
+    if (!divider)
+        return;
+
     //Calculate bounding box of triangle
     int32_t min_x = min({v1.x, v2.x, v3.x});
     int32_t min_y = min({v1.y, v2.y, v3.y});
@@ -1745,12 +2003,14 @@ void GraphicsSynthesizerThread::render_triangle()
     max_x = min(max_x, (int32_t)current_ctx->scissor.x2);
     max_y = min(max_y, (int32_t)current_ctx->scissor.y2);
 
-    //We'll process the pixels in blocks, set the blocksize
-    const int32_t BLOCKSIZE = 1 << 4; // Must be power of 2
+    //We'll process the pixels in blocks of 16x16 pixels, set the blocksize
+    const int32_t BLOCKSIZE = 16 << 4; // Must be power of 2
+    //Offset of the last pixel in a block
+    const int32_t BLOCK_LAST = BLOCKSIZE - (1 << 4);
 
-    //Round down to make starting corner's coordinates a multiple of BLOCKSIZE with bitwise magic
-    min_x &= ~(BLOCKSIZE - 1);
-    min_y &= ~(BLOCKSIZE - 1);
+    //Round down to make starting corner's coordinates a whole pixel with bitwise magic
+    min_x &= ~0xF;
+    min_y &= ~0xF;
 
     //Calculate incremental steps for the weights
     //Reference: https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
@@ -1786,11 +2046,74 @@ void GraphicsSynthesizerThread::render_triangle()
         v2.rgbaq.a = v3.rgbaq.a;
     }
 
+    //Triangle setup: one plane per attribute, so that pixels need no divides outside of the perspective correction
+    const int32_t w_corner[3] = {w1_row, w2_row, w3_row};
+    const int32_t A[3] = {A23, A31, A12};
+    const int32_t B[3] = {B23, B31, B12};
+    TriangleAttributes block_row;
+    TriangleGradients gradients;
+    gradients.area = divider;
+    setup_attribute(ATTR_Z, v1.z, v2.z, v3.z, w_corner, A, B, BLOCKSIZE, block_row, gradients);
+    setup_attribute(ATTR_R, v1.rgbaq.r, v2.rgbaq.r, v3.rgbaq.r, w_corner, A, B, BLOCKSIZE, block_row, gradients);
+    setup_attribute(ATTR_G, v1.rgbaq.g, v2.rgbaq.g, v3.rgbaq.g, w_corner, A, B, BLOCKSIZE, block_row, gradients);
+    setup_attribute(ATTR_B, v1.rgbaq.b, v2.rgbaq.b, v3.rgbaq.b, w_corner, A, B, BLOCKSIZE, block_row, gradients);
+    setup_attribute(ATTR_A, v1.rgbaq.a, v2.rgbaq.a, v3.rgbaq.a, w_corner, A, B, BLOCKSIZE, block_row, gradients);
+    setup_attribute(ATTR_FOG, v1.fog, v2.fog, v3.fog, w_corner, A, B, BLOCKSIZE, block_row, gradients);
+    setup_attribute(ATTR_U, v1.uv.u, v2.uv.u, v3.uv.u, w_corner, A, B, BLOCKSIZE, block_row, gradients);
+    setup_attribute(ATTR_V, v1.uv.v, v2.uv.v, v3.uv.v, w_corner, A, B, BLOCKSIZE, block_row, gradients);
+    setup_stq(ATTR_S, v1.s, v2.s, v3.s, w_corner, A, B, BLOCKSIZE, block_row, gradients);
+    setup_stq(ATTR_T, v1.t, v2.t, v3.t, w_corner, A, B, BLOCKSIZE, block_row, gradients);
+    setup_stq(ATTR_Q, v1.rgbaq.q, v2.rgbaq.q, v3.rgbaq.q, w_corner, A, B, BLOCKSIZE, block_row, gradients);
+
     TexLookupInfo tex_info;
 
     bool tmp_tex = current_PRMODE->texture_mapping;
     bool tmp_uv = !current_PRMODE->use_UV;//allow for loop unswitching
 
+    auto shade_pixel = [&](int32_t x, int32_t y, const TriangleAttributes& pixel)
+    {
+        tex_info.vtx_color.r = pixel.value[ATTR_R];
+        tex_info.vtx_color.g = pixel.value[ATTR_G];
+        tex_info.vtx_color.b = pixel.value[ATTR_B];
+        tex_info.vtx_color.a = pixel.value[ATTR_A];
+        tex_info.vtx_color.q = pixel.stq[ATTR_Q];
+        tex_info.fog = pixel.value[ATTR_FOG];
+
+        if (tmp_tex)
+        {
+            int32_t u, v;
+            calculate_LOD(tex_info);
+            if (tmp_uv)
+            {
+                //The one divide per pixel left, for perspective correction
+                double inv_q = 1.0 / pixel.stq[ATTR_Q];
+                u = (pixel.stq[ATTR_S] * inv_q * tex_info.tex_width) * 16.0;
+                v = (pixel.stq[ATTR_T] * inv_q * tex_info.tex_height) * 16.0;
+            }
+            else
+            {
+                u = (uint32_t)pixel.value[ATTR_U];
+                v = (uint32_t)pixel.value[ATTR_V];
+            }
+            tex_lookup(u, v, tex_info);
+            draw_pixel(x, y, (uint32_t)pixel.value[ATTR_Z], tex_info.tex_color, current_PRMODE->alpha_blend);
+        }
+        else
+        {
+            draw_pixel(x, y, (uint32_t)pixel.value[ATTR_Z], tex_info.vtx_color, current_PRMODE->alpha_blend);
+        }
+    };
+
+    //Draws a row of pixels that are all known to be inside the triangle
+    auto draw_span = [&](int32_t x, int32_t x_end, int32_t y, TriangleAttributes pixel)
+    {
+        for (; x < x_end; x += 0x10)
+        {
+            shade_pixel(x, y, pixel);
+            pixel.step(gradients.dx, divider);
+        }
+    };
+
     //TODO: Parallelize this
     //Iterate through the bounding rectangle using BLOCKSIZE * BLOCKSIZE large blocks
     //This way we can throw out blocks which are totally outside the triangle way faster
@@ -1801,6 +2124,9 @@ void GraphicsSynthesizerThread::render_triangle()
         int32_t w1_block = w1_row_block;
         int32_t w2_block = w2_row_block;
         int32_t w3_block = w3_row_block;
+        TriangleAttributes block = block_row;
+        int32_t y_end = min(y_block + BLOCKSIZE, max_y);
+
         for (int32_t x_block = min_x; x_block < max_x; x_block += BLOCKSIZE)
         {
             //Store barycentric coordinates for the corners of a block
@@ -1840,97 +2166,69 @@ void GraphicsSynthesizerThread::render_triangle()
             uint8_t w1_mask = (w1_tl_check << 0) | (w1_tr_check << 1) | (w1_bl_check << 2) | (w1_br_check << 3);
             uint8_t w2_mask = (w2_tl_check << 0) | (w2_tr_check << 1) | (w2_bl_check << 2) | (w2_br_check << 3);
             uint8_t w3_mask = (w3_tl_check << 0) | (w3_tr_check << 1) | (w3_bl_check << 2) | (w3_br_check << 3);
-            //However in other cases, we process the block pixel-by-pixel as usual
-            //TODO: In the case where all corners lie inside the triangle the code below could be slightly simplified
             if (w1_mask != 0 && w2_mask != 0 && w3_mask != 0)
             {
-                //Process a BLOCKSIZE * BLOCKSIZE block as normal
-                int32_t w1_row = w1_block;
-                int32_t w2_row = w2_block;
-                int32_t w3_row = w3_block;
-                for (int32_t y = y_block; y < y_block + BLOCKSIZE; y += 0x10)
+                int32_t x_end = min(x_block + BLOCKSIZE, max_x);
+
+                //If the outermost pixels of the block are strictly inside every edge, so are all the others
+                //(the weights are linear), and the block can be drawn as spans without any edge tests
+                bool covered = w1_tl > 0 && w2_tl > 0 && w3_tl > 0 &&
+                        w1_tl + BLOCK_LAST * A23 > 0 && w2_tl + BLOCK_LAST * A31 > 0 && w3_tl + BLOCK_LAST * A12 > 0 &&
+                        w1_tl + BLOCK_LAST * B23 > 0 && w2_tl + BLOCK_LAST * B31 > 0 && w3_tl + BLOCK_LAST * B12 > 0 &&
+                        w1_tl + BLOCK_LAST * (A23 + B23) > 0 && w2_tl + BLOCK_LAST * (A31 + B31) > 0 &&
+                        w3_tl + BLOCK_LAST * (A12 + B12) > 0;
+
+                TriangleAttributes row = block;
+                if (covered)
+                {
+                    for (int32_t y = y_block; y < y_end; y += 0x10)
+                    {
+                        draw_span(x_block, x_end, y, row);
+                        row.step(gradients.dy, divider);
+                    }
+                }
+                else
                 {
-                    int32_t w1 = w1_row;
-                    int32_t w2 = w2_row;
-                    int32_t w3 = w3_row;
-                    for (int32_t x = x_block; x < x_block + BLOCKSIZE; x += 0x10)
+                    //Partially covered, test every pixel
+                    int32_t w1_row = w1_block;
+                    int32_t w2_row = w2_block;
+                    int32_t w3_row = w3_block;
+                    for (int32_t y = y_block; y < y_end; y += 0x10)
                     {
-                        //Is inside triangle?
-                        if ((w1 | w2 | w3) >= 0)
+                        int32_t w1 = w1_row;
+                        int32_t w2 = w2_row;
+                        int32_t w3 = w3_row;
+                        TriangleAttributes pixel = row;
+                        for (int32_t x = x_block; x < x_end; x += 0x10)
                         {
-                            //Interpolate Z
-                            double z = (double) v1.z * w1 + (double) v2.z * w2 + (double) v3.z * w3;
-                            z /= divider;
-
-                            //Gourand shading calculations
-                            float r = (float) v1.rgbaq.r * w1 + (float) v2.rgbaq.r * w2 + (float) v3.rgbaq.r * w3;
-                            float g = (float) v1.rgbaq.g * w1 + (float) v2.rgbaq.g * w2 + (float) v3.rgbaq.g * w3;
-                            float b = (float) v1.rgbaq.b * w1 + (float) v2.rgbaq.b * w2 + (float) v3.rgbaq.b * w3;
-                            float a = (float) v1.rgbaq.a * w1 + (float) v2.rgbaq.a * w2 + (float) v3.rgbaq.a * w3;
-                            float q = v1.rgbaq.q * w1 + v2.rgbaq.q * w2 + v3.rgbaq.q * w3;
-                            float fog = (float) v1.fog * w1 + (float) v2.fog * w2 + (float) v3.fog * w3;
-                            tex_info.vtx_color.r = r / divider;
-                            tex_info.vtx_color.g = g / divider;
-                            tex_info.vtx_color.b = b / divider;
-                            tex_info.vtx_color.a = a / divider;
-                            tex_info.vtx_color.q = q / divider;
-                            tex_info.fog = fog / divider;
-
-                            if (tmp_tex)
-                            {
-                                int32_t u, v;
-                                calculate_LOD(tex_info);
-                                if (tmp_uv)
-                                {
-                                    float s, t, q;
-                                    s = v1.s * w1 + v2.s * w2 + v3.s * w3;
-                                    t = v1.t * w1 + v2.t * w2 + v3.t * w3;
-                                    q = v1.rgbaq.q * w1 + v2.rgbaq.q * w2 + v3.rgbaq.q * w3;
-
-                                    //We don't divide s and t by "divider" because dividing by Q effectively
-                                    //cancels that out
-                                    s /= q;
-                                    t /= q;
-                                    u = (s * tex_info.tex_width) * 16.0;
-                                    v = (t * tex_info.tex_height) * 16.0;
-                                }
-                                else
-                                {
-                                    float temp_u = (float) v1.uv.u * w1 + (float) v2.uv.u * w2 + (float) v3.uv.u * w3;
-                                    float temp_v = (float) v1.uv.v * w1 + (float) v2.uv.v * w2 + (float) v3.uv.v * w3;
-                                    temp_u /= divider;
-                                    temp_v /= divider;
-                                    u = (uint32_t) temp_u;
-                                    v = (uint32_t) temp_v;
-                                }
-                                tex_lookup(u, v, tex_info);
-                                draw_pixel(x, y, (uint32_t)z, tex_info.tex_color, current_PRMODE->alpha_blend);
-                            }
-                            else
-                            {
-                                draw_pixel(x, y, (uint32_t)z, tex_info.vtx_color, current_PRMODE->alpha_blend);
-                            }
+                            //Is inside triangle?
+                            if ((w1 | w2 | w3) >= 0 && edge_covers_pixel(w1, A23, B23) &&
+                                    edge_covers_pixel(w2, A31, B31) && edge_covers_pixel(w3, A12, B12))
+                                shade_pixel(x, y, pixel);
+                            //Horizontal step
+                            w1 += A23 << 4;
+                            w2 += A31 << 4;
+                            w3 += A12 << 4;
+                            pixel.step(gradients.dx, divider);
                         }
-                        //Horizontal step
-                        w1 += A23 << 4;
-                        w2 += A31 << 4;
-                        w3 += A12 << 4;
+                        //Vertical step
+                        w1_row += B23 << 4;
+                        w2_row += B31 << 4;
+                        w3_row += B12 << 4;
+                        row.step(gradients.dy, divider);
                     }
-                    //Vertical step
-                    w1_row += B23 << 4;
-                    w2_row += B31 << 4;
-                    w3_row += B12 << 4;
                 }
             }
 
             w1_block += BLOCKSIZE * A23;
             w2_block += BLOCKSIZE * A31;
             w3_block += BLOCKSIZE * A12;
-
+            block.step(gradients.block_dx, divider);
         }
         w1_row_block += BLOCKSIZE * B23;
         w2_row_block += BLOCKSIZE * B31;
         w3_row_block += BLOCKSIZE * B12;
+        block_row.step(gradients.block_dy, divider);
     }
 
 }
@@ -2005,6 +2303,8 @@ void GraphicsSynthesizerThread::render_sprite()
 void GraphicsSynthesizerThread::write_HWREG(uint64_t data)
 {
     int ppd = 0; //pixels per doubleword (64-bits)
+    if (draw_stats)
+        draw_stats->hwreg_bytes += 8;
 
     switch (BITBLTBUF.dest_format)
     {
@@ -2248,10 +2548,126 @@ void GraphicsSynthesizerThread::host_to_host()
             TRXPOS.int_source_y++;
         }
     }
+
+    if (draw_stats)
+    {
+        switch (BITBLTBUF.source_format)
+        {
+            case 0x13:
+                draw_stats->host_to_host_bytes += max_pixels;
+                break;
+            case 0x14:
+                draw_stats->host_to_host_bytes += max_pixels / 2;
+                break;
+            default:
+                draw_stats->host_to_host_bytes += max_pixels * 4;
+                break;
+        }
+    }
     pixels_transferred = 0;
     TRXDIR = 3;
 }
 
+/**
+VRAM to EE transfer. Rather than feed the FIFO a quadword at a time, the whole TRXPOS/TRXREG rectangle
+is read out and packed the same way HWREG would take it, then handed to the main thread as one block.
+**/
+void GraphicsSynthesizerThread::local_to_host()
+{
+    int bpp;
+    switch (BITBLTBUF.source_format)
+    {
+        case 0x00:
+        case 0x30:
+            bpp = 32;
+            break;
+        case 0x01:
+        case 0x31:
+            bpp = 24;
+            break;
+        case 0x02:
+        case 0x0A:
+        case 0x32:
+        case 0x3A:
+            bpp = 16;
+            break;
+        case 0x13:
+            bpp = 8;
+            break;
+        case 0x14:
+            bpp = 4;
+            break;
+        default:
+            Errors::die("[GS_t] Unrecognized local-to-host format $%02X", BITBLTBUF.source_format);
+            return;
+    }
+
+    uint64_t bits = (uint64_t)TRXREG.width * TRXREG.height * bpp;
+    GSReadback readback;
+    readback.quadwords = (bits + 127) / 128;
+    readback.data = new uint128_t[readback.quadwords]();
+    uint8_t* out = (uint8_t*)readback.data;
+
+    uint32_t base = BITBLTBUF.source_base;
+    uint32_t width = BITBLTBUF.source_width;
+    uint64_t offset = 0; //In bits
+    for (uint32_t y = 0; y < TRXREG.height; y++)
+    {
+        uint32_t source_y = (TRXPOS.source_y + y) & 0x7FF;
+        for (uint32_t x = 0; x < TRXREG.width; x++)
+        {
+            uint32_t source_x = (TRXPOS.source_x + x) & 0x7FF;
+            uint8_t* pixel = out + (offset >> 3);
+            switch (BITBLTBUF.source_format)
+            {
+                case 0x00:
+                    *(uint32_t*)pixel = read_PSMCT32_block(base, width, source_x, source_y);
+                    break;
+                case 0x30:
+                    *(uint32_t*)pixel = read_PSMCT32Z_block(base, width, source_x, source_y);
+                    break;
+                case 0x01:
+                case 0x31:
+                {
+                    uint32_t value;
+                    if (BITBLTBUF.source_format == 0x01)
+                        value = read_PSMCT32_block(base, width, source_x, source_y);
+                    else
+                        value = read_PSMCT32Z_block(base, width, source_x, source_y);
+                    pixel[0] = value & 0xFF;
+                    pixel[1] = (value >> 8) & 0xFF;
+                    pixel[2] = (value >> 16) & 0xFF;
+                }
+                    break;
+                case 0x02:
+                    *(uint16_t*)pixel = read_PSMCT16_block(base, width, source_x, source_y);
+                    break;
+                case 0x0A:
+                    *(uint16_t*)pixel = read_PSMCT16S_block(base, width, source_x, source_y);
+                    break;
+                case 0x32:
+                    *(uint16_t*)pixel = read_PSMCT16Z_block(base, width, source_x, source_y);
+                    break;
+                case 0x3A:
+                    *(uint16_t*)pixel = read_PSMCT16SZ_block(base, width, source_x, source_y);
+                    break;
+                case 0x13:
+                    *pixel = read_PSMCT8_block(base, width, source_x, source_y);
+                    break;
+                case 0x14:
+                    *pixel |= (read_PSMCT4_block(base, width, source_x, source_y) & 0xF) << (offset & 0x4);
+                    break;
+            }
+            offset += bpp;
+        }
+    }
+
+    GSReturnMessagePayload return_payload;
+    return_payload.readback_payload = readback;
+    return_fifo->push({ GSReturn::local_to_host_done_t,return_payload });
+    TRXDIR = 3;
+}
+
 uint8_t GraphicsSynthesizerThread::get_16bit_alpha(uint16_t color)
 {
     if (color & (1 << 15))
@@ -2435,6 +2851,8 @@ void GraphicsSynthesizerThread::tex_lookup(int16_t u, int16_t v, TexLookupInfo&
 
 void GraphicsSynthesizerThread::tex_lookup_int(int16_t u, int16_t v, TexLookupInfo& info)
 {
+    if (draw_stats)
+        draw_stats->texels_fetched++;
     switch (current_ctx->clamp.wrap_s)
     {
         case 0:
@@ -2706,6 +3124,8 @@ void GraphicsSynthesizerThread::reload_clut(GSContext& context)
     if (reload)
     {
         printf("[GS_t] Reloading CLUT cache!\n");
+        if (draw_stats)
+            draw_stats->clut_reloads++;
         for (int i = 0; i < entries; i++)
         {
             if (context.tex0.use_CSM2)
@@ -2769,6 +3189,75 @@ void GraphicsSynthesizerThread::reload_clut(GSContext& context)
 void GraphicsSynthesizerThread::load_state(ifstream *state)
 {
     state->read((char*)local_mem, 1024 * 1024 * 4);
+    memset(dirty_pages, GS_DIRTY_HASH, sizeof(dirty_pages));
+    load_registers(state);
+}
+
+void GraphicsSynthesizerThread::save_state(ofstream *state)
+{
+    state->write((char*)local_mem, 1024 * 1024 * 4);
+    clear_dirty(GS_DIRTY_SNAPSHOT);
+    save_registers(state);
+}
+
+/**
+A delta holds the local memory pages written since the last snapshot, full or delta, followed by all registers.
+It can only be loaded on top of the state it was taken from. Loading it makes that the new baseline, so a chain
+of deltas has to be replayed in order starting from the full state it was based on.
+**/
+void GraphicsSynthesizerThread::load_state_delta(ifstream *state)
+{
+    uint32_t page_count = 0;
+    state->read((char*)&page_count, sizeof(page_count));
+    for (uint32_t i = 0; i < page_count && i < GS_PAGE_COUNT; i++)
+    {
+        uint16_t page = 0;
+        state->read((char*)&page, sizeof(page));
+        state->read((char*)&local_mem[(page % GS_PAGE_COUNT) * GS_PAGE_SIZE], GS_PAGE_SIZE);
+        dirty_pages[page % GS_PAGE_COUNT] |= GS_DIRTY_HASH;
+    }
+    clear_dirty(GS_DIRTY_SNAPSHOT);
+    load_registers(state);
+}
+
+void GraphicsSynthesizerThread::save_state_delta(ofstream *state)
+{
+    uint32_t page_count = 0;
+    for (int page = 0; page < GS_PAGE_COUNT; page++)
+        page_count += dirty_pages[page] & GS_DIRTY_SNAPSHOT;
+    state->write((char*)&page_count, sizeof(page_count));
+
+    for (uint16_t page = 0; page < GS_PAGE_COUNT; page++)
+    {
+        if (!(dirty_pages[page] & GS_DIRTY_SNAPSHOT))
+            continue;
+        state->write((char*)&page, sizeof(page));
+        state->write((char*)&local_mem[page * GS_PAGE_SIZE], GS_PAGE_SIZE);
+    }
+    clear_dirty(GS_DIRTY_SNAPSHOT);
+    save_registers(state);
+}
+
+void GraphicsSynthesizerThread::clear_dirty(uint8_t flag)
+{
+    for (int page = 0; page < GS_PAGE_COUNT; page++)
+        dirty_pages[page] &= ~flag;
+}
+
+//Only the pages written since the last call are rehashed
+uint64_t GraphicsSynthesizerThread::hash_local_mem()
+{
+    for (int page = 0; page < GS_PAGE_COUNT; page++)
+    {
+        if (dirty_pages[page] & GS_DIRTY_HASH)
+            vram_hash.mark_dirty(page * GS_PAGE_SIZE);
+    }
+    clear_dirty(GS_DIRTY_HASH);
+    return vram_hash.update(local_mem);
+}
+
+void GraphicsSynthesizerThread::load_registers(ifstream *state)
+{
     state->read((char*)&IMR, sizeof(IMR));
     state->read((char*)&context1, sizeof(context1));
     state->read((char*)&context2, sizeof(context2));
@@ -2815,9 +3304,8 @@ void GraphicsSynthesizerThread::load_state(ifstream *state)
     state->read((char*)&num_vertices, sizeof(num_vertices));
 }
 
-void GraphicsSynthesizerThread::save_state(ofstream *state)
+void GraphicsSynthesizerThread::save_registers(ofstream *state)
 {
-    state->write((char*)local_mem, 1024 * 1024 * 4);
     state->write((char*)&IMR, sizeof(IMR));
     state->write((char*)&context1, sizeof(context1));
     state->write((char*)&context2, sizeof(context2));
@@ -3,6 +3,15 @@
 #include <cstdint>
 #include "gscontext.hpp"
 #include "gs.hpp"
+#include "statehash.hpp"
+
+//Local memory is tracked for snapshots and state hashes in units of GS pages
+#define GS_PAGE_SIZE (1024 * 8)
+#define GS_PAGE_COUNT (1024 * 1024 * 4 / GS_PAGE_SIZE)
+
+//Flags in dirty_pages, one for each consumer so that they can be cleared separately
+#define GS_DIRTY_SNAPSHOT 0x1
+#define GS_DIRTY_HASH 0x2
 
 struct PRMODE_REG
 {
@@ -95,10 +104,19 @@ class GraphicsSynthesizerThread
         bool frame_complete;
         int frame_count;
         uint8_t* local_mem;
+        bool owns_local_mem;
+        uint8_t dirty_pages[GS_PAGE_COUNT]; //Written since the last snapshot and since the last hash
+        PageHasher vram_hash;
         uint8_t CRT_mode;
         uint8_t clut_cache[1024];
         uint32_t CBP0, CBP1;
 
+        gs_return_fifo* return_fifo;
+
+        //Counters for the current frame, or nullptr when nobody asked for them
+        GSDrawStats* draw_stats;
+        bool draw_stats_heatmap;
+
         //CSR/IMR stuff - to be merged into structs
 
         GS_IMR IMR;
@@ -143,6 +161,9 @@ class GraphicsSynthesizerThread
 
         uint32_t get_word(uint32_t addr);
         void set_word(uint32_t addr, uint32_t value);
+        void mark_dirty(uint32_t addr);
+        void clear_dirty(uint8_t flag);
+        uint64_t hash_local_mem();
 
         //Swizzling routines
         uint32_t blockid_PSMCT32(uint32_t block, uint32_t width, uint32_t x, uint32_t y);
@@ -202,6 +223,7 @@ class GraphicsSynthesizerThread
         void write_HWREG(uint64_t data);
         void unpack_PSMCT24(uint64_t data, int offset, bool z_format);
         void host_to_host();
+        void local_to_host();
 
         int32_t orient2D(const Vertex &v1, const Vertex &v2, const Vertex &v3);
 
@@ -215,6 +237,8 @@ class GraphicsSynthesizerThread
 
         void set_VBLANK(bool is_VBLANK);
         void assert_FINISH();
+        void set_draw_stats(bool enabled, bool heatmap);
+        GSDrawStats* swap_draw_stats();
         void dump_texture(uint32_t* target, uint32_t start_addr, uint32_t width);
 
         void write64(uint32_t addr, uint64_t value);
@@ -227,11 +251,17 @@ class GraphicsSynthesizerThread
 
         void load_state(std::ifstream* state);
         void save_state(std::ofstream* state);
+        void load_state_delta(std::ifstream* state);
+        void save_state_delta(std::ofstream* state);
+        void load_registers(std::ifstream* state);
+        void save_registers(std::ofstream* state);
+
+        void init_swizzle_tables();
     public:
         GraphicsSynthesizerThread();
         ~GraphicsSynthesizerThread();
         
-        static void event_loop(gs_fifo* fifo, gs_return_fifo* return_fifo);
+        static void event_loop(gs_fifo* fifo, gs_return_fifo* return_fifo, uint8_t* local_mem);
 };
 
 inline uint32_t GraphicsSynthesizerThread::get_word(uint32_t addr)
@@ -241,7 +271,13 @@ inline uint32_t GraphicsSynthesizerThread::get_word(uint32_t addr)
 
 inline void GraphicsSynthesizerThread::set_word(uint32_t addr, uint32_t value)
 {
+    mark_dirty(addr);
     *(uint32_t*)&local_mem[addr] = value;
 }
 
+inline void GraphicsSynthesizerThread::mark_dirty(uint32_t addr)
+{
+    dirty_pages[(addr / GS_PAGE_SIZE) % GS_PAGE_COUNT] = GS_DIRTY_SNAPSHOT | GS_DIRTY_HASH;
+}
+
 #endif // GSTHREAD_HPP
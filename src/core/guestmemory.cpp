@@ -0,0 +1,287 @@
+#include <cstdio>
+#include <cstring>
+#include "guestmemory.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+struct RegionInfo
+{
+    const char* name;
+    size_t size;
+    int mirrors;
+    bool huge;
+};
+
+static const RegionInfo region_info[REGION_COUNT] =
+{
+    {"RDRAM", 1024 * 1024 * 32, 1, true},
+    {"IOP RAM", 1024 * 1024 * 2, 4, false},
+    {"BIOS", 1024 * 1024 * 4, 1, false},
+    {"SPU RAM", 1024 * 1024 * 2, 1, false},
+    {"GS VRAM", 1024 * 1024 * 4, 1, true}
+};
+
+static size_t align_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+GuestMemory::GuestMemory()
+{
+    arena = nullptr;
+    arena_size = 0;
+    allocated = false;
+    for (int i = 0; i < REGION_COUNT; i++)
+    {
+        regions[i] = nullptr;
+        fds[i] = -1;
+    }
+}
+
+GuestMemory::~GuestMemory()
+{
+    release();
+}
+
+size_t GuestMemory::get_size(GUEST_REGION region)
+{
+    return region_info[region].size;
+}
+
+int GuestMemory::get_mirrors(GUEST_REGION region)
+{
+    return region_info[region].mirrors;
+}
+
+//Offset of an area from the start of the arena. Only meaningful when is_arena() is true.
+size_t GuestMemory::get_offset(GUEST_REGION region)
+{
+    size_t offset = 0;
+    for (int i = 0; i < region; i++)
+    {
+        offset += region_info[i].size * region_info[i].mirrors;
+        offset = align_up(offset + GUARD_SIZE, GUARD_SIZE);
+    }
+    return offset;
+}
+
+void GuestMemory::allocate(HUGE_PAGES huge_pages)
+{
+    release();
+    if (!map_arena(huge_pages))
+    {
+        printf("[GuestMemory] Unable to reserve the guest memory arena, using separate allocations\n");
+        for (int i = 0; i < REGION_COUNT; i++)
+        {
+            regions[i] = new uint8_t[region_info[i].size];
+            memset(regions[i], 0, region_info[i].size);
+        }
+    }
+    allocated = true;
+}
+
+bool GuestMemory::map_arena(HUGE_PAGES huge_pages)
+{
+#ifdef __linux__
+    size_t size = get_offset(REGION_COUNT);
+
+    //Reserve one extra huge page worth of space so that the base can be aligned to it
+    size_t reserve_size = size + GUARD_SIZE;
+    void* reserve = mmap(nullptr, reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserve == MAP_FAILED)
+        return false;
+
+    uint8_t* base = (uint8_t*)align_up((size_t)reserve, GUARD_SIZE);
+    size_t head = base - (uint8_t*)reserve;
+    if (head)
+        munmap(reserve, head);
+    size_t tail = reserve_size - head - size;
+    if (tail)
+        munmap(base + size, tail);
+
+    arena = base;
+    arena_size = size;
+    for (int i = 0; i < REGION_COUNT; i++)
+    {
+        if (!map_region(i, get_offset((GUEST_REGION)i), huge_pages))
+        {
+            release();
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef __linux__
+static int create_memfd(const char* name, size_t size, bool hugetlb)
+{
+#ifdef SYS_memfd_create
+    unsigned int flags = 0x0001U; //MFD_CLOEXEC
+    if (hugetlb)
+        flags |= 0x0004U; //MFD_HUGETLB
+    int fd = syscall(SYS_memfd_create, name, flags);
+    if (fd >= 0 && ftruncate(fd, size) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+static bool map_mirrors(uint8_t* dest, size_t size, int mirrors, int fd)
+{
+    for (int i = 0; i < mirrors; i++)
+    {
+        void* map = mmap(dest + (i * size), size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        if (map == MAP_FAILED)
+            return false;
+    }
+    return true;
+}
+#endif
+
+bool GuestMemory::map_region(int index, size_t offset, HUGE_PAGES huge_pages)
+{
+#ifdef __linux__
+    const RegionInfo& info = region_info[index];
+    uint8_t* dest = arena + offset;
+    bool use_huge = info.huge && huge_pages != HUGE_PAGES::OFF;
+
+    int fd = -1;
+    if (use_huge && huge_pages == HUGE_PAGES::EXPLICIT)
+    {
+        //This only succeeds if huge pages have been reserved on the host
+        fd = create_memfd(info.name, info.size, true);
+        if (fd >= 0 && map_mirrors(dest, info.size, info.mirrors, fd))
+            use_huge = false; //Already backed by huge pages, nothing to advise
+        else if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    //Only mirrored areas need a memfd. The rest stay anonymous memory, which transparent huge pages apply to
+    //whenever they're enabled at all, while shmem such as a memfd only gets them if shmem_enabled allows it.
+    if (fd < 0 && info.mirrors > 1)
+    {
+        fd = create_memfd(info.name, info.size, false);
+        if (fd >= 0 && !map_mirrors(dest, info.size, info.mirrors, fd))
+        {
+            close(fd);
+            return false;
+        }
+    }
+
+    if (fd >= 0)
+        fds[index] = fd;
+    else
+    {
+        //Unmirrored, or no memfd to mirror with. The rest of a mirror window then stays a guard.
+        void* map = mmap(dest, info.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+        if (map == MAP_FAILED)
+            return false;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (use_huge)
+        madvise(dest, info.size, MADV_HUGEPAGE);
+#endif
+
+    regions[index] = dest;
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t GuestMemory::get_page_size()
+{
+#ifdef __linux__
+    return sysconf(_SC_PAGESIZE);
+#else
+    return 4096;
+#endif
+}
+
+bool GuestMemory::map_file(GUEST_REGION region, const char* file_name, uint64_t offset)
+{
+#ifdef __linux__
+    //A private mapping can't stand in for a mirrored area, as writes through one mirror must show in the others
+    const RegionInfo& info = region_info[region];
+    if (!arena || info.mirrors != 1 || offset % get_page_size())
+        return false;
+
+    int fd = open(file_name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    //Pages past the end of the file would fault with SIGBUS instead of reading as zero
+    struct stat file_info;
+    if (fstat(fd, &file_info) || (uint64_t)file_info.st_size < offset + info.size)
+    {
+        close(fd);
+        return false;
+    }
+
+    uint8_t* dest = regions[region];
+    void* map = mmap(dest, info.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, offset);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        //A failed fixed mapping may already have removed the old one
+        if (fds[region] >= 0)
+            map_mirrors(dest, info.size, info.mirrors, fds[region]);
+        else
+            mmap(dest, info.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+        return false;
+    }
+
+    //Nothing maps the area's memfd anymore, so let go of its pages
+    if (fds[region] >= 0)
+    {
+        if (ftruncate(fds[region], 0) || ftruncate(fds[region], info.size))
+            printf("[GuestMemory] Failed to release the old pages of %s\n", info.name);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void GuestMemory::release()
+{
+#ifdef __linux__
+    if (arena)
+    {
+        munmap(arena, arena_size);
+        for (int i = 0; i < REGION_COUNT; i++)
+        {
+            if (fds[i] >= 0)
+                close(fds[i]);
+            fds[i] = -1;
+            regions[i] = nullptr;
+        }
+        arena = nullptr;
+        arena_size = 0;
+    }
+#endif
+    for (int i = 0; i < REGION_COUNT; i++)
+    {
+        if (regions[i])
+            delete[] regions[i];
+        regions[i] = nullptr;
+    }
+    allocated = false;
+}
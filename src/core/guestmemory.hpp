@@ -0,0 +1,88 @@
+#ifndef GUESTMEMORY_HPP
+#define GUESTMEMORY_HPP
+#include <cstddef>
+#include <cstdint>
+
+enum GUEST_REGION
+{
+    REGION_RDRAM,
+    REGION_IOP_RAM,
+    REGION_BIOS,
+    REGION_SPU_RAM,
+    REGION_GS_VRAM,
+    REGION_COUNT
+};
+
+enum class HUGE_PAGES
+{
+    OFF,
+    TRANSPARENT, //madvise(MADV_HUGEPAGE), left to the kernel
+    EXPLICIT //hugetlbfs-backed memfd, falls back to transparent if no huge pages are reserved
+};
+
+/**
+All guest memory of one emulator lives in a single reserved address range with a fixed layout.
+Each area starts on a 2 MB boundary and is followed by an inaccessible guard region, so that an access
+running off the end of an area faults instead of landing in its neighbour.
+
+On Linux, areas the hardware mirrors (IOP RAM) are backed by a memfd mapped several times back to back, so that
+the whole mirror window reads and writes the same memory. Other areas are anonymous memory, or a hugetlb memfd
+with explicit huge pages.
+Where that isn't available, the areas fall back to plain allocations without mirrors or guards.
+**/
+class GuestMemory
+{
+    private:
+        uint8_t* arena;
+        size_t arena_size;
+        uint8_t* regions[REGION_COUNT];
+        int fds[REGION_COUNT];
+        bool allocated;
+
+        bool map_arena(HUGE_PAGES huge_pages);
+        bool map_region(int index, size_t offset, HUGE_PAGES huge_pages);
+        void release();
+    public:
+        constexpr static size_t GUARD_SIZE = 1024 * 1024 * 2;
+
+        GuestMemory();
+        ~GuestMemory();
+
+        void allocate(HUGE_PAGES huge_pages);
+        bool is_allocated();
+        bool is_arena();
+
+        uint8_t* get(GUEST_REGION region);
+        uint8_t* get_base();
+        size_t get_offset(GUEST_REGION region);
+
+        static size_t get_size(GUEST_REGION region);
+        static int get_mirrors(GUEST_REGION region);
+        static size_t get_page_size();
+
+        //Maps part of a file copy-on-write over an area, so that its pages are only read in when touched.
+        //Returns false, leaving the area as it was, if the area or the file can't be mapped that way.
+        bool map_file(GUEST_REGION region, const char* file_name, uint64_t offset);
+};
+
+inline bool GuestMemory::is_allocated()
+{
+    return allocated;
+}
+
+inline bool GuestMemory::is_arena()
+{
+    return arena != nullptr;
+}
+
+inline uint8_t* GuestMemory::get(GUEST_REGION region)
+{
+    return regions[region];
+}
+
+inline uint8_t* GuestMemory::get_base()
+{
+    return arena;
+}
+
+#endif // GUESTMEMORY_HPP
@@ -2,12 +2,23 @@
 #define INT128_HPP
 #include <cstdint>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define INT128_SSE2
+#endif
+
 /**
  * These 128-bit integer definitions were taken from PCSX2 and modified for DobieStation.
  * All credits go to the PCSX2 team.
  * View the original code here: https://github.com/PCSX2/pcsx2/blob/171e7f016dc9e132f9faf40a22f0312d45d356a5/common/include/Pcsx2Types.h#L58
  */
-union uint128_t
+/**
+ * Always 16-byte aligned, so that register files and guest memory holding these can be moved with aligned vector
+ * loads and stores. Anything cast to a uint128_t* must be 16-byte aligned as well.
+ * The static operations below are the lane-wise building blocks of the MMI, VIF and GIF paths. They use SSE2 where
+ * available and are plain loops elsewhere.
+ */
+union alignas(16) uint128_t
 {
     struct
     {
@@ -23,6 +34,9 @@ union uint128_t
     int16_t  _s16[8];
     uint8_t  _u8[16];
     int8_t   _s8[16];
+#ifdef INT128_SSE2
+    __m128i  _m128;
+#endif
 
     // Explicit conversion from u64. Zero-extends the source through 128 bits.
     static uint128_t from_u64(uint64_t src)
@@ -56,6 +70,127 @@ union uint128_t
     {
         return (lo != right.lo) || (hi != right.hi);
     }
+
+#ifdef INT128_SSE2
+    static uint128_t from_m128(__m128i src)
+    {
+        uint128_t retval;
+        retval._m128 = src;
+        return retval;
+    }
+
+    uint128_t operator&(const uint128_t &right) const { return from_m128(_mm_and_si128(_m128, right._m128)); }
+    uint128_t operator|(const uint128_t &right) const { return from_m128(_mm_or_si128(_m128, right._m128)); }
+    uint128_t operator^(const uint128_t &right) const { return from_m128(_mm_xor_si128(_m128, right._m128)); }
+    uint128_t operator~() const { return from_m128(_mm_xor_si128(_m128, _mm_set1_epi32(-1))); }
+
+    // Lane-wise compares. Each lane is all ones where the compare holds and zero elsewhere.
+    static uint128_t cmpeq8(const uint128_t &a, const uint128_t &b) { return from_m128(_mm_cmpeq_epi8(a._m128, b._m128)); }
+    static uint128_t cmpeq16(const uint128_t &a, const uint128_t &b) { return from_m128(_mm_cmpeq_epi16(a._m128, b._m128)); }
+    static uint128_t cmpeq32(const uint128_t &a, const uint128_t &b) { return from_m128(_mm_cmpeq_epi32(a._m128, b._m128)); }
+    static uint128_t cmpgt8(const uint128_t &a, const uint128_t &b) { return from_m128(_mm_cmpgt_epi8(a._m128, b._m128)); }
+    static uint128_t cmpgt16(const uint128_t &a, const uint128_t &b) { return from_m128(_mm_cmpgt_epi16(a._m128, b._m128)); }
+    static uint128_t cmpgt32(const uint128_t &a, const uint128_t &b) { return from_m128(_mm_cmpgt_epi32(a._m128, b._m128)); }
+
+    // Lane-wise shifts by the same amount, which must be less than the lane width
+    static uint128_t sll16(const uint128_t &a, int shift) { return from_m128(_mm_sll_epi16(a._m128, _mm_cvtsi32_si128(shift))); }
+    static uint128_t srl16(const uint128_t &a, int shift) { return from_m128(_mm_srl_epi16(a._m128, _mm_cvtsi32_si128(shift))); }
+    static uint128_t sra16(const uint128_t &a, int shift) { return from_m128(_mm_sra_epi16(a._m128, _mm_cvtsi32_si128(shift))); }
+    static uint128_t sll32(const uint128_t &a, int shift) { return from_m128(_mm_sll_epi32(a._m128, _mm_cvtsi32_si128(shift))); }
+    static uint128_t srl32(const uint128_t &a, int shift) { return from_m128(_mm_srl_epi32(a._m128, _mm_cvtsi32_si128(shift))); }
+    static uint128_t sra32(const uint128_t &a, int shift) { return from_m128(_mm_sra_epi32(a._m128, _mm_cvtsi32_si128(shift))); }
+
+    // Truncating packs: the low half of every lane of lo, then of hi, as the EE's PPACB/PPACH/PPACW do
+    static uint128_t pack16to8(const uint128_t &lo, const uint128_t &hi)
+    {
+        __m128i mask = _mm_set1_epi16(0xFF);
+        return from_m128(_mm_packus_epi16(_mm_and_si128(lo._m128, mask), _mm_and_si128(hi._m128, mask)));
+    }
+
+    static uint128_t pack32to16(const uint128_t &lo, const uint128_t &hi)
+    {
+        //Sign-extending the low halves first keeps the saturating pack from changing them
+        __m128i l = _mm_srai_epi32(_mm_slli_epi32(lo._m128, 16), 16);
+        __m128i h = _mm_srai_epi32(_mm_slli_epi32(hi._m128, 16), 16);
+        return from_m128(_mm_packs_epi32(l, h));
+    }
+
+    static uint128_t pack64to32(const uint128_t &lo, const uint128_t &hi)
+    {
+        __m128 packed = _mm_shuffle_ps(_mm_castsi128_ps(lo._m128), _mm_castsi128_ps(hi._m128), _MM_SHUFFLE(2, 0, 2, 0));
+        return from_m128(_mm_castps_si128(packed));
+    }
+#else
+    uint128_t operator&(const uint128_t &right) const { uint128_t r; r.lo = lo & right.lo; r.hi = hi & right.hi; return r; }
+    uint128_t operator|(const uint128_t &right) const { uint128_t r; r.lo = lo | right.lo; r.hi = hi | right.hi; return r; }
+    uint128_t operator^(const uint128_t &right) const { uint128_t r; r.lo = lo ^ right.lo; r.hi = hi ^ right.hi; return r; }
+    uint128_t operator~() const { uint128_t r; r.lo = ~lo; r.hi = ~hi; return r; }
+
+#define INT128_LANES(name, count, field, expr) \
+    static uint128_t name(const uint128_t &a, const uint128_t &b) \
+    { \
+        uint128_t r; \
+        for (int i = 0; i < count; i++) \
+            r.field[i] = (expr) ? -1 : 0; \
+        return r; \
+    }
+    INT128_LANES(cmpeq8, 16, _s8, a._u8[i] == b._u8[i])
+    INT128_LANES(cmpeq16, 8, _s16, a._u16[i] == b._u16[i])
+    INT128_LANES(cmpeq32, 4, _s32, a._u32[i] == b._u32[i])
+    INT128_LANES(cmpgt8, 16, _s8, a._s8[i] > b._s8[i])
+    INT128_LANES(cmpgt16, 8, _s16, a._s16[i] > b._s16[i])
+    INT128_LANES(cmpgt32, 4, _s32, a._s32[i] > b._s32[i])
+#undef INT128_LANES
+
+#define INT128_SHIFT(name, count, field, op) \
+    static uint128_t name(const uint128_t &a, int shift) \
+    { \
+        uint128_t r; \
+        for (int i = 0; i < count; i++) \
+            r.field[i] = a.field[i] op shift; \
+        return r; \
+    }
+    INT128_SHIFT(sll16, 8, _u16, <<)
+    INT128_SHIFT(srl16, 8, _u16, >>)
+    INT128_SHIFT(sra16, 8, _s16, >>)
+    INT128_SHIFT(sll32, 4, _u32, <<)
+    INT128_SHIFT(srl32, 4, _u32, >>)
+    INT128_SHIFT(sra32, 4, _s32, >>)
+#undef INT128_SHIFT
+
+    static uint128_t pack16to8(const uint128_t &lo, const uint128_t &hi)
+    {
+        uint128_t r;
+        for (int i = 0; i < 8; i++)
+        {
+            r._u8[i] = (uint8_t)lo._u16[i];
+            r._u8[i + 8] = (uint8_t)hi._u16[i];
+        }
+        return r;
+    }
+
+    static uint128_t pack32to16(const uint128_t &lo, const uint128_t &hi)
+    {
+        uint128_t r;
+        for (int i = 0; i < 4; i++)
+        {
+            r._u16[i] = (uint16_t)lo._u32[i];
+            r._u16[i + 4] = (uint16_t)hi._u32[i];
+        }
+        return r;
+    }
+
+    static uint128_t pack64to32(const uint128_t &lo, const uint128_t &hi)
+    {
+        uint128_t r;
+        for (int i = 0; i < 2; i++)
+        {
+            r._u32[i] = (uint32_t)lo._u64[i];
+            r._u32[i + 2] = (uint32_t)hi._u64[i];
+        }
+        return r;
+    }
+#endif
 };
 
 struct int128_t
@@ -9,7 +9,7 @@
 using namespace std;
 
 //Values from PCSX2 - subject to change
-static uint64_t IOP_CLOCK = 36864000;
+static const uint64_t IOP_CLOCK = 36864000;
 static const int PSX_CD_READSPEED = 153600;
 static const int PSX_DVD_READSPEED = 1382400;
 
@@ -6,7 +6,7 @@
 
 //Reply buffers taken from PCSX2's LilyPad
 
-uint8_t Gamepad::mask_mode[7] = {0x5A, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x5A};
+const uint8_t Gamepad::mask_mode_default[7] = {0x5A, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x5A};
 const uint8_t Gamepad::vref_param[7] = {0x5A, 0x00, 0x00, 0x02, 0x00, 0x00, 0x5A};
 const uint8_t Gamepad::config_exit[7] = {0x5A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 const uint8_t Gamepad::set_mode[7] = {0x5A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
@@ -21,6 +21,55 @@ const uint8_t Gamepad::query_comb[7] = {0x5A, 0x00, 0x00, 0x02, 0x00, 0x01, 0x00
 const uint8_t Gamepad::query_mode[7] = {0x5A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 const uint8_t Gamepad::native_mode[7] = {0x5A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5A};
 
+PadInput::PadInput()
+{
+    reset();
+}
+
+void PadInput::reset()
+{
+    buttons = 0xFFFF;
+    axis_sequence = 0;
+    for (int i = 0; i < 4; i++)
+        axes[i] = 0x80;
+}
+
+void PadInput::press_button(PAD_BUTTON button)
+{
+    buttons.fetch_and(~(1 << (int)button), std::memory_order_release);
+}
+
+void PadInput::release_button(PAD_BUTTON button)
+{
+    buttons.fetch_or(1 << (int)button, std::memory_order_release);
+}
+
+void PadInput::set_axis(PAD_AXIS axis, uint8_t value)
+{
+    //Claim the seqlock by making the sequence odd. Writers are rare, so spinning here is fine.
+    uint32_t seq = axis_sequence.load(std::memory_order_relaxed);
+    while ((seq & 0x1) || !axis_sequence.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire))
+        seq = axis_sequence.load(std::memory_order_relaxed);
+
+    axes[(int)axis].store(value, std::memory_order_relaxed);
+    axis_sequence.store(seq + 2, std::memory_order_release);
+}
+
+void PadInput::latch(uint16_t &button_state, uint8_t *axis_state)
+{
+    button_state = buttons.load(std::memory_order_acquire);
+
+    uint32_t seq_start, seq_end;
+    do
+    {
+        seq_start = axis_sequence.load(std::memory_order_acquire);
+        for (int i = 0; i < 4; i++)
+            axis_state[i] = axes[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        seq_end = axis_sequence.load(std::memory_order_relaxed);
+    } while ((seq_start & 0x1) || seq_start != seq_end);
+}
+
 Gamepad::Gamepad()
 {
 
@@ -31,7 +80,13 @@ void Gamepad::reset()
     //The first reply is always high-z
     command_buffer[0] = 0xFF;
     config_mode = false;
+    input.reset();
+    memcpy(mask_mode, mask_mode_default, sizeof(mask_mode));
     buttons = 0xFFFF;
+    for (int i = 0; i < 16; i++)
+        button_pressure[i] = 0;
+    for (int i = 0; i < 4; i++)
+        axes[i] = 0x80;
     command_length = 0;
     pad_mode = DIGITAL;
     command = 0;
@@ -42,16 +97,27 @@ void Gamepad::reset()
     reset_vibrate();
 }
 
+//These may be called from any thread; the emulated pad only sees the change on its next poll
 void Gamepad::press_button(PAD_BUTTON button)
 {
-    buttons &= ~(1 << (int)button);
-    button_pressure[(int)button] = 0xFF;
+    input.press_button(button);
 }
 
 void Gamepad::release_button(PAD_BUTTON button)
 {
-    buttons |= 1 << (int)button;
-    button_pressure[(int)button] = 0;
+    input.release_button(button);
+}
+
+void Gamepad::set_axis(PAD_AXIS axis, uint8_t value)
+{
+    input.set_axis(axis, value);
+}
+
+void Gamepad::latch_input()
+{
+    input.latch(buttons, axes);
+    for (int i = 0; i < 16; i++)
+        button_pressure[i] = (buttons & (1 << i)) ? 0 : 0xFF;
 }
 
 void Gamepad::set_result(const uint8_t *result)
@@ -72,6 +138,7 @@ uint8_t Gamepad::start_transfer(uint8_t value)
 {
     data_count = 0;
     command_length = 5;
+    latch_input();
     return 0xFF;
 }
 
@@ -113,10 +180,10 @@ uint8_t Gamepad::write_SIO(uint8_t value)
                 if (pad_mode != DIGITAL)
                 {
                     command_length = 9;
-                    command_buffer[5] = 0x80;
-                    command_buffer[6] = 0x80;
-                    command_buffer[7] = 0x80;
-                    command_buffer[8] = 0x80;
+                    command_buffer[5] = axes[(int)PAD_AXIS::RIGHT_X];
+                    command_buffer[6] = axes[(int)PAD_AXIS::RIGHT_Y];
+                    command_buffer[7] = axes[(int)PAD_AXIS::LEFT_X];
+                    command_buffer[8] = axes[(int)PAD_AXIS::LEFT_Y];
                     if (pad_mode != ANALOG && !config_mode)
                     {
                         command_buffer[9] = button_pressure[(int)PAD_BUTTON::RIGHT];
@@ -1,5 +1,6 @@
 #ifndef GAMEPAD_HPP
 #define GAMEPAD_HPP
+#include <atomic>
 #include <cstdint>
 
 enum class PAD_BUTTON
@@ -22,6 +23,38 @@ enum class PAD_BUTTON
     SQUARE
 };
 
+//Ordered as they appear in an analog pad's reply
+enum class PAD_AXIS
+{
+    RIGHT_X,
+    RIGHT_Y,
+    LEFT_X,
+    LEFT_Y
+};
+
+/*
+PadInput is the mailbox between the frontend (or an input script) and the emulated pad.
+Writers may live on any thread; the emulation thread latches a consistent snapshot once per SIO2 poll.
+Buttons are a single atomic bitmask, while the analog axes are protected by a seqlock so that
+the emulation thread never has to take a mutex.
+*/
+class PadInput
+{
+    private:
+        std::atomic<uint16_t> buttons;
+        std::atomic<uint32_t> axis_sequence;
+        std::atomic<uint8_t> axes[4];
+    public:
+        PadInput();
+
+        void reset();
+        void press_button(PAD_BUTTON button);
+        void release_button(PAD_BUTTON button);
+        void set_axis(PAD_AXIS axis, uint8_t value);
+
+        void latch(uint16_t& button_state, uint8_t* axis_state);
+};
+
 enum PAD_MODE
 {
     DIGITAL = 0x41,
@@ -35,14 +68,17 @@ class Gamepad
         uint8_t command_buffer[25];
         uint8_t rumble_values[8];
         uint8_t mode_lock;
+        PadInput input;
         uint16_t buttons;
         uint8_t button_pressure[16];
+        uint8_t axes[4];
         uint8_t command;
         int command_length;
         int data_count;
 
         uint8_t mask[2];
-        static uint8_t mask_mode[7];
+        uint8_t mask_mode[7];
+        const static uint8_t mask_mode_default[7];
         const static uint8_t vref_param[7];
         const static uint8_t config_exit[7];
         const static uint8_t set_mode[7];
@@ -58,12 +94,14 @@ class Gamepad
 
         void reset_vibrate();
         void set_result(const uint8_t* result);
+        void latch_input();
     public:
         Gamepad();
 
         void reset();
         void press_button(PAD_BUTTON button);
         void release_button(PAD_BUTTON button);
+        void set_axis(PAD_AXIS axis, uint8_t value);
 
         uint8_t start_transfer(uint8_t value);
         uint8_t write_SIO(uint8_t value);
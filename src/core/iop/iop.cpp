@@ -9,7 +9,10 @@
 
 IOP::IOP(Emulator* e) : e(e)
 {
-
+    write_log = nullptr;
+    trace = nullptr;
+    profiler = nullptr;
+    profile_countdown = 0;
 }
 
 const char* IOP::REG(int id)
@@ -63,7 +66,16 @@ void IOP::run(int cycles)
                 printf("[IOP] [$%08X] $%08X - %s\n", PC, instr, EmotionDisasm::disasm_instr(instr, PC).c_str());
                 //print_state();
             }
+            if (trace)
+                trace->instruction(PC, instr);
+            if (profiler && --profile_countdown <= 0)
+            {
+                profile_countdown = profiler->get_interval(PROFILE_IOP);
+                profiler->sample_mips(PROFILE_IOP, PC, gpr[31], gpr[29]);
+            }
             IOP_Interpreter::interpret(*this, instr);
+            if (trace && trace->records_registers())
+                trace->iop_registers(gpr);
 
             PC += 4;
 
@@ -105,6 +117,36 @@ void IOP::set_disassembly(bool dis)
     can_disassemble = dis;
 }
 
+void IOP::set_write_log(WriteLog* log)
+{
+    write_log = log;
+}
+
+void IOP::set_trace(TraceStream* trace)
+{
+    this->trace = trace;
+}
+
+void IOP::set_profiler(Profiler* profiler)
+{
+    this->profiler = profiler;
+    profile_countdown = profiler ? profiler->get_interval(PROFILE_IOP) : 0;
+}
+
+void IOP::get_state(IOP_State& state)
+{
+    for (int i = 0; i < 32; i++)
+        state.gpr[i] = gpr[i];
+    state.PC = PC;
+    state.LO = LO;
+    state.HI = HI;
+    state.new_PC = new_PC;
+    state.will_branch = will_branch;
+    state.cop0_status = cop0.mfc(12);
+    state.cop0_cause = cop0.mfc(13);
+    state.cop0_EPC = cop0.mfc(14);
+}
+
 void IOP::jp(uint32_t addr)
 {
     if (!will_branch)
@@ -227,6 +269,7 @@ void IOP::write8(uint32_t addr, uint8_t value)
 {
     if (cop0.status.IsC)
         return;
+    log_write(addr, 1, value);
     e->iop_write8(translate_addr(addr), value);
 }
 
@@ -238,6 +281,7 @@ void IOP::write16(uint32_t addr, uint16_t value)
     {
         Errors::die("[IOP] Invalid write16 to $%08X!\n", addr);
     }
+    log_write(addr, 2, value);
     e->iop_write16(translate_addr(addr), value);
 }
 
@@ -249,5 +293,6 @@ void IOP::write32(uint32_t addr, uint32_t value)
     {
         Errors::die("[IOP] Invalid write32 to $%08X!\n", addr);
     }
+    log_write(addr, 4, value);
     e->iop_write32(translate_addr(addr), value);
 }
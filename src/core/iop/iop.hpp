@@ -5,8 +5,21 @@
 #include <cstdio>
 #include <fstream>
 #include "iop_cop0.hpp"
+#include "../trace.hpp"
+#include "../writelog.hpp"
 
 class Emulator;
+class Profiler;
+
+//Architectural state, as compared by the lockstep harness
+struct IOP_State
+{
+    uint32_t gpr[32];
+    uint32_t PC, LO, HI;
+    uint32_t new_PC;
+    bool will_branch;
+    uint32_t cop0_status, cop0_cause, cop0_EPC;
+};
 
 class IOP
 {
@@ -23,7 +36,13 @@ class IOP
         bool will_branch;
         bool wait_for_IRQ;
 
+        WriteLog* write_log;
+        TraceStream* trace;
+        Profiler* profiler;
+        int profile_countdown;
+
         uint32_t translate_addr(uint32_t addr);
+        void log_write(uint32_t addr, int size, uint32_t value);
     public:
         IOP(Emulator* e);
         static const char* REG(int id);
@@ -34,6 +53,10 @@ class IOP
         void unhalt();
         void print_state();
         void set_disassembly(bool dis);
+        void set_write_log(WriteLog* log);
+        void set_trace(TraceStream* trace);
+        void set_profiler(Profiler* profiler);
+        void get_state(IOP_State& state);
 
         void jp(uint32_t addr);
         void branch(bool condition, int32_t offset);
@@ -68,6 +91,14 @@ class IOP
         void save_state(std::ofstream& state);
 };
 
+inline void IOP::log_write(uint32_t addr, int size, uint32_t value)
+{
+    if (write_log)
+        write_log->push_back({addr, size, uint128_t::from_u32(value)});
+    if (trace && trace->records_writes())
+        trace->write(addr, size, uint128_t::from_u32(value));
+}
+
 inline void IOP::halt()
 {
     wait_for_IRQ = true;
@@ -110,6 +110,7 @@ void IOP_DMA::process_CDVD()
     {
         printf("[IOP DMA] CDVD bytes: $%08X\n", count);
         uint32_t bytes_read = cdvd->read_to_RAM(RAM + channels[CDVD].addr, count);
+        e->mark_dirty(REGION_IOP_RAM, channels[CDVD].addr, bytes_read);
         if (count <= bytes_read)
         {
             transfer_end(CDVD);
@@ -233,6 +234,7 @@ void IOP_DMA::process_SIF1()
         {
             uint32_t data = sif->read_SIF1();
 
+            e->mark_dirty(REGION_IOP_RAM, channels[SIF1].addr);
             *(uint32_t*)&RAM[channels[SIF1].addr] = data;
             channels[SIF1].addr += 4;
             channels[SIF1].word_count--;
@@ -282,6 +284,7 @@ void IOP_DMA::process_SIO2out()
     int size = channels[SIO2out].word_count * channels[SIO2out].block_size * 4;
     while (size)
     {
+        e->mark_dirty(REGION_IOP_RAM, channels[SIO2out].addr);
         RAM[channels[SIO2out].addr] = sio2->read_serial();
         channels[SIO2out].addr++;
         size--;
@@ -1,6 +1,444 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include "memcard.hpp"
+#include "../errors.hpp"
+#include "../threadtopology.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+The memory card image is a raw dump of the card's flash: 528-byte pages, each holding 512 bytes of data
+plus 16 bytes of ECC. ECC is generated by the IOP's memory card driver, so the card simply stores it.
+
+File-backed cards are mmap'd where possible so that reads come straight from the page cache.
+Writes only touch memory and set a dirty bit; a background thread writes dirty pages back to the file,
+so saving never blocks the emulation thread on I/O.
+**/
+
+using namespace std;
 
 Memcard::Memcard()
 {
+    data = nullptr;
+    mapped = false;
+    file_handle = -1;
+    write_back = false;
+    flush_requested = false;
+    flush_abort = false;
+    for (int i = 0; i < MEMCARD_PAGE_COUNT / 64; i++)
+        dirty_pages[i] = 0;
+}
+
+Memcard::~Memcard()
+{
+    close();
+}
+
+bool Memcard::open(const char* file_name)
+{
+    close();
+#ifndef _WIN32
+    int fd = ::open(file_name, O_RDWR | O_CREAT, 0644);
+    if (fd >= 0)
+    {
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+            st.st_size = -1;
+        bool blank = st.st_size == 0;
+        if (blank && ftruncate(fd, MEMCARD_SIZE) != 0)
+            blank = false;
+        if (blank || st.st_size == MEMCARD_SIZE)
+        {
+            void* map = mmap(nullptr, MEMCARD_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                data = (uint8_t*)map;
+                mapped = true;
+                file_handle = fd;
+                if (blank)
+                {
+                    //An unformatted card is all 1s; the BIOS will format it on first use
+                    memset(data, 0xFF, MEMCARD_SIZE);
+                    msync(data, MEMCARD_SIZE, MS_ASYNC);
+                }
+            }
+        }
+        if (!mapped)
+            ::close(fd);
+    }
+#endif
+    if (!mapped)
+    {
+        //mmap isn't available, so keep the image in memory and write dirty pages through a stream
+        card_file.open(file_name, ios::in | ios::out | ios::binary);
+        if (!card_file.is_open())
+        {
+            ofstream create(file_name, ios::binary);
+            create.close();
+            card_file.open(file_name, ios::in | ios::out | ios::binary);
+            if (!card_file.is_open())
+                return false;
+        }
+        data = new uint8_t[MEMCARD_SIZE];
+        memset(data, 0xFF, MEMCARD_SIZE);
+        card_file.read((char*)data, MEMCARD_SIZE);
+        streamsize size = card_file.gcount();
+        card_file.clear();
+        if (size != 0 && size != MEMCARD_SIZE)
+        {
+            printf("[MCD] %s is not an 8 MB memory card image\n", file_name);
+            close();
+            return false;
+        }
+        if (size == 0)
+        {
+            card_file.seekp(0);
+            card_file.write((char*)data, MEMCARD_SIZE);
+            card_file.flush();
+        }
+    }
+
+    printf("[MCD] Loaded memory card %s\n", file_name);
+    write_back = true;
+    flush_abort = false;
+    flush_requested = false;
+    flush_thread = std::thread(&Memcard::flush_loop, this);
+    return true;
+}
+
+void Memcard::open_in_memory()
+{
+    //Ephemeral card for test runs; contents are discarded when the card is closed
+    close();
+    data = new uint8_t[MEMCARD_SIZE];
+    memset(data, 0xFF, MEMCARD_SIZE);
+}
+
+void Memcard::close()
+{
+    if (flush_thread.joinable())
+    {
+        {
+            lock_guard<mutex> lock(flush_mutex);
+            flush_abort = true;
+        }
+        flush_cv.notify_one();
+        flush_thread.join();
+    }
+    if (write_back)
+        flush_dirty_pages();
+    write_back = false;
+
+#ifndef _WIN32
+    if (mapped)
+    {
+        munmap(data, MEMCARD_SIZE);
+        ::close(file_handle);
+        file_handle = -1;
+        mapped = false;
+        data = nullptr;
+    }
+#endif
+    if (card_file.is_open())
+        card_file.close();
+    if (data)
+        delete[] data;
+    data = nullptr;
+}
+
+void Memcard::flush()
+{
+    if (write_back)
+        request_flush();
+}
+
+void Memcard::reset()
+{
+    command = 0;
+    data_count = 0;
+    terminator = 0x55;
+    transfer_size = 0;
+    checksum = 0;
+    auth_command = 0;
+    sector = 0;
+    erase_sector = 0;
+    rw_address = 0;
+}
+
+void Memcard::mark_dirty(uint32_t address)
+{
+    if (!write_back)
+        return;
+    uint32_t page = address / MEMCARD_RAW_PAGE_SIZE;
+    dirty_pages[page / 64].fetch_or(1ULL << (page % 64), memory_order_release);
+}
+
+void Memcard::request_flush()
+{
+    {
+        lock_guard<mutex> lock(flush_mutex);
+        flush_requested = true;
+    }
+    flush_cv.notify_one();
+}
+
+void Memcard::flush_loop()
+{
+    ThreadRoleScope role(ROLE_IO);
+    unique_lock<mutex> lock(flush_mutex);
+    while (!flush_abort)
+    {
+        //Flush when the IOP finishes a write sequence, or periodically in case it never does
+        flush_cv.wait_for(lock, chrono::seconds(1), [this] { return flush_requested || flush_abort; });
+        flush_requested = false;
+        lock.unlock();
+        flush_dirty_pages();
+        lock.lock();
+    }
+}
+
+void Memcard::flush_dirty_pages()
+{
+    for (int i = 0; i < MEMCARD_PAGE_COUNT / 64; i++)
+    {
+        uint64_t bits = dirty_pages[i].exchange(0, memory_order_acquire);
+        while (bits)
+        {
+            //Write back each run of contiguous dirty pages in one go
+            int first = __builtin_ctzll(bits);
+            int last = first;
+            while (last < 64 && (bits & (1ULL << last)))
+                last++;
+            if (last == 64)
+                bits = 0;
+            else
+                bits &= ~((1ULL << last) - 1);
+            flush_range((i * 64) + first, (i * 64) + last);
+        }
+    }
+}
+
+void Memcard::flush_range(uint32_t start, uint32_t end)
+{
+    uint32_t offset = start * MEMCARD_RAW_PAGE_SIZE;
+    uint32_t len = (end - start) * MEMCARD_RAW_PAGE_SIZE;
+#ifndef _WIN32
+    if (mapped)
+    {
+        //msync needs an address aligned to the host page size
+        uint32_t host_page = sysconf(_SC_PAGESIZE);
+        uint32_t aligned = offset & ~(host_page - 1);
+        msync(data + aligned, len + (offset - aligned), MS_SYNC);
+        return;
+    }
+#endif
+    card_file.seekp(offset);
+    card_file.write((char*)data + offset, len);
+    card_file.flush();
+}
+
+uint8_t Memcard::read_byte()
+{
+    uint8_t value = data[rw_address];
+    rw_address = (rw_address + 1) % MEMCARD_SIZE;
+    return value;
+}
+
+void Memcard::write_byte(uint8_t value)
+{
+    data[rw_address] = value;
+    mark_dirty(rw_address);
+    rw_address = (rw_address + 1) % MEMCARD_SIZE;
+}
+
+void Memcard::erase_block()
+{
+    uint32_t addr = (erase_sector & ~(MEMCARD_PAGES_PER_BLOCK - 1)) % MEMCARD_PAGE_COUNT;
+    addr *= MEMCARD_RAW_PAGE_SIZE;
+    memset(data + addr, 0xFF, MEMCARD_RAW_PAGE_SIZE * MEMCARD_PAGES_PER_BLOCK);
+    for (int i = 0; i < MEMCARD_PAGES_PER_BLOCK; i++)
+        mark_dirty(addr + (i * MEMCARD_RAW_PAGE_SIZE));
+}
+
+//Most commands end with an acknowledge byte followed by the terminator
+uint8_t Memcard::end_reply(int pos)
+{
+    switch (pos)
+    {
+        case 0:
+            return 0x2B;
+        case 1:
+            return terminator;
+        default:
+            return 0xFF;
+    }
+}
+
+uint8_t Memcard::start_transfer(uint8_t)
+{
+    command = 0;
+    data_count = 0;
+    return 0xFF;
+}
+
+uint8_t Memcard::write_SIO(uint8_t value)
+{
+    if (!data_count)
+    {
+        printf("[MCD] New command: $%02X\n", value);
+        command = value;
+        checksum = 0;
+        data_count++;
+        return 0xFF;
+    }
+
+    int pos = data_count - 1;
+    data_count++;
 
+    switch (command)
+    {
+        case 0x11: //Probe
+        case 0x12:
+            return end_reply(pos);
+        case 0x81: //Read/write end
+            if (pos == 0)
+                request_flush();
+            return end_reply(pos);
+        case 0x82: //Erase block
+            if (pos == 0)
+                erase_block();
+            return end_reply(pos);
+        case 0x21: //Set erase sector
+        case 0x22: //Set write sector
+        case 0x23: //Set read sector
+            if (pos < 4)
+            {
+                if (pos == 0)
+                    sector = 0;
+                sector |= (uint32_t)value << (pos * 8);
+                return 0xFF;
+            }
+            if (pos == 4)
+            {
+                if (command == 0x21)
+                    erase_sector = sector;
+                else
+                    rw_address = (sector % MEMCARD_PAGE_COUNT) * MEMCARD_RAW_PAGE_SIZE;
+                return 0xFF;
+            }
+            return end_reply(pos - 5);
+        case 0x26: //Get card specs
+        {
+            const uint8_t specs[8] =
+            {
+                MEMCARD_PAGE_SIZE & 0xFF, MEMCARD_PAGE_SIZE >> 8,
+                MEMCARD_PAGES_PER_BLOCK & 0xFF, MEMCARD_PAGES_PER_BLOCK >> 8,
+                MEMCARD_PAGE_COUNT & 0xFF, (MEMCARD_PAGE_COUNT >> 8) & 0xFF, 0x00, 0x00
+            };
+            if (pos == 0)
+                return 0x2B;
+            if (pos <= 8)
+            {
+                checksum ^= specs[pos - 1];
+                return specs[pos - 1];
+            }
+            if (pos == 9)
+                return checksum;
+            if (pos == 10)
+                return terminator;
+            return 0xFF;
+        }
+        case 0x27: //Set terminator
+            if (pos == 0)
+            {
+                terminator = value;
+                return 0xFF;
+            }
+            return end_reply(pos - 1);
+        case 0x28: //Get terminator
+            if (pos == 2)
+                return 0x55;
+            return end_reply(pos);
+        case 0x42: //Write data
+            if (pos == 0)
+            {
+                transfer_size = value;
+                return 0xFF;
+            }
+            if (pos <= transfer_size)
+            {
+                write_byte(value);
+                return 0xFF;
+            }
+            if (pos == transfer_size + 1)
+                return 0xFF;
+            return end_reply(pos - transfer_size - 2);
+        case 0x43: //Read data
+            if (pos == 0)
+            {
+                transfer_size = value;
+                return 0xFF;
+            }
+            if (pos == 1)
+                return 0x2B;
+            if (pos < transfer_size + 2)
+            {
+                uint8_t reply = read_byte();
+                checksum ^= reply;
+                return reply;
+            }
+            if (pos == transfer_size + 2)
+                return checksum;
+            if (pos == transfer_size + 3)
+                return terminator;
+            return 0xFF;
+        case 0xBF:
+        case 0xF3: //Reset authentication
+        case 0xF7:
+            if (pos == 0)
+                return 0xFF;
+            return end_reply(pos - 1);
+        case 0xF0: //MagicGate authentication
+        case 0xF1:
+        case 0xF2:
+            //The actual handshake isn't emulated. Each step is answered with well-formed dummy data, like PCSX2 does.
+            if (pos == 0)
+            {
+                auth_command = value;
+                return 0xFF;
+            }
+            switch (auth_command)
+            {
+                case 0x01:
+                case 0x02:
+                case 0x04:
+                case 0x0F:
+                case 0x11:
+                case 0x13:
+                    if (pos == 1)
+                        return 0x2B;
+                    if (pos < 11)
+                        return 0x00;
+                    if (pos == 11)
+                        return terminator;
+                    return 0xFF;
+                case 0x06:
+                case 0x07:
+                case 0x0B:
+                    if (pos < 10)
+                        return 0xFF;
+                    return end_reply(pos - 10);
+                default:
+                    return end_reply(pos - 1);
+            }
+        default:
+            Errors::die("[MCD] Unrecognized command $%02X\n", command);
+    }
+    return 0xFF;
 }
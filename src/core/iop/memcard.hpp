@@ -1,11 +1,78 @@
 #ifndef MEMCARD_HPP
 #define MEMCARD_HPP
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+//Standard 8 MB card: 0x4000 pages of 512 bytes of data followed by 16 bytes of ECC/spare area
+#define MEMCARD_PAGE_SIZE 0x200
+#define MEMCARD_ECC_SIZE 0x10
+#define MEMCARD_RAW_PAGE_SIZE (MEMCARD_PAGE_SIZE + MEMCARD_ECC_SIZE)
+#define MEMCARD_PAGES_PER_BLOCK 0x10
+#define MEMCARD_PAGE_COUNT 0x4000
+#define MEMCARD_SIZE (MEMCARD_RAW_PAGE_SIZE * MEMCARD_PAGE_COUNT)
 
 class Memcard
 {
+    private:
+        //Raw card image, either mmap'd from the card file or a plain heap allocation
+        uint8_t* data;
+        bool mapped;
+        int file_handle;
+        std::fstream card_file;
+        bool write_back;
+
+        //One bit per card page, set by the emulation thread and consumed by the flush thread
+        std::atomic<uint64_t> dirty_pages[MEMCARD_PAGE_COUNT / 64];
+        std::thread flush_thread;
+        std::mutex flush_mutex;
+        std::condition_variable flush_cv;
+        bool flush_requested;
+        bool flush_abort;
+
+        uint8_t command;
+        int data_count;
+        uint8_t terminator;
+        uint8_t transfer_size;
+        uint8_t checksum;
+        uint8_t auth_command;
+
+        uint32_t sector;
+        uint32_t erase_sector;
+        uint32_t rw_address;
+
+        void mark_dirty(uint32_t address);
+        void request_flush();
+        void flush_loop();
+        void flush_dirty_pages();
+        void flush_range(uint32_t start, uint32_t end);
+
+        uint8_t read_byte();
+        void write_byte(uint8_t value);
+        void erase_block();
+        uint8_t end_reply(int pos);
     public:
         Memcard();
+        ~Memcard();
+
+        bool open(const char* file_name);
+        void open_in_memory();
+        void close();
+        void flush();
+        bool is_connected();
+
+        void reset();
+
+        uint8_t start_transfer(uint8_t value);
+        uint8_t write_SIO(uint8_t value);
 };
 
+inline bool Memcard::is_connected()
+{
+    return data != nullptr;
+}
+
 #endif // MEMCARD_HPP
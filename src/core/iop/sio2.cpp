@@ -21,6 +21,7 @@ void SIO2::reset()
     control = 0;
     new_command = false;
     RECV1 = 0x1D100;
+    port = 0;
 }
 
 uint8_t SIO2::read_serial()
@@ -71,8 +72,12 @@ void SIO2::write_serial(uint8_t value)
             printf("[SIO2] Get new send3 port: $%08X\n", send3[send3_port]);
             command_length = (send3[send3_port] >> 8) & 0x1FF;
             printf("[SIO2] Command len: %d\n", command_length);
+            port = send3[send3_port] & 0x1;
             send3_port++;
             new_command = true;
+
+            //Each SEND3 entry addresses its own device
+            active_command = SIO_DEVICE::NONE;
         }
     }
 
@@ -92,6 +97,13 @@ void SIO2::write_device(uint8_t value)
                 case 0x01:
                     active_command = SIO_DEVICE::PAD;
                     break;
+                case 0x81:
+                    //Only a card in the first slot is emulated
+                    if (port == 0 && memcard->is_connected())
+                        active_command = SIO_DEVICE::MEMCARD;
+                    else
+                        active_command = SIO_DEVICE::DUMMY;
+                    break;
                 default:
                     active_command = SIO_DEVICE::DUMMY;
                     break;
@@ -114,6 +126,21 @@ void SIO2::write_device(uint8_t value)
             FIFO.push(reply);
         }
             break;
+        case SIO_DEVICE::MEMCARD:
+        {
+            RECV1 = 0x1100;
+            uint8_t reply;
+            if (new_command)
+            {
+                new_command = false;
+                reply = memcard->start_transfer(value);
+            }
+            else
+                reply = memcard->write_SIO(value);
+            printf("[SIO2] MEMCARD reply: $%02X\n", reply);
+            FIFO.push(reply);
+        }
+            break;
         case SIO_DEVICE::DUMMY:
             FIFO.push(0x00);
             RECV1 = 0x1D100;
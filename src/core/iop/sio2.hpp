@@ -37,6 +37,7 @@ class SIO2
         SIO_DEVICE active_command;
         int command_length;
         int send3_port;
+        int port;
 
         void write_device(uint8_t value);
     public:
@@ -9,10 +9,7 @@
  * Bits 0 and 1 of the ADMA control register determine if the core is transferring data via AutoDMA.
  * Bit 2 seems to be some sort of finish flag?
  */
-uint16_t SPU::spdif_irq = 0;
-uint16_t SPU::core_att[2];
-uint32_t SPU::IRQA[2];
-SPU::SPU(int id, Emulator* e) : id(id), e(e)
+SPU::SPU(int id, Emulator* e, SPU_COMMON* common) : id(id), e(e), common(common)
 { 
 
 }
@@ -24,13 +21,13 @@ void SPU::reset(uint8_t* RAM)
     status.DMA_finished = false;
     transfer_addr = 0;
     current_addr = 0;
-    core_att[id-1] = 0;
+    common->core_att[id-1] = 0;
     autodma_ctrl = 0x0;
     ADMA_left = 0;
     input_pos = 0;
     key_on = 0;
     key_off = 0xFFFFFF;
-    spdif_irq = 0;
+    common->spdif_irq = 0;
 
     for (int i = 0; i < 24; i++)
     {
@@ -43,7 +40,7 @@ void SPU::reset(uint8_t* RAM)
         voices[i].loop_addr_specified = false;
     }
 
-    IRQA[id-1] = 0x800;
+    common->IRQA[id-1] = 0x800;
 
     ENDX = 0;
 }
@@ -52,18 +49,18 @@ void SPU::spu_check_irq(uint32_t address)
 {
     for (int j = 0; j < 2; j++)
     {
-        if (address == IRQA[j] && (core_att[j] & (1 << 6)))
+        if (address == common->IRQA[j] && (common->core_att[j] & (1 << 6)))
             spu_irq(j);
     }
 }
 
 void SPU::spu_irq(int index)
 {
-    if (spdif_irq & (4 << index))
+    if (common->spdif_irq & (4 << index))
         return;
 
     printf("[SPU%d] IRQA interrupt!\n", index);
-    spdif_irq |= 4 << index;
+    common->spdif_irq |= 4 << index;
     e->iop_request_IRQ(9);
 }
 
@@ -155,6 +152,8 @@ void SPU::start_DMA(int size)
 void SPU::write_DMA(uint32_t value)
 {
     //printf("[SPU%d] Write mem $%08X ($%08X)\n", id, value, current_addr);
+    //RAM is in halfwords
+    e->mark_dirty(REGION_SPU_RAM, current_addr * 2, 4);
     RAM[current_addr] = value & 0xFFFF;
     RAM[current_addr + 1] = value >> 16;
 
@@ -203,6 +202,7 @@ uint16_t SPU::read_mem()
 void SPU::write_mem(uint16_t value)
 {
     printf("[SPU%d] Write mem $%04X ($%08X)\n", id, value, current_addr);
+    e->mark_dirty(REGION_SPU_RAM, current_addr * 2);
     RAM[current_addr] = value;
     
     spu_check_irq(current_addr);
@@ -217,8 +217,8 @@ uint16_t SPU::read16(uint32_t addr)
     {
         if (addr == 0x7C2)
         {
-            printf("[SPU] Read SPDIF_IRQ: $%04X\n", spdif_irq);
-            return spdif_irq;
+            printf("[SPU] Read SPDIF_IRQ: $%04X\n", common->spdif_irq);
+            return common->spdif_irq;
         }
         printf("[SPU] Read high addr $%04X\n", addr);
         return 0;
@@ -283,7 +283,7 @@ uint16_t SPU::read16(uint32_t addr)
             return voice_mixwet_right & 0xFFFF;
         case 0x19A:
             printf("[SPU%d] Read Core Att\n", id);
-            return core_att[id-1];
+            return common->core_att[id-1];
         case 0x1A0:
             printf("[SPU%d] Read KON1: $%04X\n", id, (key_off >> 16));
             return (key_on >> 16);
@@ -366,7 +366,7 @@ void SPU::write16(uint32_t addr, uint16_t value)
         if (addr == 0x7C2)
         {
             printf("[SPU] Write SPDIF_IRQ: $%04X\n", value);
-            spdif_irq = value;
+            common->spdif_irq = value;
             return;
         }
         printf("[SPU] Write high addr $%04X: $%04X\n", addr, value);
@@ -455,12 +455,12 @@ void SPU::write16(uint32_t addr, uint16_t value)
             break;
         case 0x19A:
             printf("[SPU%d] Write Core Att: $%04X\n", id, value);
-            if (core_att[id - 1] & (1 << 6))
+            if (common->core_att[id - 1] & (1 << 6))
             {
                 if (!(value & (1 << 6)))
-                    spdif_irq &= ~(2 << id);
+                    common->spdif_irq &= ~(2 << id);
             }
-            core_att[id - 1] = value & 0x7FFF;
+            common->core_att[id - 1] = value & 0x7FFF;
             if (value & (1 << 15))
             {
                 status.DMA_finished = false;
@@ -469,13 +469,13 @@ void SPU::write16(uint32_t addr, uint16_t value)
             break;
         case 0x19C:
             printf("[SPU%d] Write IRQA_H: $%04X\n", id, value);
-            IRQA[id - 1] &= 0xFFFF;
-            IRQA[id - 1] |= (value & 0x3F) << 16;
+            common->IRQA[id - 1] &= 0xFFFF;
+            common->IRQA[id - 1] |= (value & 0x3F) << 16;
             break;
         case 0x19E:
             printf("[SPU%d] Write IRQA_L: $%04X\n", id, value);
-            IRQA[id - 1] &= ~0xFFFF;
-            IRQA[id - 1] |= value & 0xFFFF;
+            common->IRQA[id - 1] &= ~0xFFFF;
+            common->IRQA[id - 1] |= value & 0xFFFF;
             break;
         case 0x1A0:
             printf("[SPU%d] Write KON0: $%04X\n", id, value);
@@ -27,19 +27,25 @@ struct SPU_STAT
 
 class Emulator;
 
+//Registers that both cores can see. The Emulator owns one set and hands it to both SPU objects.
+struct SPU_COMMON
+{
+    uint16_t core_att[2];
+    uint16_t spdif_irq;
+    uint32_t IRQA[2];
+};
+
 class SPU
 {
     private:
         int id;
         Emulator* e;
+        SPU_COMMON* common;
 
         uint16_t* RAM;
         Voice voices[24];
-        static uint16_t core_att[2];
         SPU_STAT status;
 
-        static uint16_t spdif_irq;
-
         uint32_t transfer_addr;
 
         uint32_t current_addr;
@@ -55,7 +61,6 @@ class SPU
 
         int cycles;
 
-        static uint32_t IRQA[2];
         uint32_t ENDX;
         uint32_t key_on;
         uint32_t key_off;
@@ -72,7 +77,7 @@ class SPU
         void write_voice_reg(uint32_t addr, uint16_t value);
         void write_voice_addr(uint32_t addr, uint16_t value);
     public:
-        SPU(int id, Emulator* e);
+        SPU(int id, Emulator* e, SPU_COMMON* common);
 
         bool running_ADMA();
         bool can_write_ADMA();
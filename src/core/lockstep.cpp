@@ -0,0 +1,411 @@
+#include <algorithm>
+#include <cfenv>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include "lockstep.hpp"
+#include "ee/emotiondisasm.hpp"
+
+using namespace std;
+
+//Instructions listed from the start of a diverging block
+#define BLOCK_LISTING_SIZE 16
+
+LockstepHarness::LockstepHarness() : slices(0), frames(0)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        emulators[i] = unique_ptr<Emulator>(new Emulator());
+        emulators[i]->get_ee().set_write_log(&ee_writes[i]);
+        emulators[i]->get_iop().set_write_log(&iop_writes[i]);
+    }
+}
+
+LockstepHarness::~LockstepHarness()
+{
+    for (int i = 0; i < 2; i++)
+    {
+        emulators[i]->get_ee().set_write_log(nullptr);
+        emulators[i]->get_iop().set_write_log(nullptr);
+    }
+}
+
+Emulator& LockstepHarness::get(int side)
+{
+    return *emulators[side];
+}
+
+void LockstepHarness::load_BIOS(const uint8_t* BIOS_file)
+{
+    uint8_t* image = new uint8_t[1024 * 1024 * 4];
+    memcpy(image, BIOS_file, 1024 * 1024 * 4);
+    BIOS = shared_ptr<const uint8_t>(image, default_delete<uint8_t[]>());
+
+    for (int i = 0; i < 2; i++)
+        emulators[i]->load_shared_BIOS(BIOS);
+}
+
+void LockstepHarness::load_ELF(uint8_t* ELF, uint32_t size)
+{
+    for (int i = 0; i < 2; i++)
+        emulators[i]->load_ELF(ELF, size);
+}
+
+bool LockstepHarness::load_CDVD(const char* name)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (!emulators[i]->load_CDVD(name))
+            return false;
+    }
+    return true;
+}
+
+//Loads an ELF or ISO on both sides, picked by extension, with the matching BIOS skip if asked for
+bool LockstepHarness::load_exec(const char* file_name, bool skip_BIOS, string& error)
+{
+    string format = file_name;
+    format = format.substr(format.length() < 4 ? 0 : format.length() - 4);
+    transform(format.begin(), format.end(), format.begin(), ::tolower);
+    if (format == ".elf")
+    {
+        ifstream exec_file(file_name, ios::binary | ios::in | ios::ate);
+        long long ELF_size = exec_file.is_open() ? (long long)exec_file.tellg() : 0;
+        if (ELF_size <= 0)
+        {
+            error = string("Failed to load ") + file_name;
+            return false;
+        }
+        vector<uint8_t> ELF(ELF_size);
+        exec_file.seekg(0);
+        exec_file.read((char*)ELF.data(), ELF_size);
+        load_ELF(ELF.data(), ELF_size);
+        if (skip_BIOS)
+            set_skip_BIOS_hack(SKIP_HACK::LOAD_ELF);
+        return true;
+    }
+    if (format == ".iso")
+    {
+        if (!load_CDVD(file_name))
+        {
+            error = string("Failed to load ") + file_name;
+            return false;
+        }
+        if (skip_BIOS)
+            set_skip_BIOS_hack(SKIP_HACK::LOAD_DISC);
+        return true;
+    }
+    error = "Unrecognized file format " + format;
+    return false;
+}
+
+void LockstepHarness::set_skip_BIOS_hack(SKIP_HACK type)
+{
+    for (int i = 0; i < 2; i++)
+        emulators[i]->set_skip_BIOS_hack(type);
+}
+
+void LockstepHarness::queue_scripted_button(int frame, PAD_BUTTON button, bool pressed)
+{
+    for (int i = 0; i < 2; i++)
+        emulators[i]->queue_scripted_button(frame, button, pressed);
+}
+
+void LockstepHarness::reset()
+{
+    slices = 0;
+    frames = 0;
+    report.clear();
+    for (int i = 0; i < 2; i++)
+        emulators[i]->reset();
+}
+
+uint64_t LockstepHarness::get_slices()
+{
+    return slices;
+}
+
+const string& LockstepHarness::get_report()
+{
+    return report;
+}
+
+void LockstepHarness::add_report(const char* fmt, ...)
+{
+    char line[512];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    report += line;
+}
+
+//Returns false and fills in the report at the first divergence
+bool LockstepHarness::run_frames(int count)
+{
+    for (int frame = 0; frame < count; frame++)
+    {
+        int host_rounding = fegetround();
+        for (int i = 0; i < 2; i++)
+            emulators[i]->start_frame();
+
+        bool frame_running = true;
+        while (frame_running)
+        {
+            bool still_running[2] = {false, false};
+            string errors[2];
+            for (int i = 0; i < 2; i++)
+            {
+                ee_block[i] = emulators[i]->get_ee().get_PC();
+                iop_block[i] = emulators[i]->get_iop().get_PC();
+                ee_writes[i].clear();
+                iop_writes[i].clear();
+                try
+                {
+                    still_running[i] = emulators[i]->run_slice();
+                }
+                catch (runtime_error& e)
+                {
+                    errors[i] = e.what();
+                    if (errors[i].empty())
+                        errors[i] = "Unknown error";
+                }
+            }
+            slices++;
+
+            if (!errors[0].empty() || !errors[1].empty())
+            {
+                add_report("Frame %d, slice %llu: emulation stopped\n", frames, (unsigned long long)slices);
+                for (int i = 0; i < 2; i++)
+                    add_report("  Side %d: %s\n", i, errors[i].empty() ? "still running" : errors[i].c_str());
+                describe_blocks();
+                try
+                {
+                    finish_frame();
+                }
+                catch (runtime_error& e)
+                {
+                    //A side that already failed can fail again here; the report has what matters
+                }
+                //Which may have kept a side from putting the rounding mode back
+                fesetround(host_rounding);
+                return false;
+            }
+
+            bool same = compare_ee();
+            same = compare_iop() && same;
+            same = compare_writes("EE", ee_writes) && same;
+            same = compare_writes("IOP", iop_writes) && same;
+            if (!same)
+            {
+                describe_blocks();
+                finish_frame();
+                return false;
+            }
+            if (still_running[0] != still_running[1])
+            {
+                add_report("Frame %d, slice %llu: only side %d finished the frame\n", frames,
+                           (unsigned long long)slices, still_running[0] ? 1 : 0);
+                describe_blocks();
+                finish_frame();
+                return false;
+            }
+            frame_running = still_running[0];
+        }
+        finish_frame();
+        frames++;
+    }
+    return true;
+}
+
+void LockstepHarness::finish_frame()
+{
+    //Side 1 started its frame after side 0 set the EE's rounding mode, so it has to end first for side 0
+    //to put back the host's
+    for (int i = 1; i >= 0; i--)
+    {
+        emulators[i]->end_frame();
+
+        //Take the finished frame so that the GS thread's return queue doesn't back up
+        emulators[i]->get_framebuffer();
+    }
+}
+
+bool LockstepHarness::compare_ee()
+{
+    EE_State a, b;
+    emulators[0]->get_ee().get_state(a);
+    emulators[1]->get_ee().get_state(b);
+
+    bool same = true;
+    auto diverge = [&](const char* reg, uint64_t x, uint64_t y)
+    {
+        if (same)
+            add_report("Frame %d, slice %llu: EE state diverged\n", frames, (unsigned long long)slices);
+        add_report("  %s: $%016llX != $%016llX\n", reg, (unsigned long long)x, (unsigned long long)y);
+        same = false;
+    };
+
+    for (int i = 0; i < 32; i++)
+    {
+        uint64_t* x = (uint64_t*)&a.gpr[i * sizeof(uint64_t) * 2];
+        uint64_t* y = (uint64_t*)&b.gpr[i * sizeof(uint64_t) * 2];
+        if (x[0] != y[0] || x[1] != y[1])
+        {
+            char name[16];
+            snprintf(name, sizeof(name), "%s.lo", EmotionEngine::REG(i));
+            diverge(name, x[0], y[0]);
+            snprintf(name, sizeof(name), "%s.hi", EmotionEngine::REG(i));
+            diverge(name, x[1], y[1]);
+        }
+    }
+    if (a.LO != b.LO)
+        diverge("LO", a.LO, b.LO);
+    if (a.HI != b.HI)
+        diverge("HI", a.HI, b.HI);
+    if (a.LO1 != b.LO1)
+        diverge("LO1", a.LO1, b.LO1);
+    if (a.HI1 != b.HI1)
+        diverge("HI1", a.HI1, b.HI1);
+    if (a.SA != b.SA)
+        diverge("SA", a.SA, b.SA);
+    if (a.PC != b.PC)
+        diverge("PC", a.PC, b.PC);
+    if (a.branch_on != b.branch_on || (a.branch_on && a.new_PC != b.new_PC))
+        diverge("branch target", a.branch_on ? a.new_PC : 0, b.branch_on ? b.new_PC : 0);
+    for (int i = 0; i < 32; i++)
+    {
+        if (a.cop0[i] != b.cop0[i])
+        {
+            char name[16];
+            snprintf(name, sizeof(name), "cop0r%d", i);
+            diverge(name, a.cop0[i], b.cop0[i]);
+        }
+    }
+    for (int i = 0; i < 32; i++)
+    {
+        if (a.fpr[i] != b.fpr[i])
+        {
+            char name[16];
+            snprintf(name, sizeof(name), "f%d", i);
+            diverge(name, a.fpr[i], b.fpr[i]);
+        }
+    }
+    if (a.fpu_acc != b.fpu_acc)
+        diverge("ACC", a.fpu_acc, b.fpu_acc);
+    if (a.fpu_control != b.fpu_control)
+        diverge("FCR31", a.fpu_control, b.fpu_control);
+    return same;
+}
+
+bool LockstepHarness::compare_iop()
+{
+    IOP_State a, b;
+    emulators[0]->get_iop().get_state(a);
+    emulators[1]->get_iop().get_state(b);
+
+    bool same = true;
+    auto diverge = [&](const char* reg, uint32_t x, uint32_t y)
+    {
+        if (same)
+            add_report("Frame %d, slice %llu: IOP state diverged\n", frames, (unsigned long long)slices);
+        add_report("  %s: $%08X != $%08X\n", reg, x, y);
+        same = false;
+    };
+
+    for (int i = 0; i < 32; i++)
+    {
+        if (a.gpr[i] != b.gpr[i])
+            diverge(IOP::REG(i), a.gpr[i], b.gpr[i]);
+    }
+    if (a.LO != b.LO)
+        diverge("LO", a.LO, b.LO);
+    if (a.HI != b.HI)
+        diverge("HI", a.HI, b.HI);
+    if (a.PC != b.PC)
+        diverge("PC", a.PC, b.PC);
+    if (a.will_branch != b.will_branch || (a.will_branch && a.new_PC != b.new_PC))
+        diverge("branch target", a.will_branch ? a.new_PC : 0, b.will_branch ? b.new_PC : 0);
+    if (a.cop0_status != b.cop0_status)
+        diverge("STATUS", a.cop0_status, b.cop0_status);
+    if (a.cop0_cause != b.cop0_cause)
+        diverge("CAUSE", a.cop0_cause, b.cop0_cause);
+    if (a.cop0_EPC != b.cop0_EPC)
+        diverge("EPC", a.cop0_EPC, b.cop0_EPC);
+    return same;
+}
+
+bool LockstepHarness::compare_writes(const char* cpu, WriteLog* logs)
+{
+    size_t count = logs[0].size();
+    if (logs[1].size() > count)
+        count = logs[1].size();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        bool same = i < logs[0].size() && i < logs[1].size();
+        if (same)
+        {
+            LoggedWrite& x = logs[0][i];
+            LoggedWrite& y = logs[1][i];
+            same = x.address == y.address && x.size == y.size &&
+                    x.value.lo == y.value.lo && x.value.hi == y.value.hi;
+        }
+        if (same)
+            continue;
+
+        add_report("Frame %d, slice %llu: %s store #%zu diverged\n", frames, (unsigned long long)slices, cpu, i);
+        for (int side = 0; side < 2; side++)
+        {
+            if (i < logs[side].size())
+            {
+                LoggedWrite& w = logs[side][i];
+                add_report("  Side %d: write%d $%08X = $%016llX_%016llX\n", side, w.size * 8, w.address,
+                           (unsigned long long)w.value.hi, (unsigned long long)w.value.lo);
+            }
+            else
+                add_report("  Side %d: no store\n", side);
+        }
+        return false;
+    }
+    return true;
+}
+
+//Lists the code each side started the slice on. A slice may branch, so the listing runs linearly from the
+//block start and the instruction each side stopped at is marked when it falls inside it.
+void LockstepHarness::describe_blocks()
+{
+    for (int side = 0; side < 2; side++)
+    {
+        EmotionEngine& ee = emulators[side]->get_ee();
+        IOP& iop = emulators[side]->get_iop();
+        try
+        {
+            add_report("Side %d EE block at $%08X, stopped at $%08X:\n", side, ee_block[side], ee.get_PC());
+            for (int i = 0; i < BLOCK_LISTING_SIZE; i++)
+            {
+                uint32_t addr = ee_block[side] + (i * 4);
+                uint32_t instr = ee.read32(addr);
+                add_report("  %c [$%08X] $%08X - %s\n", addr == ee.get_PC() ? '>' : ' ', addr, instr,
+                           EmotionDisasm::disasm_instr(instr, addr).c_str());
+            }
+
+            //The IOP shares its encoding with the EE's MIPS I subset
+            add_report("Side %d IOP block at $%08X, stopped at $%08X:\n", side, iop_block[side], iop.get_PC());
+            for (int i = 0; i < BLOCK_LISTING_SIZE / 4; i++)
+            {
+                uint32_t addr = iop_block[side] + (i * 4);
+                uint32_t instr = iop.read32(addr);
+                add_report("  %c [$%08X] $%08X - %s\n", addr == iop.get_PC() ? '>' : ' ', addr, instr,
+                           EmotionDisasm::disasm_instr(instr, addr).c_str());
+            }
+        }
+        catch (runtime_error& e)
+        {
+            add_report("  Unable to read the block: %s\n", e.what());
+        }
+    }
+}
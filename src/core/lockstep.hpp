@@ -0,0 +1,58 @@
+#ifndef LOCKSTEP_HPP
+#define LOCKSTEP_HPP
+#include <memory>
+#include <string>
+
+#include "emulator.hpp"
+#include "writelog.hpp"
+
+/**
+Differential tester for the CPU execution engines.
+Two emulators are fed the same BIOS, executable and input script and are stepped one scheduler slice
+(up to 16 EE instructions and the IOP time that goes with them) at a time. After every slice the
+architectural state of both EEs and both IOPs is compared, along with every store each CPU made during
+the slice. The first difference stops the run and leaves a report with a disassembly of the block
+each side was executing.
+
+Nothing here depends on a frontend, so it can be driven headlessly over test ELFs and disc images.
+**/
+class LockstepHarness
+{
+    private:
+        std::unique_ptr<Emulator> emulators[2];
+        std::shared_ptr<const uint8_t> BIOS;
+
+        WriteLog ee_writes[2], iop_writes[2];
+        uint32_t ee_block[2], iop_block[2];
+
+        uint64_t slices;
+        int frames;
+        std::string report;
+
+        bool compare_ee();
+        bool compare_iop();
+        bool compare_writes(const char* cpu, WriteLog* logs);
+        void describe_blocks();
+        void finish_frame();
+        void add_report(const char* fmt, ...);
+    public:
+        LockstepHarness();
+        ~LockstepHarness();
+
+        Emulator& get(int side);
+
+        void load_BIOS(const uint8_t* BIOS_file);
+        void load_ELF(uint8_t* ELF, uint32_t size);
+        bool load_CDVD(const char* name);
+        bool load_exec(const char* file_name, bool skip_BIOS, std::string& error);
+        void set_skip_BIOS_hack(SKIP_HACK type);
+        void queue_scripted_button(int frame, PAD_BUTTON button, bool pressed);
+        void reset();
+
+        bool run_frames(int count);
+
+        uint64_t get_slices();
+        const std::string& get_report();
+};
+
+#endif // LOCKSTEP_HPP
@@ -0,0 +1,439 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "profiler.hpp"
+
+using namespace std;
+
+//How far above $sp to look for saved return addresses, and how deep a call stack may get
+#define PROFILE_STACK_SCAN_WORDS 256
+#define PROFILE_MAX_FRAMES 32
+
+static const char* unit_names[PROFILE_UNIT_COUNT] = {"EE", "IOP", "VU0", "VU1"};
+
+template <typename T> static bool read_elf(const uint8_t* data, uint32_t size, uint32_t offset, T& value)
+{
+    if (offset > size || size - offset < sizeof(T))
+        return false;
+    memcpy(&value, data + offset, sizeof(T));
+    return true;
+}
+
+SymbolTable::SymbolTable() : sorted(true)
+{
+
+}
+
+void SymbolTable::sort_symbols()
+{
+    sort(symbols.begin(), symbols.end(), [](const GuestSymbol& a, const GuestSymbol& b)
+    {
+        return a.start < b.start;
+    });
+
+    //Symbols without a size were given the rest of their section; they end where the next one starts
+    for (size_t i = 0; i + 1 < symbols.size(); i++)
+    {
+        uint32_t gap = symbols[i + 1].start - symbols[i].start;
+        if (gap && symbols[i].size > gap)
+            symbols[i].size = gap;
+    }
+    sorted = true;
+}
+
+/**
+Reads the function symbols out of an ELF's .symtab. Executables are taken at their linked addresses.
+Relocatable files (IRX modules) have no fixed address, so base must be where the module was loaded.
+**/
+bool SymbolTable::load_elf(const uint8_t* data, uint32_t size, uint32_t base, string& error)
+{
+    if (size < 0x34 || data[0] != 0x7F || data[1] != 'E' || data[2] != 'L' || data[3] != 'F')
+    {
+        error = "not an ELF file";
+        return false;
+    }
+    if (data[4] != 1 || data[5] != 1)
+    {
+        error = "not a 32-bit little-endian ELF";
+        return false;
+    }
+
+    uint16_t e_type, e_shentsize, e_shnum;
+    uint32_t e_shoff;
+    if (!read_elf(data, size, 0x10, e_type) || !read_elf(data, size, 0x20, e_shoff) ||
+            !read_elf(data, size, 0x2E, e_shentsize) || !read_elf(data, size, 0x30, e_shnum))
+    {
+        error = "truncated ELF header";
+        return false;
+    }
+    if (e_shentsize < 0x28 || !e_shnum)
+    {
+        error = "no section headers";
+        return false;
+    }
+    bool relocatable = e_type != 2;
+
+    auto section = [&](uint32_t index, uint32_t field, uint32_t& value)
+    {
+        return index < e_shnum && read_elf(data, size, e_shoff + index * e_shentsize + field, value);
+    };
+
+    uint32_t symtab = 0;
+    while (symtab < e_shnum)
+    {
+        uint32_t type;
+        if (!section(symtab, 0x4, type))
+        {
+            error = "truncated section headers";
+            return false;
+        }
+        if (type == 2) //SHT_SYMTAB
+            break;
+        symtab++;
+    }
+    if (symtab == e_shnum)
+    {
+        error = "no symbol table (the file is stripped)";
+        return false;
+    }
+
+    uint32_t sym_offset, sym_size, strtab, str_offset, str_size;
+    if (!section(symtab, 0x10, sym_offset) || !section(symtab, 0x14, sym_size) || !section(symtab, 0x18, strtab) ||
+            !section(strtab, 0x10, str_offset) || !section(strtab, 0x14, str_size) ||
+            sym_offset > size || sym_size > size - sym_offset || str_offset > size || str_size > size - str_offset)
+    {
+        error = "bad symbol table";
+        return false;
+    }
+
+    size_t added = 0;
+    for (uint32_t sym = sym_offset; sym + 16 <= sym_offset + sym_size; sym += 16)
+    {
+        uint32_t name, value, sym_size;
+        uint8_t info;
+        uint16_t shndx;
+        //Anything past a truncated entry is garbage
+        if (!read_elf(data, size, sym, name) || !read_elf(data, size, sym + 4, value) ||
+                !read_elf(data, size, sym + 8, sym_size) || !read_elf(data, size, sym + 12, info) ||
+                !read_elf(data, size, sym + 14, shndx))
+            break;
+
+        //Skip undefined, absolute and common symbols
+        if (!shndx || shndx >= 0xFF00 || name >= str_size)
+            continue;
+
+        //Functions, and untyped labels in code sections (hand-written assembly rarely sets a type)
+        uint32_t flags, address, section_size;
+        if (!section(shndx, 0x8, flags) || !section(shndx, 0xC, address) || !section(shndx, 0x14, section_size))
+            continue;
+        int type = info & 0xF;
+        if (type != 2 && !(type == 0 && (flags & 0x4)))
+            continue;
+
+        const char* str = (const char*)data + str_offset + name;
+        size_t length = strnlen(str, str_size - name);
+        if (!length)
+            continue;
+
+        GuestSymbol symbol;
+        symbol.start = base + value + (relocatable ? address : 0);
+        symbol.size = sym_size;
+        if (!symbol.size)
+            symbol.size = (relocatable ? 0 : address) + section_size - value;
+        symbol.name = string(str, length);
+        symbols.push_back(symbol);
+        added++;
+    }
+
+    if (!added)
+    {
+        error = "no function symbols";
+        return false;
+    }
+    sorted = false;
+    return true;
+}
+
+bool SymbolTable::load_file(const char* file_name, uint32_t base, string& error)
+{
+    ifstream file(file_name, ios::binary | ios::in);
+    if (!file.is_open())
+    {
+        error = "can't open file";
+        return false;
+    }
+    file.seekg(0, ios::end);
+    streamoff size = file.tellg();
+    if (size <= 0 || size > 0x7FFFFFFF)
+    {
+        error = "bad file size";
+        return false;
+    }
+    file.seekg(0, ios::beg);
+    vector<uint8_t> data(size);
+    file.read((char*)data.data(), size);
+    if (!file.good())
+    {
+        error = "read error";
+        return false;
+    }
+    return load_elf(data.data(), size, base, error);
+}
+
+const GuestSymbol* SymbolTable::find(uint32_t address)
+{
+    if (!sorted)
+        sort_symbols();
+
+    auto it = upper_bound(symbols.begin(), symbols.end(), address, [](uint32_t address, const GuestSymbol& symbol)
+    {
+        return address < symbol.start;
+    });
+    if (it == symbols.begin())
+        return nullptr;
+    --it;
+    if (address - it->start >= it->size)
+        return nullptr;
+    return &*it;
+}
+
+size_t SymbolTable::size()
+{
+    return symbols.size();
+}
+
+Profiler::Profiler() : active(false)
+{
+    for (int i = 0; i < PROFILE_UNIT_COUNT; i++)
+    {
+        units[i].interval = 0;
+        units[i].samples = 0;
+        units[i].RAM = nullptr;
+        units[i].RAM_size = 0;
+    }
+}
+
+//Clears any earlier samples. The IOP runs at an eighth of the EE's clock, so it gets an eighth of the interval.
+void Profiler::start(int ee_interval)
+{
+    for (int i = 0; i < PROFILE_UNIT_COUNT; i++)
+    {
+        lock_guard<mutex> lock(units[i].lock);
+        units[i].interval = (i == PROFILE_IOP) ? max(ee_interval / 8, 1) : ee_interval;
+        units[i].samples = 0;
+        units[i].stacks.clear();
+    }
+    active = true;
+}
+
+void Profiler::stop()
+{
+    active = false;
+}
+
+bool Profiler::is_active()
+{
+    return active;
+}
+
+int Profiler::get_interval(PROFILE_UNIT unit)
+{
+    return units[unit].interval;
+}
+
+//Stack walks only ever look at main RAM, so they can't touch registers with side effects
+void Profiler::set_RAM(PROFILE_UNIT unit, const uint8_t* RAM, uint32_t size)
+{
+    units[unit].RAM = RAM;
+    units[unit].RAM_size = size;
+}
+
+SymbolTable& Profiler::get_symbols(PROFILE_UNIT unit)
+{
+    return units[unit].symbols;
+}
+
+bool Profiler::read_word(UnitProfile& profile, uint32_t address, uint32_t& value)
+{
+    //kuseg, kseg0 and kseg1 all mirror physical memory on both CPUs as far as stacks are concerned
+    address &= 0x1FFFFFFF;
+    if (!profile.RAM || (address & 0x3) || address >= profile.RAM_size)
+        return false;
+    memcpy(&value, profile.RAM + address, sizeof(value));
+    return true;
+}
+
+//A return address points right after the delay slot of a JAL/JALR
+bool Profiler::is_return_address(UnitProfile& profile, uint32_t address)
+{
+    uint32_t call;
+    if (address < 8 || !read_word(profile, address - 8, call))
+        return false;
+    bool is_jal = (call >> 26) == 0x03;
+    bool is_jalr = (call >> 26) == 0 && (call & 0x3F) == 0x09;
+    if (!is_jal && !is_jalr)
+        return false;
+    //Once there are symbols, anything outside of them is most likely stale data
+    return !profile.symbols.size() || profile.symbols.find(address - 8);
+}
+
+uint32_t Profiler::function_of(UnitProfile& profile, uint32_t address)
+{
+    const GuestSymbol* symbol = profile.symbols.find(address);
+    return symbol ? symbol->start : address;
+}
+
+void Profiler::push_frame(UnitProfile& profile, uint32_t address)
+{
+    uint32_t function = function_of(profile, address);
+    if (function != profile.frames.back())
+        profile.frames.push_back(function);
+}
+
+void Profiler::add_sample(UnitProfile& profile)
+{
+    lock_guard<mutex> lock(profile.lock);
+    profile.stacks[profile.frames]++;
+    profile.samples++;
+}
+
+/**
+The innermost frame is the sampled PC. $ra is the caller in leaf functions and in prologues; elsewhere it
+usually points back into the current function and is dropped as a duplicate. Further callers are the
+return addresses saved on the stack. Stale ones can slip in, which is the price of not unwinding properly.
+**/
+void Profiler::sample_mips(PROFILE_UNIT unit, uint32_t PC, uint32_t ra, uint32_t sp)
+{
+    UnitProfile& profile = units[unit];
+    profile.frames.clear();
+    profile.frames.push_back(function_of(profile, PC));
+    if (is_return_address(profile, ra))
+        push_frame(profile, ra - 8);
+
+    for (int i = 0; i < PROFILE_STACK_SCAN_WORDS && profile.frames.size() < PROFILE_MAX_FRAMES; i++)
+    {
+        uint32_t value;
+        if (!read_word(profile, sp + i * 4, value))
+            break;
+        if (is_return_address(profile, value))
+            push_frame(profile, value - 8);
+    }
+    add_sample(profile);
+}
+
+//VU microprograms have no calls worth following; they are grouped under the address they were started at
+void Profiler::sample_vu(PROFILE_UNIT unit, uint32_t PC, uint32_t program_start)
+{
+    UnitProfile& profile = units[unit];
+    profile.frames.clear();
+    profile.frames.push_back(function_of(profile, PC));
+    profile.frames.push_back(program_start | 0x80000000);
+    add_sample(profile);
+}
+
+string Profiler::frame_name(PROFILE_UNIT unit, uint32_t address)
+{
+    char buffer[32];
+    if (unit == PROFILE_VU0 || unit == PROFILE_VU1)
+    {
+        if (address & 0x80000000)
+        {
+            snprintf(buffer, sizeof(buffer), "program_$%04X", address & 0xFFFF);
+            return buffer;
+        }
+    }
+
+    const GuestSymbol* symbol = units[unit].symbols.find(address);
+    if (!symbol)
+    {
+        snprintf(buffer, sizeof(buffer), "$%08X", address);
+        return buffer;
+    }
+
+    //The folded format separates frames with ';' and ends with a space and the count
+    string name = symbol->name;
+    for (char& c : name)
+    {
+        if (c == ';' || c == ' ')
+            c = '_';
+    }
+    return name;
+}
+
+bool Profiler::write_folded(const char* file_name)
+{
+    FILE* file = fopen(file_name, "w");
+    if (!file)
+        return false;
+
+    for (int i = 0; i < PROFILE_UNIT_COUNT; i++)
+    {
+        PROFILE_UNIT unit = (PROFILE_UNIT)i;
+        lock_guard<mutex> lock(units[i].lock);
+        for (auto& stack : units[i].stacks)
+        {
+            //Outermost caller first
+            string line = unit_names[i];
+            for (auto frame = stack.first.rbegin(); frame != stack.first.rend(); ++frame)
+                line += ";" + frame_name(unit, *frame);
+            fprintf(file, "%s %llu\n", line.c_str(), (unsigned long long)stack.second);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+//Per unit, the functions with the most samples in them (self) or under them (total)
+bool Profiler::write_report(const char* file_name, int top)
+{
+    FILE* file = fopen(file_name, "w");
+    if (!file)
+        return false;
+
+    for (int i = 0; i < PROFILE_UNIT_COUNT; i++)
+    {
+        PROFILE_UNIT unit = (PROFILE_UNIT)i;
+        lock_guard<mutex> lock(units[i].lock);
+        if (!units[i].samples)
+            continue;
+
+        map<uint32_t, pair<uint64_t, uint64_t>> functions;
+        for (auto& stack : units[i].stacks)
+        {
+            functions[stack.first[0]].first += stack.second;
+
+            //Recursion shouldn't count a function more than once per sample
+            vector<uint32_t> seen;
+            for (uint32_t frame : stack.first)
+            {
+                if (find(seen.begin(), seen.end(), frame) != seen.end())
+                    continue;
+                seen.push_back(frame);
+                functions[frame].second += stack.second;
+            }
+        }
+
+        vector<pair<uint32_t, pair<uint64_t, uint64_t>>> sorted(functions.begin(), functions.end());
+        sort(sorted.begin(), sorted.end(), [](const pair<uint32_t, pair<uint64_t, uint64_t>>& a,
+                                              const pair<uint32_t, pair<uint64_t, uint64_t>>& b)
+        {
+            if (a.second.first != b.second.first)
+                return a.second.first > b.second.first;
+            return a.second.second > b.second.second;
+        });
+
+        double total = units[i].samples;
+        fprintf(file, "%s: %llu samples every %d cycles, %zu symbols\n", unit_names[i],
+                (unsigned long long)units[i].samples, units[i].interval, units[i].symbols.size());
+        fprintf(file, "%8s %8s  %s\n", "self", "total", "function");
+        for (int j = 0; j < top && j < (int)sorted.size(); j++)
+        {
+            fprintf(file, "%7.2f%% %7.2f%%  %s\n", sorted[j].second.first * 100.0 / total,
+                    sorted[j].second.second * 100.0 / total, frame_name(unit, sorted[j].first).c_str());
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,95 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum PROFILE_UNIT
+{
+    PROFILE_EE,
+    PROFILE_IOP,
+    PROFILE_VU0,
+    PROFILE_VU1,
+    PROFILE_UNIT_COUNT
+};
+
+struct GuestSymbol
+{
+    uint32_t start;
+    uint32_t size;
+    std::string name;
+};
+
+//Function symbols of the code running on one unit, from ELF executables and IRX modules
+class SymbolTable
+{
+    private:
+        std::vector<GuestSymbol> symbols;
+        bool sorted;
+
+        void sort_symbols();
+    public:
+        SymbolTable();
+
+        bool load_elf(const uint8_t* data, uint32_t size, uint32_t base, std::string& error);
+        bool load_file(const char* file_name, uint32_t base, std::string& error);
+        const GuestSymbol* find(uint32_t address);
+        size_t size();
+};
+
+/**
+Sampling profiler for guest code. Every unit calls in once per interval of its own cycles with its current PC.
+For the EE and IOP, callers are recovered with return-address heuristics: $ra, then words on the stack that
+point right after a JAL/JALR. Samples are bucketed by function as they are taken, so memory use only grows
+with the number of distinct call stacks.
+
+The output is one line per call stack in the "folded" format that flamegraph.pl, inferno and speedscope read,
+plus a flat per-function report.
+**/
+class Profiler
+{
+    private:
+        struct UnitProfile
+        {
+            int interval;
+            uint64_t samples;
+            std::map<std::vector<uint32_t>, uint64_t> stacks;
+            std::vector<uint32_t> frames;
+            SymbolTable symbols;
+            const uint8_t* RAM;
+            uint32_t RAM_size;
+            std::mutex lock;
+        };
+
+        UnitProfile units[PROFILE_UNIT_COUNT];
+        bool active;
+
+        bool read_word(UnitProfile& profile, uint32_t address, uint32_t& value);
+        bool is_return_address(UnitProfile& profile, uint32_t address);
+        uint32_t function_of(UnitProfile& profile, uint32_t address);
+        void push_frame(UnitProfile& profile, uint32_t address);
+        void add_sample(UnitProfile& profile);
+        std::string frame_name(PROFILE_UNIT unit, uint32_t address);
+    public:
+        static const int DEFAULT_INTERVAL = 50000;
+
+        Profiler();
+
+        void start(int ee_interval);
+        void stop();
+        bool is_active();
+        int get_interval(PROFILE_UNIT unit);
+
+        void set_RAM(PROFILE_UNIT unit, const uint8_t* RAM, uint32_t size);
+        SymbolTable& get_symbols(PROFILE_UNIT unit);
+
+        void sample_mips(PROFILE_UNIT unit, uint32_t PC, uint32_t ra, uint32_t sp);
+        void sample_vu(PROFILE_UNIT unit, uint32_t PC, uint32_t program_start);
+
+        bool write_folded(const char* file_name);
+        bool write_report(const char* file_name, int top);
+};
+
+#endif // PROFILER_HPP
@@ -0,0 +1,191 @@
+/**
+Single-producer single-consumer FIFO built out of fixed-size segments.
+Elements are pushed into the tail segment; when it fills up, a new segment is linked in,
+taken from a small pool of recycled segments where possible. The consumer hands drained
+segments back to the pool, and anything beyond the pool's limit is freed again, so memory
+grows with bursts and shrinks once the queue is drained.
+
+The queue never holds more than MaxSegments segments. A producer that hits the limit waits
+for the consumer to drain a segment instead of failing.
+**/
+#ifndef SEGMENTEDFIFO_HPP
+#define SEGMENTEDFIFO_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+template<typename Element, size_t SegmentSize, size_t MaxSegments, size_t SpareSegments = 2>
+class SegmentedFifo
+{
+public:
+    SegmentedFifo();
+    ~SegmentedFifo();
+
+    void push(const Element& item);
+    bool pop(Element& item);
+
+    bool was_empty() const;
+    size_t allocated_segments() const;
+
+    //Called by the consumer when it stops consuming, so that a blocked producer doesn't wait forever
+    void close();
+
+private:
+    struct Segment
+    {
+        Element items[SegmentSize];
+        std::atomic<size_t> written;
+        std::atomic<Segment*> next;
+    };
+
+    Segment* new_segment();
+    void release_segment(Segment* segment);
+
+    //Producer side
+    Segment* tail;
+
+    //Consumer side
+    Segment* head;
+    size_t head_index;
+
+    //Shared, only touched once per segment
+    std::mutex pool_mutex;
+    std::condition_variable pool_cv;
+    std::vector<Segment*> pool;
+    std::atomic<size_t> segment_count;
+    bool closed;
+};
+
+template<typename Element, size_t SegmentSize, size_t MaxSegments, size_t SpareSegments>
+SegmentedFifo<Element, SegmentSize, MaxSegments, SpareSegments>::SegmentedFifo() : segment_count(0), closed(false)
+{
+    head = tail = new_segment();
+    head_index = 0;
+}
+
+template<typename Element, size_t SegmentSize, size_t MaxSegments, size_t SpareSegments>
+SegmentedFifo<Element, SegmentSize, MaxSegments, SpareSegments>::~SegmentedFifo()
+{
+    while (head)
+    {
+        Segment* next = head->next.load(std::memory_order_relaxed);
+        delete head;
+        head = next;
+    }
+    for (Segment* segment : pool)
+        delete segment;
+}
+
+template<typename Element, size_t SegmentSize, size_t MaxSegments, size_t SpareSegments>
+typename SegmentedFifo<Element, SegmentSize, MaxSegments, SpareSegments>::Segment*
+SegmentedFifo<Element, SegmentSize, MaxSegments, SpareSegments>::new_segment()
+{
+    Segment* segment;
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    if (pool.empty())
+    {
+        //Backpressure: wait for the consumer to drain a segment
+        pool_cv.wait(lock, [this] { return closed || !pool.empty() || segment_count < MaxSegments; });
+    }
+    if (!pool.empty())
+    {
+        segment = pool.back();
+        pool.pop_back();
+    }
+    else if (closed && segment_count >= MaxSegments)
+        return nullptr;
+    else
+    {
+        segment = new Segment;
+        segment_count++;
+    }
+    lock.unlock();
+
+    segment->written.store(0, std::memory_order_relaxed);
+    segment->next.store(nullptr, std::memory_order_relaxed);
+    return segment;
+}
+
+template<typename Element, size_t SegmentSize, size_t MaxSegments, size_t SpareSegments>
+void SegmentedFifo<Element, SegmentSize, MaxSegments, SpareSegments>::release_segment(Segment* segment)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        if (pool.size() < SpareSegments)
+            pool.push_back(segment);
+        else
+        {
+            delete segment;
+            segment_count--;
+        }
+    }
+    pool_cv.notify_one();
+}
+
+template<typename Element, size_t SegmentSize, size_t MaxSegments, size_t SpareSegments>
+void SegmentedFifo<Element, SegmentSize, MaxSegments, SpareSegments>::push(const Element& item)
+{
+    size_t index = tail->written.load(std::memory_order_relaxed);
+    if (index == SegmentSize)
+    {
+        Segment* segment = new_segment();
+        //The consumer is gone, nobody will read this
+        if (!segment)
+            return;
+        tail->next.store(segment, std::memory_order_release);
+        tail = segment;
+        index = 0;
+    }
+    tail->items[index] = item;
+    tail->written.store(index + 1, std::memory_order_release);
+}
+
+template<typename Element, size_t SegmentSize, size_t MaxSegments, size_t SpareSegments>
+bool SegmentedFifo<Element, SegmentSize, MaxSegments, SpareSegments>::pop(Element& item)
+{
+    if (head_index == SegmentSize)
+    {
+        Segment* next = head->next.load(std::memory_order_acquire);
+        if (!next)
+            return false;
+        release_segment(head);
+        head = next;
+        head_index = 0;
+    }
+    if (head_index == head->written.load(std::memory_order_acquire))
+        return false;
+
+    item = head->items[head_index];
+    head_index++;
+    return true;
+}
+
+// snapshot from the consumer's point of view
+template<typename Element, size_t SegmentSize, size_t MaxSegments, size_t SpareSegments>
+bool SegmentedFifo<Element, SegmentSize, MaxSegments, SpareSegments>::was_empty() const
+{
+    if (head_index == SegmentSize)
+        return head->next.load(std::memory_order_acquire) == nullptr;
+    return head_index == head->written.load(std::memory_order_acquire);
+}
+
+template<typename Element, size_t SegmentSize, size_t MaxSegments, size_t SpareSegments>
+size_t SegmentedFifo<Element, SegmentSize, MaxSegments, SpareSegments>::allocated_segments() const
+{
+    return segment_count.load();
+}
+
+template<typename Element, size_t SegmentSize, size_t MaxSegments, size_t SpareSegments>
+void SegmentedFifo<Element, SegmentSize, MaxSegments, SpareSegments>::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        closed = true;
+    }
+    pool_cv.notify_all();
+}
+
+#endif // SEGMENTEDFIFO_HPP
@@ -1,13 +1,24 @@
+#include <cstdio>
 #include <fstream>
 #include <cstring>
 #include "emulator.hpp"
 
 #define VER_MAJOR 0
 #define VER_MINOR 0
-#define VER_REV 16
+#define VER_REV 17
+
+//RDRAM and SPU RAM are stored last, starting at a multiple of this, so that they can be mapped straight from the file.
+//64 KB covers the page size of every host we run on.
+#define STATE_MEMORY_ALIGN (1024 * 64)
+#define STATE_MEMORY_SIZE (1024 * 1024 * (32 + 2))
 
 using namespace std;
 
+static uint64_t state_memory_offset(uint64_t end_of_registers)
+{
+    return (end_of_registers + STATE_MEMORY_ALIGN - 1) & ~(uint64_t)(STATE_MEMORY_ALIGN - 1);
+}
+
 bool Emulator::request_load_state(const char *file_name)
 {
     ifstream state(file_name, ios::binary);
@@ -21,7 +32,8 @@ bool Emulator::request_load_state(const char *file_name)
 
 bool Emulator::request_save_state(const char *file_name)
 {
-    ofstream state(file_name, ios::binary);
+    //Don't truncate here, the state being replaced may still be mapped into guest memory
+    ofstream state(file_name, ios::binary | ios::app);
     if (!state.is_open())
         return false;
     state.close();
@@ -56,23 +68,35 @@ void Emulator::load_state(const char *file_name)
     state.read((char*)&minor, sizeof(minor));
     state.read((char*)&rev, sizeof(rev));
 
-    if (major != VER_MAJOR || minor != VER_MINOR || rev != VER_REV)
+    if (!state || major != VER_MAJOR || minor != VER_MINOR || rev != VER_REV)
     {
         state.close();
         Errors::non_fatal("Save state doesn't match version");
         return;
     }
 
+    //The memory at the end of the state puts a floor on its size and fixes where it ends, which catches a cut
+    //short state before reset() rather than halfway through applying it
+    uint64_t end_of_header = state.tellg();
+    state.seekg(0, ios::end);
+    uint64_t file_size = state.tellg();
+    state.seekg(end_of_header);
+    if (!state || file_size < state_memory_offset(end_of_header + 1024 * 1024 * 2 + 1024 * 16) + STATE_MEMORY_SIZE ||
+            (file_size - STATE_MEMORY_SIZE) % STATE_MEMORY_ALIGN)
+    {
+        state.close();
+        Errors::non_fatal("Save state is truncated");
+        return;
+    }
+
     reset();
 
     //Emulator info
     state.read((char*)&VBLANK_sent, sizeof(VBLANK_sent));
     state.read((char*)&frames, sizeof(frames));
 
-    //RAM
-    state.read((char*)RDRAM, 1024 * 1024 * 32);
+    //RAM. RDRAM and SPU RAM come after everything else.
     state.read((char*)IOP_RAM, 1024 * 1024 * 2);
-    state.read((char*)SPU_RAM, 1024 * 1024 * 2);
     state.read((char*)scratchpad, 1024 * 16);
 
     //CPUs
@@ -111,15 +135,52 @@ void Emulator::load_state(const char *file_name)
     //Important note - this serialization function is located in gs.cpp as it contains a lot of thread-specific details
     gs.load_state(state);
 
+    //A bad state has been partly applied by now, so failing resets again instead of leaving a mix
+    uint64_t offset = state_memory_offset(state.tellg());
+    if (!state || offset + STATE_MEMORY_SIZE != file_size)
+    {
+        state.close();
+        reset();
+        Errors::non_fatal("Save state is corrupt");
+        return;
+    }
+
+    //Map RDRAM and SPU RAM copy-on-write where possible, so that loading doesn't touch them.
+    //Pages are read in from the file when the guest first uses them.
+    bool lazy = memory.map_file(REGION_RDRAM, file_name, offset);
+    if (!lazy)
+    {
+        state.seekg(offset);
+        state.read((char*)RDRAM, 1024 * 1024 * 32);
+    }
+    offset += 1024 * 1024 * 32;
+    if (!memory.map_file(REGION_SPU_RAM, file_name, offset))
+    {
+        state.seekg(offset);
+        state.read((char*)SPU_RAM, 1024 * 1024 * 2);
+    }
+
+    if (!state)
+    {
+        state.close();
+        reset();
+        Errors::non_fatal("Save state is truncated");
+        return;
+    }
+
     state.close();
-    printf("[Emulator] Success!\n");
+    printf("[Emulator] Success%s!\n", lazy ? " (memory mapped)" : "");
 }
 
 void Emulator::save_state(const char *file_name)
 {
     save_requested = false;
     printf("[Emulator] Saving state...\n");
-    ofstream state(file_name, ios::binary);
+
+    //Write to a new file and swap it in at the end. Overwriting in place would change the memory of a state
+    //that was loaded from the same file, as its pages are still being read in from there.
+    string temp_name = string(file_name) + ".tmp";
+    ofstream state(temp_name, ios::binary);
     if (!state.is_open())
     {
         Errors::non_fatal("Failed to save state");
@@ -140,10 +201,8 @@ void Emulator::save_state(const char *file_name)
     state.write((char*)&VBLANK_sent, sizeof(VBLANK_sent));
     state.write((char*)&frames, sizeof(frames));
 
-    //RAM
-    state.write((char*)RDRAM, 1024 * 1024 * 32);
+    //RAM. RDRAM and SPU RAM come after everything else.
     state.write((char*)IOP_RAM, 1024 * 1024 * 2);
-    state.write((char*)SPU_RAM, 1024 * 1024 * 2);
     state.write((char*)scratchpad, 1024 * 16);
 
     //CPUs
@@ -182,7 +241,29 @@ void Emulator::save_state(const char *file_name)
     //Important note - this serialization function is located in gs.cpp as it contains a lot of thread-specific details
     gs.save_state(state);
 
+    uint64_t end_of_registers = state.tellp();
+    uint64_t offset = state_memory_offset(end_of_registers);
+    static const char padding[STATE_MEMORY_ALIGN] = {0};
+    state.write(padding, offset - end_of_registers);
+    state.write((char*)RDRAM, 1024 * 1024 * 32);
+    state.write((char*)SPU_RAM, 1024 * 1024 * 2);
+
     state.close();
+    if (!state)
+    {
+        remove(temp_name.c_str());
+        Errors::non_fatal("Failed to save state");
+        return;
+    }
+#ifdef _WIN32
+    //rename() won't replace an existing file here
+    remove(file_name);
+#endif
+    if (rename(temp_name.c_str(), file_name))
+    {
+        Errors::non_fatal("Failed to save state");
+        return;
+    }
     printf("Success!\n");
 }
 
@@ -349,6 +430,7 @@ void VectorUnit::load_state(ifstream &state)
         state.read((char*)&instr_mem, 1024 * 16);
         state.read((char*)&data_mem, 1024 * 16);
     }
+    invalidate_predecoded();
 
     state.read((char*)&running, sizeof(running));
     state.read((char*)&PC, sizeof(PC));
@@ -474,6 +556,9 @@ void DMAC::load_state(ifstream &state)
     state.read((char*)&SQWC, sizeof(SQWC));
     state.read((char*)&mfifo_empty_triggered, sizeof(mfifo_empty_triggered));
     state.read((char*)&master_disable, sizeof(master_disable));
+
+    //Stalled channels will simply poll their destination again
+    stalled_channels = 0;
 }
 
 void DMAC::save_state(ofstream &state)
@@ -582,12 +667,9 @@ void SubsystemInterface::save_state(ofstream &state)
 
 void VectorInterface::load_state(ifstream &state)
 {
-    int size;
-    uint32_t FIFO_buffer[64];
-    state.read((char*)&size, sizeof(size));
-    state.read((char*)&FIFO_buffer, sizeof(uint32_t) * size);
-    for (int i = 0; i < size; i++)
-        FIFO.push(FIFO_buffer[i]);
+    state.read((char*)&FIFO_size, sizeof(FIFO_size));
+    state.read((char*)&FIFO, sizeof(uint32_t) * FIFO_size);
+    FIFO_head = 0;
 
     state.read((char*)&imm, sizeof(imm));
     state.read((char*)&command, sizeof(command));
@@ -626,17 +708,11 @@ void VectorInterface::load_state(ifstream &state)
 
 void VectorInterface::save_state(ofstream &state)
 {
-    int size = FIFO.size();
     uint32_t FIFO_buffer[64];
-    for (int i = 0; i < size; i++)
-    {
-        FIFO_buffer[i] = FIFO.front();
-        FIFO.pop();
-    }
-    state.write((char*)&size, sizeof(size));
-    state.write((char*)&FIFO_buffer, sizeof(uint32_t) * size);
-    for (int i = 0; i < size; i++)
-        FIFO.push(FIFO_buffer[i]);
+    for (int i = 0; i < FIFO_size; i++)
+        FIFO_buffer[i] = peek_FIFO(i);
+    state.write((char*)&FIFO_size, sizeof(FIFO_size));
+    state.write((char*)&FIFO_buffer, sizeof(uint32_t) * FIFO_size);
 
     state.write((char*)&imm, sizeof(imm));
     state.write((char*)&command, sizeof(command));
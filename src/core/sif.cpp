@@ -1,11 +1,12 @@
 #include <cstdio>
 #include "sif.hpp"
+#include "ee/dmac.hpp"
 
 /**
  * TODO: What are the sizes of the SIF0/SIF1 DMAC FIFOs?
  */
 
-SubsystemInterface::SubsystemInterface()
+SubsystemInterface::SubsystemInterface(DMAC* dmac) : dmac(dmac)
 {
 
 }
@@ -25,6 +26,8 @@ void SubsystemInterface::reset()
 void SubsystemInterface::write_SIF0(uint32_t word)
 {
     SIF0_FIFO.push(word);
+    if (SIF0_FIFO.size() >= 2)
+        dmac->wake_channel(DMAC::SIF0);
 }
 
 void SubsystemInterface::write_SIF1(uint128_t quad)
@@ -46,6 +49,8 @@ uint32_t SubsystemInterface::read_SIF1()
 {
     uint32_t value = SIF1_FIFO.front();
     SIF1_FIFO.pop();
+    if (SIF1_FIFO.size() <= MAX_FIFO_SIZE - 4)
+        dmac->wake_channel(DMAC::SIF1);
     return value;
 }
 
@@ -6,6 +6,8 @@
 
 #include "int128.hpp"
 
+class DMAC;
+
 class SubsystemInterface
 {
     private:
@@ -15,11 +17,13 @@ class SubsystemInterface
         uint32_t smflag;
         uint32_t control; //???
 
+        DMAC* dmac;
+
         std::queue<uint32_t> SIF0_FIFO;
         std::queue<uint32_t> SIF1_FIFO;
     public:
         constexpr static int MAX_FIFO_SIZE = 32;
-        SubsystemInterface();
+        SubsystemInterface(DMAC* dmac);
 
         void reset();
         int get_SIF0_size();
@@ -0,0 +1,200 @@
+#include <cstring>
+#include "statehash.hpp"
+#include "errors.hpp"
+#include "int128.hpp"
+
+#define PRIME32_1 0x9E3779B1ULL
+#define PRIME32_2 0x85EBCA77ULL
+#define PRIME32_3 0xC2B2AE3DULL
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define STRIPE_SIZE 64
+#define SECRET_SIZE 192
+//Each stripe of a block uses the key 8 bytes further into the secret
+#define STRIPES_PER_BLOCK ((SECRET_SIZE - STRIPE_SIZE) / 8)
+#define BLOCK_SIZE (STRIPE_SIZE * STRIPES_PER_BLOCK)
+
+using namespace std;
+
+namespace StateHash
+{
+
+struct Secret
+{
+    alignas(16) uint8_t bytes[SECRET_SIZE];
+
+    Secret()
+    {
+        //splitmix64, so that the key has no structure of its own
+        uint64_t state = PRIME64_3;
+        for (int i = 0; i < SECRET_SIZE; i += 8)
+        {
+            state += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            z ^= z >> 31;
+            memcpy(&bytes[i], &z, 8);
+        }
+    }
+};
+
+static const Secret secret;
+
+static inline uint64_t read64(const uint8_t* ptr)
+{
+    uint64_t value;
+    memcpy(&value, ptr, 8);
+    return value;
+}
+
+#ifdef INT128_SSE2
+static inline void accumulate_stripe(uint64_t* acc, const uint8_t* data, const uint8_t* key)
+{
+    __m128i* lanes = (__m128i*)acc;
+    for (int i = 0; i < 4; i++)
+    {
+        __m128i value = _mm_loadu_si128((const __m128i*)data + i);
+        __m128i mixed = _mm_xor_si128(value, _mm_loadu_si128((const __m128i*)key + i));
+        __m128i product = _mm_mul_epu32(mixed, _mm_shuffle_epi32(mixed, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+        lanes[i] = _mm_add_epi64(product, _mm_add_epi64(lanes[i], swapped));
+    }
+}
+
+static inline void scramble(uint64_t* acc, const uint8_t* key)
+{
+    __m128i* lanes = (__m128i*)acc;
+    const __m128i prime = _mm_set1_epi32((int)PRIME32_1);
+    for (int i = 0; i < 4; i++)
+    {
+        __m128i lane = _mm_xor_si128(lanes[i], _mm_srli_epi64(lanes[i], 47));
+        lane = _mm_xor_si128(lane, _mm_loadu_si128((const __m128i*)key + i));
+        //64x32 multiply out of two 32x32 ones
+        __m128i lo = _mm_mul_epu32(lane, prime);
+        __m128i hi = _mm_mul_epu32(_mm_shuffle_epi32(lane, _MM_SHUFFLE(2, 3, 0, 1)), prime);
+        lanes[i] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+    }
+}
+#else
+static inline void accumulate_stripe(uint64_t* acc, const uint8_t* data, const uint8_t* key)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        uint64_t value = read64(data + i * 8);
+        uint64_t mixed = value ^ read64(key + i * 8);
+        acc[i ^ 1] += value;
+        acc[i] += (mixed & 0xFFFFFFFF) * (mixed >> 32);
+    }
+}
+
+static inline void scramble(uint64_t* acc, const uint8_t* key)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        uint64_t lane = acc[i] ^ (acc[i] >> 47) ^ read64(key + i * 8);
+        acc[i] = lane * PRIME32_1;
+    }
+}
+#endif
+
+static inline uint64_t avalanche(uint64_t value)
+{
+    value ^= value >> 37;
+    value *= 0x165667919E3779F9ULL;
+    value ^= value >> 32;
+    return value;
+}
+
+uint64_t hash_bytes(const void* data, size_t size)
+{
+    alignas(16) uint64_t acc[8] = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+    const uint8_t* input = (const uint8_t*)data;
+    const uint8_t* key = secret.bytes;
+
+    size_t full_blocks = size / BLOCK_SIZE;
+    for (size_t block = 0; block < full_blocks; block++)
+    {
+        for (int stripe = 0; stripe < STRIPES_PER_BLOCK; stripe++)
+            accumulate_stripe(acc, input + stripe * STRIPE_SIZE, key + stripe * 8);
+        scramble(acc, key + SECRET_SIZE - STRIPE_SIZE);
+        input += BLOCK_SIZE;
+    }
+
+    size_t left = size - full_blocks * BLOCK_SIZE;
+    int stripe = 0;
+    for (; left >= STRIPE_SIZE; stripe++, left -= STRIPE_SIZE, input += STRIPE_SIZE)
+        accumulate_stripe(acc, input, key + stripe * 8);
+    if (left)
+    {
+        //Zero padded. The length goes into the result, so this can't collide with data that has the zeros.
+        alignas(16) uint8_t tail[STRIPE_SIZE] = {};
+        memcpy(tail, input, left);
+        accumulate_stripe(acc, tail, key + stripe * 8);
+    }
+
+    uint64_t result = size * PRIME64_1;
+    for (int i = 0; i < 8; i++)
+        result = avalanche(result ^ (acc[i] + read64(key + 11 + i * 8))) * PRIME64_2;
+    return avalanche(result);
+}
+
+const char* component_name(HASH_COMPONENT component)
+{
+    static const char* names[] =
+    {
+        "rdram", "iop_ram", "spu_ram", "scratchpad", "vu_mem", "registers", "gs_vram"
+    };
+    return names[component];
+}
+
+};
+
+PageHasher::PageHasher(size_t size, size_t page_size)
+{
+    if ((size & (size - 1)) || (page_size & (page_size - 1)) || page_size > size)
+        Errors::die("[StateHash] Bad page hasher geometry: $%zX in pages of $%zX", size, page_size);
+    offset_mask = size - 1;
+    page_shift = 0;
+    while (((size_t)1 << page_shift) < page_size)
+        page_shift++;
+    page_hashes.resize(size / page_size);
+    dirty.resize(size / page_size);
+    mark_all_dirty();
+}
+
+void PageHasher::mark_dirty(size_t offset, size_t bytes)
+{
+    if (!bytes)
+        return;
+    size_t first = (offset & offset_mask) >> page_shift;
+    size_t last = ((offset + bytes - 1) & offset_mask) >> page_shift;
+    for (size_t page = first; ; page = (page + 1) % dirty.size())
+    {
+        dirty[page] = 1;
+        if (page == last)
+            break;
+    }
+}
+
+void PageHasher::mark_all_dirty()
+{
+    memset(dirty.data(), 1, dirty.size());
+}
+
+uint64_t PageHasher::update(const uint8_t* mem)
+{
+    size_t page_size = (size_t)1 << page_shift;
+    for (size_t page = 0; page < dirty.size(); page++)
+    {
+        if (!dirty[page])
+            continue;
+        page_hashes[page] = StateHash::hash_bytes(mem + page * page_size, page_size);
+        dirty[page] = 0;
+    }
+    return StateHash::hash_bytes(page_hashes.data(), page_hashes.size() * sizeof(uint64_t));
+}
@@ -0,0 +1,60 @@
+#ifndef STATEHASH_HPP
+#define STATEHASH_HPP
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Parts of the machine hashed separately by Emulator::hash_state
+enum HASH_COMPONENT
+{
+    HASH_RDRAM,
+    HASH_IOP_RAM,
+    HASH_SPU_RAM,
+    HASH_SCRATCHPAD,
+    HASH_VU_MEM,
+    HASH_REGISTERS,
+    HASH_GS_VRAM,
+    HASH_COMPONENT_COUNT
+};
+
+/**
+64-bit hash built on the XXH3 long-input loop: eight 64-bit lanes each take a 32x32->64 multiply of the data
+mixed with a key, plus the data of the neighbouring lane, 64 bytes at a time, and are scrambled once per KB.
+Uses SSE2 where available and an equivalent scalar loop elsewhere; both give the same result.
+
+This is a checksum for catching divergence, not a stable format. Values are only comparable between builds
+of the same version.
+**/
+namespace StateHash
+{
+    uint64_t hash_bytes(const void* data, size_t size);
+    const char* component_name(HASH_COMPONENT component);
+};
+
+/**
+Hash of one memory area that is kept up to date incrementally. The area is split into pages with a hash and a
+dirty flag each. Writers flag the pages they touch, and update() rehashes only those before hashing the page
+hashes together, so an area that barely changes costs little more than a walk over its flags.
+The area and page sizes must be powers of two; offsets wrap around the area like the hardware mirrors do.
+**/
+class PageHasher
+{
+    private:
+        size_t offset_mask, page_shift;
+        std::vector<uint64_t> page_hashes;
+        std::vector<uint8_t> dirty;
+    public:
+        PageHasher(size_t size, size_t page_size);
+
+        void mark_dirty(size_t offset);
+        void mark_dirty(size_t offset, size_t bytes);
+        void mark_all_dirty();
+        uint64_t update(const uint8_t* mem);
+};
+
+inline void PageHasher::mark_dirty(size_t offset)
+{
+    dirty[(offset & offset_mask) >> page_shift] = 1;
+}
+
+#endif // STATEHASH_HPP
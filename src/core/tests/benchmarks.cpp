@@ -0,0 +1,220 @@
+#include <chrono>
+#include "cputests.hpp"
+#include "../emulator.hpp"
+#include "../ee/emotioninterpreter.hpp"
+#include "../ee/vu_interpreter.hpp"
+#include "../iop/iop_interpreter.hpp"
+
+using namespace std;
+using namespace CPUTests;
+
+#define UPPER_NOP 0x000002FF
+#define LOWER_NOP 0x8000033C
+
+//Times a single instruction executed back to back. Operands are set once up front, so instructions that
+//feed back into their own sources (such as ADD.S) settle on a stable value instead of overflowing.
+template <typename Func>
+static void benchmark(TestResults& results, const char* name, uint64_t iterations, Func run)
+{
+    //Warm up caches and branch predictors
+    for (uint64_t i = 0; i < iterations / 16; i++)
+        run();
+
+    auto start = chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; i++)
+        run();
+    auto end = chrono::steady_clock::now();
+
+    double ns = chrono::duration_cast<chrono::duration<double, nano>>(end - start).count();
+    results.add_benchmark(name, iterations, ns / iterations);
+}
+
+void CPUTests::benchmark_ee(Emulator& e, TestResults& results, uint64_t iterations)
+{
+    EmotionEngine& cpu = e.get_ee();
+    results.begin_suite("ee");
+
+    cpu.set_gpr<uint64_t>(9, 0x12345678);
+    cpu.set_gpr<uint64_t>(10, 0x1234);
+    const struct
+    {
+        const char* name;
+        uint32_t instr;
+    } ops[] =
+    {
+        {"addu", r_type(0x21, 8, 10, 9)},
+        {"daddu", r_type(0x2D, 8, 10, 9)},
+        {"sll", r_type(0x00, 8, 0, 9, 3)},
+        {"dsra32", r_type(0x3F, 8, 0, 9, 1)},
+        {"slt", r_type(0x2A, 8, 10, 9)},
+        {"addiu", i_type(0x09, 8, 10, 0x10)},
+        {"lui", i_type(0x0F, 8, 0, 0x8000)},
+        {"mult", r_type(0x18, 8, 10, 9)},
+        {"div", r_type(0x1A, 0, 9, 10)},
+        {"paddw", mmi_type(0x08, 0x00, 8, 10, 9)},
+        {"pextlw", mmi_type(0x08, 0x12, 8, 10, 9)},
+        {"paddsw", mmi_type(0x08, 0x10, 8, 10, 9)},
+        {"por", mmi_type(0x29, 0x12, 8, 10, 9)},
+        {"pcpyld", mmi_type(0x09, 0x0E, 8, 10, 9)}
+    };
+    for (auto& op : ops)
+        benchmark(results, op.name, iterations, [&] { EmotionInterpreter::interpret(cpu, op.instr); });
+
+    //f1 = 1.5, f2 = 2.25
+    cpu.set_gpr<uint64_t>(8, 0x3FC00000);
+    EmotionInterpreter::interpret(cpu, (0x11 << 26) | (0x04 << 21) | (8 << 16) | (1 << 11));
+    cpu.set_gpr<uint64_t>(8, 0x40100000);
+    EmotionInterpreter::interpret(cpu, (0x11 << 26) | (0x04 << 21) | (8 << 16) | (2 << 11));
+    results.begin_suite("fpu");
+    const struct
+    {
+        const char* name;
+        uint8_t funct;
+    } fpu_ops[] =
+    {
+        {"add.s", 0x00},
+        {"mul.s", 0x02},
+        {"div.s", 0x03},
+        {"sqrt.s", 0x04},
+        {"madd.s", 0x1C},
+        {"c.lt.s", 0x34}
+    };
+    for (auto& op : fpu_ops)
+    {
+        uint32_t instr = (0x11 << 26) | (0x10 << 21) | (2 << 16) | (1 << 11) | (3 << 6) | op.funct;
+        benchmark(results, op.name, iterations, [&] { EmotionInterpreter::interpret(cpu, instr); });
+    }
+
+    results.begin_suite("cop2");
+    const struct
+    {
+        const char* name;
+        uint8_t op;
+    } cop2_ops[] =
+    {
+        {"vadd", 0x28},
+        {"vmul", 0x2A},
+        {"vmadd", 0x29},
+        {"vmulx", 0x18}
+    };
+    for (auto& op : cop2_ops)
+    {
+        uint32_t instr = (0x12 << 26) | (1 << 25) | (0xF << 21) | (2 << 16) | (1 << 11) | (3 << 6) | op.op;
+        benchmark(results, op.name, iterations, [&] { EmotionInterpreter::interpret(cpu, instr); });
+    }
+}
+
+void CPUTests::benchmark_iop(Emulator& e, TestResults& results, uint64_t iterations)
+{
+    IOP& iop = e.get_iop();
+    results.begin_suite("iop");
+
+    iop.set_gpr(9, 0x12345678);
+    iop.set_gpr(10, 0x1234);
+    const struct
+    {
+        const char* name;
+        uint32_t instr;
+    } ops[] =
+    {
+        {"addu", r_type(0x21, 8, 10, 9)},
+        {"sll", r_type(0x00, 8, 0, 9, 3)},
+        {"slt", r_type(0x2A, 8, 10, 9)},
+        {"addiu", i_type(0x09, 8, 10, 0x10)},
+        {"lui", i_type(0x0F, 8, 0, 0x8000)},
+        {"mult", r_type(0x18, 0, 10, 9)},
+        {"div", r_type(0x1A, 0, 9, 10)}
+    };
+    for (auto& op : ops)
+        benchmark(results, op.name, iterations, [&] { IOP_Interpreter::interpret(iop, op.instr); });
+}
+
+void CPUTests::benchmark_vu(Emulator& e, TestResults& results, uint64_t iterations)
+{
+    uint32_t FBRST = 0;
+    VectorUnit vu(1, &e, &FBRST);
+    vu.reset();
+    results.begin_suite("vu");
+
+    for (int i = 0; i < 4; i++)
+    {
+        vu.set_gpr_f(1, i, 1.5f);
+        vu.set_gpr_f(2, i, 0.5f);
+    }
+    vu.set_int(1, 3);
+    vu.set_int(2, 5);
+    const struct
+    {
+        const char* name;
+        uint32_t upper, lower;
+    } ops[] =
+    {
+        {"nop", UPPER_NOP, LOWER_NOP},
+        {"add", (0xF << 21) | (2 << 16) | (1 << 11) | (3 << 6) | 0x28, LOWER_NOP},
+        {"mul", (0xF << 21) | (2 << 16) | (1 << 11) | (3 << 6) | 0x2A, LOWER_NOP},
+        {"madd", (0xF << 21) | (2 << 16) | (1 << 11) | (3 << 6) | 0x29, LOWER_NOP},
+        {"mulx", (0xF << 21) | (2 << 16) | (1 << 11) | (3 << 6) | 0x18, LOWER_NOP},
+        {"ftoi0", (0xF << 21) | (3 << 16) | (1 << 11) | (5 << 6) | 0x3C, LOWER_NOP},
+        {"iadd", UPPER_NOP, 0x80000000 | (2 << 16) | (1 << 11) | (3 << 6) | 0x30},
+        {"add+iadd", (0xF << 21) | (2 << 16) | (1 << 11) | (3 << 6) | 0x28,
+                     0x80000000 | (2 << 16) | (1 << 11) | (3 << 6) | 0x30}
+    };
+    for (auto& op : ops)
+        benchmark(results, op.name, iterations, [&] { VU_Interpreter::interpret(vu, op.upper, op.lower); });
+
+    //The same pairs once they are in the predecoded cache, as VectorUnit::run sees them
+    for (auto& op : ops)
+    {
+        VU_Predecoded pair;
+        VU_Interpreter::predecode(vu, op.upper, op.lower, pair);
+        benchmark(results, (string(op.name) + "/cached").c_str(), iterations,
+                  [&] { VU_Interpreter::execute(vu, pair, op.upper, op.lower); });
+    }
+}
+
+//Whole DMA packets through VIF1 into VU1 memory, one packet per iteration
+void CPUTests::benchmark_vif(Emulator& e, TestResults& results, uint64_t iterations)
+{
+    VectorInterface& vif = e.get_vif1();
+    vif.reset();
+    results.begin_suite("vif");
+
+    const struct
+    {
+        const char* name;
+        uint32_t code;
+    } packets[] =
+    {
+        {"unpack_v4_32", 0x6C0F0000},
+        {"unpack_v4_16", 0x6D0F0000},
+        {"mpg", 0x4A0F0000}
+    };
+    for (auto& packet : packets)
+    {
+        //STCYCL 1/1 and the command, then data up to a full FIFO of 16 quadwords
+        uint128_t quads[16];
+        for (int i = 0; i < 16; i++)
+        {
+            for (int j = 0; j < 4; j++)
+                quads[i]._u32[j] = (i << 4) | j;
+        }
+        quads[0]._u32[0] = 0x01000101;
+        quads[0]._u32[1] = packet.code;
+        for (int i = 2; i < 4; i++)
+            quads[15]._u32[i] = 0;
+        if ((packet.code >> 24) == 0x6D)
+        {
+            for (int i = 0; i < 4; i++)
+                quads[8]._u32[i] = 0;
+            for (int i = 9; i < 16; i++)
+                quads[i] = quads[8];
+        }
+
+        benchmark(results, packet.name, iterations / 16, [&]
+        {
+            for (int i = 0; i < 16; i++)
+                vif.feed_DMA(quads[i]);
+            vif.update(16);
+        });
+    }
+}
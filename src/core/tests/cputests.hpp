@@ -0,0 +1,46 @@
+#ifndef CPUTESTS_HPP
+#define CPUTESTS_HPP
+#include <cstdint>
+
+#include "testresults.hpp"
+
+class Emulator;
+
+/**
+Instruction-level tests and benchmarks for the EE, IOP and VU execution engines, plus the VIF feeding VU1.
+Each instruction is run in isolation through the same entry point the CPU uses for decoded instructions,
+so results and timings reflect the engine, not the rest of the emulator.
+**/
+namespace CPUTests
+{
+    void test_ee_alu(Emulator& e, TestResults& results);
+    void test_ee_mmi(Emulator& e, TestResults& results);
+    void test_ee_fpu(Emulator& e, TestResults& results);
+    void test_ee_cop2(Emulator& e, TestResults& results);
+    void test_iop_alu(Emulator& e, TestResults& results);
+    void test_vu(Emulator& e, TestResults& results);
+    void test_vif(Emulator& e, TestResults& results);
+
+    void benchmark_ee(Emulator& e, TestResults& results, uint64_t iterations);
+    void benchmark_iop(Emulator& e, TestResults& results, uint64_t iterations);
+    void benchmark_vu(Emulator& e, TestResults& results, uint64_t iterations);
+    void benchmark_vif(Emulator& e, TestResults& results, uint64_t iterations);
+
+    //MIPS encodings shared by the EE and IOP tests
+    inline uint32_t r_type(uint8_t funct, int rd, int rs, int rt, int sa = 0)
+    {
+        return (rs << 21) | (rt << 16) | (rd << 11) | (sa << 6) | funct;
+    }
+
+    inline uint32_t i_type(uint8_t op, int rt, int rs, uint16_t imm)
+    {
+        return (op << 26) | (rs << 21) | (rt << 16) | imm;
+    }
+
+    inline uint32_t mmi_type(uint8_t group, uint8_t op, int rd, int rs, int rt)
+    {
+        return (0x1C << 26) | (rs << 21) | (rt << 16) | (rd << 11) | (op << 6) | group;
+    }
+};
+
+#endif // CPUTESTS_HPP
@@ -0,0 +1,171 @@
+#include "../cputests.hpp"
+#include "../../emulator.hpp"
+#include "../../ee/emotioninterpreter.hpp"
+
+using namespace std;
+using namespace CPUTests;
+
+#define RD 8
+#define RT 9
+#define RS 10
+
+static void set_u64(EmotionEngine& cpu, int reg, uint64_t value)
+{
+    cpu.set_gpr<uint64_t>(reg, value);
+    cpu.set_gpr<uint64_t>(reg, 0, 1);
+}
+
+static void set_u128(EmotionEngine& cpu, int reg, uint64_t lo, uint64_t hi)
+{
+    cpu.set_gpr<uint64_t>(reg, lo);
+    cpu.set_gpr<uint64_t>(reg, hi, 1);
+}
+
+static uint128_t get_u128(EmotionEngine& cpu, int reg)
+{
+    uint128_t value;
+    value.lo = cpu.get_gpr<uint64_t>(reg);
+    value.hi = cpu.get_gpr<uint64_t>(reg, 1);
+    return value;
+}
+
+//Runs an instruction with rs and rt set, and checks the low doubleword of rd
+static void check_rrr(TestResults& results, EmotionEngine& cpu, const char* name, uint32_t instr,
+                      uint64_t s, uint64_t t, uint64_t expected)
+{
+    set_u64(cpu, RD, 0x1337);
+    set_u64(cpu, RS, s);
+    set_u64(cpu, RT, t);
+    EmotionInterpreter::interpret(cpu, instr);
+    results.check(name, cpu.get_gpr<uint64_t>(RD), expected);
+}
+
+//Same for immediate instructions, which write rt
+static void check_rri(TestResults& results, EmotionEngine& cpu, const char* name, uint8_t op,
+                      uint64_t s, uint16_t imm, uint64_t expected)
+{
+    set_u64(cpu, RT, 0x1337);
+    set_u64(cpu, RS, s);
+    EmotionInterpreter::interpret(cpu, i_type(op, RT, RS, imm));
+    results.check(name, cpu.get_gpr<uint64_t>(RT), expected);
+}
+
+static void check_mmi(TestResults& results, EmotionEngine& cpu, const char* name, uint8_t group, uint8_t op,
+                      uint64_t s_lo, uint64_t s_hi, uint64_t t_lo, uint64_t t_hi,
+                      uint64_t expected_lo, uint64_t expected_hi)
+{
+    set_u128(cpu, RD, 0x1337, 0x1337);
+    set_u128(cpu, RS, s_lo, s_hi);
+    set_u128(cpu, RT, t_lo, t_hi);
+    EmotionInterpreter::interpret(cpu, mmi_type(group, op, RD, RS, RT));
+    results.check(name, get_u128(cpu, RD), expected_lo, expected_hi);
+}
+
+void CPUTests::test_ee_alu(Emulator& e, TestResults& results)
+{
+    EmotionEngine& cpu = e.get_ee();
+    results.begin_suite("ee");
+
+    //32-bit results are sign-extended to 64 bits
+    check_rrr(results, cpu, "addu", r_type(0x21, RD, RS, RT), 0x7FFFFFFF, 1, 0xFFFFFFFF80000000);
+    check_rrr(results, cpu, "subu", r_type(0x23, RD, RS, RT), 0, 1, 0xFFFFFFFFFFFFFFFF);
+    check_rrr(results, cpu, "daddu", r_type(0x2D, RD, RS, RT), 0x7FFFFFFFFFFFFFFF, 1, 0x8000000000000000);
+    check_rrr(results, cpu, "dsubu", r_type(0x2F, RD, RS, RT), 0, 1, 0xFFFFFFFFFFFFFFFF);
+    check_rrr(results, cpu, "and", r_type(0x24, RD, RS, RT), 0xFF00FF00FF00FF00, 0x0F0F0F0F0F0F0F0F, 0x0F000F000F000F00);
+    check_rrr(results, cpu, "or", r_type(0x25, RD, RS, RT), 0xFF00FF00FF00FF00, 0x0F0F0F0F0F0F0F0F, 0xFF0FFF0FFF0FFF0F);
+    check_rrr(results, cpu, "xor", r_type(0x26, RD, RS, RT), 0xFF00FF00FF00FF00, 0x0F0F0F0F0F0F0F0F, 0xF00FF00FF00FF00F);
+    check_rrr(results, cpu, "nor", r_type(0x27, RD, RS, RT), 0xFF00FF00FF00FF00, 0x0F0F0F0F0F0F0F0F, 0x00F000F000F000F0);
+    check_rrr(results, cpu, "slt", r_type(0x2A, RD, RS, RT), 0xFFFFFFFFFFFFFFFF, 1, 1);
+    check_rrr(results, cpu, "sltu", r_type(0x2B, RD, RS, RT), 0xFFFFFFFFFFFFFFFF, 1, 0);
+    check_rrr(results, cpu, "movz", r_type(0x0A, RD, RS, RT), 0xABCD, 0, 0xABCD);
+    check_rrr(results, cpu, "movn", r_type(0x0B, RD, RS, RT), 0xABCD, 0, 0x1337);
+
+    check_rrr(results, cpu, "sll", r_type(0x00, RD, 0, RT, 1), 0, 0x40000001, 0xFFFFFFFF80000002);
+    check_rrr(results, cpu, "srl", r_type(0x02, RD, 0, RT, 4), 0, 0xFFFFFFFF80000000, 0x08000000);
+    check_rrr(results, cpu, "sra", r_type(0x03, RD, 0, RT, 4), 0, 0xFFFFFFFF80000000, 0xFFFFFFFFF8000000);
+    check_rrr(results, cpu, "sllv", r_type(0x04, RD, RS, RT), 33, 1, 2);
+    check_rrr(results, cpu, "dsll32", r_type(0x3C, RD, 0, RT, 0), 0, 1, 0x100000000);
+    check_rrr(results, cpu, "dsrl", r_type(0x3A, RD, 0, RT, 4), 0, 0x8000000000000000, 0x0800000000000000);
+    check_rrr(results, cpu, "dsra32", r_type(0x3F, RD, 0, RT, 0), 0, 0x8000000000000000, 0xFFFFFFFF80000000);
+
+    check_rri(results, cpu, "addiu", 0x09, 0xFFFFFFFFFFFFFFFF, 1, 0);
+    check_rri(results, cpu, "addiu_neg", 0x09, 0, 0x8000, 0xFFFFFFFFFFFF8000);
+    check_rri(results, cpu, "daddiu", 0x19, 0xFFFFFFFF, 1, 0x100000000);
+    check_rri(results, cpu, "slti", 0x0A, (uint64_t)-5, 0xFFFC, 1);
+    check_rri(results, cpu, "sltiu", 0x0B, 5, 0xFFFF, 1);
+    check_rri(results, cpu, "andi", 0x0C, 0xFFFFFFFFFFFFFFFF, 0x8001, 0x8001);
+    check_rri(results, cpu, "ori", 0x0D, 0x12340000, 0xFFFF, 0x1234FFFF);
+    check_rri(results, cpu, "xori", 0x0E, 0xFFFF, 0x00FF, 0xFF00);
+    check_rri(results, cpu, "lui", 0x0F, 0, 0x8000, 0xFFFFFFFF80000000);
+
+    //MULT and DIV also write LO/HI, and on the EE MULT copies LO into rd
+    check_rrr(results, cpu, "mult", r_type(0x18, RD, RS, RT), (uint64_t)-2, 3, 0xFFFFFFFFFFFFFFFA);
+    results.check("mult_hi", cpu.get_HI(), 0xFFFFFFFFFFFFFFFF);
+    check_rrr(results, cpu, "multu", r_type(0x19, RD, RS, RT), 0xFFFFFFFF, 2, 0xFFFFFFFFFFFFFFFE);
+    results.check("multu_hi", cpu.get_HI(), 1);
+    set_u64(cpu, RS, 7);
+    set_u64(cpu, RT, (uint64_t)-2);
+    EmotionInterpreter::interpret(cpu, r_type(0x1A, 0, RS, RT));
+    results.check("div_lo", cpu.get_LO(), 0xFFFFFFFFFFFFFFFD);
+    results.check("div_hi", cpu.get_HI(), 1);
+    set_u64(cpu, RT, 2);
+    EmotionInterpreter::interpret(cpu, r_type(0x1B, 0, RS, RT));
+    results.check("divu_lo", cpu.get_LO(), 3);
+    results.check("divu_hi", cpu.get_HI(), 1);
+}
+
+void CPUTests::test_ee_mmi(Emulator& e, TestResults& results)
+{
+    EmotionEngine& cpu = e.get_ee();
+    results.begin_suite("mmi");
+
+    //MMI0
+    check_mmi(results, cpu, "paddw", 0x08, 0x00, 0x0000000200000001, 0xFFFFFFFF00000003,
+              0x0000000100000001, 0x0000000100000001, 0x0000000300000002, 0x0000000000000004);
+    check_mmi(results, cpu, "psubw", 0x08, 0x01, 0x0000000200000001, 0x0000000000000003,
+              0x0000000100000001, 0x0000000100000001, 0x0000000100000000, 0xFFFFFFFF00000002);
+    check_mmi(results, cpu, "pcgtw", 0x08, 0x02, 0xFFFFFFFF00000005, 0x0000000700000000,
+              0x0000000000000003, 0x0000000800000000, 0x00000000FFFFFFFF, 0);
+    check_mmi(results, cpu, "pmaxw", 0x08, 0x03, 0xFFFFFFFF00000005, 0x0000000700000000,
+              0x0000000000000003, 0x0000000800000000, 0x0000000000000005, 0x0000000800000000);
+    check_mmi(results, cpu, "paddh", 0x08, 0x04, 0x7FFF000100020003, 0,
+              0x0001000100010001, 0, 0x8000000200030004, 0);
+    check_mmi(results, cpu, "paddsw", 0x08, 0x10, 0x800000007FFFFFFF, 0x0000000200000001,
+              0xFFFFFFFF00000001, 0x0000000200000001, 0x800000007FFFFFFF, 0x0000000400000002);
+    check_mmi(results, cpu, "pextlw", 0x08, 0x12, 0x2222222211111111, 0,
+              0x4444444433333333, 0, 0x1111111133333333, 0x2222222244444444);
+
+    //MMI1
+    check_mmi(results, cpu, "pabsw", 0x28, 0x01, 0, 0,
+              0x80000000FFFFFFFB, 0x0000000000000007, 0x7FFFFFFF00000005, 0x0000000000000007);
+    check_mmi(results, cpu, "pceqw", 0x28, 0x02, 0x0000000200000001, 0x0000000400000003,
+              0x0000000000000001, 0x0000000000000003, 0x00000000FFFFFFFF, 0x00000000FFFFFFFF);
+
+    //MMI2 and MMI3
+    const uint64_t S_LO = 0xFF00FF00FF00FF00, S_HI = 0x0123456789ABCDEF;
+    const uint64_t T_LO = 0x0F0F0F0F0F0F0F0F, T_HI = 0xFFFFFFFF00000000;
+    check_mmi(results, cpu, "pand", 0x09, 0x12, S_LO, S_HI, T_LO, T_HI, 0x0F000F000F000F00, 0x0123456700000000);
+    check_mmi(results, cpu, "pxor", 0x09, 0x13, S_LO, S_HI, T_LO, T_HI, 0xF00FF00FF00FF00F, 0xFEDCBA9889ABCDEF);
+    check_mmi(results, cpu, "pcpyld", 0x09, 0x0E, S_LO, S_HI, T_LO, T_HI, T_LO, S_LO);
+    check_mmi(results, cpu, "por", 0x29, 0x12, S_LO, S_HI, T_LO, T_HI, 0xFF0FFF0FFF0FFF0F, 0xFFFFFFFF89ABCDEF);
+    check_mmi(results, cpu, "pnor", 0x29, 0x13, S_LO, S_HI, T_LO, T_HI, 0x00F000F000F000F0, 0x0000000076543210);
+    check_mmi(results, cpu, "pcpyud", 0x29, 0x0E, S_LO, S_HI, T_LO, T_HI, S_HI, T_HI);
+
+    //Lane-wise compares, packs and shifts
+    check_mmi(results, cpu, "pcgth", 0x08, 0x06, S_LO, S_HI, T_LO, T_HI, 0, 0xFFFFFFFF00000000);
+    check_mmi(results, cpu, "pcgtb", 0x08, 0x0A, S_LO, S_HI, T_LO, T_HI, 0, 0xFFFFFFFF00000000);
+    check_mmi(results, cpu, "pceqh", 0x28, 0x06, S_LO, S_HI, S_LO ^ 1, S_HI, 0xFFFFFFFFFFFF0000, 0xFFFFFFFFFFFFFFFF);
+    check_mmi(results, cpu, "pceqb", 0x28, 0x0A, S_LO, S_HI, S_LO ^ 1, S_HI, 0xFFFFFFFFFFFFFF00, 0xFFFFFFFFFFFFFFFF);
+    check_mmi(results, cpu, "ppacw", 0x08, 0x13, S_LO, S_HI, T_LO, T_HI, 0x000000000F0F0F0F, 0x89ABCDEFFF00FF00);
+    check_mmi(results, cpu, "ppach", 0x08, 0x17, S_LO, S_HI, T_LO, T_HI, 0xFFFF00000F0F0F0F, 0x4567CDEFFF00FF00);
+    check_mmi(results, cpu, "ppacb", 0x08, 0x1B, S_LO, S_HI, T_LO, T_HI, 0xFFFF00000F0F0F0F, 0x2367ABEF00000000);
+    check_mmi(results, cpu, "psllh", 0x34, 4, 0, 0, S_LO, S_HI, 0xF000F000F000F000, 0x123056709AB0DEF0);
+    check_mmi(results, cpu, "psrah", 0x37, 4, 0, 0, S_LO, S_HI, 0xFFF0FFF0FFF0FFF0, 0x00120456F89AFCDE);
+    check_mmi(results, cpu, "psrlw", 0x3E, 8, 0, 0, S_LO, S_HI, 0x00FF00FF00FF00FF, 0x000123450089ABCD);
+    check_mmi(results, cpu, "psraw", 0x3F, 8, 0, 0, S_LO, S_HI, 0xFFFF00FFFFFF00FF, 0x00012345FF89ABCD);
+
+    //PLZCW counts the leading bits matching the sign bit, minus one, of the two low words
+    set_u128(cpu, RS, 0xFFFFFFFF00000001, 0);
+    EmotionInterpreter::interpret(cpu, (0x1C << 26) | (RS << 21) | (RD << 11) | 0x04);
+    results.check("plzcw", cpu.get_gpr<uint64_t>(RD), 0x0000001F0000001E);
+}
@@ -0,0 +1,144 @@
+#include "../cputests.hpp"
+#include "../../emulator.hpp"
+#include "../../ee/emotioninterpreter.hpp"
+
+using namespace std;
+using namespace CPUTests;
+
+#define TEMP 8
+
+//COP1 and COP2 encodings
+static uint32_t mtc1(int rt, int fs)
+{
+    return (0x11 << 26) | (0x04 << 21) | (rt << 16) | (fs << 11);
+}
+
+static uint32_t fpu_op(uint8_t funct, int fd, int fs, int ft, uint8_t fmt = 0x10)
+{
+    return (0x11 << 26) | (fmt << 21) | (ft << 16) | (fs << 11) | (fd << 6) | funct;
+}
+
+static uint32_t qmtc2(int rt, int fs)
+{
+    return (0x12 << 26) | (0x05 << 21) | (rt << 16) | (fs << 11);
+}
+
+static uint32_t qmfc2(int rt, int fs)
+{
+    return (0x12 << 26) | (0x01 << 21) | (rt << 16) | (fs << 11);
+}
+
+static uint32_t vu_macro(uint8_t op, int dest, int fd, int fs, int ft)
+{
+    return (0x12 << 26) | (1 << 25) | (dest << 21) | (ft << 16) | (fs << 11) | (fd << 6) | op;
+}
+
+static void set_fpr(EmotionEngine& cpu, int index, uint32_t value)
+{
+    cpu.set_gpr<uint64_t>(TEMP, value);
+    EmotionInterpreter::interpret(cpu, mtc1(TEMP, index));
+}
+
+static uint32_t get_fpr(EmotionEngine& cpu, int index)
+{
+    EE_State state;
+    cpu.get_state(state);
+    return state.fpr[index];
+}
+
+static void set_vf(EmotionEngine& cpu, int index, uint64_t lo, uint64_t hi)
+{
+    cpu.set_gpr<uint64_t>(TEMP, lo);
+    cpu.set_gpr<uint64_t>(TEMP, hi, 1);
+    EmotionInterpreter::interpret(cpu, qmtc2(TEMP, index));
+}
+
+static uint128_t get_vf(EmotionEngine& cpu, int index)
+{
+    EmotionInterpreter::interpret(cpu, qmfc2(TEMP, index));
+    uint128_t value;
+    value.lo = cpu.get_gpr<uint64_t>(TEMP);
+    value.hi = cpu.get_gpr<uint64_t>(TEMP, 1);
+    return value;
+}
+
+static void check_fpu(TestResults& results, EmotionEngine& cpu, const char* name, uint32_t instr, uint32_t expected)
+{
+    set_fpr(cpu, 3, 0x1337);
+    EmotionInterpreter::interpret(cpu, instr);
+    results.check(name, get_fpr(cpu, 3), expected);
+}
+
+void CPUTests::test_ee_fpu(Emulator& e, TestResults& results)
+{
+    EmotionEngine& cpu = e.get_ee();
+    results.begin_suite("fpu");
+
+    //f1 = 1.5, f2 = 2.25
+    set_fpr(cpu, 1, 0x3FC00000);
+    set_fpr(cpu, 2, 0x40100000);
+    check_fpu(results, cpu, "add.s", fpu_op(0x00, 3, 1, 2), 0x40700000);
+    check_fpu(results, cpu, "sub.s", fpu_op(0x01, 3, 1, 2), 0xBF400000);
+    check_fpu(results, cpu, "mul.s", fpu_op(0x02, 3, 1, 2), 0x40580000);
+    check_fpu(results, cpu, "div.s", fpu_op(0x03, 3, 2, 1), 0x3FC00000);
+    check_fpu(results, cpu, "sqrt.s", fpu_op(0x04, 3, 0, 2), 0x3FC00000);
+    check_fpu(results, cpu, "neg.s", fpu_op(0x07, 3, 1, 0), 0xBFC00000);
+    check_fpu(results, cpu, "max.s", fpu_op(0x28, 3, 1, 2), 0x40100000);
+    check_fpu(results, cpu, "min.s", fpu_op(0x29, 3, 1, 2), 0x3FC00000);
+    check_fpu(results, cpu, "cvt.w.s", fpu_op(0x24, 3, 2, 0), 2);
+
+    set_fpr(cpu, 4, 0xBF400000);
+    check_fpu(results, cpu, "abs.s", fpu_op(0x05, 3, 4, 0), 0x3F400000);
+    set_fpr(cpu, 4, 2);
+    check_fpu(results, cpu, "cvt.s.w", fpu_op(0x20, 3, 4, 0, 0x14), 0x40000000);
+
+    //ACC = 1.5 + 2.25, then 3.75 + 1.5 * 2.25
+    EmotionInterpreter::interpret(cpu, fpu_op(0x18, 0, 1, 2));
+    check_fpu(results, cpu, "madd.s", fpu_op(0x1C, 3, 1, 2), 0x40E40000);
+
+    //The PS2 FPU has no infinities, overflows clamp to the largest float
+    set_fpr(cpu, 4, 0x7F7FFFFF);
+    check_fpu(results, cpu, "add.s_overflow", fpu_op(0x00, 3, 4, 4), 0x7F7FFFFF);
+
+    EE_State state;
+    EmotionInterpreter::interpret(cpu, fpu_op(0x34, 0, 1, 2));
+    cpu.get_state(state);
+    results.check("c.lt.s", (state.fpu_control >> 23) & 0x1, 1);
+    EmotionInterpreter::interpret(cpu, fpu_op(0x32, 0, 1, 2));
+    cpu.get_state(state);
+    results.check("c.eq.s", (state.fpu_control >> 23) & 0x1, 0);
+}
+
+void CPUTests::test_ee_cop2(Emulator& e, TestResults& results)
+{
+    EmotionEngine& cpu = e.get_ee();
+    results.begin_suite("cop2");
+
+    //vf1 = (1, 2, 3, 4), vf2 = (0.5, 0.5, 0.5, 0.5)
+    set_vf(cpu, 1, 0x400000003F800000, 0x4080000040400000);
+    set_vf(cpu, 2, 0x3F0000003F000000, 0x3F0000003F000000);
+    results.check("qmtc2", get_vf(cpu, 1), 0x400000003F800000, 0x4080000040400000);
+
+    set_vf(cpu, 3, 0, 0);
+    EmotionInterpreter::interpret(cpu, vu_macro(0x28, 0xF, 3, 1, 2));
+    results.check("vadd", get_vf(cpu, 3), 0x402000003FC00000, 0x4090000040600000);
+
+    set_vf(cpu, 3, 0, 0);
+    EmotionInterpreter::interpret(cpu, vu_macro(0x28, 0x8, 3, 1, 2));
+    results.check("vadd.x", get_vf(cpu, 3), 0x000000003FC00000, 0);
+
+    EmotionInterpreter::interpret(cpu, vu_macro(0x2C, 0xF, 3, 1, 2));
+    results.check("vsub", get_vf(cpu, 3), 0x3FC000003F000000, 0x4060000040200000);
+
+    EmotionInterpreter::interpret(cpu, vu_macro(0x2A, 0xF, 3, 1, 2));
+    results.check("vmul", get_vf(cpu, 3), 0x3F8000003F000000, 0x400000003FC00000);
+
+    EmotionInterpreter::interpret(cpu, vu_macro(0x18, 0xF, 3, 1, 2));
+    results.check("vmulx", get_vf(cpu, 3), 0x3F8000003F000000, 0x400000003FC00000);
+
+    EmotionInterpreter::interpret(cpu, vu_macro(0x2B, 0xF, 3, 1, 2));
+    results.check("vmax", get_vf(cpu, 3), 0x400000003F800000, 0x4080000040400000);
+
+    EmotionInterpreter::interpret(cpu, vu_macro(0x2F, 0xF, 3, 1, 2));
+    results.check("vmini", get_vf(cpu, 3), 0x3F0000003F000000, 0x3F0000003F000000);
+}
@@ -0,0 +1,162 @@
+#include <vector>
+#include "../cputests.hpp"
+#include "../../emulator.hpp"
+
+using namespace std;
+using namespace CPUTests;
+
+static uint32_t vifcode(uint8_t cmd, uint8_t num, uint16_t imm)
+{
+    return (cmd << 24) | (num << 16) | imm;
+}
+
+//One of every VIFcode the geometry path uses, with data for each UNPACK read and mask mode
+static vector<uint32_t> build_packet()
+{
+    vector<uint32_t> packet =
+    {
+        vifcode(0x01, 0, 0x0101), //STCYCL CL=1 WL=1
+        vifcode(0x30, 0, 0), 1, 2, 3, 4, //STROW
+        vifcode(0x05, 0, 1), //STMOD offset
+        vifcode(0x6C, 3, 0x0000), //UNPACK V4-32
+        0x10, 0x11, 0x12, 0x13, 0x20, 0x21, 0x22, 0x23, 0x30, 0x31, 0x32, 0x33,
+        vifcode(0x05, 0, 0), //STMOD normal
+        vifcode(0x20, 0, 0), 0x40404040, //STMASK, W from ROW
+        vifcode(0x7C, 2, 0x0010), //UNPACK V4-32 masked
+        0xA0, 0xA1, 0xA2, 0xA3, 0xB0, 0xB1, 0xB2, 0xB3,
+        vifcode(0x68, 2, 0x0020), //UNPACK V3-32
+        0xC0, 0xC1, 0xC2, 0xD0, 0xD1, 0xD2,
+        vifcode(0x6D, 2, 0x0030), //UNPACK V4-16 signed
+        0x0002FFFF, 0x80007FFF, 0x00010001, 0x00030002,
+        vifcode(0x62, 4, 0x4030), //UNPACK S-8 unsigned
+        0xFF807F01,
+        vifcode(0x4A, 2, 0), //MPG
+        0x8000033C, 0x000002FF, 0x8000033C, 0x400002FF,
+        vifcode(0x01, 0, 0x0201), //STCYCL CL=1 WL=2, filling write
+        vifcode(0x6C, 4, 0x0050),
+        0xE0, 0xE1, 0xE2, 0xE3, 0xF0, 0xF1, 0xF2, 0xF3,
+        vifcode(0x31, 0, 0), 5, 6, 7, 8, //STCOL
+    };
+    while (packet.size() & 0x3)
+        packet.push_back(0); //NOP
+    return packet;
+}
+
+//Feeds the packet one quadword at a time as DMA would, running the VIF for the given cycles in between
+static void send_packet(VectorInterface& vif, const vector<uint32_t>& packet, int cycles)
+{
+    for (size_t i = 0; i < packet.size(); i += 4)
+    {
+        uint128_t quad;
+        for (int j = 0; j < 4; j++)
+            quad._u32[j] = packet[i + j];
+        while (!vif.feed_DMA(quad))
+            vif.update(cycles);
+        vif.update(cycles);
+    }
+    for (int i = 0; i < 64; i++)
+        vif.update(cycles);
+}
+
+static uint64_t hash_VU_memory(VectorUnit& vu)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (uint32_t addr = 0; addr < 0x600; addr += 4)
+    {
+        uint32_t word = vu.read_data<uint32_t>(addr);
+        for (int byte = 0; byte < 4; byte++)
+        {
+            hash ^= (word >> (byte * 8)) & 0xFF;
+            hash *= 0x100000001B3ULL;
+        }
+    }
+    for (uint32_t addr = 0; addr < 0x10; addr += 4)
+    {
+        hash ^= vu.read_instr<uint32_t>(addr);
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static void clear_VU_memory(VectorUnit& vu)
+{
+    uint128_t zero;
+    zero._u64[0] = 0;
+    zero._u64[1] = 0;
+    for (uint32_t addr = 0; addr < 0x600; addr += 16)
+        vu.write_data<uint128_t>(addr, zero);
+    for (uint32_t addr = 0; addr < 0x10; addr += 4)
+        vu.write_instr<uint32_t>(addr, 0);
+}
+
+//A DIRECT packet whose second SIGNAL stalls the GS before a LABEL. The LABEL must wait until the CPU clears it.
+static void test_direct_signal(Emulator& e, TestResults& results)
+{
+    VectorInterface& vif = e.get_vif1();
+    GraphicsSynthesizer& gs = e.get_gs();
+
+    const uint64_t label = 0x55;
+    vector<uint32_t> packet =
+    {
+        vifcode(0x50, 0, 4), //DIRECT
+        0x8003, 0x10000000, 0xE, 0, //GIFtag: NLOOP=3 EOP, PACKED with A+D
+        1, 0, 0x60, 0, //SIGNAL
+        2, 0, 0x60, 0, //SIGNAL again before the first is acknowledged
+        (uint32_t)label, 0, 0x62, 0, //LABEL
+    };
+    while (packet.size() & 0x3)
+        packet.push_back(0);
+
+    gs.write64_privileged(0x1000, 1);
+    gs.write64_privileged(0x1080, 0);
+    vif.reset();
+
+    //All of it in the FIFO before the VIF runs, so that the data goes to the GIF in one batch
+    for (size_t i = 0; i < packet.size(); i += 4)
+    {
+        uint128_t quad;
+        for (int j = 0; j < 4; j++)
+            quad._u32[j] = packet[i + j];
+        vif.feed_DMA(quad);
+    }
+    for (int i = 0; i < 64; i++)
+        vif.update(1000);
+    results.check("direct_signal_stall", gs.read64_privileged(0x1080) >> 32, 0);
+
+    gs.write64_privileged(0x1000, 1);
+    for (int i = 0; i < 64; i++)
+        vif.update(1000);
+    results.check("direct_signal_resume", gs.read64_privileged(0x1080) >> 32, label);
+
+    gs.write64_privileged(0x1000, 1);
+    vif.reset();
+}
+
+void CPUTests::test_vif(Emulator& e, TestResults& results)
+{
+    VectorInterface& vif = e.get_vif1();
+    VectorUnit& vu = e.get_vu1();
+    results.begin_suite("vif");
+
+    vector<uint32_t> packet = build_packet();
+    const uint64_t expected = 0x328476C998C24FFD;
+
+    //However the packet is split between updates, the result must be the same
+    const int cycles[] = {1, 3, 1000};
+    const char* names[] = {"packet_per_quad", "packet_split", "packet_whole"};
+    for (int i = 0; i < 3; i++)
+    {
+        clear_VU_memory(vu);
+        vif.reset();
+        send_packet(vif, packet, cycles[i]);
+        results.check(names[i], hash_VU_memory(vu), expected);
+    }
+
+    results.check("unpack_offset", vu.read_data<uint128_t>(0x10), 0x0000002300000021ULL, 0x0000002700000025ULL);
+    results.check("unpack_mask_row", vu.read_data<uint128_t>(0x100), 0x000000A1000000A0ULL, 0x00000004000000A2ULL);
+    //Filling writes go through the mask as well
+    results.check("unpack_fill_row", vu.read_data<uint128_t>(0x510), 0, 0x0000000400000000ULL);
+    results.check("mpg", vu.read_instr<uint32_t>(0xC), 0x400002FF);
+
+    test_direct_signal(e, results);
+}
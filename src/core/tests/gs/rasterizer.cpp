@@ -0,0 +1,777 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../gstests.hpp"
+#include "../../errors.hpp"
+#include "../../gsthread.hpp"
+
+using namespace std;
+
+#define FRAME_WIDTH 640
+#define FRAME_HEIGHT 448
+
+//Local memory layout. Frame and Z buffers are in 8 KB pages, textures and the CLUT in 256 byte blocks.
+//The Z buffer starts past the rows that a memdump reads below the scissor area, so the hash never sees it.
+#define FRAME_BASE 0
+#define Z_BASE 150
+#define TEX_CT32_BASE 0x2800
+#define TEX_T8_BASE 0x3000
+#define TEX_T4_BASE 0x3200
+#define CLUT_BASE 0x3F00
+
+#define TEX_SIZE 256
+
+enum GSRegister
+{
+    REG_PRIM = 0x00,
+    REG_RGBAQ = 0x01,
+    REG_UV = 0x03,
+    REG_XYZ2 = 0x05,
+    REG_TEX0_1 = 0x06,
+    REG_CLAMP_1 = 0x08,
+    REG_TEX1_1 = 0x14,
+    REG_XYOFFSET_1 = 0x18,
+    REG_PRMODECONT = 0x1A,
+    REG_TEXFLUSH = 0x3F,
+    REG_SCISSOR_1 = 0x40,
+    REG_ALPHA_1 = 0x42,
+    REG_TEST_1 = 0x47,
+    REG_FRAME_1 = 0x4C,
+    REG_ZBUF_1 = 0x4E,
+    REG_BITBLTBUF = 0x50,
+    REG_TRXPOS = 0x51,
+    REG_TRXREG = 0x52,
+    REG_TRXDIR = 0x53,
+    REG_HWREG = 0x54
+};
+
+enum PrimType
+{
+    PRIM_TRIANGLE = 3,
+    PRIM_TRIANGLE_STRIP = 4,
+    PRIM_TRIANGLE_FAN = 5,
+    PRIM_SPRITE = 6
+};
+
+#define PRIM_GOURAUD (1 << 3)
+#define PRIM_TEXTURED (1 << 4)
+#define PRIM_BLEND (1 << 6)
+#define PRIM_UV (1 << 8)
+
+//GS messages recorded up front, so that replaying them costs the benchmark nothing but the queue push.
+//The pixel and primitive counts are what the draw commands cover, for reporting throughput.
+struct CommandList
+{
+    vector<GSMessage> messages;
+    double pixels;
+    uint64_t prims;
+
+    CommandList() : pixels(0.0), prims(0) {}
+
+    void write(uint32_t addr, uint64_t value)
+    {
+        GSMessagePayload payload;
+        payload.write64_payload = {addr, value};
+        messages.push_back({write64_t, payload});
+    }
+
+    void rgba(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+    {
+        //Q = 1.0
+        write(REG_RGBAQ, r | (g << 8) | (b << 16) | ((uint64_t)a << 24) | (0x3F800000ULL << 32));
+    }
+
+    //Texel coordinates, with 4 fractional bits
+    void uv(uint32_t u, uint32_t v)
+    {
+        write(REG_UV, u | (v << 16));
+    }
+
+    //Pixel coordinates, converted to the GS's 12.4 fixed point
+    void xyz(int32_t x, int32_t y, uint32_t z = 0)
+    {
+        write(REG_XYZ2, (uint32_t)(x << 4) | ((uint32_t)(y << 4) << 16) | ((uint64_t)z << 32));
+    }
+
+    void add_triangle(int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t x3, int32_t y3)
+    {
+        int64_t area = (int64_t)(x2 - x1) * (y3 - y1) - (int64_t)(y2 - y1) * (x3 - x1);
+        pixels += (area < 0 ? -area : area) / 2.0;
+        prims++;
+    }
+
+    void add_sprite(int32_t width, int32_t height)
+    {
+        pixels += width * height;
+        prims++;
+    }
+};
+
+//Owns a GS thread and the local memory it draws into.
+//Between workloads the thread is idle in its event loop, so local memory can be cleared from here.
+class GSDriver
+{
+    private:
+        gs_fifo* fifo;
+        gs_return_fifo* return_fifo;
+        uint8_t* local_mem;
+        uint32_t* dump;
+        mutex dump_mutex;
+        thread gs_thread;
+    public:
+        GSDriver();
+        ~GSDriver();
+
+        void clear_memory();
+        void submit(const CommandList& list);
+        uint64_t finish();
+
+        void save_state(const char* file_name, bool delta);
+        void load_state(const char* file_name, bool delta);
+
+        void set_draw_stats(bool enabled, bool heatmap);
+        GSDrawStats* vsync();
+};
+
+GSDriver::GSDriver()
+{
+    fifo = new gs_fifo();
+    return_fifo = new gs_return_fifo();
+    local_mem = new uint8_t[1024 * 1024 * 4];
+    dump = new uint32_t[1024 * 1024];
+    clear_memory();
+    gs_thread = thread(&GraphicsSynthesizerThread::event_loop, fifo, return_fifo, local_mem);
+}
+
+GSDriver::~GSDriver()
+{
+    GSMessagePayload payload;
+    payload.no_payload = {0};
+    fifo->push({die_t, payload});
+    gs_thread.join();
+
+    delete fifo;
+    delete return_fifo;
+    delete[] local_mem;
+    delete[] dump;
+}
+
+void GSDriver::clear_memory()
+{
+    memset(local_mem, 0, 1024 * 1024 * 4);
+}
+
+void GSDriver::submit(const CommandList& list)
+{
+    for (auto& message : list.messages)
+        fifo->push(message);
+}
+
+//Waits for the GS thread to work through everything submitted so far,
+//then returns an FNV-1a hash of the frame buffer as seen through context 1's scissor area
+uint64_t GSDriver::finish()
+{
+    GSMessagePayload payload;
+    payload.render_payload = {dump, &dump_mutex};
+    fifo->push({memdump_t, payload});
+
+    GSReturnMessage data;
+    while (!return_fifo->pop(data))
+        this_thread::yield();
+
+    if (data.type == death_error_t)
+    {
+        string error = data.payload.death_error_payload.error_str;
+        delete[] data.payload.death_error_payload.error_str;
+        Errors::die("%s", error.c_str());
+    }
+
+    lock_guard<mutex> lock(dump_mutex);
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    uint32_t size = data.payload.xy_payload.x * data.payload.xy_payload.y;
+    for (uint32_t i = 0; i < size; i++)
+    {
+        for (int byte = 0; byte < 4; byte++)
+        {
+            hash ^= (dump[i] >> (byte * 8)) & 0xFF;
+            hash *= 0x100000001B3ULL;
+        }
+    }
+    return hash;
+}
+
+void GSDriver::save_state(const char* file_name, bool delta)
+{
+    ofstream state(file_name, ios::binary);
+    GSMessagePayload payload;
+    payload.save_state_payload = {&state};
+    fifo->push({delta ? save_state_delta_t : save_state_t, payload});
+
+    GSReturnMessage data;
+    while (!return_fifo->pop(data))
+        this_thread::yield();
+}
+
+void GSDriver::load_state(const char* file_name, bool delta)
+{
+    ifstream state(file_name, ios::binary);
+    GSMessagePayload payload;
+    payload.load_state_payload = {&state};
+    fifo->push({delta ? load_state_delta_t : load_state_t, payload});
+
+    GSReturnMessage data;
+    while (!return_fifo->pop(data))
+        this_thread::yield();
+}
+
+void GSDriver::set_draw_stats(bool enabled, bool heatmap)
+{
+    GSMessagePayload payload;
+    payload.set_draw_stats_payload = {enabled, heatmap};
+    fifo->push({set_draw_stats_t, payload});
+}
+
+//Ends the frame, returning the draw stats for it. The caller frees them.
+GSDrawStats* GSDriver::vsync()
+{
+    GSMessagePayload payload;
+    payload.no_payload = {0};
+    fifo->push({assert_vsync_t, payload});
+
+    GSReturnMessage data;
+    while (!return_fifo->pop(data))
+        this_thread::yield();
+    if (data.type != draw_stats_t)
+        Errors::die("[GS test] Expected draw stats, got return %d", data.type);
+    return data.payload.draw_stats_payload.stats;
+}
+
+/**
+Setup shared by every workload
+**/
+
+static void set_frame(CommandList& list)
+{
+    list.write(REG_PRMODECONT, 1);
+    list.write(REG_FRAME_1, FRAME_BASE | ((FRAME_WIDTH / 64) << 16));
+    list.write(REG_SCISSOR_1, ((uint64_t)(FRAME_WIDTH - 1) << 16) | ((uint64_t)(FRAME_HEIGHT - 1) << 48));
+    list.write(REG_XYOFFSET_1, 0);
+    list.write(REG_ZBUF_1, Z_BASE | (1ULL << 32));
+    list.write(REG_TEST_1, 0);
+    list.write(REG_ALPHA_1, 0);
+    list.write(REG_CLAMP_1, 0);
+    list.write(REG_TEX1_1, 1);
+}
+
+static void set_depth_test(CommandList& list, uint8_t z_format, uint8_t method)
+{
+    list.write(REG_ZBUF_1, Z_BASE | (z_format << 24));
+    list.write(REG_TEST_1, (1 << 16) | (method << 17));
+}
+
+//Host to local transfer. Pixels are packed into doublewords low bits first, the same as HWREG unpacks them.
+template <typename Func>
+static void upload(CommandList& list, uint32_t base, uint8_t format, int bpp, int width, int height, Func pixel)
+{
+    list.write(REG_BITBLTBUF, ((uint64_t)base << 32) | ((uint64_t)(width / 64) << 48) | ((uint64_t)format << 56));
+    list.write(REG_TRXPOS, 0);
+    list.write(REG_TRXREG, width | ((uint64_t)height << 32));
+    list.write(REG_TRXDIR, 0);
+
+    int per_dword = 64 / bpp;
+    uint64_t mask = (bpp == 32) ? 0xFFFFFFFF : (1 << bpp) - 1;
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x += per_dword)
+        {
+            uint64_t data = 0;
+            for (int i = 0; i < per_dword; i++)
+                data |= ((uint64_t)pixel(x + i, y) & mask) << (i * bpp);
+            list.write(REG_HWREG, data);
+        }
+    }
+}
+
+static uint32_t clut_color(int index)
+{
+    return index | ((255 - index) << 8) | (((index * 7) & 0xFF) << 16) | (0x80 << 24);
+}
+
+//format is one of PSMCT32, PSMT8 or PSMT4. Paletted textures also upload a 256 entry PSMCT32 CLUT.
+static void set_texture(CommandList& list, uint8_t format, bool bilinear)
+{
+    uint32_t base;
+    uint64_t clut = 0;
+    switch (format)
+    {
+        case 0x00:
+            base = TEX_CT32_BASE;
+            upload(list, base, format, 32, TEX_SIZE, TEX_SIZE, [](int x, int y)
+            {
+                return x | (y << 8) | (((x ^ y) & 0xFF) << 16) | (0x80 << 24);
+            });
+            break;
+        case 0x13:
+            base = TEX_T8_BASE;
+            upload(list, base, format, 8, TEX_SIZE, TEX_SIZE, [](int x, int y) { return (x * 3 + y * 5) & 0xFF; });
+            break;
+        case 0x14:
+            base = TEX_T4_BASE;
+            upload(list, base, format, 4, TEX_SIZE, TEX_SIZE, [](int x, int y) { return ((x >> 2) ^ (y >> 2)) & 0xF; });
+            break;
+        default:
+            Errors::die("[GS bench] Unsupported texture format $%02X", format);
+            return;
+    }
+
+    if (format != 0x00)
+    {
+        upload(list, CLUT_BASE, 0x00, 32, 64, 4, [](int x, int y) { return clut_color((x + y * 64) & 0xFF); });
+        //CLUT in PSMCT32 at CBP, loaded on this TEX0 write
+        clut = ((uint64_t)CLUT_BASE << 37) | (1ULL << 61);
+    }
+
+    list.write(REG_TEXFLUSH, 0);
+    //TBW, 256x256, RGBA, decal
+    list.write(REG_TEX0_1, base | ((TEX_SIZE / 64) << 14) | ((uint64_t)format << 20) | (8ULL << 26) | (8ULL << 30)
+               | (1ULL << 34) | (1ULL << 35) | clut);
+    //Fixed LOD of 0, so that MMAG alone picks the filter
+    list.write(REG_TEX1_1, 1 | (bilinear << 5));
+}
+
+/**
+Workloads. Each one builds its setup commands (uploads and register state), which are not timed,
+and its draw commands, which are.
+**/
+
+static void large_triangles(CommandList& setup, CommandList& draw)
+{
+    set_frame(setup);
+    draw.write(REG_PRIM, PRIM_TRIANGLE);
+    for (int i = 0; i < 8; i++)
+    {
+        draw.rgba(i * 32, 255 - i * 32, 0x40, 0x80);
+        draw.xyz(0, 0);
+        draw.xyz(FRAME_WIDTH, 0);
+        draw.xyz(0, FRAME_HEIGHT);
+        draw.add_triangle(0, 0, FRAME_WIDTH, 0, 0, FRAME_HEIGHT);
+        draw.xyz(FRAME_WIDTH, 0);
+        draw.xyz(FRAME_WIDTH, FRAME_HEIGHT);
+        draw.xyz(0, FRAME_HEIGHT);
+        draw.add_triangle(FRAME_WIDTH, 0, FRAME_WIDTH, FRAME_HEIGHT, 0, FRAME_HEIGHT);
+    }
+}
+
+//Two triangles per 4x4 cell over the whole frame, where per-primitive setup dominates
+static void tiny_triangles(CommandList& setup, CommandList& draw)
+{
+    set_frame(setup);
+    draw.write(REG_PRIM, PRIM_TRIANGLE | PRIM_GOURAUD);
+    for (int y = 0; y < FRAME_HEIGHT; y += 4)
+    {
+        for (int x = 0; x < FRAME_WIDTH; x += 4)
+        {
+            draw.rgba(x, y, 0xFF, 0x80);
+            draw.xyz(x, y);
+            draw.rgba(y, x, 0x00, 0x80);
+            draw.xyz(x + 4, y);
+            draw.rgba(0xFF, x, y, 0x80);
+            draw.xyz(x, y + 4);
+            draw.add_triangle(x, y, x + 4, y, x, y + 4);
+            draw.rgba(x, 0xFF, y, 0x80);
+            draw.xyz(x + 4, y + 4);
+            draw.add_triangle(x + 4, y, x, y + 4, x + 4, y + 4);
+        }
+    }
+}
+
+static void triangle_strips(CommandList& setup, CommandList& draw)
+{
+    set_frame(setup);
+    for (int y = 0; y < FRAME_HEIGHT; y += 16)
+    {
+        draw.write(REG_PRIM, PRIM_TRIANGLE_STRIP | PRIM_GOURAUD);
+        for (int x = 0; x <= FRAME_WIDTH; x += 8)
+        {
+            draw.rgba(x / 3, y / 2, 0x80, 0x80);
+            draw.xyz(x, y);
+            draw.rgba(y / 2, x / 3, 0xC0, 0x80);
+            draw.xyz(x, y + 16);
+            if (x)
+            {
+                draw.add_triangle(x - 8, y, x - 8, y + 16, x, y);
+                draw.add_triangle(x - 8, y + 16, x, y, x, y + 16);
+            }
+        }
+    }
+}
+
+//A fan around the middle of the frame, with its rim walking the edges of a 400x400 box
+static void triangle_fans(CommandList& setup, CommandList& draw)
+{
+    set_frame(setup);
+    const int cx = FRAME_WIDTH / 2, cy = FRAME_HEIGHT / 2;
+    const int left = cx - 200, top = cy - 200, right = cx + 200, bottom = cy + 200;
+    vector<pair<int, int>> rim;
+    for (int x = left; x < right; x += 8)
+        rim.push_back({x, top});
+    for (int y = top; y < bottom; y += 8)
+        rim.push_back({right, y});
+    for (int x = right; x > left; x -= 8)
+        rim.push_back({x, bottom});
+    for (int y = bottom; y > top; y -= 8)
+        rim.push_back({left, y});
+    rim.push_back(rim[0]);
+
+    for (int i = 0; i < 4; i++)
+    {
+        draw.write(REG_PRIM, PRIM_TRIANGLE_FAN | PRIM_GOURAUD);
+        draw.rgba(0xFF, 0xFF, i * 64, 0x80);
+        draw.xyz(cx, cy);
+        for (size_t j = 0; j < rim.size(); j++)
+        {
+            draw.rgba(j & 0xFF, i * 64, 0xFF - (j & 0xFF), 0x80);
+            draw.xyz(rim[j].first, rim[j].second);
+            if (j)
+                draw.add_triangle(cx, cy, rim[j - 1].first, rim[j - 1].second, rim[j].first, rim[j].second);
+        }
+    }
+}
+
+static void flat_sprites(CommandList& setup, CommandList& draw)
+{
+    set_frame(setup);
+    draw.write(REG_PRIM, PRIM_SPRITE);
+    for (int i = 0; i < 4; i++)
+    {
+        for (int y = 0; y < FRAME_HEIGHT; y += 32)
+        {
+            for (int x = 0; x < FRAME_WIDTH; x += 32)
+            {
+                draw.rgba(x / 3 + i, y / 2, i * 64, 0x80);
+                draw.xyz(x, y);
+                draw.xyz(x + 32, y + 32);
+                draw.add_sprite(32, 32);
+            }
+        }
+    }
+}
+
+//64x64 sprites each showing the whole 256x256 texture, so every sprite minifies by four
+static void textured_sprites(CommandList& setup, CommandList& draw, uint8_t format, bool bilinear)
+{
+    set_frame(setup);
+    set_texture(setup, format, bilinear);
+    draw.write(REG_PRIM, PRIM_SPRITE | PRIM_TEXTURED | PRIM_UV);
+    draw.rgba(0x80, 0x80, 0x80, 0x80);
+    for (int y = 0; y < FRAME_HEIGHT; y += 64)
+    {
+        for (int x = 0; x < FRAME_WIDTH; x += 64)
+        {
+            draw.uv(0, 0);
+            draw.xyz(x, y);
+            draw.uv(TEX_SIZE << 4, TEX_SIZE << 4);
+            draw.xyz(x + 64, y + 64);
+            draw.add_sprite(64, 64);
+        }
+    }
+}
+
+//Quads of two triangles, 128 pixels on a side, each mapped to a 96x96 texel window so that the texture magnifies
+static void textured_triangles(CommandList& setup, CommandList& draw, uint8_t format, bool bilinear)
+{
+    set_frame(setup);
+    set_texture(setup, format, bilinear);
+    draw.write(REG_PRIM, PRIM_TRIANGLE | PRIM_TEXTURED | PRIM_UV);
+    draw.rgba(0x80, 0x80, 0x80, 0x80);
+    for (int y = 0; y < FRAME_HEIGHT; y += 128)
+    {
+        int y2 = min(y + 128, FRAME_HEIGHT);
+        for (int x = 0; x < FRAME_WIDTH; x += 128)
+        {
+            uint32_t u = x << 2, v = y << 2;
+            uint32_t size = 96 << 4;
+            draw.uv(u, v);
+            draw.xyz(x, y);
+            draw.uv(u + size, v);
+            draw.xyz(x + 128, y);
+            draw.uv(u, v + size);
+            draw.xyz(x, y2);
+            draw.add_triangle(x, y, x + 128, y, x, y2);
+            draw.uv(u + size, v);
+            draw.xyz(x + 128, y);
+            draw.uv(u + size, v + size);
+            draw.xyz(x + 128, y2);
+            draw.uv(u, v + size);
+            draw.xyz(x, y2);
+            draw.add_triangle(x + 128, y, x + 128, y2, x, y2);
+        }
+    }
+}
+
+static void sprites_ct32(CommandList& setup, CommandList& draw)
+{
+    textured_sprites(setup, draw, 0x00, false);
+}
+
+static void sprites_ct32_bilinear(CommandList& setup, CommandList& draw)
+{
+    textured_sprites(setup, draw, 0x00, true);
+}
+
+static void triangles_ct32(CommandList& setup, CommandList& draw)
+{
+    textured_triangles(setup, draw, 0x00, false);
+}
+
+static void triangles_t8_clut(CommandList& setup, CommandList& draw)
+{
+    textured_triangles(setup, draw, 0x13, false);
+}
+
+static void triangles_t8_clut_bilinear(CommandList& setup, CommandList& draw)
+{
+    textured_triangles(setup, draw, 0x13, true);
+}
+
+static void triangles_t4_clut(CommandList& setup, CommandList& draw)
+{
+    textured_triangles(setup, draw, 0x14, false);
+}
+
+static void triangles_t4_clut_bilinear(CommandList& setup, CommandList& draw)
+{
+    textured_triangles(setup, draw, 0x14, true);
+}
+
+//Overlapping translucent triangles, (Cs - Cd) * As + Cd, so every pixel also reads the frame buffer
+static void alpha_blended_triangles(CommandList& setup, CommandList& draw)
+{
+    set_frame(setup);
+    setup.write(REG_ALPHA_1, (0 << 0) | (1 << 2) | (0 << 4) | (1 << 6));
+    draw.write(REG_PRIM, PRIM_TRIANGLE | PRIM_GOURAUD | PRIM_BLEND);
+    for (int i = 0; i < 16; i++)
+    {
+        int offset = i * 16;
+        draw.rgba(0xFF, offset, 0x00, 0x40);
+        draw.xyz(offset, 0);
+        draw.rgba(0x00, 0xFF, offset, 0x60);
+        draw.xyz(FRAME_WIDTH - 1, offset);
+        draw.rgba(offset, 0x00, 0xFF, 0x20);
+        draw.xyz(FRAME_WIDTH / 2 - offset, FRAME_HEIGHT - 1);
+        draw.add_triangle(offset, 0, FRAME_WIDTH - 1, offset, FRAME_WIDTH / 2 - offset, FRAME_HEIGHT - 1);
+    }
+}
+
+//Bands of triangles at increasing depth that cross each other, so that the depth test both passes and fails
+static void depth_tested_triangles(CommandList& setup, CommandList& draw, uint8_t z_format, uint8_t method)
+{
+    set_frame(setup);
+    set_depth_test(setup, z_format, method);
+    draw.write(REG_PRIM, PRIM_TRIANGLE | PRIM_GOURAUD);
+    uint32_t z_max = (z_format == 0x00) ? 0xFFFFFFFF : 0xFFFF;
+    for (int i = 0; i < 16; i++)
+    {
+        uint32_t z = (z_max / 16) * (i + 1);
+        int x = (i & 1) ? FRAME_WIDTH - 1 : 0;
+        draw.rgba(i * 16, 0x80, 0xFF - i * 16, 0x80);
+        draw.xyz(x, 0, z);
+        draw.rgba(0xFF, i * 16, 0x40, 0x80);
+        draw.xyz(FRAME_WIDTH - 1 - x, i * 28, z_max - z);
+        draw.rgba(0x40, 0xFF, i * 16, 0x80);
+        draw.xyz(x, FRAME_HEIGHT - 1, z / 2);
+        draw.add_triangle(x, 0, FRAME_WIDTH - 1 - x, i * 28, x, FRAME_HEIGHT - 1);
+    }
+}
+
+static void ztest_gequal_z32(CommandList& setup, CommandList& draw)
+{
+    depth_tested_triangles(setup, draw, 0x00, 2);
+}
+
+static void ztest_greater_z24(CommandList& setup, CommandList& draw)
+{
+    depth_tested_triangles(setup, draw, 0x01, 3);
+}
+
+static void ztest_greater_z16(CommandList& setup, CommandList& draw)
+{
+    depth_tested_triangles(setup, draw, 0x02, 3);
+}
+
+struct Workload
+{
+    const char* name;
+    void (*build)(CommandList& setup, CommandList& draw);
+
+    //Hash of the frame after one run of the draw commands on cleared memory
+    uint64_t reference_hash;
+};
+
+static const Workload workloads[] =
+{
+    {"tri_large", large_triangles, 0x47A0401E7A3AC2A0ULL},
+    {"tri_tiny", tiny_triangles, 0xD18FD6CF65268D61ULL},
+    {"tri_strip", triangle_strips, 0x76FAD8D773859776ULL},
+    {"tri_fan", triangle_fans, 0x100EC14438003DE0ULL},
+    {"sprite_flat", flat_sprites, 0x8854B5606E955988ULL},
+    {"sprite_ct32", sprites_ct32, 0xBD1FAF5E55D49D8DULL},
+    {"sprite_ct32_bilinear", sprites_ct32_bilinear, 0x69EC853A8D8E0A40ULL},
+    {"tri_ct32", triangles_ct32, 0xB73BCF4EF630F83DULL},
+    {"tri_t8_clut", triangles_t8_clut, 0x7AEFA9CB28DD383BULL},
+    {"tri_t8_clut_bilinear", triangles_t8_clut_bilinear, 0x092F532749ADDE2DULL},
+    {"tri_t4_clut", triangles_t4_clut, 0x245C6A3FEAA35780ULL},
+    {"tri_t4_clut_bilinear", triangles_t4_clut_bilinear, 0x26BC603131C1D424ULL},
+    {"tri_alpha_blend", alpha_blended_triangles, 0x4ACCC3F326027B72ULL},
+    {"ztest_gequal_z32", ztest_gequal_z32, 0x6A6643ABD242C120ULL},
+    {"ztest_greater_z24", ztest_greater_z24, 0xF71452F9E0BC58A8ULL},
+    {"ztest_greater_z16", ztest_greater_z16, 0xF71452F9E0BC58A8ULL}
+};
+
+void GSTests::test_rasterizer(TestResults& results)
+{
+    GSDriver gs;
+    results.begin_suite("gs");
+
+    for (auto& workload : workloads)
+    {
+        CommandList setup, draw;
+        workload.build(setup, draw);
+
+        gs.clear_memory();
+        gs.submit(setup);
+        gs.submit(draw);
+        results.check(workload.name, gs.finish(), workload.reference_hash);
+    }
+}
+
+//A full snapshot plus a delta taken after more drawing must restore the same frame on a fresh GS,
+//and the delta must only hold the pages that the later drawing touched
+void GSTests::test_snapshots(TestResults& results)
+{
+    const char* full_name = "gs_snapshot_full.tmp";
+    const char* delta_name = "gs_snapshot_delta.tmp";
+    results.begin_suite("gs_snapshot");
+
+    CommandList setup, draw, fan_setup, fan_draw;
+    triangles_t8_clut(setup, draw);
+    triangle_fans(fan_setup, fan_draw);
+
+    uint64_t expected;
+    {
+        GSDriver gs;
+        gs.submit(setup);
+        gs.submit(draw);
+        gs.finish();
+        gs.save_state(full_name, false);
+        gs.submit(fan_draw);
+        expected = gs.finish();
+        gs.save_state(delta_name, true);
+    }
+
+    GSDriver gs;
+    gs.load_state(full_name, false);
+    gs.load_state(delta_name, true);
+    results.check("restore_delta", gs.finish(), expected);
+
+    ifstream delta(delta_name, ios::binary | ios::ate);
+    uint64_t delta_size = delta.tellg();
+    delta.close();
+    results.check("delta_under_quarter", delta_size < 1024 * 1024, 1);
+
+    remove(full_name);
+    remove(delta_name);
+}
+
+static void free_draw_stats(GSDrawStats* stats)
+{
+    delete[] stats->heatmap;
+    delete stats;
+}
+
+void GSTests::test_draw_stats(TestResults& results)
+{
+    GSDriver gs;
+    results.begin_suite("gs_draw_stats");
+
+    CommandList setup, draw;
+    flat_sprites(setup, draw);
+    gs.set_draw_stats(true, true);
+    gs.submit(setup);
+    gs.submit(draw);
+    GSDrawStats* stats = gs.vsync();
+    results.check("sprite_prims", stats->prims[PRIM_SPRITE], draw.prims);
+    uint64_t heatmap_sum = 0;
+    for (int i = 0; i < GS_HEATMAP_WIDTH * GS_HEATMAP_HEIGHT; i++)
+        heatmap_sum += stats->heatmap[i];
+    results.check("sprite_pixels_tested", stats->pixels_tested, heatmap_sum);
+    results.check("sprite_pixels_written", stats->pixels_written, stats->pixels_tested);
+    results.check("sprite_pixels_in_frame", stats->pixels_tested <= draw.pixels && stats->pixels_tested > 0, 1);
+    results.check("sprite_texels", stats->texels_fetched, 0);
+    //FRAME, SCISSOR, ZBUF and so on, then PRIM
+    results.check("sprite_state_changes", stats->state_changes, setup.messages.size() + 1);
+    results.check("heatmap_overdraw", stats->heatmap[100 + 100 * GS_HEATMAP_WIDTH], 4);
+    results.check("heatmap_outside", stats->heatmap[FRAME_WIDTH + 100 * GS_HEATMAP_WIDTH], 0);
+    free_draw_stats(stats);
+
+    //Counting starts over every frame
+    CommandList t8_setup, t8_draw;
+    triangles_t8_clut(t8_setup, t8_draw);
+    gs.set_draw_stats(true, false);
+    gs.submit(t8_setup);
+    gs.submit(t8_draw);
+    stats = gs.vsync();
+    results.check("t8_no_heatmap", stats->heatmap == nullptr, 1);
+    results.check("t8_prims", stats->prims[PRIM_TRIANGLE], t8_draw.prims);
+    results.check("t8_texel_per_pixel", stats->texels_fetched, stats->pixels_tested);
+    results.check("t8_clut_reloads", stats->clut_reloads, 1);
+    //The 256x256 texture at a byte per texel and the CLUT
+    results.check("t8_hwreg_bytes", stats->hwreg_bytes, TEX_SIZE * TEX_SIZE + 64 * 4 * 4);
+    free_draw_stats(stats);
+
+    //Depth tested pixels that fail are tested but never pass
+    CommandList z_setup, z_draw;
+    ztest_greater_z16(z_setup, z_draw);
+    gs.clear_memory();
+    gs.submit(z_setup);
+    gs.submit(z_draw);
+    stats = gs.vsync();
+    results.check("ztest_some_fail", stats->pixels_passed < stats->pixels_tested && stats->pixels_passed > 0, 1);
+    results.check("ztest_written", stats->pixels_written, stats->pixels_passed);
+    free_draw_stats(stats);
+
+    gs.set_draw_stats(false, false);
+}
+
+void GSTests::benchmark_rasterizer(TestResults& results, int passes)
+{
+    GSDriver gs;
+    results.begin_suite("gs");
+
+    for (auto& workload : workloads)
+    {
+        CommandList setup, draw;
+        workload.build(setup, draw);
+
+        gs.clear_memory();
+        gs.submit(setup);
+        gs.submit(draw);
+        gs.finish();
+
+        //The final sync reads back the frame once, which is small next to the draws themselves
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < passes; i++)
+            gs.submit(draw);
+        gs.finish();
+        auto end = chrono::steady_clock::now();
+
+        double seconds = chrono::duration_cast<chrono::duration<double>>(end - start).count();
+        results.add_benchmark(workload.name, passes, seconds * 1e9 / passes,
+                              draw.pixels * passes / seconds / 1e6, draw.prims * passes / seconds);
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef GSTESTS_HPP
+#define GSTESTS_HPP
+#include <cstdint>
+
+#include "testresults.hpp"
+
+class Emulator;
+
+/**
+Synthetic rasterizer workloads for the GS thread. Each workload is a list of GS register writes that is fed
+to GraphicsSynthesizerThread::event_loop through its message queue, exactly as the emulator would send them,
+but with no EE, GIF or DMA in front of it.
+The tests render every workload once and compare a hash of the framebuffer against a recorded reference;
+the benchmarks replay the draw commands and report fill rate and primitive throughput.
+The readback tests go through an emulator's GraphicsSynthesizer instead, to cover its side of local to host
+transfers as well.
+**/
+namespace GSTests
+{
+    void test_rasterizer(TestResults& results);
+    void test_snapshots(TestResults& results);
+    void test_draw_stats(TestResults& results);
+    void test_readback(Emulator& e, TestResults& results);
+    void benchmark_rasterizer(TestResults& results, int passes);
+};
+
+#endif // GSTESTS_HPP
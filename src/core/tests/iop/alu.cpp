@@ -1,3 +1,4 @@
+#include "../cputests.hpp"
 #include "../../emulator.hpp"
 #include "../../iop/iop_interpreter.hpp"
 #include <iomanip>
@@ -134,3 +135,61 @@ void Emulator::test_iop()
     test_output << "-- TEST END\n";
     test_output.flush();
 }
+
+using namespace CPUTests;
+
+static void check_iop_rrr(TestResults& results, IOP& iop, const char* name, uint32_t instr,
+                          uint32_t s, uint32_t t, uint32_t expected)
+{
+    SET_U32(RD, 0x1337); SET_U32(RS, s); SET_U32(RT, t);
+    IOP_Interpreter::interpret(iop, instr);
+    results.check(name, GET_U32(RD), expected);
+}
+
+static void check_iop_rri(TestResults& results, IOP& iop, const char* name, uint8_t op,
+                          uint32_t s, uint16_t imm, uint32_t expected)
+{
+    SET_U32(RD, 0x1337); SET_U32(RS, s);
+    IOP_Interpreter::interpret(iop, CPUTests::i_type(op, RD, RS, imm));
+    results.check(name, GET_U32(RD), expected);
+}
+
+void CPUTests::test_iop_alu(Emulator& e, TestResults& results)
+{
+    IOP& iop = e.get_iop();
+    results.begin_suite("iop");
+
+    check_iop_rrr(results, iop, "addu", r_type(0x21, RD, RS, RT), 0xFFFFFFFF, 1, 0);
+    check_iop_rrr(results, iop, "subu", r_type(0x23, RD, RS, RT), 0, 1, 0xFFFFFFFF);
+    check_iop_rrr(results, iop, "and", r_type(0x24, RD, RS, RT), 0xFF00FF00, 0x0F0F0F0F, 0x0F000F00);
+    check_iop_rrr(results, iop, "or", r_type(0x25, RD, RS, RT), 0xFF00FF00, 0x0F0F0F0F, 0xFF0FFF0F);
+    check_iop_rrr(results, iop, "xor", r_type(0x26, RD, RS, RT), 0xFF00FF00, 0x0F0F0F0F, 0xF00FF00F);
+    check_iop_rrr(results, iop, "nor", r_type(0x27, RD, RS, RT), 0xFF00FF00, 0x0F0F0F0F, 0x00F000F0);
+    check_iop_rrr(results, iop, "slt", r_type(0x2A, RD, RS, RT), 0xFFFFFFFF, 1, 1);
+    check_iop_rrr(results, iop, "sltu", r_type(0x2B, RD, RS, RT), 0xFFFFFFFF, 1, 0);
+    check_iop_rrr(results, iop, "sll", r_type(0x00, RD, 0, RT, 4), 0, 0x12345678, 0x23456780);
+    check_iop_rrr(results, iop, "srl", r_type(0x02, RD, 0, RT, 4), 0, 0x80000000, 0x08000000);
+    check_iop_rrr(results, iop, "sra", r_type(0x03, RD, 0, RT, 4), 0, 0x80000000, 0xF8000000);
+    check_iop_rrr(results, iop, "srav", r_type(0x07, RD, RS, RT), 36, 0x80000000, 0xF8000000);
+
+    check_iop_rri(results, iop, "addiu", 0x09, 0, 0x8000, 0xFFFF8000);
+    check_iop_rri(results, iop, "slti", 0x0A, 0xFFFFFFFB, 0xFFFC, 1);
+    check_iop_rri(results, iop, "sltiu", 0x0B, 5, 0xFFFF, 1);
+    check_iop_rri(results, iop, "andi", 0x0C, 0xFFFFFFFF, 0x8001, 0x8001);
+    check_iop_rri(results, iop, "ori", 0x0D, 0x12340000, 0xFFFF, 0x1234FFFF);
+    check_iop_rri(results, iop, "xori", 0x0E, 0xFFFF, 0x00FF, 0xFF00);
+    check_iop_rri(results, iop, "lui", 0x0F, 0, 0x8000, 0x80000000);
+
+    SET_U32(RS, 0xFFFFFFFE); SET_U32(RT, 3);
+    IOP_Interpreter::interpret(iop, r_type(0x18, 0, RS, RT));
+    results.check("mult_lo", iop.get_LO(), 0xFFFFFFFA);
+    results.check("mult_hi", iop.get_HI(), 0xFFFFFFFF);
+    SET_U32(RS, 7); SET_U32(RT, 0xFFFFFFFE);
+    IOP_Interpreter::interpret(iop, r_type(0x1A, 0, RS, RT));
+    results.check("div_lo", iop.get_LO(), 0xFFFFFFFD);
+    results.check("div_hi", iop.get_HI(), 1);
+    SET_U32(RT, 2);
+    IOP_Interpreter::interpret(iop, r_type(0x1B, 0, RS, RT));
+    results.check("divu_lo", iop.get_LO(), 3);
+    results.check("divu_hi", iop.get_HI(), 1);
+}
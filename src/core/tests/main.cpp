@@ -0,0 +1,109 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "cputests.hpp"
+#include "gstests.hpp"
+#include "pooltests.hpp"
+#include "statetests.hpp"
+#include "../emulator.hpp"
+#include "../threadtopology.hpp"
+
+using namespace std;
+
+static void usage(const char* name)
+{
+    printf("usage: %s [options]\n\n", name);
+    printf("options:\n");
+    printf("-o {file}\twrite results as JSON\n");
+    printf("-n {count}\titerations per benchmark (default 1000000)\n");
+    printf("-p {count}\tpasses per GS rasterizer workload and state hash benchmark (default 10)\n");
+    printf("-T {role=cpus[:priority]}\tpin a thread role, e.g. gs=2 to keep the GS thread off the runner's CPU\n");
+    printf("-t\t\trun the tests only\n");
+    printf("-b\t\trun the benchmarks only\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* json_name = nullptr;
+    uint64_t iterations = 1000000;
+    int passes = 10;
+    bool run_tests = true, run_benchmarks = true;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            json_name = argv[++i];
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            iterations = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+            passes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-T") && i + 1 < argc)
+        {
+            string error;
+            if (!ThreadTopology::configure(argv[++i], error))
+            {
+                printf("Bad thread placement %s: %s\n", argv[i], error.c_str());
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-t"))
+            run_benchmarks = false;
+        else if (!strcmp(argv[i], "-b"))
+            run_tests = false;
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    //No BIOS is needed, the tests drive the execution engines directly
+    Emulator e;
+    e.reset();
+
+    TestResults results("interpreter");
+    try
+    {
+        if (run_tests)
+        {
+            CPUTests::test_ee_alu(e, results);
+            CPUTests::test_ee_mmi(e, results);
+            CPUTests::test_ee_fpu(e, results);
+            CPUTests::test_ee_cop2(e, results);
+            CPUTests::test_iop_alu(e, results);
+            CPUTests::test_vu(e, results);
+            CPUTests::test_vif(e, results);
+            GSTests::test_rasterizer(results);
+            GSTests::test_snapshots(results);
+            GSTests::test_draw_stats(results);
+            GSTests::test_readback(e, results);
+            StateTests::test_state_hash(e, results);
+            PoolTests::test_emulator_pool(results);
+        }
+        if (run_benchmarks)
+        {
+            CPUTests::benchmark_ee(e, results, iterations);
+            CPUTests::benchmark_iop(e, results, iterations);
+            CPUTests::benchmark_vu(e, results, iterations);
+            CPUTests::benchmark_vif(e, results, iterations);
+            GSTests::benchmark_rasterizer(results, passes);
+            StateTests::benchmark_state_hash(e, results, passes);
+        }
+    }
+    catch (runtime_error& err)
+    {
+        printf("Test run aborted: %s\n", err.what());
+        return 1;
+    }
+
+    results.print_summary();
+    if (ThreadTopology::is_configured())
+        ThreadTopology::print_report();
+    if (json_name && !results.write_json(json_name))
+    {
+        printf("Failed to write %s\n", json_name);
+        return 1;
+    }
+    return results.get_failures() ? 1 : 0;
+}
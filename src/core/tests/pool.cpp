@@ -0,0 +1,56 @@
+#include <vector>
+#include "pooltests.hpp"
+#include "../emulatorpool.hpp"
+
+using namespace std;
+
+#define BIOS_START 0xBFC00000
+
+//A BIOS that spins on a branch to itself, which both the EE and the IOP can run forever
+static vector<uint8_t> build_BIOS()
+{
+    vector<uint8_t> BIOS(1024 * 1024 * 4, 0);
+    uint32_t loop = 0x1000FFFF; //beq $zero, $zero, -1
+    for (int i = 0; i < 4; i++)
+        BIOS[i] = (loop >> (i * 8)) & 0xFF;
+    return BIOS;
+}
+
+//Every emulator is spinning in the BIOS loop (or its delay slot) and none has failed
+static bool pool_running(EmulatorPool& pool)
+{
+    for (int i = 0; i < pool.size(); i++)
+    {
+        uint32_t PC = pool.get(i).get_ee().get_PC();
+        if (pool.has_failed(i) || (PC != BIOS_START && PC != BIOS_START + 4))
+            return false;
+    }
+    return true;
+}
+
+void PoolTests::test_emulator_pool(TestResults& results)
+{
+    results.begin_suite("emulator_pool");
+
+    vector<uint8_t> BIOS = build_BIOS();
+    {
+        EmulatorPool pool(3, 2);
+        pool.load_BIOS(BIOS.data());
+        pool.reset();
+        results.check("size", pool.size(), 3);
+
+        pool.run_frame();
+        pool.run_frame();
+        results.check("run", pool_running(pool), 1);
+
+        //A second reset goes through the same workers that took the frame locks
+        pool.reset();
+        bool at_start = true;
+        for (int i = 0; i < pool.size(); i++)
+            at_start &= pool.get(i).get_ee().get_PC() == BIOS_START;
+        results.check("reset", at_start, 1);
+
+        pool.run_frame();
+        results.check("run_after_reset", pool_running(pool), 1);
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef POOLTESTS_HPP
+#define POOLTESTS_HPP
+#include "testresults.hpp"
+
+/**
+Runs several emulators through an EmulatorPool with more than one worker thread, so that resets, frames and
+teardown happen on the workers the way a batch runner would drive them.
+**/
+namespace PoolTests
+{
+    void test_emulator_pool(TestResults& results);
+};
+
+#endif // POOLTESTS_HPP
@@ -0,0 +1,156 @@
+#include <chrono>
+#include <vector>
+#include "statetests.hpp"
+#include "../emulator.hpp"
+#include "../statehash.hpp"
+
+using namespace std;
+
+#define REG_BITBLTBUF 0x50
+#define REG_TRXPOS 0x51
+#define REG_TRXREG 0x52
+#define REG_TRXDIR 0x53
+#define REG_HWREG 0x54
+
+//Bit n is set when component n differs between the two sets of hashes
+static uint64_t changed_components(const uint64_t* before, const uint64_t* after)
+{
+    uint64_t changed = 0;
+    for (int i = 0; i < HASH_COMPONENT_COUNT; i++)
+    {
+        if (before[i] != after[i])
+            changed |= 1 << i;
+    }
+    return changed;
+}
+
+static void test_hash_bytes(TestResults& results)
+{
+    vector<uint8_t> data(5000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (uint8_t)(i * 7 + (i >> 8));
+
+    uint64_t hash = StateHash::hash_bytes(data.data(), data.size());
+    results.check("bytes_stable", StateHash::hash_bytes(data.data(), data.size()) == hash, 1);
+
+    //A bit flipped in the first block, in the last full stripe and in the partial tail
+    const size_t flips[] = {3, 4095, 4990};
+    bool all_changed = true;
+    for (size_t offset : flips)
+    {
+        data[offset] ^= 0x10;
+        all_changed &= StateHash::hash_bytes(data.data(), data.size()) != hash;
+        data[offset] ^= 0x10;
+    }
+    results.check("bytes_bit_flip", all_changed, 1);
+
+    //Trailing zeros change the length, and with it the hash
+    uint8_t zeros[8] = {};
+    results.check("bytes_length", StateHash::hash_bytes(zeros, 3) != StateHash::hash_bytes(zeros, 4), 1);
+}
+
+static void test_page_hasher(TestResults& results)
+{
+    vector<uint8_t> mem(1024 * 64);
+    for (size_t i = 0; i < mem.size(); i++)
+        mem[i] = (uint8_t)(i ^ (i >> 9));
+
+    PageHasher incremental(mem.size(), 1024 * 4);
+    uint64_t hash = incremental.update(mem.data());
+    results.check("pages_clean", incremental.update(mem.data()) == hash, 1);
+
+    //Writes that straddle a page boundary and wrap around the end
+    mem[0x2FFF] ^= 0xFF;
+    mem[0x3000] ^= 0xFF;
+    incremental.mark_dirty(0x2FFF, 2);
+    mem[0x1] ^= 0x1;
+    incremental.mark_dirty(mem.size() + 0x1);
+
+    PageHasher full(mem.size(), 1024 * 4);
+    uint64_t updated = incremental.update(mem.data());
+    results.check("pages_changed", updated != hash, 1);
+    results.check("pages_match_full", updated == full.update(mem.data()), 1);
+}
+
+void StateTests::test_state_hash(Emulator& e, TestResults& results)
+{
+    results.begin_suite("state_hash");
+
+    test_hash_bytes(results);
+    test_page_hasher(results);
+
+    uint64_t before[HASH_COMPONENT_COUNT], after[HASH_COMPONENT_COUNT];
+    uint64_t state = e.hash_state(before);
+    results.check("state_stable", e.hash_state(after) == state, 1);
+    results.check("state_stable_components", changed_components(before, after), 0);
+
+    //A write shows up in its own component, and undoing it brings back the old hash
+    uint32_t old_word = e.read32(0x00100000);
+    e.write32(0x00100000, old_word ^ 0x80000000);
+    e.hash_state(after);
+    results.check("rdram_write", changed_components(before, after), 1 << HASH_RDRAM);
+    e.write32(0x00100000, old_word);
+    results.check("rdram_restored", e.hash_state() == state, 1);
+
+    old_word = e.iop_read32(0x00010000);
+    e.iop_write32(0x00010000, old_word + 1);
+    e.hash_state(after);
+    results.check("iop_ram_write", changed_components(before, after), 1 << HASH_IOP_RAM);
+    e.iop_write32(0x00010000, old_word);
+
+    EmotionEngine& cpu = e.get_ee();
+    uint64_t old_gpr = cpu.get_gpr<uint64_t>(9);
+    cpu.set_gpr<uint64_t>(9, old_gpr ^ 0x1234);
+    e.hash_state(after);
+    results.check("register_write", changed_components(before, after), 1 << HASH_REGISTERS);
+    cpu.set_gpr<uint64_t>(9, old_gpr);
+
+    VectorUnit& vu = e.get_vu1();
+    uint32_t old_data = vu.read_data<uint32_t>(0x3FF0);
+    vu.write_data<uint32_t>(0x3FF0, old_data ^ 1);
+    e.hash_state(after);
+    results.check("vu_mem_write", changed_components(before, after), 1 << HASH_VU_MEM);
+    vu.write_data<uint32_t>(0x3FF0, old_data);
+    results.check("restored", e.hash_state() == state, 1);
+
+    //Eight pixels uploaded at the far end of VRAM through HWREG
+    GraphicsSynthesizer& gs = e.get_gs();
+    gs.write64(REG_BITBLTBUF, (0x3F00ULL << 32) | (1ULL << 48));
+    gs.write64(REG_TRXPOS, 0);
+    gs.write64(REG_TRXREG, 8 | (1ULL << 32));
+    gs.write64(REG_TRXDIR, 0);
+    for (int i = 0; i < 4; i++)
+        gs.write64(REG_HWREG, 0x0123456789ABCDEFULL * (i + 1));
+    e.hash_state(after);
+    results.check("gs_vram_write", changed_components(before, after), 1 << HASH_GS_VRAM);
+}
+
+void StateTests::benchmark_state_hash(Emulator& e, TestResults& results, int passes)
+{
+    results.begin_suite("state_hash");
+
+    vector<uint8_t> data(1024 * 1024 * 32);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (uint8_t)(i * 13);
+    volatile uint64_t sink = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < passes; i++)
+        sink += StateHash::hash_bytes(data.data(), data.size());
+    auto end = chrono::steady_clock::now();
+    double ns = chrono::duration_cast<chrono::duration<double, nano>>(end - start).count();
+    results.add_benchmark("hash_32mb", passes, ns / passes);
+
+    //A frame that wrote to a handful of pages, which is what leaving the per-frame log on costs
+    e.hash_state();
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < passes; i++)
+    {
+        for (uint32_t page = 0; page < 16; page++)
+            e.write32(page * 0x10000 + i * 4, i);
+        sink += e.hash_state();
+    }
+    end = chrono::steady_clock::now();
+    ns = chrono::duration_cast<chrono::duration<double, nano>>(end - start).count();
+    results.add_benchmark("state_incremental", passes, ns / passes);
+}
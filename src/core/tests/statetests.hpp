@@ -0,0 +1,19 @@
+#ifndef STATETESTS_HPP
+#define STATETESTS_HPP
+#include <cstdint>
+
+#include "testresults.hpp"
+
+class Emulator;
+
+/**
+Tests and benchmarks for Emulator::hash_state. The tests check that a change to one part of the machine shows up
+in that part's hash and no other, and that incremental page hashing gives the same result as hashing from scratch.
+**/
+namespace StateTests
+{
+    void test_state_hash(Emulator& e, TestResults& results);
+    void benchmark_state_hash(Emulator& e, TestResults& results, int passes);
+};
+
+#endif // STATETESTS_HPP
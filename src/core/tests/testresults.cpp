@@ -0,0 +1,123 @@
+#include <cstdio>
+#include <fstream>
+#include "testresults.hpp"
+
+using namespace std;
+
+TestResults::TestResults(const string& backend) : backend(backend)
+{
+
+}
+
+void TestResults::begin_suite(const string& name)
+{
+    suite = name;
+}
+
+void TestResults::check(const string& name, uint64_t result, uint64_t expected)
+{
+    TestCheck test = {suite, name, result == expected, ""};
+    if (!test.passed)
+    {
+        char detail[96];
+        snprintf(detail, sizeof(detail), "got $%016llX, expected $%016llX",
+                 (unsigned long long)result, (unsigned long long)expected);
+        test.detail = detail;
+    }
+    checks.push_back(test);
+}
+
+void TestResults::check(const string& name, const uint128_t& result, uint64_t expected_lo, uint64_t expected_hi)
+{
+    TestCheck test = {suite, name, result.lo == expected_lo && result.hi == expected_hi, ""};
+    if (!test.passed)
+    {
+        char detail[160];
+        snprintf(detail, sizeof(detail), "got $%016llX_%016llX, expected $%016llX_%016llX",
+                 (unsigned long long)result.hi, (unsigned long long)result.lo,
+                 (unsigned long long)expected_hi, (unsigned long long)expected_lo);
+        test.detail = detail;
+    }
+    checks.push_back(test);
+}
+
+void TestResults::add_benchmark(const string& name, uint64_t iterations, double ns_per_op,
+                                double mpixels_per_sec, double prims_per_sec)
+{
+    benchmarks.push_back({suite, name, iterations, ns_per_op, mpixels_per_sec, prims_per_sec});
+}
+
+int TestResults::get_failures()
+{
+    int failures = 0;
+    for (auto& test : checks)
+    {
+        if (!test.passed)
+            failures++;
+    }
+    return failures;
+}
+
+void TestResults::print_summary()
+{
+    for (auto& test : checks)
+    {
+        if (!test.passed)
+            printf("FAIL %s/%s: %s\n", test.suite.c_str(), test.name.c_str(), test.detail.c_str());
+    }
+    for (auto& bench : benchmarks)
+    {
+        if (bench.mpixels_per_sec > 0.0)
+        {
+            printf("%-8s %-20s %10.2f Mpixels/s %12.0f prims/s\n", bench.suite.c_str(), bench.name.c_str(),
+                   bench.mpixels_per_sec, bench.prims_per_sec);
+        }
+        else
+            printf("%-8s %-16s %10.2f ns/op\n", bench.suite.c_str(), bench.name.c_str(), bench.ns_per_op);
+    }
+    printf("%d checks, %d failed, %d benchmarks (%s)\n", (int)checks.size(), get_failures(),
+           (int)benchmarks.size(), backend.c_str());
+}
+
+//Names only ever come from the test sources, so nothing needs escaping
+bool TestResults::write_json(const char* file_name)
+{
+    ofstream file(file_name);
+    if (!file.is_open())
+        return false;
+
+    file << "{\n";
+    file << "  \"backend\": \"" << backend << "\",\n";
+    file << "  \"failures\": " << get_failures() << ",\n";
+    file << "  \"checks\": [\n";
+    for (size_t i = 0; i < checks.size(); i++)
+    {
+        TestCheck& test = checks[i];
+        file << "    {\"suite\": \"" << test.suite << "\", \"name\": \"" << test.name << "\", \"passed\": "
+             << (test.passed ? "true" : "false");
+        if (!test.passed)
+            file << ", \"detail\": \"" << test.detail << "\"";
+        file << "}" << (i + 1 < checks.size() ? "," : "") << "\n";
+    }
+    file << "  ],\n";
+    file << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < benchmarks.size(); i++)
+    {
+        BenchmarkResult& bench = benchmarks[i];
+        char ns[32];
+        snprintf(ns, sizeof(ns), "%.3f", bench.ns_per_op);
+        file << "    {\"suite\": \"" << bench.suite << "\", \"name\": \"" << bench.name << "\", \"iterations\": "
+             << bench.iterations << ", \"ns_per_op\": " << ns;
+        if (bench.mpixels_per_sec > 0.0)
+        {
+            char rates[64];
+            snprintf(rates, sizeof(rates), ", \"mpixels_per_sec\": %.3f, \"prims_per_sec\": %.1f",
+                     bench.mpixels_per_sec, bench.prims_per_sec);
+            file << rates;
+        }
+        file << "}" << (i + 1 < benchmarks.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n";
+    file << "}\n";
+    return file.good();
+}
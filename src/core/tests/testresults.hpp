@@ -0,0 +1,55 @@
+#ifndef TESTRESULTS_HPP
+#define TESTRESULTS_HPP
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../int128.hpp"
+
+struct TestCheck
+{
+    std::string suite;
+    std::string name;
+    bool passed;
+    std::string detail;
+};
+
+struct BenchmarkResult
+{
+    std::string suite;
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+
+    //Only set by the rasterizer workloads
+    double mpixels_per_sec;
+    double prims_per_sec;
+};
+
+/**
+Collects golden-value checks and benchmark timings from the test runner, and writes them out as JSON
+so that results can be compared between builds. The backend names the execution engine that was measured.
+**/
+class TestResults
+{
+    private:
+        std::string backend;
+        std::string suite;
+        std::vector<TestCheck> checks;
+        std::vector<BenchmarkResult> benchmarks;
+    public:
+        TestResults(const std::string& backend);
+
+        void begin_suite(const std::string& name);
+
+        void check(const std::string& name, uint64_t result, uint64_t expected);
+        void check(const std::string& name, const uint128_t& result, uint64_t expected_lo, uint64_t expected_hi);
+        void add_benchmark(const std::string& name, uint64_t iterations, double ns_per_op,
+                           double mpixels_per_sec = 0.0, double prims_per_sec = 0.0);
+
+        int get_failures();
+        void print_summary();
+        bool write_json(const char* file_name);
+};
+
+#endif // TESTRESULTS_HPP
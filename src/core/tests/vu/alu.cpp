@@ -0,0 +1,121 @@
+#include "../cputests.hpp"
+#include "../../emulator.hpp"
+#include "../../ee/vu_interpreter.hpp"
+
+using namespace std;
+using namespace CPUTests;
+
+#define UPPER_NOP 0x000002FF
+#define LOWER_NOP 0x8000033C
+
+static uint32_t upper_op(uint8_t op, int dest, int fd, int fs, int ft)
+{
+    return (dest << 21) | (ft << 16) | (fs << 11) | (fd << 6) | op;
+}
+
+//Upper special ops are split over the low 2 bits and bits 6-10
+static uint32_t upper_special(uint8_t op, int dest, int ft, int fs)
+{
+    return (dest << 21) | (ft << 16) | (fs << 11) | ((op >> 2) << 6) | 0x3C | (op & 0x3);
+}
+
+static uint32_t lower_op(uint8_t op, int id, int is, int it)
+{
+    return 0x80000000 | (it << 16) | (is << 11) | (id << 6) | op;
+}
+
+static void set_vf(VectorUnit& vu, int index, uint32_t x, uint32_t y, uint32_t z, uint32_t w)
+{
+    vu.set_gpr_u(index, 0, x);
+    vu.set_gpr_u(index, 1, y);
+    vu.set_gpr_u(index, 2, z);
+    vu.set_gpr_u(index, 3, w);
+}
+
+static uint128_t get_vf(VectorUnit& vu, int index)
+{
+    uint128_t value;
+    for (int i = 0; i < 4; i++)
+        value._u32[i] = vu.get_gpr_u(index, i);
+    return value;
+}
+
+static void execute(VectorUnit& vu, uint32_t upper, uint32_t lower)
+{
+    VU_Interpreter::interpret(vu, upper, lower);
+    vu.flush_pipes();
+}
+
+static void check_upper(TestResults& results, VectorUnit& vu, const char* name, uint32_t instr,
+                        uint64_t expected_lo, uint64_t expected_hi)
+{
+    set_vf(vu, 3, 0, 0, 0, 0);
+    execute(vu, instr, LOWER_NOP);
+    results.check(name, get_vf(vu, 3), expected_lo, expected_hi);
+}
+
+static void check_lower(TestResults& results, VectorUnit& vu, const char* name, uint32_t instr, uint16_t expected)
+{
+    vu.set_int(3, 0x1337);
+    execute(vu, UPPER_NOP, instr);
+    results.check(name, vu.get_int(3), expected);
+}
+
+void CPUTests::test_vu(Emulator& e, TestResults& results)
+{
+    uint32_t FBRST = 0;
+    VectorUnit vu(1, &e, &FBRST);
+    vu.reset();
+    results.begin_suite("vu");
+
+    //vf1 = (1, 2, 3, 4), vf2 = (0.5, 0.5, 0.5, -2)
+    set_vf(vu, 1, 0x3F800000, 0x40000000, 0x40400000, 0x40800000);
+    set_vf(vu, 2, 0x3F000000, 0x3F000000, 0x3F000000, 0xC0000000);
+
+    check_upper(results, vu, "add", upper_op(0x28, 0xF, 3, 1, 2), 0x402000003FC00000, 0x4000000040600000);
+    check_upper(results, vu, "add.xy", upper_op(0x28, 0xC, 3, 1, 2), 0x402000003FC00000, 0);
+    check_upper(results, vu, "sub", upper_op(0x2C, 0xF, 3, 1, 2), 0x3FC000003F000000, 0x40C0000040200000);
+    check_upper(results, vu, "mul", upper_op(0x2A, 0xF, 3, 1, 2), 0x3F8000003F000000, 0xC10000003FC00000);
+    check_upper(results, vu, "mulw", upper_op(0x1B, 0xF, 3, 1, 2), 0xC0800000C0000000, 0xC1000000C0C00000);
+    check_upper(results, vu, "max", upper_op(0x2B, 0xF, 3, 1, 2), 0x400000003F800000, 0x4080000040400000);
+    check_upper(results, vu, "mini", upper_op(0x2F, 0xF, 3, 1, 2), 0x3F0000003F000000, 0xC00000003F000000);
+
+    //vf4 = (-1.5, 2.75, 0, 7)
+    set_vf(vu, 4, 0xBFC00000, 0x40300000, 0, 0x40E00000);
+    check_upper(results, vu, "ftoi0", upper_special(0x14, 0xF, 3, 4), 0x00000002FFFFFFFF, 0x0000000700000000);
+    set_vf(vu, 4, 0xFFFFFFFE, 3, 0, 0x10);
+    check_upper(results, vu, "itof0", upper_special(0x10, 0xF, 3, 4), 0x40400000C0000000, 0x4180000000000000);
+    set_vf(vu, 4, 0xBFC00000, 0x40300000, 0, 0xC0E00000);
+    check_upper(results, vu, "abs", upper_special(0x1D, 0xF, 3, 4), 0x403000003FC00000, 0x40E0000000000000);
+
+    //ACC = vf1 * vf2, then vf3 = ACC + vf1 * vf2
+    execute(vu, upper_special(0x2A, 0xF, 2, 1), LOWER_NOP);
+    check_upper(results, vu, "madd", upper_op(0x29, 0xF, 3, 1, 2), 0x400000003F800000, 0xC180000040400000);
+
+    vu.set_int(1, 0x7FFF);
+    vu.set_int(2, 0x0003);
+    check_lower(results, vu, "iadd", lower_op(0x30, 3, 1, 2), 0x8002);
+    check_lower(results, vu, "isub", lower_op(0x31, 3, 2, 1), 0x8004);
+    check_lower(results, vu, "iand", lower_op(0x34, 3, 1, 2), 0x0003);
+    check_lower(results, vu, "ior", lower_op(0x35, 3, 2, 2), 0x0003);
+
+    //IADDI has a signed 5-bit immediate in the fd field
+    vu.set_int(3, 0x1337);
+    execute(vu, UPPER_NOP, lower_op(0x32, 0x1F, 2, 3));
+    results.check("iaddi", vu.get_int(3), 0x0002);
+
+    //Microprograms run through the predecoded cache, which has to notice when micro memory is rewritten
+    const uint32_t E_BIT = 1 << 30;
+    vu.write_instr<uint64_t>(0x00, ((uint64_t)upper_op(0x28, 0xF, 3, 1, 2) << 32) | LOWER_NOP);
+    vu.write_instr<uint64_t>(0x08, ((uint64_t)(UPPER_NOP | E_BIT) << 32) | LOWER_NOP);
+    vu.write_instr<uint64_t>(0x10, ((uint64_t)UPPER_NOP << 32) | LOWER_NOP);
+    set_vf(vu, 3, 0, 0, 0, 0);
+    vu.mscal(0);
+    vu.run(16);
+    results.check("microprogram", get_vf(vu, 3), 0x402000003FC00000, 0x4000000040600000);
+
+    vu.write_instr<uint64_t>(0x00, ((uint64_t)upper_op(0x2C, 0xF, 3, 1, 2) << 32) | LOWER_NOP);
+    vu.mscal(0);
+    vu.run(16);
+    results.check("microprogram_rewritten", get_vf(vu, 3), 0x3FC000003F000000, 0x40C0000040200000);
+}
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include "errors.hpp"
+#include "threadtopology.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+struct ThreadRecord
+{
+    THREAD_ROLE role;
+    string name;
+    string cpus;
+    bool alive;
+    chrono::steady_clock::time_point start;
+
+    //Filled in when the thread leaves its scope
+    double wall_seconds;
+    double cpu_seconds;
+#ifdef __linux__
+    pthread_t handle;
+#endif
+};
+
+static const char* role_names[ROLE_COUNT] = {"core", "gs", "vu1", "iop", "ipu", "audio", "io"};
+
+static mutex topology_mutex;
+static ThreadPlacement placements[ROLE_COUNT];
+static bool configured = false;
+static vector<ThreadRecord> records;
+
+static string describe_cpus(const vector<int>& cpus)
+{
+    if (cpus.empty())
+        return "any";
+    string text;
+    for (size_t i = 0; i < cpus.size(); i++)
+    {
+        //Collapse runs into ranges
+        size_t end = i;
+        while (end + 1 < cpus.size() && cpus[end + 1] == cpus[end] + 1)
+            end++;
+        if (!text.empty())
+            text += ",";
+        text += to_string(cpus[i]);
+        if (end > i)
+            text += "-" + to_string(cpus[end]);
+        i = end;
+    }
+    return text;
+}
+
+static bool parse_cpus(const string& text, vector<int>& cpus)
+{
+    cpus.clear();
+    if (text == "any")
+        return true;
+
+    size_t pos = 0;
+    while (pos < text.length())
+    {
+        size_t comma = text.find(',', pos);
+        if (comma == string::npos)
+            comma = text.length();
+        string item = text.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        char* end;
+        long first = strtol(item.c_str(), &end, 10);
+        long last = first;
+        if (end == item.c_str())
+            return false;
+        if (*end == '-')
+        {
+            const char* range = end + 1;
+            last = strtol(range, &end, 10);
+            if (end == range)
+                return false;
+        }
+        if (*end || first < 0 || last < first || last >= 1024)
+            return false;
+        for (long cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+    sort(cpus.begin(), cpus.end());
+    cpus.erase(unique(cpus.begin(), cpus.end()), cpus.end());
+    return !cpus.empty();
+}
+
+const char* ThreadTopology::get_role_name(THREAD_ROLE role)
+{
+    return role_names[role];
+}
+
+bool ThreadTopology::configure(const string& spec, string& error)
+{
+    size_t equals = spec.find('=');
+    if (equals == string::npos)
+    {
+        error = "expected role=cpus[:priority]";
+        return false;
+    }
+
+    string role_name = spec.substr(0, equals);
+    int role = 0;
+    while (role < ROLE_COUNT && role_name != role_names[role])
+        role++;
+    if (role == ROLE_COUNT)
+    {
+        error = "unknown role '" + role_name + "'";
+        return false;
+    }
+
+    ThreadPlacement placement;
+    placement.priority = THREAD_PRIORITY::NORMAL;
+    string cpus = spec.substr(equals + 1);
+    size_t colon = cpus.find(':');
+    if (colon != string::npos)
+    {
+        string priority = cpus.substr(colon + 1);
+        cpus = cpus.substr(0, colon);
+        if (priority == "low")
+            placement.priority = THREAD_PRIORITY::LOW;
+        else if (priority == "high")
+            placement.priority = THREAD_PRIORITY::HIGH;
+        else if (priority != "normal")
+        {
+            error = "unknown priority '" + priority + "'";
+            return false;
+        }
+    }
+    if (!parse_cpus(cpus, placement.cpus))
+    {
+        error = "bad CPU list '" + cpus + "'";
+        return false;
+    }
+
+    set_placement((THREAD_ROLE)role, placement);
+    return true;
+}
+
+void ThreadTopology::set_placement(THREAD_ROLE role, const ThreadPlacement& placement)
+{
+    lock_guard<mutex> lock(topology_mutex);
+    placements[role] = placement;
+    configured = true;
+}
+
+ThreadPlacement ThreadTopology::get_placement(THREAD_ROLE role)
+{
+    lock_guard<mutex> lock(topology_mutex);
+    return placements[role];
+}
+
+bool ThreadTopology::is_configured()
+{
+    lock_guard<mutex> lock(topology_mutex);
+    return configured;
+}
+
+void ThreadTopology::print_report()
+{
+    lock_guard<mutex> lock(topology_mutex);
+    printf("[Threads] %-6s %-16s %-12s %10s %10s %7s\n", "role", "name", "cpus", "cpu (s)", "wall (s)", "usage");
+    auto now = chrono::steady_clock::now();
+    for (auto& record : records)
+    {
+        double wall = record.wall_seconds;
+        double cpu = record.cpu_seconds;
+        if (record.alive)
+        {
+            wall = chrono::duration_cast<chrono::duration<double>>(now - record.start).count();
+#ifdef __linux__
+            clockid_t clock;
+            timespec time;
+            if (!pthread_getcpuclockid(record.handle, &clock) && !clock_gettime(clock, &time))
+                cpu = time.tv_sec + time.tv_nsec / 1e9;
+#endif
+        }
+        printf("[Threads] %-6s %-16s %-12s %10.2f %10.2f %6.1f%%%s\n", role_names[record.role], record.name.c_str(),
+               record.cpus.c_str(), cpu, wall, wall > 0.0 ? cpu * 100.0 / wall : 0.0, record.alive ? "" : " (exited)");
+    }
+}
+
+ThreadRoleScope::ThreadRoleScope(THREAD_ROLE role)
+{
+    ThreadPlacement placement = ThreadTopology::get_placement(role);
+
+    ThreadRecord record;
+    record.role = role;
+    record.cpus = describe_cpus(placement.cpus);
+    record.alive = true;
+    record.start = chrono::steady_clock::now();
+    record.wall_seconds = 0.0;
+    record.cpu_seconds = 0.0;
+
+    {
+        lock_guard<mutex> lock(topology_mutex);
+        int same_role = 0;
+        for (auto& other : records)
+        {
+            if (other.role == role && other.alive)
+                same_role++;
+        }
+        //Linux limits thread names to 15 characters
+        record.name = string("dobie-") + role_names[role];
+        if (same_role)
+            record.name += to_string(same_role);
+#ifdef __linux__
+        record.handle = pthread_self();
+#endif
+        id = records.size();
+        records.push_back(record);
+    }
+
+#ifdef __linux__
+    pthread_setname_np(pthread_self(), record.name.c_str());
+
+    if (!placement.cpus.empty())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : placement.cpus)
+            CPU_SET(cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+            Errors::print_warning("[Threads] Failed to pin %s to CPUs %s\n", record.name.c_str(), record.cpus.c_str());
+    }
+
+    //Priorities are nice values of the thread alone. Raising one usually needs CAP_SYS_NICE.
+    if (placement.priority != THREAD_PRIORITY::NORMAL)
+    {
+        int nice = (placement.priority == THREAD_PRIORITY::HIGH) ? -5 : 5;
+        if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), nice))
+            Errors::print_warning("[Threads] Failed to set the priority of %s\n", record.name.c_str());
+    }
+#endif
+}
+
+ThreadRoleScope::~ThreadRoleScope()
+{
+    lock_guard<mutex> lock(topology_mutex);
+    ThreadRecord& record = records[id];
+    record.alive = false;
+    record.wall_seconds = chrono::duration_cast<chrono::duration<double>>(
+                chrono::steady_clock::now() - record.start).count();
+#ifdef __linux__
+    timespec time;
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time))
+        record.cpu_seconds = time.tv_sec + time.tv_nsec / 1e9;
+#endif
+}
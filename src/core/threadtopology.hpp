@@ -0,0 +1,65 @@
+#ifndef THREADTOPOLOGY_HPP
+#define THREADTOPOLOGY_HPP
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum THREAD_ROLE
+{
+    ROLE_CORE, //EE and everything stepped alongside it
+    ROLE_GS,
+    ROLE_VU1,
+    ROLE_IOP,
+    ROLE_IPU,
+    ROLE_AUDIO,
+    ROLE_IO, //Memory card flushing and other file work
+    ROLE_COUNT
+};
+
+enum class THREAD_PRIORITY
+{
+    NORMAL,
+    LOW,
+    HIGH
+};
+
+struct ThreadPlacement
+{
+    std::vector<int> cpus; //Empty means any CPU
+    THREAD_PRIORITY priority;
+};
+
+/**
+Process-wide table of where each kind of emulator thread should run.
+Threads don't get placed from outside: each one opens a ThreadRoleScope when it starts, which looks up the
+placement for its role, pins it to the role's CPU set, names it after the role and adjusts its priority.
+The same scope records the thread's CPU time, so that a report can show how busy each role was.
+
+Pinning and naming are only implemented on Linux. Elsewhere the roles are still tracked, but placements are ignored.
+**/
+class ThreadTopology
+{
+    public:
+        static const char* get_role_name(THREAD_ROLE role);
+
+        //Parses one role's placement, written as role=cpus[:priority], e.g. "gs=2-3,6:high".
+        //Returns false and fills in error if the spec can't be used.
+        static bool configure(const std::string& spec, std::string& error);
+        static void set_placement(THREAD_ROLE role, const ThreadPlacement& placement);
+        static ThreadPlacement get_placement(THREAD_ROLE role);
+        static bool is_configured();
+
+        //CPU time and utilization of every thread that has run under a role so far
+        static void print_report();
+};
+
+class ThreadRoleScope
+{
+    private:
+        int id;
+    public:
+        ThreadRoleScope(THREAD_ROLE role);
+        ~ThreadRoleScope();
+};
+
+#endif // THREADTOPOLOGY_HPP
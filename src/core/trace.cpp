@@ -0,0 +1,484 @@
+#include <cstring>
+#include "errors.hpp"
+#include "trace.hpp"
+
+using namespace std;
+
+#define TRACE_VERSION 1
+#define TRACE_CHUNK_COUNT 16
+
+//Largest event a stream can emit: tag, register index and two 64-bit varints
+#define TRACE_MAX_EVENT 32
+
+static const char trace_magic[8] = {'D', 'O', 'B', 'T', 'R', 'A', 'C', 'E'};
+
+static uint64_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint64_t value)
+{
+    return (int32_t)((value >> 1) ^ -(int64_t)(value & 1));
+}
+
+TraceInstructionTable::TraceInstructionTable() : PCs(TABLE_SIZE, 0xFFFFFFFF), instructions(TABLE_SIZE, 0)
+{
+
+}
+
+//Returns true if the instruction at PC differs from the last one recorded there
+bool TraceInstructionTable::update(uint32_t PC, uint64_t instr)
+{
+    int index = (PC >> 2) & (TABLE_SIZE - 1);
+    if (PCs[index] == PC && instructions[index] == instr)
+        return false;
+    PCs[index] = PC;
+    instructions[index] = instr;
+    return true;
+}
+
+uint64_t TraceInstructionTable::get(uint32_t PC)
+{
+    return instructions[(PC >> 2) & (TABLE_SIZE - 1)];
+}
+
+TraceStream::TraceStream(TraceRecorder* recorder, TRACE_UNIT unit, int flags) :
+    recorder(recorder), unit(unit), flags(flags), chunk(nullptr)
+{
+    PC_step = (unit == TRACE_VU0 || unit == TRACE_VU1) ? 8 : 4;
+    next_PC = 0;
+    run = 0;
+    memset(ee_gpr, 0, sizeof(ee_gpr));
+    memset(iop_gpr, 0, sizeof(iop_gpr));
+}
+
+TraceStream::~TraceStream()
+{
+    flush();
+}
+
+bool TraceStream::records_registers()
+{
+    return flags & TRACE_REGISTERS;
+}
+
+bool TraceStream::records_writes()
+{
+    return flags & TRACE_WRITES;
+}
+
+void TraceStream::reserve(uint32_t bytes)
+{
+    if (chunk && chunk->size + bytes <= TRACE_CHUNK_SIZE)
+        return;
+    if (chunk)
+        recorder->submit(chunk);
+    chunk = recorder->get_chunk(unit);
+}
+
+void TraceStream::put(uint8_t value)
+{
+    chunk->data[chunk->size] = value;
+    chunk->size++;
+}
+
+void TraceStream::put_varint(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        put((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    put(value);
+}
+
+void TraceStream::end_run()
+{
+    if (!run)
+        return;
+    reserve(1);
+    put(run);
+    run = 0;
+}
+
+void TraceStream::event(uint32_t PC, uint64_t instr, int instr_bytes)
+{
+    uint32_t expected_PC = next_PC;
+    bool jumped = PC != expected_PC;
+    bool changed = table.update(PC, instr);
+    next_PC = PC + PC_step;
+
+    if (!jumped && !changed)
+    {
+        run++;
+        if (run == 0x7F)
+            end_run();
+        return;
+    }
+
+    end_run();
+    reserve(TRACE_MAX_EVENT);
+    put(0x80 | (jumped ? 1 : 0) | (changed ? 2 : 0));
+    if (jumped)
+        put_varint(zigzag(PC - expected_PC));
+    if (changed)
+    {
+        for (int i = 0; i < instr_bytes; i++)
+            put(instr >> (i * 8));
+    }
+}
+
+void TraceStream::instruction(uint32_t PC, uint32_t instr)
+{
+    event(PC, instr, 4);
+}
+
+void TraceStream::vu_instruction(uint32_t PC, uint32_t upper, uint32_t lower)
+{
+    event(PC, ((uint64_t)upper << 32) | lower, 8);
+}
+
+void TraceStream::ee_registers(const uint8_t* gpr)
+{
+    for (int i = 1; i < 32; i++)
+    {
+        const uint8_t* reg = gpr + i * 16;
+        uint8_t* shadow = ee_gpr + i * 16;
+        if (!memcmp(reg, shadow, 16))
+            continue;
+        memcpy(shadow, reg, 16);
+
+        uint64_t value[2];
+        memcpy(value, reg, 16);
+        end_run();
+        reserve(TRACE_MAX_EVENT);
+        put(0x90);
+        put(i);
+        put_varint(value[0]);
+        put_varint(value[1]);
+    }
+}
+
+void TraceStream::iop_registers(const uint32_t* gpr)
+{
+    for (int i = 1; i < 32; i++)
+    {
+        if (gpr[i] == iop_gpr[i])
+            continue;
+        iop_gpr[i] = gpr[i];
+        end_run();
+        reserve(TRACE_MAX_EVENT);
+        put(0x90);
+        put(i);
+        put_varint(gpr[i]);
+    }
+}
+
+void TraceStream::write(uint32_t address, int size, const uint128_t& value)
+{
+    int shift = 0;
+    while ((1 << shift) < size)
+        shift++;
+
+    end_run();
+    reserve(TRACE_MAX_EVENT);
+    put(0xA0 | shift);
+    put_varint(address);
+    put_varint(value.lo);
+    if (size == 16)
+        put_varint(value.hi);
+}
+
+void TraceStream::flush()
+{
+    end_run();
+    if (chunk)
+    {
+        recorder->submit(chunk);
+        chunk = nullptr;
+    }
+}
+
+TraceRecorder::TraceRecorder() : stopping(false), bytes_written(0)
+{
+    for (int i = 0; i < TRACE_UNIT_COUNT; i++)
+        streams[i] = nullptr;
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    close();
+    for (auto chunk : chunks)
+        delete chunk;
+}
+
+bool TraceRecorder::open(const char* file_name, int flags)
+{
+    close();
+    file.open(file_name, ios::binary | ios::trunc);
+    if (!file.is_open())
+        return false;
+
+    uint32_t version = TRACE_VERSION;
+    file.write(trace_magic, sizeof(trace_magic));
+    file.write((char*)&version, sizeof(version));
+    file.write((char*)&flags, sizeof(flags));
+    bytes_written = 16;
+
+    if (chunks.empty())
+    {
+        for (int i = 0; i < TRACE_CHUNK_COUNT; i++)
+            chunks.push_back(new TraceChunk);
+    }
+    free_chunks = chunks;
+    pending.clear();
+    stopping = false;
+
+    for (int i = 0; i < TRACE_UNIT_COUNT; i++)
+        streams[i] = new TraceStream(this, (TRACE_UNIT)i, flags);
+    writer = thread(&TraceRecorder::writer_loop, this);
+    return true;
+}
+
+void TraceRecorder::close()
+{
+    if (!writer.joinable())
+        return;
+
+    //Streams hand their last partial chunks to the writer as they're deleted
+    for (int i = 0; i < TRACE_UNIT_COUNT; i++)
+    {
+        delete streams[i];
+        streams[i] = nullptr;
+    }
+
+    {
+        lock_guard<mutex> lock(chunk_mutex);
+        stopping = true;
+    }
+    chunk_cv.notify_all();
+    writer.join();
+    file.close();
+}
+
+TraceStream* TraceRecorder::get_stream(TRACE_UNIT unit)
+{
+    return streams[unit];
+}
+
+uint64_t TraceRecorder::get_bytes_written()
+{
+    lock_guard<mutex> lock(chunk_mutex);
+    return bytes_written;
+}
+
+TraceChunk* TraceRecorder::get_chunk(TRACE_UNIT unit)
+{
+    unique_lock<mutex> lock(chunk_mutex);
+    chunk_cv.wait(lock, [this] { return !free_chunks.empty(); });
+    TraceChunk* chunk = free_chunks.back();
+    free_chunks.pop_back();
+    chunk->unit = unit;
+    chunk->size = 0;
+    return chunk;
+}
+
+void TraceRecorder::submit(TraceChunk* chunk)
+{
+    {
+        lock_guard<mutex> lock(chunk_mutex);
+        pending.push_back(chunk);
+    }
+    chunk_cv.notify_all();
+}
+
+void TraceRecorder::writer_loop()
+{
+    unique_lock<mutex> lock(chunk_mutex);
+    while (true)
+    {
+        chunk_cv.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty())
+            break;
+
+        TraceChunk* chunk = pending.front();
+        pending.pop_front();
+        lock.unlock();
+
+        if (chunk->size)
+        {
+            uint32_t header[2] = {(uint32_t)chunk->unit, chunk->size};
+            file.write((char*)header, sizeof(header));
+            file.write((char*)chunk->data, chunk->size);
+        }
+
+        lock.lock();
+        bytes_written += chunk->size ? sizeof(uint32_t) * 2 + chunk->size : 0;
+        free_chunks.push_back(chunk);
+        chunk_cv.notify_all();
+    }
+    file.flush();
+}
+
+TraceReader::TraceReader() : flags(0), current_unit(-1)
+{
+    for (int i = 0; i < TRACE_UNIT_COUNT; i++)
+    {
+        units[i].pos = 0;
+        units[i].next_PC = 0;
+        units[i].run = 0;
+    }
+}
+
+bool TraceReader::open(const char* file_name, string& error)
+{
+    file.open(file_name, ios::binary);
+    if (!file.is_open())
+    {
+        error = "can't open file";
+        return false;
+    }
+
+    char magic[sizeof(trace_magic)];
+    uint32_t version;
+    file.read(magic, sizeof(magic));
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&flags, sizeof(flags));
+    if (!file || memcmp(magic, trace_magic, sizeof(magic)))
+    {
+        error = "not a trace file";
+        return false;
+    }
+    if (version != TRACE_VERSION)
+    {
+        error = "unsupported trace version " + to_string(version);
+        return false;
+    }
+    return true;
+}
+
+int TraceReader::get_flags()
+{
+    return flags;
+}
+
+bool TraceReader::next_chunk()
+{
+    uint32_t header[2];
+    file.read((char*)header, sizeof(header));
+    if (!file || header[0] >= TRACE_UNIT_COUNT || header[1] > TRACE_CHUNK_SIZE)
+        return false;
+
+    UnitState& state = units[header[0]];
+    state.data.resize(header[1]);
+    state.pos = 0;
+    file.read((char*)state.data.data(), header[1]);
+    if (!file)
+        return false;
+    current_unit = header[0];
+    return true;
+}
+
+uint8_t TraceReader::get(UnitState& state)
+{
+    if (state.pos >= state.data.size())
+        Errors::die("[Trace] Event runs past the end of its chunk");
+    return state.data[state.pos++];
+}
+
+uint64_t TraceReader::get_varint(UnitState& state)
+{
+    uint64_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do
+    {
+        byte = get(state);
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+bool TraceReader::next(TraceEvent& event)
+{
+    while (true)
+    {
+        if (current_unit < 0)
+        {
+            if (!next_chunk())
+                return false;
+            continue;
+        }
+
+        UnitState& state = units[current_unit];
+        TRACE_UNIT unit = (TRACE_UNIT)current_unit;
+        uint32_t PC_step = (unit == TRACE_VU0 || unit == TRACE_VU1) ? 8 : 4;
+        event.unit = unit;
+
+        if (state.run)
+        {
+            state.run--;
+            event.type = TraceEvent::INSTRUCTION;
+            event.PC = state.next_PC;
+            event.instr = state.table.get(event.PC);
+            state.next_PC += PC_step;
+            return true;
+        }
+
+        if (state.pos >= state.data.size())
+        {
+            if (!next_chunk())
+                return false;
+            continue;
+        }
+
+        uint8_t tag = get(state);
+        if (tag < 0x80)
+        {
+            state.run = tag;
+            continue;
+        }
+
+        if (tag <= 0x83)
+        {
+            event.type = TraceEvent::INSTRUCTION;
+            event.PC = state.next_PC;
+            if (tag & 1)
+                event.PC += unzigzag(get_varint(state));
+            if (tag & 2)
+            {
+                event.instr = 0;
+                for (uint32_t i = 0; i < PC_step; i++)
+                    event.instr |= (uint64_t)get(state) << (i * 8);
+                state.table.update(event.PC, event.instr);
+            }
+            else
+                event.instr = state.table.get(event.PC);
+            state.next_PC = event.PC + PC_step;
+            return true;
+        }
+
+        if (tag == 0x90)
+        {
+            event.type = TraceEvent::REGISTER;
+            event.index = get(state);
+            event.value.lo = get_varint(state);
+            event.value.hi = (unit == TRACE_EE) ? get_varint(state) : 0;
+            return true;
+        }
+
+        if (tag >= 0xA0 && tag <= 0xA4)
+        {
+            event.type = TraceEvent::WRITE;
+            event.index = 1 << (tag & 7);
+            event.address = get_varint(state);
+            event.value.lo = get_varint(state);
+            event.value.hi = (event.index == 16) ? get_varint(state) : 0;
+            return true;
+        }
+
+        Errors::die("[Trace] Unknown event tag $%02X", tag);
+    }
+}
@@ -0,0 +1,190 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "int128.hpp"
+
+enum TRACE_UNIT
+{
+    TRACE_EE,
+    TRACE_IOP,
+    TRACE_VU0,
+    TRACE_VU1,
+    TRACE_UNIT_COUNT
+};
+
+enum TRACE_FLAGS
+{
+    TRACE_REGISTERS = 1 << 0, //GPR deltas after every EE/IOP instruction
+    TRACE_WRITES = 1 << 1 //EE/IOP memory writes
+};
+
+/**
+~ Trace format ~
+A trace file is an 16-byte header ("DOBTRACE", version, flags) followed by chunks. Every chunk starts with
+the unit it belongs to and its payload size. A unit's chunks appear in order, but chunks of different units
+are interleaved as they fill up.
+
+The payload is a stream of events, each starting with a tag byte:
+$01-$7F - that many instructions, each at the PC following the last one, and each the same instruction
+          that was last seen at its PC. This is what hot loops compress down to.
+$80-$83 - one instruction. Bit 0 means the PC didn't follow (a zigzag varint of the PC minus the expected PC
+          follows), bit 1 means the instruction changed (4 raw bytes follow, 8 for a VU upper/lower pair).
+$90     - GPR delta. Register index, then the new value as varints (lo, then hi on the EE).
+$A0-$A4 - memory write of 1 << (tag & 7) bytes. Address as a varint, then the value as varints (lo, then hi for 128-bit).
+
+"Same instruction" is tracked with a direct-mapped table indexed by PC. The decoder keeps an identical table,
+so the two always agree on which instructions need to be spelled out.
+**/
+
+#define TRACE_CHUNK_SIZE (1024 * 256)
+
+struct TraceChunk
+{
+    TRACE_UNIT unit;
+    uint32_t size;
+    uint8_t data[TRACE_CHUNK_SIZE];
+};
+
+//Direct-mapped table of the last instruction seen at each PC, shared by the encoder and decoder
+class TraceInstructionTable
+{
+    private:
+        static const int TABLE_SIZE = 1 << 16;
+        std::vector<uint32_t> PCs;
+        std::vector<uint64_t> instructions;
+    public:
+        TraceInstructionTable();
+        bool update(uint32_t PC, uint64_t instr);
+        uint64_t get(uint32_t PC);
+};
+
+class TraceRecorder;
+
+/**
+Encodes the events of one unit into chunks handed out by the recorder.
+Only ever used from the thread that runs the unit.
+**/
+class TraceStream
+{
+    private:
+        TraceRecorder* recorder;
+        TRACE_UNIT unit;
+        int flags;
+        TraceChunk* chunk;
+
+        uint32_t PC_step;
+        uint32_t next_PC;
+        int run;
+        TraceInstructionTable table;
+
+        uint8_t ee_gpr[32 * sizeof(uint64_t) * 2];
+        uint32_t iop_gpr[32];
+
+        void reserve(uint32_t bytes);
+        void put(uint8_t value);
+        void put_varint(uint64_t value);
+        void end_run();
+        void event(uint32_t PC, uint64_t instr, int instr_bytes);
+    public:
+        TraceStream(TraceRecorder* recorder, TRACE_UNIT unit, int flags);
+        ~TraceStream();
+
+        bool records_registers();
+        bool records_writes();
+
+        void instruction(uint32_t PC, uint32_t instr);
+        void vu_instruction(uint32_t PC, uint32_t upper, uint32_t lower);
+        void ee_registers(const uint8_t* gpr);
+        void iop_registers(const uint32_t* gpr);
+        void write(uint32_t address, int size, const uint128_t& value);
+        void flush();
+};
+
+/**
+Owns the trace file and a fixed ring of chunks. Streams fill chunks on the emulation thread; full chunks are
+written out by a background thread and then go back into the ring. If the writer falls behind, a stream waits
+for a free chunk rather than dropping events, so a trace is always complete.
+**/
+class TraceRecorder
+{
+    private:
+        std::ofstream file;
+        TraceStream* streams[TRACE_UNIT_COUNT];
+
+        std::vector<TraceChunk*> chunks;
+        std::vector<TraceChunk*> free_chunks;
+        std::deque<TraceChunk*> pending;
+        std::mutex chunk_mutex;
+        std::condition_variable chunk_cv;
+        bool stopping;
+        uint64_t bytes_written;
+        std::thread writer;
+
+        void writer_loop();
+    public:
+        TraceRecorder();
+        ~TraceRecorder();
+
+        bool open(const char* file_name, int flags);
+        void close();
+        TraceStream* get_stream(TRACE_UNIT unit);
+        uint64_t get_bytes_written();
+
+        TraceChunk* get_chunk(TRACE_UNIT unit);
+        void submit(TraceChunk* chunk);
+};
+
+struct TraceEvent
+{
+    enum
+    {
+        INSTRUCTION,
+        REGISTER,
+        WRITE
+    } type;
+    TRACE_UNIT unit;
+    uint32_t PC;
+    uint64_t instr; //VU: upper << 32 | lower
+    int index; //Register index, or write size
+    uint32_t address;
+    uint128_t value;
+};
+
+//Reads events back out of a trace file, in file order
+class TraceReader
+{
+    private:
+        std::ifstream file;
+        int flags;
+
+        struct UnitState
+        {
+            std::vector<uint8_t> data;
+            size_t pos;
+            uint32_t next_PC;
+            int run;
+            TraceInstructionTable table;
+        };
+        UnitState units[TRACE_UNIT_COUNT];
+        int current_unit;
+
+        bool next_chunk();
+        uint8_t get(UnitState& state);
+        uint64_t get_varint(UnitState& state);
+    public:
+        TraceReader();
+
+        bool open(const char* file_name, std::string& error);
+        int get_flags();
+        bool next(TraceEvent& event);
+};
+
+#endif // TRACE_HPP
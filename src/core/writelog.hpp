@@ -0,0 +1,18 @@
+#ifndef WRITELOG_HPP
+#define WRITELOG_HPP
+#include <cstdint>
+#include <vector>
+
+#include "int128.hpp"
+
+//A store made by a CPU, recorded while lockstep testing
+struct LoggedWrite
+{
+    uint32_t address;
+    int size;
+    uint128_t value;
+};
+
+typedef std::vector<LoggedWrite> WriteLog;
+
+#endif // WRITELOG_HPP
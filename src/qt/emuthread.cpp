@@ -3,6 +3,7 @@
 #include <fstream>
 
 #include "emuthread.hpp"
+#include "../core/threadtopology.hpp"
 
 using namespace std;
 
@@ -12,6 +13,7 @@ EmuThread::EmuThread()
     pause_status = 0x0;
     gsdump_reading = false;
     frame_advance = false;
+    e.open_ee_log("ee_log.txt");
 }
 
 void EmuThread::reset()
@@ -49,6 +51,53 @@ void EmuThread::load_CDVD(const char* name)
     load_mutex.unlock();
 }
 
+bool EmuThread::load_memcard(const char* name)
+{
+    load_mutex.lock();
+    bool success = e.load_memcard(name);
+    load_mutex.unlock();
+    return success;
+}
+
+bool EmuThread::start_trace(const char* name, int flags)
+{
+    load_mutex.lock();
+    bool success = e.start_trace(name, flags);
+    load_mutex.unlock();
+    return success;
+}
+
+void EmuThread::start_profile(const char* name)
+{
+    load_mutex.lock();
+    e.start_profile(name);
+    load_mutex.unlock();
+}
+
+bool EmuThread::start_draw_stats(const char* name, bool heatmap)
+{
+    load_mutex.lock();
+    bool success = e.start_draw_stats(name, heatmap);
+    load_mutex.unlock();
+    return success;
+}
+
+bool EmuThread::start_hash_log(const char* name)
+{
+    load_mutex.lock();
+    bool success = e.start_hash_log(name);
+    load_mutex.unlock();
+    return success;
+}
+
+bool EmuThread::load_symbols(PROFILE_UNIT unit, const char* name, uint32_t base, std::string& error)
+{
+    load_mutex.lock();
+    bool success = e.load_symbols(unit, name, base, error);
+    load_mutex.unlock();
+    return success;
+}
+
 bool EmuThread::load_state(const char *name)
 {
     load_mutex.lock();
@@ -166,6 +215,7 @@ void EmuThread::gsdump_run()
 
 void EmuThread::run()
 {
+    ThreadRoleScope role(ROLE_CORE);
     forever
     {
         QMutexLocker locker(&emu_mutex);
@@ -221,18 +271,15 @@ void EmuThread::shutdown()
     pause_mutex.unlock();
 }
 
+//Pad input goes through a lock-free mailbox, so there's no need to synchronize with the emulation thread here
 void EmuThread::press_key(PAD_BUTTON button)
 {
-    pause_mutex.lock();
     e.press_button(button);
-    pause_mutex.unlock();
 }
 
 void EmuThread::release_key(PAD_BUTTON button)
 {
-    pause_mutex.lock();
     e.release_button(button);
-    pause_mutex.unlock();
 }
 
 void EmuThread::pause(PAUSE_EVENT event)
@@ -40,6 +40,12 @@ class EmuThread : public QThread
         void load_BIOS(uint8_t* BIOS);
         void load_ELF(uint8_t* ELF, uint64_t ELF_size);
         void load_CDVD(const char* name);
+        bool load_memcard(const char* name);
+        bool start_trace(const char* name, int flags);
+        void start_profile(const char* name);
+        bool start_draw_stats(const char* name, bool heatmap);
+        bool start_hash_log(const char* name);
+        bool load_symbols(PROFILE_UNIT unit, const char* name, uint32_t base, std::string& error);
 
         bool load_state(const char* name);
         bool save_state(const char* name);
@@ -1,6 +1,7 @@
 #include <cmath>
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 #include <QApplication>
 #include <QPainter>
@@ -11,6 +12,8 @@
 #include <QMessageBox>
 
 #include "emuwindow.hpp"
+#include "../core/threadtopology.hpp"
+#include "../core/trace.hpp"
 
 #include "arg.h"
 
@@ -72,9 +75,16 @@ EmuWindow::EmuWindow(QWidget *parent) : QMainWindow(parent)
 int EmuWindow::init(int argc, char** argv)
 {
     bool skip_BIOS = false;
+    int trace_flags = 0;
     char* argv0; // Program name; AKA argv[0]
 
-    char* bios_name = nullptr, *file_name = nullptr, *gsdump = nullptr;
+    char* bios_name = nullptr, *file_name = nullptr, *gsdump = nullptr, *memcard_name = nullptr;
+    char* trace_name = nullptr;
+    char* profile_name = nullptr;
+    char* draw_stats_name = nullptr;
+    bool draw_heatmap = false;
+    char* hash_log_name = nullptr;
+    vector<const char*> symbol_files;
 
     // Load before the arguments, so the arguments override the config.
     Settings::load();
@@ -96,6 +106,43 @@ int EmuWindow::init(int argc, char** argv)
         case 'g':
             gsdump = ARGF();
             break;
+        case 'm':
+            memcard_name = ARGF();
+            break;
+        case 'r':
+            trace_name = ARGF();
+            trace_flags = 0;
+            break;
+        case 'R':
+            trace_name = ARGF();
+            trace_flags = TRACE_REGISTERS | TRACE_WRITES;
+            break;
+        case 'p':
+            profile_name = ARGF();
+            break;
+        case 'y':
+            symbol_files.push_back(ARGF());
+            break;
+        case 'S':
+            draw_stats_name = ARGF();
+            break;
+        case 'H':
+            draw_heatmap = true;
+            break;
+        case 'd':
+            hash_log_name = ARGF();
+            break;
+        case 'T':
+        {
+            string error;
+            const char* spec = ARGF();
+            if (!ThreadTopology::configure(spec, error))
+            {
+                printf("Bad thread placement %s: %s\n", spec, error.c_str());
+                return 1;
+            }
+            break;
+        }
         case 'h':
         default:
             printf("usage: %s [options]\n\n", argv0);
@@ -105,6 +152,16 @@ int EmuWindow::init(int argc, char** argv)
             printf("-h\t\tshow this message\n");
             printf("-s\t\tskip BIOS\n");
             printf("-g {.GSD}\t\trun a gsdump\n");
+            printf("-m {.PS2}\t\tinsert a memory card image (created if missing)\n");
+            printf("-r {file}\trecord an execution trace of the EE, IOP and VUs (read it with DobieTrace)\n");
+            printf("-R {file}\tlike -r, but also record register changes and memory writes\n");
+            printf("-p {file}\tsample the EE, IOP and VUs; writes flamegraph stacks to file and a flat profile to file.txt\n");
+            printf("-y {ee/iop:ELF[@address]}\tload symbols for -p, e.g. iop:module.irx@0x40000 (may be repeated)\n");
+            printf("-S {file}\tlog GS primitive, pixel, texel and transfer counts per frame to file as CSV\n");
+            printf("-H\t\twith -S, also write a heatmap of how often each pixel was drawn to file.pgm\n");
+            printf("-d {file}\tlog a hash of the machine state and of each part of it per frame to file as CSV\n");
+            printf("-T {role=cpus[:priority]}\tpin a thread role (core, gs, vu1, iop, ipu, audio, io) to CPUs, e.g. gs=2-3:high\n");
+            printf("\t\tmay be repeated; a per-thread CPU usage report is printed on exit\n");
             return 1;
     } ARGEND
 
@@ -137,6 +194,29 @@ int EmuWindow::init(int argc, char** argv)
     delete[] BIOS;
     BIOS = nullptr;
 
+    if (memcard_name && !emu_thread.load_memcard(memcard_name))
+        printf("Failed to load memory card from %s\n", memcard_name);
+
+    if (trace_name && !emu_thread.start_trace(trace_name, trace_flags))
+        printf("Failed to open trace file %s\n", trace_name);
+
+    if (profile_name)
+    {
+        emu_thread.start_profile(profile_name);
+        for (const char* spec : symbol_files)
+        {
+            string error;
+            if (!load_symbol_file(spec, error))
+                printf("Failed to load symbols from %s: %s\n", spec, error.c_str());
+        }
+    }
+
+    if (draw_stats_name && !emu_thread.start_draw_stats(draw_stats_name, draw_heatmap))
+        printf("Failed to open draw stats file %s\n", draw_stats_name);
+
+    if (hash_log_name && !emu_thread.start_hash_log(hash_log_name))
+        printf("Failed to open state hash file %s\n", hash_log_name);
+
     // Save at the end of init, so our arguments are saved.
     Settings::save();
 
@@ -154,6 +234,41 @@ int EmuWindow::run_gsdump(const char* file_name)
     emu_thread.unpause(PAUSE_EVENT::GAME_NOT_LOADED);
     return 0;
 }
+
+//spec is unit:file, optionally followed by @address for modules that aren't linked to a fixed address
+bool EmuWindow::load_symbol_file(const char* spec, string& error)
+{
+    string text = spec;
+    size_t colon = text.find(':');
+    if (colon == string::npos)
+    {
+        error = "expected ee:file or iop:file";
+        return false;
+    }
+
+    string unit_name = text.substr(0, colon);
+    PROFILE_UNIT unit;
+    if (unit_name == "ee")
+        unit = PROFILE_EE;
+    else if (unit_name == "iop")
+        unit = PROFILE_IOP;
+    else
+    {
+        error = "unknown unit '" + unit_name + "'";
+        return false;
+    }
+
+    string file_name = text.substr(colon + 1);
+    uint32_t base = 0;
+    size_t at = file_name.rfind('@');
+    if (at != string::npos)
+    {
+        base = strtoul(file_name.c_str() + at + 1, nullptr, 0);
+        file_name = file_name.substr(0, at);
+    }
+    return emu_thread.load_symbols(unit, file_name.c_str(), base, error);
+}
+
 int EmuWindow::load_exec(const char* file_name, bool skip_BIOS)
 {
     ifstream exec_file(file_name, ios::binary | ios::in);
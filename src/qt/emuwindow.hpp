@@ -36,6 +36,7 @@ class EmuWindow : public QMainWindow
         int init(int argc, char** argv);
         int load_exec(const char* file_name, bool skip_BIOS);
         int run_gsdump(const char* file_name);
+        bool load_symbol_file(const char* spec, std::string& error);
 
         void create_menu();
 
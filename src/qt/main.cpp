@@ -1,5 +1,6 @@
 #include <QApplication>
 #include "emuwindow.hpp"
+#include "../core/threadtopology.hpp"
 
 using namespace std;
 
@@ -10,5 +11,7 @@ int main(int argc, char** argv)
     if (window->init(argc, argv))
         return 1;
     a.exec();
+    if (ThreadTopology::is_configured())
+        ThreadTopology::print_report();
     return 0;
 }
@@ -0,0 +1,99 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../core/lockstep.hpp"
+
+using namespace std;
+
+//Headless runner for the lockstep harness, for scripts and CI
+
+//Exit codes, so that automation can tell a divergence from a run that never got going
+#define EXIT_MATCH 0
+#define EXIT_DIVERGED 1
+#define EXIT_SETUP_ERROR 2
+
+static void usage(const char* name)
+{
+    printf("usage: %s [options] -b {BIOS} -l {frames}\n\n", name);
+    printf("Runs two emulators in lockstep and reports the first divergence.\n");
+    printf("Exits with %d if both sides matched, %d if they diverged and %d if the run couldn't be set up.\n\n",
+           EXIT_MATCH, EXIT_DIVERGED, EXIT_SETUP_ERROR);
+    printf("options:\n");
+    printf("-b {BIOS}\tspecify BIOS\n");
+    printf("-f {ELF/ISO}\tspecify ELF/ISO\n");
+    printf("-s\t\tskip BIOS\n");
+    printf("-l {frames}\tframes to run\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* BIOS_name = nullptr;
+    const char* file_name = nullptr;
+    bool skip_BIOS = false;
+    int frames = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-b") && i + 1 < argc)
+            BIOS_name = argv[++i];
+        else if (!strcmp(argv[i], "-f") && i + 1 < argc)
+            file_name = argv[++i];
+        else if (!strcmp(argv[i], "-s"))
+            skip_BIOS = true;
+        else if (!strcmp(argv[i], "-l") && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else
+        {
+            usage(argv[0]);
+            return EXIT_SETUP_ERROR;
+        }
+    }
+    if (!BIOS_name || frames <= 0)
+    {
+        usage(argv[0]);
+        return EXIT_SETUP_ERROR;
+    }
+
+    vector<uint8_t> BIOS(1024 * 1024 * 4);
+    ifstream BIOS_file(BIOS_name, ios::binary | ios::in);
+    BIOS_file.read((char*)BIOS.data(), BIOS.size());
+    if (!BIOS_file.is_open() || !BIOS_file.good())
+    {
+        printf("Failed to load PS2 BIOS from %s\n", BIOS_name);
+        return EXIT_SETUP_ERROR;
+    }
+
+    try
+    {
+        LockstepHarness harness;
+        harness.load_BIOS(BIOS.data());
+        harness.reset();
+
+        string error;
+        if (file_name && !harness.load_exec(file_name, skip_BIOS, error))
+        {
+            printf("%s\n", error.c_str());
+            return EXIT_SETUP_ERROR;
+        }
+
+        if (!harness.run_frames(frames))
+        {
+            printf("[Lockstep] %s", harness.get_report().c_str());
+            return EXIT_DIVERGED;
+        }
+        printf("[Lockstep] No divergence in %d frames (%llu slices)\n", frames,
+               (unsigned long long)harness.get_slices());
+        return EXIT_MATCH;
+    }
+    catch (runtime_error& e)
+    {
+        printf("Lockstep run aborted: %s\n", e.what());
+        return EXIT_SETUP_ERROR;
+    }
+}
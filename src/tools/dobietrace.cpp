@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include "../core/ee/emotion.hpp"
+#include "../core/ee/emotiondisasm.hpp"
+#include "../core/ee/vu_disasm.hpp"
+#include "../core/iop/iop.hpp"
+#include "../core/trace.hpp"
+
+using namespace std;
+
+//Offline reader for the execution traces recorded with DobieStation -r/-R
+
+static const char* unit_names[TRACE_UNIT_COUNT] = {"EE", "IOP", "VU0", "VU1"};
+static const char* unit_options[TRACE_UNIT_COUNT] = {"ee", "iop", "vu0", "vu1"};
+
+static void usage(const char* name)
+{
+    printf("usage: %s [options] {trace}\n\n", name);
+    printf("options:\n");
+    printf("-u {ee/iop/vu0/vu1}\tonly show one unit (may be repeated)\n");
+    printf("-s {count}\tskip the first count events\n");
+    printf("-n {count}\tstop after count events\n");
+    printf("-H {count}\tinstead of a listing, print the count most executed PCs of each unit\n");
+}
+
+static string disassemble(const TraceEvent& event)
+{
+    switch (event.unit)
+    {
+        case TRACE_EE:
+        case TRACE_IOP:
+            return EmotionDisasm::disasm_instr(event.instr, event.PC);
+        default:
+        {
+            uint32_t upper = event.instr >> 32;
+            uint32_t lower = event.instr & 0xFFFFFFFF;
+            return VU_Disasm::upper(event.PC, upper) + " | " + VU_Disasm::lower(event.PC, lower);
+        }
+    }
+}
+
+static void print_event(const TraceEvent& event)
+{
+    const char* unit = unit_names[event.unit];
+    switch (event.type)
+    {
+        case TraceEvent::INSTRUCTION:
+            if (event.unit == TRACE_VU0 || event.unit == TRACE_VU1)
+            {
+                printf("[%s] [$%04X] $%08X:$%08X - %s\n", unit, event.PC, (uint32_t)(event.instr >> 32),
+                       (uint32_t)event.instr, disassemble(event).c_str());
+            }
+            else
+                printf("[%s] [$%08X] $%08X - %s\n", unit, event.PC, (uint32_t)event.instr, disassemble(event).c_str());
+            break;
+        case TraceEvent::REGISTER:
+        {
+            const char* name = (event.unit == TRACE_EE) ? EmotionEngine::REG(event.index) : IOP::REG(event.index);
+            if (event.unit == TRACE_EE)
+                printf("[%s]     %s = $%016llX_%016llX\n", unit, name,
+                       (unsigned long long)event.value.hi, (unsigned long long)event.value.lo);
+            else
+                printf("[%s]     %s = $%08X\n", unit, name, (uint32_t)event.value.lo);
+            break;
+        }
+        case TraceEvent::WRITE:
+            if (event.index == 16)
+                printf("[%s]     write128 [$%08X] = $%016llX_%016llX\n", unit, event.address,
+                       (unsigned long long)event.value.hi, (unsigned long long)event.value.lo);
+            else
+                printf("[%s]     write%d [$%08X] = $%llX\n", unit, event.index * 8, event.address,
+                       (unsigned long long)event.value.lo);
+            break;
+    }
+}
+
+static void print_histogram(map<uint32_t, uint64_t>* counts, map<uint32_t, uint64_t>* instrs, int top)
+{
+    for (int unit = 0; unit < TRACE_UNIT_COUNT; unit++)
+    {
+        if (counts[unit].empty())
+            continue;
+
+        uint64_t total = 0;
+        vector<pair<uint64_t, uint32_t>> sorted;
+        for (auto& count : counts[unit])
+        {
+            total += count.second;
+            sorted.push_back({count.second, count.first});
+        }
+        sort(sorted.begin(), sorted.end(), [](const pair<uint64_t, uint32_t>& a, const pair<uint64_t, uint32_t>& b)
+        {
+            return a.first > b.first;
+        });
+
+        printf("%s: %llu instructions, %zu distinct PCs\n", unit_names[unit], (unsigned long long)total, sorted.size());
+        for (int i = 0; i < top && i < (int)sorted.size(); i++)
+        {
+            TraceEvent event;
+            event.unit = (TRACE_UNIT)unit;
+            event.PC = sorted[i].second;
+            event.instr = instrs[unit][event.PC];
+            printf("  %12llu %6.2f%%  [$%08X] %s\n", (unsigned long long)sorted[i].first,
+                   sorted[i].first * 100.0 / total, event.PC, disassemble(event).c_str());
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* file_name = nullptr;
+    bool show_unit[TRACE_UNIT_COUNT] = {false};
+    bool filtered = false;
+    uint64_t skip = 0, limit = UINT64_MAX;
+    int histogram = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-u") && i + 1 < argc)
+        {
+            const char* name = argv[++i];
+            int unit = 0;
+            while (unit < TRACE_UNIT_COUNT && strcmp(name, unit_options[unit]))
+                unit++;
+            if (unit == TRACE_UNIT_COUNT)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            show_unit[unit] = true;
+            filtered = true;
+        }
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            skip = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            limit = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "-H") && i + 1 < argc)
+            histogram = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && !file_name)
+            file_name = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!file_name)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    TraceReader reader;
+    string error;
+    if (!reader.open(file_name, error))
+    {
+        printf("Failed to open %s: %s\n", file_name, error.c_str());
+        return 1;
+    }
+
+    map<uint32_t, uint64_t> counts[TRACE_UNIT_COUNT];
+    map<uint32_t, uint64_t> instrs[TRACE_UNIT_COUNT];
+    TraceEvent event;
+    uint64_t seen = 0, shown = 0;
+    try
+    {
+        while (shown < limit && reader.next(event))
+        {
+            if (filtered && !show_unit[event.unit])
+                continue;
+            if (seen++ < skip)
+                continue;
+            shown++;
+
+            if (!histogram)
+                print_event(event);
+            else if (event.type == TraceEvent::INSTRUCTION)
+            {
+                counts[event.unit][event.PC]++;
+                instrs[event.unit][event.PC] = event.instr;
+            }
+        }
+    }
+    catch (runtime_error& err)
+    {
+        printf("Trace is corrupt: %s\n", err.what());
+        return 1;
+    }
+
+    if (histogram)
+        print_histogram(counts, instrs, histogram);
+    return 0;
+}